@@ -314,6 +314,7 @@ typedef struct {
 
 extern at_callback_t at_callback;
 extern AT_ERROR_CODE at_init(at_callback_t *cb);
+extern AT_ERROR_CODE at_init_uart(at_callback_t *cb, UART_ID uart_id);
 extern AT_ERROR_CODE at_parse(void);
 extern s32 at_event(s32 idx);
 extern s32 at_serial(at_serial_para_t *ppara);
@@ -31,6 +31,8 @@
 #define _AT_QUEUE_H_
 
 #include "atcmd/at_types.h"
+#include "kernel/os/os_ring.h"
+#include "driver/chip/hal_uart.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,12 +45,16 @@ typedef enum {
 	AQEC_FULL
 } AT_QUEUE_ERROR_CODE;
 
+/*
+ * Byte ring between a single producer and the AT parser, see OS_Ring_t. The
+ * producer is either the callback, called by the consumer when the queue is
+ * empty, or an ISR with at_queue_write(), e.g. the UART RX interrupt set by
+ * at_queue_init_uart(). The consumer blocks in
+ * at_queue_wait() until the producer writes data.
+ */
 typedef struct {
-	u8 *qbuf;
-	s32 qsize;
-	s32 qcnt;
-	s32 ridx;
-	s32 widx;
+	OS_Ring_t ring;
+	u32 overflow;        /* bytes dropped by at_queue_write() */
 } at_queue_t;
 
 typedef s32 (*at_queue_callback_t)(u8 *buf, s32 size);
@@ -56,6 +62,14 @@ typedef s32 (*at_queue_callback_t)(u8 *buf, s32 size);
 extern s32 at_queue_init(void *buf, s32 size, at_queue_callback_t cb);
 extern AT_QUEUE_ERROR_CODE at_queue_get(u8 *element);
 extern AT_QUEUE_ERROR_CODE at_queue_peek(u8 *element);
+extern s32 at_queue_read(u8 *buf, s32 size);
+extern s32 at_queue_read_line(u8 *buf, s32 size, s32 *eol);
+extern s32 at_queue_wait(OS_Time_t waitMS);
+
+/* producer side */
+extern s32 at_queue_write(const u8 *buf, s32 size);
+extern s32 at_queue_init_uart(UART_ID uart_id, void *buf, s32 size);
+extern void at_queue_deinit_uart(UART_ID uart_id);
 
 #ifdef __cplusplus
 }
@@ -60,6 +60,11 @@ struct audio_filter {
 	void  (*filter_destroy)(void *handle);
 	void  (*filter_process)(void *handle, short *buf, int sample_nums);
 
+	//audio filter statistics, cpu cycles of filter_process
+	uint32_t process_cnt;
+	uint64_t process_cycles;
+	uint32_t process_max_cycles;
+
 	//audio filter node
 	struct list_head node;
 };
@@ -69,6 +74,7 @@ struct audio_filter {
 
 int audio_filter_register(Snd_Card_Num card_num, Audio_Filter_Type filter_type, void *user_params);
 int audio_filter_unregister(Snd_Card_Num card_num, Audio_Filter_Type filter_type);
+void audio_filter_show(Snd_Card_Num card_num);
 
 
 /********************************* Audio PCM interface *************************************/
@@ -78,6 +84,20 @@ int snd_pcm_deinit(void);
 int snd_pcm_write(Snd_Card_Num card_num, void *data, uint32_t count);
 int snd_pcm_read(Snd_Card_Num card_num, void *data, uint32_t count);
 int snd_pcm_flush(Snd_Card_Num card_num);
+
+/*
+ * Zero copy interface, process the samples in place in the pcm cache.
+ * peek returns the bytes available at *data (captured data for read,
+ * free space for write), commit consumes/queues count bytes of it.
+ * Do not mix with snd_pcm_read/snd_pcm_write between peek and commit.
+ * Write peek/commit take the same lock as snd_pcm_write/flush/close, but
+ * the peeked space is only valid until snd_pcm_close(), so peek and commit
+ * must be called by the thread that writes and closes the stream.
+ */
+int snd_pcm_read_peek(Snd_Card_Num card_num, void **data);
+int snd_pcm_read_commit(Snd_Card_Num card_num, uint32_t count);
+int snd_pcm_write_peek(Snd_Card_Num card_num, void **data);
+int snd_pcm_write_commit(Snd_Card_Num card_num, uint32_t count);
 int snd_pcm_open(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir, struct pcm_config *pcm_cfg);
 int snd_pcm_close(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir);
 
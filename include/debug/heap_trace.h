@@ -56,6 +56,7 @@ void psram_heap_trace_info_get(heap_info_t *info);
 
 void heap_trace_info_show(int verbose);
 void heap_trace_info_get(heap_info_t *info);
+void heap_trace_site_show(int verbose);
 
 int heap_trace_malloc(void *ptr, size_t size);
 int heap_trace_free(void *ptr);
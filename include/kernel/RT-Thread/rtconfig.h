@@ -39,6 +39,32 @@
 #define RT_USING_IDLE_HOOK
 #endif
 
+#ifdef CONFIG_RT_USING_CPU_USAGE
+#define RT_USING_CPU_USAGE
+#define RT_CPU_USAGE_WIN_NUM       4
+#endif
+
+#ifdef CONFIG_RT_USING_THREAD_PROFILE
+#define RT_USING_THREAD_PROFILE
+#endif
+
+#ifdef CONFIG_RT_USING_MUTEX_STATS
+#define RT_USING_MUTEX_STATS
+#endif
+
+#if defined(RT_USING_CPU_USAGE) || defined(RT_USING_THREAD_PROFILE) || \
+    defined(RT_USING_MUTEX_STATS)
+#define RT_USING_CYCLE_COUNTER
+#endif
+
+#ifdef CONFIG_RT_USING_TIMER_WHEEL
+#define RT_USING_TIMER_WHEEL
+#endif
+
+#ifdef CONFIG_RT_USING_TICKLESS
+#define RT_USING_TICKLESS
+#endif
+
 #ifdef CONFIG_RT_USING_TIMER_SOFT
 #define RT_USING_TIMER_SOFT
 #define RT_TIMER_THREAD_PRIO       CONFIG_RT_TIMER_THREAD_PRIO
@@ -73,6 +99,10 @@
 #define RT_USING_SMALL_MEM
 #endif
 
+#ifdef CONFIG_RT_USING_TLSF
+#define RT_USING_TLSF
+#endif
+
 #ifdef CONFIG_RT_USING_TINY_SIZE
 #define RT_USING_TINY_SIZE
 #endif
@@ -524,6 +524,20 @@ struct rt_thread
     void (*cleanup)(struct rt_thread *tid);             /**< cleanup function when thread exit */
 
     rt_uint32_t user_data;                              /**< private user data beyond this thread */
+
+#ifdef RT_USING_CPU_USAGE
+    rt_uint64_t run_cycles;                             /**< cpu cycles the thread has run */
+    rt_uint64_t usage_last;                             /**< run_cycles at the last usage sample */
+    rt_uint32_t usage_win[RT_CPU_USAGE_WIN_NUM];        /**< cycles run in each sample period */
+#endif
+
+#ifdef RT_USING_THREAD_PROFILE
+    rt_uint64_t prof_latency_sum;                       /**< sum of ready to running cycles */
+    rt_uint32_t prof_latency_max;                       /**< max ready to running cycles */
+    rt_uint32_t prof_ready;                             /**< cycle count when made ready */
+    rt_uint32_t prof_runs;                              /**< times switched in */
+    rt_uint32_t prof_preempts;                          /**< times switched out while ready */
+#endif
 };
 typedef struct rt_thread *rt_thread_t;
 
@@ -585,6 +599,16 @@ struct rt_mutex
     rt_uint8_t           hold;                          /**< numbers of thread hold the mutex */
 
     struct rt_thread    *owner;                         /**< current owner of mutex */
+
+#ifdef RT_USING_MUTEX_STATS
+    rt_uint64_t          stat_wait_sum;                 /**< sum of wait cycles */
+    rt_uint32_t          stat_wait_max;                 /**< max wait cycles */
+    rt_uint32_t          stat_hold_max;                 /**< max hold cycles */
+    rt_uint32_t          stat_hold_start;               /**< cycle count when taken */
+    rt_uint32_t          stat_acquires;                 /**< times taken, not nested */
+    rt_uint32_t          stat_contended;                /**< times it had to wait */
+    struct rt_thread    *stat_last_owner;               /**< last thread taken it */
+#endif
 };
 typedef struct rt_mutex *rt_mutex_t;
 #endif
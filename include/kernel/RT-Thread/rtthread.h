@@ -76,6 +76,9 @@ void rt_system_tick_init(void);
 rt_tick_t rt_tick_get(void);
 void rt_tick_set(rt_tick_t tick);
 void rt_tick_increase(void);
+#ifdef RT_USING_TICKLESS
+void rt_tick_step(rt_tick_t ticks);
+#endif
 rt_tick_t  rt_tick_from_millisecond(rt_int32_t ms);
 
 void rt_system_timer_init(void);
@@ -181,6 +184,13 @@ rt_uint16_t rt_critical_level(void);
 void rt_scheduler_sethook(void (*hook)(rt_thread_t from, rt_thread_t to));
 #endif
 
+#ifdef RT_USING_CPU_USAGE
+void rt_cpu_usage_update(void);
+void rt_cpu_usage_add(rt_uint32_t cycles);
+rt_uint64_t rt_cpu_usage_cycles(void);
+rt_uint32_t rt_cpu_usage_switches(void);
+#endif
+
 /**@}*/
 
 /**
@@ -36,5 +36,6 @@
 #include "kernel/os/os_semaphore.h"
 #include "kernel/os/os_mutex.h"
 #include "kernel/os/os_timer.h"
+#include "kernel/os/os_ring.h"
 
 #endif /* _KERNEL_OS_OS_H_ */
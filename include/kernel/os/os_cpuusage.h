@@ -36,10 +36,38 @@
 extern "C" {
 #endif
 
+#define OS_CPUUSAGE_NAME_MAX    16
+
+/* cpu usage of the system, in the last window */
+typedef struct OS_CpuUsageInfo {
+	uint16_t usage;         /* busy, in permille */
+	uint16_t idle;          /* idle, in permille */
+	uint16_t overhead;      /* cost of the accounting, in 1/10000 */
+	uint32_t switches;      /* thread switches */
+	uint32_t window_ms;
+} OS_CpuUsageInfo_t;
+
+/* cpu usage of a thread */
+typedef struct OS_CpuUsageThread {
+	char     name[OS_CPUUSAGE_NAME_MAX];
+	uint8_t  priority;
+	uint16_t usage;         /* in the last window, in permille */
+	uint64_t run_us;        /* cumulative run time */
+} OS_CpuUsageThread_t;
+
 void OS_CpuUsageInit(uint32_t print_s);
 
+/* cpu usage in percent */
 uint32_t OS_CpuUsageGet(void);
 
+int OS_CpuUsageGetInfo(OS_CpuUsageInfo_t *info);
+
+/* fill up to @num threads, return the number of threads, more than @num if
+ * some did not fit */
+int OS_CpuUsageGetThreads(OS_CpuUsageThread_t *threads, int num);
+
+void OS_CpuUsageShow(void);
+
 #ifdef __cplusplus
 }
 #endif
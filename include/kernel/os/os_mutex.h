@@ -54,6 +54,23 @@ typedef struct OS_Mutex {
 	OS_MutexHandle_t handle;
 } OS_Mutex_t;
 
+/** @brief Size of the private storage of a static mutex, in words */
+#ifdef CONFIG_RT_USING_MUTEX_STATS
+#define OS_MUTEX_STATIC_STORAGE_WORDS   24
+#else
+#define OS_MUTEX_STATIC_STORAGE_WORDS   16
+#endif
+
+/**
+ * @brief Mutex object with embedded storage, see OS_MutexCreateStatic()
+ * @note Use the member "mutex" with the other OS_Mutex* functions, the
+ *       storage is private.
+ */
+typedef struct OS_MutexStatic {
+	OS_Mutex_t mutex;
+	uint32_t   storage[OS_MUTEX_STATIC_STORAGE_WORDS];
+} OS_MutexStatic_t;
+
 /**
  * @brief Create and initialize a mutex object
  * @note A mutex can only be locked by a single thread at any given time.
@@ -62,6 +79,18 @@ typedef struct OS_Mutex {
  */
 OS_Status OS_MutexCreate(OS_Mutex_t *mutex);
 
+/**
+ * @brief Create and initialize a mutex object in its embedded storage
+ *
+ * Same as OS_MutexCreate(), but nothing is allocated from the heap. Use
+ * &mutex->mutex with the other OS_Mutex* functions, OS_MutexDelete()
+ * releases it.
+ *
+ * @param[in] mutex Pointer to the static mutex object
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_MutexCreateStatic(OS_MutexStatic_t *mutex);
+
 /**
  * @brief Delete the mutex object
  * @param[in] mutex Pointer to the mutex object
@@ -102,6 +131,18 @@ OS_Status OS_MutexUnlock(OS_Mutex_t *mutex);
  */
 OS_Status OS_RecursiveMutexCreate(OS_Mutex_t *mutex);
 
+/**
+ * @brief Create and initialize a recursive mutex object in its embedded
+ *        storage
+ *
+ * Same as OS_RecursiveMutexCreate(), but nothing is allocated from the heap.
+ * OS_RecursiveMutexDelete() releases it.
+ *
+ * @param[in] mutex Pointer to the static mutex object
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_RecursiveMutexCreateStatic(OS_MutexStatic_t *mutex);
+
 /**
  * @brief Delete the recursive mutex object
  * @param[in] mutex Pointer to the recursive mutex object
@@ -140,6 +181,47 @@ OS_Status OS_RecursiveMutexUnlock(OS_Mutex_t *mutex);
  */
 OS_ThreadHandle_t OS_MutexGetOwner(OS_Mutex_t *mutex);
 
+/**
+ * @brief Set the name of a mutex, shown by OS_MutexStatGet()
+ * @note The name may be truncated, to RT_NAME_MAX characters on RT-Thread,
+ *       it is ignored on FreeRTOS.
+ * @param[in] mutex Pointer to the mutex object
+ * @param[in] name Name of the mutex, not referenced after return
+ * @return None
+ */
+void OS_MutexSetName(OS_Mutex_t *mutex, const char *name);
+
+#define OS_MUTEX_STAT_NAME_MAX  16
+
+/**
+ * @brief Contention statistics of a mutex, see OS_MutexStatGet()
+ */
+typedef struct OS_MutexStat {
+	char     name[OS_MUTEX_STAT_NAME_MAX];
+	char     owner[OS_MUTEX_STAT_NAME_MAX]; /* last owner thread, "-" if none or gone */
+	uint32_t acquires;        /* times taken, nested takes not counted */
+	uint32_t contended;       /* times a thread had to wait, timeouts included */
+	uint64_t wait_total_us;
+	uint32_t wait_max_us;
+	uint32_t hold_max_us;
+} OS_MutexStat_t;
+
+/**
+ * @brief Get the contention statistics of the mutexes
+ * @note Only on RT-Thread with RT_USING_MUTEX_STATS, covers all the kernel
+ *       mutexes including the ones not created by OS_MutexCreate().
+ * @param[out] stat Array receiving the statistics
+ * @param[in] num The size of the array
+ * @return The number of statistics filled, -1 if unsupported
+ */
+int OS_MutexStatGet(OS_MutexStat_t *stat, int num);
+
+/**
+ * @brief Clear the contention statistics of all mutexes
+ * @return None
+ */
+void OS_MutexStatReset(void);
+
 /**
  * @brief Check whether the mutex object is valid or not
  * @param[in] mutex Pointer to the mutex object
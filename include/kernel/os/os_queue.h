@@ -36,6 +36,7 @@
 #define _KERNEL_OS_OS_QUEUE_H_
 
 #include "kernel/os/os_common.h"
+#include "kernel/os/os_semaphore.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,6 +54,26 @@ typedef struct OS_Queue {
 	OS_QueueHandle_t handle;
 } OS_Queue_t;
 
+/** @brief Size of the private storage of a static queue, in words */
+#define OS_QUEUE_STATIC_STORAGE_WORDS   24
+
+/**
+ * @brief Queue object with embedded storage, see OS_QueueCreateStatic()
+ * @note Use the member "queue" with the other OS_Queue* functions, the
+ *       storage is private.
+ */
+typedef struct OS_QueueStatic {
+	OS_Queue_t queue;
+	uint32_t   storage[OS_QUEUE_STATIC_STORAGE_WORDS];
+} OS_QueueStatic_t;
+
+/**
+ * @brief Size in bytes of the item pool of a static queue
+ * @note It holds a link pointer and the item, aligned to 4 bytes, per item.
+ */
+#define OS_QUEUE_POOL_SIZE(queueLen, itemSize) \
+	((queueLen) * (sizeof(void *) + (((itemSize) + 3) & ~3U)))
+
 /**
  * @brief Create and initialize a queue object
  * @param[in] queue Pointer to the queue object
@@ -64,6 +85,25 @@ typedef struct OS_Queue {
  */
 OS_Status OS_QueueCreate(OS_Queue_t *queue, uint32_t queueLen, uint32_t itemSize);
 
+/**
+ * @brief Create and initialize a queue object in its embedded storage
+ *
+ * Same as OS_QueueCreate(), but nothing is allocated from the heap, the items
+ * are stored in the pool given. Use &queue->queue with the other OS_Queue*
+ * functions, OS_QueueDelete() releases it.
+ *
+ * @param[in] queue Pointer to the static queue object
+ * @param[in] queueLen The maximum number of items that the queue can hold at
+ *                     any one time.
+ * @param[in] itemSize The size, in bytes, of each data item that can be stored
+ *                     in the queue.
+ * @param[in] pool Item pool of OS_QUEUE_POOL_SIZE(queueLen, itemSize) bytes,
+ *                 4 bytes aligned
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_QueueCreateStatic(OS_QueueStatic_t *queue, uint32_t queueLen,
+                               uint32_t itemSize, void *pool);
+
 /**
  * @brief Delete the queue object
  * @param[in] queue Pointer to the queue object
@@ -176,6 +216,146 @@ static __always_inline OS_Status OS_MsgQueueReceive(OS_Queue_t *queue, void **ms
 	return OS_QueueReceive(queue, msg, waitMS);
 }
 
+/**
+ * @brief Block queue object definition
+ *
+ * A block queue passes fixed size blocks of a pool by reference. The sender
+ * takes a free block by OS_BlockQueueAlloc(), fills it and sends it, the
+ * receiver gives it back by OS_BlockQueueFree() when done. Nothing is copied
+ * whatever the block size, the blocks are linked by a header word.
+ */
+typedef struct OS_BlockQueue {
+	OS_Semaphore_t items;     /* number of blocks sent */
+	OS_Semaphore_t slots;     /* number of free blocks */
+	void          *head;      /* first block sent */
+	void          *tail;      /* last block sent */
+	void          *freeList;
+	void          *pool;
+	uint32_t       blockSize;
+	uint32_t       blockNum;
+	uint8_t        poolAlloc; /* pool allocated by OS_BlockQueueCreate() */
+} OS_BlockQueue_t;
+
+/**
+ * @brief Size in bytes of the pool of a block queue
+ * @note It holds a header word and the block, aligned to 4 bytes, per block.
+ */
+#define OS_BLOCK_QUEUE_POOL_SIZE(blockNum, blockSize) \
+	((blockNum) * (sizeof(void *) + (((blockSize) + 3) & ~3U)))
+
+/**
+ * @brief Create and initialize a block queue object
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] blockNum The number of blocks in the pool, it is also the
+ *                     maximum number of blocks the queue holds.
+ * @param[in] blockSize The size, in bytes, of each block
+ * @param[in] pool Pool of OS_BLOCK_QUEUE_POOL_SIZE(blockNum, blockSize) bytes,
+ *                 4 bytes aligned. NULL to allocate it from the heap.
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_BlockQueueCreate(OS_BlockQueue_t *bq, uint32_t blockNum,
+                              uint32_t blockSize, void *pool);
+
+/**
+ * @brief Delete the block queue object
+ * @note No thread may use the block queue any more, the blocks still queued
+ *       are dropped.
+ * @param[in] bq Pointer to the block queue object
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_BlockQueueDelete(OS_BlockQueue_t *bq);
+
+/**
+ * @brief Take a free block from the pool of the block queue
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] waitMS The maximum amount of time the thread should remain in the
+ *                   blocked state to wait for a block to be freed, should the
+ *                   pool be empty.
+ *                   OS_WAIT_FOREVER for waiting forever, zero for no waiting.
+ * @return Pointer to the block, NULL on timeout
+ */
+void *OS_BlockQueueAlloc(OS_BlockQueue_t *bq, OS_Time_t waitMS);
+
+/**
+ * @brief Give a block back to the pool of the block queue
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] block Block taken by OS_BlockQueueAlloc()
+ * @return None
+ */
+void OS_BlockQueueFree(OS_BlockQueue_t *bq, void *block);
+
+/**
+ * @brief Send a block to the back of the block queue
+ * @note Never blocks, the queue can hold all the blocks of the pool.
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] block Block taken by OS_BlockQueueAlloc(), owned by the receiver
+ *                  after this call
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_BlockQueueSend(OS_BlockQueue_t *bq, void *block);
+
+/**
+ * @brief Send several blocks to the back of the block queue
+ *
+ * The blocks are queued at once with the scheduler suspended, so that a
+ * waiting receiver is woken up once for all of them.
+ *
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] blocks Array of the blocks to send
+ * @param[in] num The number of blocks to send
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_BlockQueueSendBatch(OS_BlockQueue_t *bq, void * const *blocks,
+                                 uint32_t num);
+
+/**
+ * @brief Receive a block from the block queue
+ * @param[in] bq Pointer to the block queue object
+ * @param[in] waitMS The maximum amount of time the thread should remain in the
+ *                   blocked state to wait for a block, should the queue be
+ *                   empty.
+ *                   OS_WAIT_FOREVER for waiting forever, zero for no waiting.
+ * @return Pointer to the block, to be freed by OS_BlockQueueFree(), NULL on
+ *         timeout
+ */
+void *OS_BlockQueueReceive(OS_BlockQueue_t *bq, OS_Time_t waitMS);
+
+/**
+ * @brief Receive up to num blocks from the block queue
+ *
+ * Wait for the first block as OS_BlockQueueReceive(), then take the blocks
+ * already queued without waiting.
+ *
+ * @param[in] bq Pointer to the block queue object
+ * @param[out] blocks Array receiving the blocks
+ * @param[in] num The size of the array
+ * @param[in] waitMS The maximum amount of time to wait for the first block
+ * @return The number of blocks received, 0 on timeout
+ */
+uint32_t OS_BlockQueueReceiveBatch(OS_BlockQueue_t *bq, void **blocks,
+                                   uint32_t num, OS_Time_t waitMS);
+
+/**
+ * @brief Check whether the block queue object is valid or not
+ * @param[in] bq Pointer to the block queue object
+ * @return 1 on valid, 0 on invalid
+ */
+static __always_inline int OS_BlockQueueIsValid(OS_BlockQueue_t *bq)
+{
+	return OS_SemaphoreIsValid(&bq->items);
+}
+
+/**
+ * @brief Set the block queue object to invalid state
+ * @param[in] bq Pointer to the block queue object
+ * @return None
+ */
+static __always_inline void OS_BlockQueueSetInvalid(OS_BlockQueue_t *bq)
+{
+	OS_SemaphoreSetInvalid(&bq->items);
+	OS_SemaphoreSetInvalid(&bq->slots);
+}
+
 #ifdef __cplusplus
 }
 #endif
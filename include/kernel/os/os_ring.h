@@ -0,0 +1,177 @@
+/**
+ * @file os_ring.h
+ * @author XRADIO IOT WLAN Team
+ */
+
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _KERNEL_OS_OS_RING_H_
+#define _KERNEL_OS_OS_RING_H_
+
+#include "kernel/os/os_common.h"
+#include "kernel/os/os_semaphore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ring flags, see OS_RingCreate()
+ */
+#define OS_RING_F_MPSC      (1U << 0) /* several producers, else only one */
+#define OS_RING_F_NOTIFY    (1U << 1) /* OS_RingGet() can wait for elements */
+
+/**
+ * @brief Ring object definition
+ *
+ * A lock-free ring of fixed size elements between producers and a single
+ * consumer, e.g. an ISR and a thread. Putting and getting elements makes no
+ * kernel call, except to wake up a consumer waiting in OS_RingGet().
+ */
+typedef struct OS_Ring {
+	uint32_t       head;     /* next element put, free running */
+	uint32_t       tail;     /* next element got, free running */
+	uint32_t       mask;     /* number of elements - 1 */
+	uint16_t       elemSize;
+	uint8_t        flags;    /* OS_RING_F_* */
+	uint8_t        waiting;  /* consumer waiting on sem */
+	uint8_t       *buf;
+	uint32_t      *seq;      /* sequence of each element, MPSC only */
+	void          *mem;      /* allocated by OS_RingCreate() */
+	OS_Semaphore_t sem;      /* wakes up the consumer, OS_RING_F_NOTIFY only */
+} OS_Ring_t;
+
+/**
+ * @brief Size in bytes of the buffer of a ring
+ * @note With OS_RING_F_MPSC, a sequence word is stored per element.
+ */
+#define OS_RING_BUF_SIZE(elemNum, elemSize, flags) \
+	((elemNum) * ((elemSize) + (((flags) & OS_RING_F_MPSC) ? sizeof(uint32_t) : 0)))
+
+/**
+ * @brief Create and initialize a ring object
+ * @param[in] ring Pointer to the ring object
+ * @param[in] elemNum The number of elements the ring holds, a power of 2
+ * @param[in] elemSize The size, in bytes, of each element
+ * @param[in] flags OS_RING_F_MPSC if there are several producers,
+ *                  OS_RING_F_NOTIFY if the consumer waits for elements.
+ * @param[in] buf Buffer of OS_RING_BUF_SIZE(elemNum, elemSize, flags) bytes,
+ *                4 bytes aligned. NULL to allocate it from the heap.
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_RingCreate(OS_Ring_t *ring, uint32_t elemNum, uint32_t elemSize,
+                        uint32_t flags, void *buf);
+
+/**
+ * @brief Delete the ring object
+ * @param[in] ring Pointer to the ring object
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_RingDelete(OS_Ring_t *ring);
+
+/**
+ * @brief Put elements to the back of the ring, never blocks
+ *
+ * Without OS_RING_F_MPSC, put as many elements as there is room for.
+ * With OS_RING_F_MPSC, put all the elements or none of them.
+ *
+ * @param[in] ring Pointer to the ring object
+ * @param[in] elems The elements to put
+ * @param[in] num The number of elements
+ * @return The number of elements put
+ */
+uint32_t OS_RingPut(OS_Ring_t *ring, const void *elems, uint32_t num);
+
+/**
+ * @brief Get elements from the front of the ring
+ * @note Called by the consumer only. Waiting needs OS_RING_F_NOTIFY.
+ * @param[in] ring Pointer to the ring object
+ * @param[out] elems Buffer receiving up to num elements
+ * @param[in] num The maximum number of elements to get
+ * @param[in] waitMS The maximum amount of time the thread should remain in the
+ *                   blocked state to wait for an element, should the ring be
+ *                   empty.
+ *                   OS_WAIT_FOREVER for waiting forever, zero for no waiting.
+ * @return The number of elements got, 0 on timeout
+ */
+uint32_t OS_RingGet(OS_Ring_t *ring, void *elems, uint32_t num,
+                    OS_Time_t waitMS);
+
+/**
+ * @brief Copy elements from the front of the ring, leaving them in the ring
+ * @note Called by the consumer only. Waiting needs OS_RING_F_NOTIFY.
+ * @param[in] ring Pointer to the ring object
+ * @param[out] elems Buffer receiving up to num elements
+ * @param[in] num The maximum number of elements to copy
+ * @param[in] waitMS The maximum amount of time the thread should remain in the
+ *                   blocked state to wait for an element, should the ring be
+ *                   empty.
+ *                   OS_WAIT_FOREVER for waiting forever, zero for no waiting.
+ * @return The number of elements copied, 0 on timeout
+ */
+uint32_t OS_RingPeek(OS_Ring_t *ring, void *elems, uint32_t num,
+                     OS_Time_t waitMS);
+
+/**
+ * @brief Get the number of elements in the ring
+ * @note With OS_RING_F_MPSC, elements being put are counted as well.
+ * @param[in] ring Pointer to the ring object
+ * @return The number of elements
+ */
+static __always_inline uint32_t OS_RingCount(OS_Ring_t *ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+/**
+ * @brief Check whether the ring object is valid or not
+ * @param[in] ring Pointer to the ring object
+ * @return 1 on valid, 0 on invalid
+ */
+static __always_inline int OS_RingIsValid(OS_Ring_t *ring)
+{
+	return (ring->buf != NULL);
+}
+
+/**
+ * @brief Set the ring object to invalid state
+ * @param[in] ring Pointer to the ring object
+ * @return None
+ */
+static __always_inline void OS_RingSetInvalid(OS_Ring_t *ring)
+{
+	ring->buf = NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KERNEL_OS_OS_RING_H_ */
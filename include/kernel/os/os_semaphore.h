@@ -53,6 +53,19 @@ typedef struct OS_Semaphore {
 	OS_SemaphoreHandle_t handle;
 } OS_Semaphore_t;
 
+/** @brief Size of the private storage of a static semaphore, in words */
+#define OS_SEMAPHORE_STATIC_STORAGE_WORDS   16
+
+/**
+ * @brief Semaphore object with embedded storage, see OS_SemaphoreCreateStatic()
+ * @note Use the member "sem" with the other OS_Semaphore* functions, the
+ *       storage is private.
+ */
+typedef struct OS_SemaphoreStatic {
+	OS_Semaphore_t sem;
+	uint32_t       storage[OS_SEMAPHORE_STATIC_STORAGE_WORDS];
+} OS_SemaphoreStatic_t;
+
 /**
  * @brief Create and initialize a counting semaphore object
  * @param[in] sem Pointer to the semaphore object
@@ -74,6 +87,23 @@ OS_Status OS_SemaphoreCreate(OS_Semaphore_t *sem, uint32_t initCount, uint32_t m
  */
 OS_Status OS_SemaphoreCreateBinary(OS_Semaphore_t *sem);
 
+/**
+ * @brief Create and initialize a counting semaphore object in its embedded
+ *        storage
+ *
+ * Same as OS_SemaphoreCreate(), but nothing is allocated from the heap. Use
+ * &sem->sem with the other OS_Semaphore* functions, OS_SemaphoreDelete()
+ * releases it.
+ *
+ * @param[in] sem Pointer to the static semaphore object
+ * @param[in] initCount The count value assigned to the semaphore when it is
+ *                      created.
+ * @param[in] maxCount The maximum count value that can be reached.
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_SemaphoreCreateStatic(OS_SemaphoreStatic_t *sem, uint32_t initCount,
+                                   uint32_t maxCount);
+
 /**
  * @brief Delete the semaphore object
  * @param[in] sem Pointer to the semaphore object
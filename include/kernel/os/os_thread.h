@@ -65,6 +65,19 @@ typedef struct OS_Thread {
 	OS_ThreadHandle_t handle;
 } OS_Thread_t;
 
+/** @brief Size of the private storage of a static thread, in words */
+#define OS_THREAD_STATIC_STORAGE_WORDS  48
+
+/**
+ * @brief Thread object with embedded storage, see OS_ThreadCreateStatic()
+ * @note Use the member "thread" with the other OS_Thread* functions, the
+ *       storage is private.
+ */
+typedef struct OS_ThreadStatic {
+	OS_Thread_t thread;
+	uint32_t    storage[OS_THREAD_STATIC_STORAGE_WORDS];
+} OS_ThreadStatic_t;
+
 /**
  * @brief Thread entry definition, which is a pointer to a function
  */
@@ -93,6 +106,28 @@ OS_Status OS_ThreadCreate(OS_Thread_t *thread, const char *name,
                           OS_ThreadEntry_t entry, void *arg,
                           OS_Priority priority, uint32_t stackSize);
 
+/**
+ * @brief Create and start a thread in its embedded storage
+ *
+ * Same as OS_ThreadCreate(), but nothing is allocated from the heap, the
+ * thread runs on the stack given. Use &thread->thread with the other
+ * OS_Thread* functions. The storage and the stack must not be reused before
+ * the thread is deleted.
+ *
+ * @param[in] thread Pointer to the static thread object
+ * @param[in] name A descriptive name for the thread
+ * @param[in] entry Entry, which is a function pointer, to the thread function
+ * @param[in] arg The sole argument passed to entry()
+ * @param[in] priority The priority at which the thread will execute
+ * @param[in] stack The thread stack, 8 bytes aligned
+ * @param[in] stackSize The size of the stack in bytes
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_ThreadCreateStatic(OS_ThreadStatic_t *thread, const char *name,
+                                OS_ThreadEntry_t entry, void *arg,
+                                OS_Priority priority, void *stack,
+                                uint32_t stackSize);
+
 /**
  * @brief Terminate the thread
  * @note Only memory that is allocated to a thread by the kernel itself is
@@ -186,6 +221,40 @@ uint32_t OS_ThreadGetStackMinFreeSize(OS_Thread_t *thread);
  */
 void OS_ThreadList(void);
 
+/** @brief Size of the thread name in OS_ThreadProfile_t, including '\0' */
+#define OS_THREAD_PROFILE_NAME_MAX  16
+
+/**
+ * @brief Scheduling profile of a thread, see OS_ThreadProfileGet()
+ * @note The runs, preemptions and latencies are 0 unless the kernel profiles
+ *       the threads (RT_USING_THREAD_PROFILE on RT-Thread).
+ */
+typedef struct OS_ThreadProfile {
+	char     name[OS_THREAD_PROFILE_NAME_MAX];
+	uint8_t  priority;
+	char     state;           /* 'R'eady, 'S'uspended, 'I'nit or 'C'losed */
+	uint32_t stack_size;      /* 0 if unknown */
+	uint32_t stack_free_min;  /* stack never used, in bytes */
+	uint32_t runs;            /* times switched in */
+	uint32_t preempts;        /* times switched out while ready */
+	uint32_t latency_max_us;  /* from ready to running */
+	uint32_t latency_avg_us;
+} OS_ThreadProfile_t;
+
+/**
+ * @brief Get the scheduling profile of the threads
+ * @param[out] prof Array receiving the profiles
+ * @param[in] num The size of the array
+ * @return The number of profiles filled, -1 if unsupported
+ */
+int OS_ThreadProfileGet(OS_ThreadProfile_t *prof, int num);
+
+/**
+ * @brief Clear the runs, preemptions and latencies of all threads
+ * @return None
+ */
+void OS_ThreadProfileReset(void);
+
 /**
  * @brief Check whether the thread object is valid or not
  * @param[in] thread Pointer to the thread object
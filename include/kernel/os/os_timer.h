@@ -51,6 +51,19 @@ typedef struct OS_Timer {
 	OS_TimerHandle_t handle;
 } OS_Timer_t;
 
+/** @brief Size of the private storage of a static timer, in words */
+#define OS_TIMER_STATIC_STORAGE_WORDS   24
+
+/**
+ * @brief Timer object with embedded storage, see OS_TimerCreateStatic()
+ * @note Use the member "timer" with the other OS_Timer* functions, the
+ *       storage is private.
+ */
+typedef struct OS_TimerStatic {
+	OS_Timer_t timer;
+	uint32_t   storage[OS_TIMER_STATIC_STORAGE_WORDS];
+} OS_TimerStatic_t;
+
 /**
  * @brief Timer type definition
  *     - one shot timer: Timer will be in the dormant state after it expires.
@@ -81,6 +94,23 @@ typedef void (*OS_TimerCallback_t)(void *arg);
 OS_Status OS_TimerCreate(OS_Timer_t *timer, OS_TimerType type,
                          OS_TimerCallback_t cb, void *arg, OS_Time_t periodMS);
 
+/**
+ * @brief Create and initialize a timer object in its embedded storage
+ *
+ * Same as OS_TimerCreate(), but nothing is allocated from the heap. Use
+ * &timer->timer with the other OS_Timer* functions, OS_TimerDelete()
+ * releases it.
+ *
+ * @param[in] timer Pointer to the static timer object
+ * @param[in] type Timer type
+ * @param[in] cb Timer expire callback function
+ * @param[in] arg Argument of timer expire callback function
+ * @param[in] periodMS Timer period in milliseconds
+ * @retval OS_Status, OS_OK on success
+ */
+OS_Status OS_TimerCreateStatic(OS_TimerStatic_t *timer, OS_TimerType type,
+                               OS_TimerCallback_t cb, void *arg, OS_Time_t periodMS);
+
 /**
  * @brief Delete the timer object
  * @param[in] timer Pointer to the timer object
@@ -2,6 +2,9 @@
 #define _LIBC_STDIO_H_
 
 #include_next <stdio.h>
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+#include <stdint.h>
+#endif
 
 #ifdef CONFIG_LIBC_WRAP_STDIO
 
@@ -16,6 +19,31 @@ void stdio_set_write(stdio_write_fn fn);
 void stdout_mutex_lock(void);
 void stdout_mutex_unlock(void);
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+
+struct stdio_async_stat {
+	uint32_t records;       /* records queued */
+	uint32_t bytes;         /* bytes queued */
+	uint32_t dropped;       /* records dropped, the ring was full */
+	uint32_t dropped_bytes; /* bytes dropped, the ring was full */
+	uint32_t filtered;      /* log messages filtered out by the log level */
+	uint32_t used_max;      /* max bytes used in the ring */
+};
+
+int stdio_async_start(void);
+int stdio_async_flush(uint32_t timeout_ms);
+void stdio_async_panic(void);
+int stdio_async_write(const char *buf, int len);
+void stdio_set_async_write(stdio_write_fn fn);
+void stdio_async_get_stat(struct stdio_async_stat *stat);
+
+void stdio_log_set_level(int level);
+int stdio_log_get_level(void);
+int stdio_log_printf(int level, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#endif /* CONFIG_LIBC_STDIO_ASYNC */
+
 #undef putc
 #undef putchar
 
@@ -121,6 +121,10 @@ typedef uintptr_t       mem_ptr_t;
     #define LWIP_CHKSUM_ALGORITHM   1
 #endif
 
+/* Copy and checksum in one pass, see arch/chksum_copy.c */
+#define LWIP_CHKSUM_COPY(dst, src, len) arch_chksum_copy(dst, src, len)
+uint16_t arch_chksum_copy(void *dst, const void *src, uint16_t len);
+
 /* Debug on/off */
 //#define LWIP_DEBUG
 //#define LWIP_NOASSERT
@@ -98,6 +98,14 @@ extern OS_Mutex_t g_lwip_sys_mutex;
 #define SYS_ARCH_UNPROTECT(lev)
 #endif /* SYS_LIGHTWEIGHT_PROT */
 
+/* core lock tracing, see LWIP_TCPIP_CORE_LOCK_TRACE */
+#if (LWIP_TCPIP_CORE_LOCKING && LWIP_TCPIP_CORE_LOCK_TRACE)
+void sys_lock_tcpip_core(const char *func);
+void sys_unlock_tcpip_core(const char *func);
+#define LOCK_TCPIP_CORE()           sys_lock_tcpip_core(__func__)
+#define UNLOCK_TCPIP_CORE()         sys_unlock_tcpip_core(__func__)
+#endif
+
 #if LWIP_NETCONN_SEM_PER_THREAD
 sys_sem_t *LWIP_NETCONN_THREAD_SEM_GET();
 void LWIP_NETCONN_THREAD_SEM_ALLOC();
@@ -74,6 +74,8 @@
 #define LWIP_SUPPRESS_WARNING           0
 #define LWIP_RESOURCE_TRACE             0  // trace resource usage for debugging
 #define LWIP_MBOX_TRACE                 0  // trace mbox usage for debugging
+#define LWIP_TCPIP_CORE_LOCK_CHECK      0  // check lwIP core calls hold the core lock, for debugging
+#define LWIP_TCPIP_CORE_LOCK_TRACE      0  // trace the longest core lock holds, for debugging
 
 /**
  * LWIP_MBUF_SUPPORT==1: Reserve some head/tail space in pbuf for adding data,
@@ -82,6 +84,20 @@
 #define LWIP_MBUF_SUPPORT               CONFIG_MBUF_IMPL_MODE
 #if LWIP_MBUF_SUPPORT
 #define LWIP_PBUF_POOL_SMALL            1  // add small PBUF_POOL_SMALL to save memory
+#else /* LWIP_MBUF_SUPPORT */
+/**
+ * LWIP_MBUF_TX_ZERO_COPY==1: a single PBUF_RAM pbuf (e.g. a TCP segment) is
+ * sent by an external mbuf referencing it instead of being copied to a new
+ * mbuf. Every PBUF_RAM pbuf reserves MBUF_HEAD_SPACE bytes for the 802.11
+ * header, see PBUF_LINK_ENCAPSULATION_HLEN. There is no tail space after the
+ * pbuf data, a frame getting a trailer (e.g. CCMP MIC) is copied by
+ * mb_append() then. Like any zero-copy netif, the pbuf is referenced until
+ * it is sent, so a PBUF_RAM pbuf passed to udp_send() or raw_send() must not
+ * be modified by the application after the call.
+ * Off until it is measured on target, it costs MBUF_HEAD_SPACE bytes of lwIP
+ * heap per PBUF_RAM pbuf.
+ */
+#define LWIP_MBUF_TX_ZERO_COPY          0
 #endif /* LWIP_MBUF_SUPPORT */
 
 /*
@@ -178,8 +194,12 @@
  * into TCPIP thread using callbacks. See LOCK_TCPIP_CORE() and
  * UNLOCK_TCPIP_CORE().
  * Your system should provide mutexes supporting priority inversion to use this.
+ *
+ * The core lock is a sys_mutex_t, an OS_Mutex_t, which inherits priority on
+ * both RT-Thread and FreeRTOS. The threads calling the socket/netconn API
+ * then run the lwIP core on their own stack, size them accordingly.
  */
-#define LWIP_TCPIP_CORE_LOCKING         0 // ???
+#define LWIP_TCPIP_CORE_LOCKING         1
 
 /**
  * LWIP_TCPIP_CORE_LOCKING_INPUT: when LWIP_TCPIP_CORE_LOCKING is enabled,
@@ -188,8 +208,15 @@
  *
  * ATTENTION: this does not work when tcpip_input() is called from
  * interrupt context!
+ *
+ * The wlan RX thread calls ethernetif_input(), never an interrupt. Its stack
+ * is sized by the wlan library, so this is off unless enabled by Kconfig.
  */
+#ifdef CONFIG_LWIP_TCPIP_CORE_LOCKING_INPUT
+#define LWIP_TCPIP_CORE_LOCKING_INPUT   1
+#else
 #define LWIP_TCPIP_CORE_LOCKING_INPUT   0
+#endif
 
 /**
  * SYS_LIGHTWEIGHT_PROT==1: enable inter-task protection (and task-vs-interrupt
@@ -209,14 +236,18 @@
  * - If @ref LWIP_TCPIP_CORE_LOCKING = 0: function is called from TCPIP thread
  * @see @ref multithreading
  */
-//#define LWIP_ASSERT_CORE_LOCKED()
+#if LWIP_TCPIP_CORE_LOCK_CHECK
+void sys_check_core_locking(void);
+#define LWIP_ASSERT_CORE_LOCKED()       sys_check_core_locking()
+#endif
 
 /**
  * Called as first thing in the lwIP TCPIP thread. Can be used in conjunction
  * with @ref LWIP_ASSERT_CORE_LOCKED to check core locking.
  * @see @ref multithreading
  */
-//#define LWIP_MARK_TCPIP_THREAD()
+void sys_mark_tcpip_thread(void);
+#define LWIP_MARK_TCPIP_THREAD()        sys_mark_tcpip_thread()
 /**
  * @}
  */
@@ -1194,14 +1225,20 @@
  * PBUF_LINK_ENCAPSULATION_HLEN: the number of bytes that should be allocated
  * for an additional encapsulation header before ethernet headers (e.g. 802.11)
  */
+#if (!LWIP_MBUF_SUPPORT && LWIP_MBUF_TX_ZERO_COPY)
+#include "sys/mbuf_0.h"
+#define PBUF_LINK_ENCAPSULATION_HLEN    MBUF_HEAD_SPACE
+#else
 #define PBUF_LINK_ENCAPSULATION_HLEN    0u
+#endif
 
 /**
  * PBUF_POOL_BUFSIZE: the size of each pbuf in the pbuf pool. The default is
  * designed to accommodate single full size TCP frame in one pbuf, including
  * TCP_MSS, IP header, and link header.
+ * PBUF_LINK_ENCAPSULATION_HLEN is left out, PBUF_POOL is used to do RX.
  */
-#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_ENCAPSULATION_HLEN+PBUF_LINK_HLEN)
+#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
 
 /**
  * LWIP_PBUF_REF_T: Refcount type in pbuf.
@@ -1842,8 +1879,9 @@
 /**
  * LWIP_CHECKSUM_ON_COPY==1: Calculate checksum when copying data from
  * application buffers to pbufs.
+ * The port copies and sums in one pass, see LWIP_CHKSUM_COPY in arch/cc.h.
  */
-#define LWIP_CHECKSUM_ON_COPY           0
+#define LWIP_CHECKSUM_ON_COPY           1
 /**
  * @}
  */
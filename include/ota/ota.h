@@ -106,6 +106,20 @@ typedef enum ota_upgrade_status {
 
 typedef void (*ota_callback) (ota_upgrade_status_t status, uint32_t data_size, uint32_t percentage);
 
+/**
+ * @brief OTA flash write statistics (OTA_OPT_PIPELINE_WRITE)
+ * @note erase_ms + program_ms - flash_stall_ms is the flash time hidden
+ *       behind the download.
+ */
+typedef struct ota_write_stat {
+	uint32_t write_size;        /* bytes programmed to flash */
+	uint32_t total_ms;          /* from start to finish of the download */
+	uint32_t erase_ms;          /* time spent erasing by the writer */
+	uint32_t program_ms;        /* time spent programming by the writer */
+	uint32_t flash_stall_ms;    /* download blocked, waiting for flash */
+	uint32_t network_stall_ms;  /* writer idle, waiting for download */
+} ota_write_stat_t;
+
 /**
  * @brief Initialize the OTA service
  * @retval ota_status_t, OTA_STATUS_OK on success
@@ -125,6 +139,12 @@ void ota_deinit(void);
   */
 ota_status_t ota_set_skip_size(int32_t skip_size);
 
+/**
+  * @brief Get the skip size
+  * @retval the skip size, -1 for the bootloader size of the image
+  */
+int32_t ota_get_skip_size(void);
+
 /**
  * @brief Set the callback function of ota
  * @retval ota_status_t, OTA_STATUS_OK on success
@@ -186,6 +206,36 @@ ota_status_t ota_get_verify_data(ota_verify_data_t *data);
  */
 ota_status_t ota_verify_image(ota_verify_t verify, uint32_t *value);
 
+/**
+ * @brief Read the image back from flash to verify it, instead of using the
+ *        digest calculated while the image is written (OTA_OPT_STREAM_VERIFY)
+ * @param[in] enable 1 to read back, 0 to use the streamed digest (default)
+ * @retval ota_status_t, OTA_STATUS_OK on success
+ */
+ota_status_t ota_set_verify_readback(uint8_t enable);
+
+/**
+ * @brief Set the image to be pushed or got as a delta patch against the
+ *        running image (OTA_OPT_DELTA), generated by tools/ota_delta.py
+ * @note The skip size is reset, 0 for a patch and default for a full image
+ * @param[in] enable 1 for a delta patch, 0 for a full image (default)
+ * @retval ota_status_t, OTA_STATUS_OK on success
+ */
+ota_status_t ota_set_delta(uint8_t enable);
+
+/**
+ * @brief Get whether the image is pushed or got as a delta patch
+ * @retval 1 for a delta patch, 0 for a full image
+ */
+uint8_t ota_get_delta(void);
+
+/**
+ * @brief Get the flash write statistics of the last download
+ * @param[out] stat Pointer to the statistics
+ * @retval ota_status_t, OTA_STATUS_OK on success
+ */
+ota_status_t ota_get_write_stat(ota_write_stat_t *stat);
+
 /**
  * @brief Reboot system
  * @return None
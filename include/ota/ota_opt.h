@@ -49,6 +49,19 @@ extern "C" {
 #define OTA_OPT_EXTRA_VERIFY_SHA1    1
 #define OTA_OPT_EXTRA_VERIFY_SHA256  1
 
+/* hash the image while it is written to flash, instead of reading it back */
+#define OTA_OPT_STREAM_VERIFY        1
+
+/* program flash from a writer thread, overlapping with the download */
+#define OTA_OPT_PIPELINE_WRITE       1
+
+/* delta image against the running image, xz compressed, ping-pong only */
+#if (defined(CONFIG_BIN_COMPRESS) && defined(CONFIG_OTA_POLICY_PINGPONG))
+#define OTA_OPT_DELTA                1
+#else
+#define OTA_OPT_DELTA                0
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -245,10 +245,12 @@ void mb_free(struct mbuf *m);
 int mb_adj(struct mbuf *m, int req_len);
 int mb_copydata(const struct mbuf *m, int off, int len, uint8_t *cp);
 struct mbuf *mb_dup(struct mbuf *m);
-struct mbuf *mb_pullup(struct mbuf *m, int len); // NOT really support!
+struct mbuf *mb_pullup(struct mbuf *m, int len);
 struct mbuf *mb_split(struct mbuf *m0, int len0);
 int mb_append(struct mbuf *m, int len, const uint8_t *cp);
 int mb_reserve(struct mbuf *m, int len, uint16_t headspace, uint16_t tailspace);
+struct mbuf *mb_get_ext(uint8_t *data, int len, uint16_t headspace,
+                        uint16_t tailspace, void (*ext_free)(void *arg), void *arg);
 
 #define m_freem(m)              mb_free(m)
 #define m_adj(m, l)             mb_adj(m, l)
@@ -314,8 +316,8 @@ static __inline void m_clrprotoflags(struct mbuf *m)
 #if MBUF_OPT_LIMIT_MEM
 /*
  * Flags for @param tx in mb_get(), which also saved in struct mbuf::m_type
- *   - MBUF_GET_FLAG_LIMIT_TX: memory usage limit by MBUF_TX_MEM_MAX
- *   - MBUF_GET_FLAG_LIMIT_RX: memory usage limit by MBUF_RX_MEM_MAX
+ *   - MBUF_GET_FLAG_LIMIT_TX: got from the tx pool, limit by MBUF_TX_MEM_MAX
+ *   - MBUF_GET_FLAG_LIMIT_RX: got from the rx pool, limit by MBUF_RX_MEM_MAX
  */
 #define MBUF_GET_FLAG_MASK      (0xF << 4)
 #define MBUF_GET_FLAG_LIMIT_TX  (1 << 4)
@@ -323,6 +325,8 @@ static __inline void m_clrprotoflags(struct mbuf *m)
 
 void mb_mem_set_limit(uint32_t tx, uint32_t rx, uint32_t txrx);
 void mb_mem_get_limit(uint32_t *tx, uint32_t *rx, uint32_t *txrx);
+void mb_pool_shrink(void);
+void mb_pool_info(int verbose);
 
 #else /* MBUF_OPT_LIMIT_MEM */
 
@@ -92,6 +92,13 @@
 
 #define XR_DEBUG_PRINT(msg, arg...) printf(msg, ##arg)
 
+/* filtered by the log level before formatting in case of async stdout */
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+#define XR_DEBUG_LOG(dlevel, msg, arg...) stdio_log_printf(dlevel, msg, ##arg)
+#else
+#define XR_DEBUG_LOG(dlevel, msg, arg...) XR_DEBUG_PRINT(msg, ##arg)
+#endif
+
 #define XR_DEBUG_ABORT()    \
 	do { \
 		printf("system aborted!"); \
@@ -115,7 +122,7 @@
 				((module) & DBG_ON) && \
 				(((module) & DBG_LEVEL_MASK) >= dlevel) && \
 				(expand)) { \
-				XR_DEBUG_PRINT(msg, ##arg); \
+				XR_DEBUG_LOG(dlevel, msg, ##arg); \
 			} \
 		} while (0)
 
@@ -134,7 +141,7 @@
 			if ( \
 				(((int16_t)(module) & DBG_LEVEL_MASK) >= dlevel) && \
 				(expand)) { \
-				XR_DEBUG_PRINT(msg, ##arg); \
+				XR_DEBUG_LOG(dlevel, msg, ##arg); \
 			} \
 		} while (0)
 
@@ -355,6 +362,7 @@ extern void exception_register_panic_cli(void *cli);
 #define exception_panic() \
 	do { \
 		printf("panic at %s func:%s line:%d!!\n", __FILE__, __func__, __LINE__); \
+		sys_stdio_panic(); \
 		__asm volatile ("bkpt 0"); \
 	} while (0)
 
@@ -41,8 +41,17 @@
 
 #define xr_breakpoint arch_breakpoint
 
+/* write the queued standard output out before halting */
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+extern void stdio_async_panic(void);
+#define sys_stdio_panic()   stdio_async_panic()
+#else
+#define sys_stdio_panic()   do { } while (0)
+#endif
+
 #define sys_abort()         \
 	do {                    \
+		sys_stdio_panic();  \
 		arch_fiq_disable(); \
 		arch_breakpoint(0); \
 	} while (0)
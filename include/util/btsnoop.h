@@ -19,9 +19,14 @@
 //#pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 //#include "bt_types.h"
 
 int btsnoop_start_up(void);
+#ifdef CONFIG_FILESYSTEMS
+int btsnoop_start_up_file(const char *path);
+#endif
 int btsnoop_shut_down(void);
+void btsnoop_get_stat(uint32_t *packets, uint32_t *dropped_packets);
 
 //void btsnoop_capture(const BT_HDR *buffer, bool is_received);
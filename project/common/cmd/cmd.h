@@ -36,6 +36,7 @@
 #include "common/cmd/cmd_mem.h"
 #include "common/cmd/cmd_heap.h"
 #include "common/cmd/cmd_thread.h"
+#include "common/cmd/cmd_sysctrl.h"
 #include "common/cmd/cmd_upgrade.h"
 #include "common/cmd/cmd_sysinfo.h"
 #include "common/cmd/cmd_hexdump.h"
@@ -347,6 +347,15 @@ static enum cmd_status audio_end_task(char *arg)
 	return CMD_STATUS_OK;
 }
 
+static enum cmd_status audio_filter_exec(char *arg)
+{
+	(void)arg;
+
+	audio_filter_show(CMD_AUDIO_SND_CARD);
+
+	return CMD_STATUS_OK;
+}
+
 /*
  * brief audio Test Command
  * command
@@ -355,6 +364,7 @@ static enum cmd_status audio_end_task(char *arg)
  *        3)vol:    $ audio vol [dev] [vol]
  *        4)path:    $ audio path [dev] [en]
  *        5)end : $ audio end
+ *        6)filter: $ audio filter
  *        samplerate: [8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000]
  *        channels:   [1~2]
  *        vol:           [0~31]
@@ -366,6 +376,7 @@ static enum cmd_status audio_end_task(char *arg)
  *      audio vol 12
  *        audio path    1 1
  *        audio end
+ *        audio filter
  */
 
 #if CMD_DESCRIBE
@@ -382,6 +393,7 @@ static enum cmd_status audio_end_task(char *arg)
     "audio path [dev] [en]\n" \
     "\t\t\teg. audio path    1 1"
 #define audio_end_help_info "audio end"
+#define audio_filter_help_info "audio filter, show filter cycles"
 #endif
 
 static enum cmd_status cmd_audio_help_exec(char *cmd);
@@ -392,6 +404,7 @@ static const struct cmd_data g_audio_cmds[] = {
 	{ "vol",     audio_vol_task,       CMD_DESC(audio_vol_help_info) },
 	{ "path",    audio_path_task,      CMD_DESC(audio_path_help_info) },
 	{ "end",     audio_end_task,       CMD_DESC(audio_end_help_info) },
+	{ "filter",  audio_filter_exec,    CMD_DESC(audio_filter_help_info) },
 	{ "help",    cmd_audio_help_exec,  CMD_DESC(CMD_HELP_DESC) },
 };
 
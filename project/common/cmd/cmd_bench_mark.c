@@ -29,6 +29,17 @@
 
 #include "cmd_util.h"
 #include "cmd_bench_mark.h"
+#include "driver/chip/hal_rtc.h"
+#include "lwip/inet_chksum.h"
+#include "common/framework/sys_ctrl/container.h"
+#ifdef CONFIG_OTA
+#include "ota/ota.h"
+#endif
+#ifdef CONFIG_OS_RTTHREAD
+#include "driver/chip/hal_clock.h"
+#include <rtthread.h>
+#include <rthw.h>
+#endif
 
 #ifdef CONFIG_BENCH_MARK
 /*
@@ -71,10 +82,665 @@ static enum cmd_status cmd_whetstone_exec(char *cmd)
 	return CMD_STATUS_OK;
 }
 
+#define BENCH_MEM_BUF_SIZE  (4096 + 8)
+#define BENCH_MEM_BYTES     (256 * 1024) /* bytes moved per case */
+
+typedef void *(*bench_memcpy_fn)(void *dst, const void *src, size_t n);
+typedef void *(*bench_memset_fn)(void *s, int c, size_t n);
+
+#if (defined(CONFIG_ROM) && defined(CONFIG_LIBC_WRAP_MEM))
+void *__rom_wrap_memcpy(void *dst, const void *src, size_t n);
+void *__rom_wrap_memmove(void *dst, const void *src, size_t n);
+void *__rom_wrap_memset(void *s, int c, size_t n);
+#define BENCH_MEM_ROM   1
+#else
+#define BENCH_MEM_ROM   0
+#endif
+
+static void bench_mem_fill(uint8_t *buf, uint32_t n, uint32_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; ++i)
+		buf[i] = (uint8_t)(i * 7 + seed);
+}
+
+/* @return MB/s, 0 if the result is wrong */
+static uint32_t bench_mem_copy(bench_memcpy_fn fn, uint8_t *dst, uint8_t *src,
+                               uint32_t size, int overlap)
+{
+	uint32_t i, loop = BENCH_MEM_BYTES / size;
+	uint64_t t;
+
+	bench_mem_fill(src, size, size);
+	t = HAL_RTC_GetFreeRunTime();
+	for (i = 0; i < loop; ++i)
+		fn(dst, src, size);
+	t = HAL_RTC_GetFreeRunTime() - t;
+
+	if (!overlap) {
+		for (i = 0; i < size; ++i) {
+			if (dst[i] != (uint8_t)(i * 7 + size))
+				return 0;
+		}
+	}
+	return t ? (uint32_t)((uint64_t)loop * size / t) : 0;
+}
+
+static uint32_t bench_mem_set(bench_memset_fn fn, uint8_t *dst, uint32_t size)
+{
+	uint32_t i, loop = BENCH_MEM_BYTES / size;
+	uint64_t t;
+
+	t = HAL_RTC_GetFreeRunTime();
+	for (i = 0; i < loop; ++i)
+		fn(dst, 0x5a, size);
+	t = HAL_RTC_GetFreeRunTime() - t;
+
+	for (i = 0; i < size; ++i) {
+		if (dst[i] != 0x5a)
+			return 0;
+	}
+	return t ? (uint32_t)((uint64_t)loop * size / t) : 0;
+}
+
+/* run one case of size @n with the buffers at @dst + @da and @src + @sa */
+typedef void (*bench_buf_case)(uint8_t *dst, uint8_t *src, uint32_t da,
+                               uint32_t sa, uint32_t n);
+
+/*
+ * Parse the optional [size] of @cmd, allocate the buffers and run @fn for
+ * each size and each destination/source alignment, one line per case.
+ */
+static enum cmd_status bench_buf_exec(char *cmd, const uint32_t *sizes,
+                                      uint32_t cnt, const char *title,
+                                      bench_buf_case fn)
+{
+	uint32_t size = 0, n, s, da, sa;
+	uint8_t *dst, *src;
+
+	if (cmd_sscanf(cmd, "%u", &size) == 1 &&
+	    (size == 0 || size > BENCH_MEM_BUF_SIZE - 8)) {
+		CMD_ERR("invalid size %u\n", size);
+		return CMD_STATUS_INVALID_ARG;
+	}
+	if (size) {
+		sizes = &size;
+		cnt = 1;
+	}
+
+	dst = cmd_malloc(BENCH_MEM_BUF_SIZE);
+	src = cmd_malloc(BENCH_MEM_BUF_SIZE);
+	if (dst == NULL || src == NULL) {
+		CMD_ERR("no memory\n");
+		cmd_free(dst);
+		cmd_free(src);
+		return CMD_STATUS_FAIL;
+	}
+
+	printf("size d/s %s\n", title);
+	for (s = 0; s < cnt; ++s) {
+		n = sizes[s];
+		for (da = 0; da < 4; ++da) {
+			for (sa = 0; sa < 4; ++sa) {
+				printf("%4u %u/%u", n, da, sa);
+				fn(dst, src, da, sa, n);
+				printf("\n");
+			}
+		}
+	}
+
+	cmd_free(dst);
+	cmd_free(src);
+	return CMD_STATUS_OK;
+}
+
+static void bench_mem_case(uint8_t *dst, uint8_t *src, uint32_t da,
+                           uint32_t sa, uint32_t n)
+{
+	printf(" %8u %8u %8u",
+	       bench_mem_copy(memcpy, dst + da, src + sa, n, 0),
+	       bench_mem_copy(memmove, src + sa + 4, src + sa, n, 1),
+	       bench_mem_set(memset, dst + da, n));
+#if BENCH_MEM_ROM
+	printf(" %8u %8u %8u",
+	       bench_mem_copy(__rom_wrap_memcpy, dst + da, src + sa, n, 0),
+	       bench_mem_copy(__rom_wrap_memmove, src + sa + 4, src + sa, n, 1),
+	       bench_mem_set(__rom_wrap_memset, dst + da, n));
+#endif
+}
+
+/*
+ * benchmark mem [size]
+ *   MB/s of memcpy/memmove/memset for each destination/source alignment,
+ *   0 means a wrong result. With CONFIG_LIBC_WRAP_MEM, the ROM versions are
+ *   measured too.
+ */
+static enum cmd_status cmd_mem_exec(char *cmd)
+{
+	static const uint32_t sizes[] = { 16, 64, 256, 1460, 4096 };
+
+	return bench_buf_exec(cmd, sizes, cmd_nitems(sizes),
+	                      "  memcpy  memmove   memset"
+#if BENCH_MEM_ROM
+	                      "  rom_cpy  rom_mov  rom_set"
+#endif
+	                      , bench_mem_case);
+}
+
+#if (LWIP_CHECKSUM_ON_COPY && defined(LWIP_CHKSUM_COPY))
+/* @return MB/s, 0 if the result is wrong */
+static uint32_t bench_chksum_copy(int fused, uint8_t *dst, uint8_t *src,
+                                  uint32_t size)
+{
+	uint32_t i, loop = BENCH_MEM_BYTES / size;
+	u16_t sum, ref;
+	uint64_t t;
+
+	bench_mem_fill(src, size, size);
+	ref = inet_chksum(src, (u16_t)size);
+	t = HAL_RTC_GetFreeRunTime();
+	if (fused) {
+		for (i = 0; i < loop; ++i)
+			sum = ~LWIP_CHKSUM_COPY(dst, src, (u16_t)size);
+	} else {
+		for (i = 0; i < loop; ++i) {
+			memcpy(dst, src, size);
+			sum = inet_chksum(dst, (u16_t)size);
+		}
+	}
+	t = HAL_RTC_GetFreeRunTime() - t;
+
+	if (sum != ref || memcmp(dst, src, size))
+		return 0;
+	return t ? (uint32_t)((uint64_t)loop * size / t) : 0;
+}
+
+static void bench_chksum_case(uint8_t *dst, uint8_t *src, uint32_t da,
+                              uint32_t sa, uint32_t n)
+{
+	printf(" %8u %8u", bench_chksum_copy(0, dst + da, src + sa, n),
+	       bench_chksum_copy(1, dst + da, src + sa, n));
+}
+
+/*
+ * benchmark chksum [size]
+ *   MB/s of memcpy() + inet_chksum() and of the fused LWIP_CHKSUM_COPY()
+ *   used by lwIP for TCP/UDP data, for each destination/source alignment,
+ *   0 means a wrong result.
+ */
+static enum cmd_status cmd_chksum_exec(char *cmd)
+{
+	static const uint32_t sizes[] = { 64, 536, 1460 };
+
+	return bench_buf_exec(cmd, sizes, cmd_nitems(sizes), " cpy+sum    fused",
+	                      bench_chksum_case);
+}
+#endif /* (LWIP_CHECKSUM_ON_COPY && defined(LWIP_CHKSUM_COPY)) */
+
+static int bench_u32_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+#define BENCH_EVQ_ITEMS     2000
+
+/* item: priority in the high half, push order in the low half */
+static int bench_evq_compare(uint32_t newArg, uint32_t oldArg)
+{
+	return (newArg >> 16) > (oldArg >> 16);
+}
+
+struct bench_evq {
+	container_base *heap;
+	OS_Semaphore_t done;
+	uint32_t fail;          /* updated by both threads */
+	uint32_t *push_us;      /* time of each push call, by push order */
+	uint32_t *lat_us;       /* push to pop latency, by push order */
+};
+
+static void bench_evq_consumer(void *arg)
+{
+	struct bench_evq *b = arg;
+	uint32_t i, item;
+
+	for (i = 0; i < BENCH_EVQ_ITEMS; ++i) {
+		if (b->heap->pop(b->heap, &item, OS_WAIT_FOREVER) != 0) {
+			__atomic_fetch_add(&b->fail, 1, __ATOMIC_RELAXED);
+			continue;
+		}
+		item &= 0xffff;
+		b->lat_us[item] = (uint32_t)HAL_RTC_GetFreeRunTime() - b->push_us[item];
+	}
+	OS_SemaphoreRelease(&b->done);
+	OS_ThreadDelete(NULL);
+}
+
+static void bench_evq_print(const char *name, uint32_t *us, uint32_t n)
+{
+	qsort(us, n, sizeof(uint32_t), bench_u32_compare);
+	printf("%s us: p50 %u, p99 %u, max %u\n", name, us[n / 2],
+	       us[n * 99 / 100], us[n - 1]);
+}
+
+/*
+ * benchmark evq [size]
+ *   sys_ctrl priority event queue of size slots, 8 by default.
+ *   - fill and drain it in one thread, check the priority and FIFO order,
+ *     print the us per push and per pop
+ *   - push BENCH_EVQ_ITEMS items to a consumer thread, blocking while the
+ *     queue is full, print the items/s and the p50/p99/max us of a push call
+ *     and from the push call to the pop
+ */
+static enum cmd_status cmd_evq_exec(char *cmd)
+{
+	struct bench_evq b;
+	OS_Thread_t thd;
+	uint32_t *push_cost;
+	uint32_t size = 8, i, item, prev = 0, err = 0;
+	uint64_t t, t_push, t_pop;
+
+	if (cmd_sscanf(cmd, "%u", &size) == 1 && (size == 0 || size > 0xffff)) {
+		CMD_ERR("invalid size %u\n", size);
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	memset(&b, 0, sizeof(b));
+	b.heap = prio_heap_create(size, bench_evq_compare);
+	if (b.heap == NULL) {
+		CMD_ERR("no memory\n");
+		return CMD_STATUS_FAIL;
+	}
+
+	t = HAL_RTC_GetFreeRunTime();
+	for (i = 0; i < size; ++i) {
+		if (b.heap->push(b.heap, ((i * 7) % 5) << 16 | i, 0) != 0)
+			err++;
+	}
+	t_push = HAL_RTC_GetFreeRunTime() - t;
+	t = HAL_RTC_GetFreeRunTime();
+	for (i = 0; i < size; ++i) {
+		if (b.heap->pop(b.heap, &item, 0) != 0 ||
+		    (i && (item >> 16 > prev >> 16 ||
+		           (item >> 16 == prev >> 16 && item < prev))))
+			err++;
+		prev = item;
+	}
+	t_pop = HAL_RTC_GetFreeRunTime() - t;
+	printf("size %u: push %u us, pop %u us per item, %s\n", size,
+	       (uint32_t)(t_push / size), (uint32_t)(t_pop / size),
+	       err ? "wrong order" : "order ok");
+
+	push_cost = cmd_malloc(3 * BENCH_EVQ_ITEMS * sizeof(uint32_t));
+	if (push_cost == NULL) {
+		CMD_ERR("no memory\n");
+		b.heap->deinit(b.heap);
+		return CMD_STATUS_FAIL;
+	}
+	b.push_us = push_cost + BENCH_EVQ_ITEMS;
+	b.lat_us = b.push_us + BENCH_EVQ_ITEMS;
+	memset(b.lat_us, 0, BENCH_EVQ_ITEMS * sizeof(uint32_t));
+	if (OS_SemaphoreCreate(&b.done, 0, 1) != OS_OK) {
+		CMD_ERR("sem create failed\n");
+		err = 1;
+		goto out;
+	}
+	OS_ThreadSetInvalid(&thd);
+	if (OS_ThreadCreate(&thd, "bench_evq", bench_evq_consumer, &b,
+	                    OS_PRIORITY_NORMAL, 1024) != OS_OK) {
+		CMD_ERR("thread create failed\n");
+		OS_SemaphoreDelete(&b.done);
+		err = 1;
+		goto out;
+	}
+	t_push = HAL_RTC_GetFreeRunTime();
+	for (i = 0; i < BENCH_EVQ_ITEMS; ++i) {
+		t = HAL_RTC_GetFreeRunTime();
+		b.push_us[i] = (uint32_t)t; /* seen by the consumer after the push */
+		if (b.heap->push(b.heap, (i & 0x3) << 16 | i, OS_WAIT_FOREVER) != 0)
+			__atomic_fetch_add(&b.fail, 1, __ATOMIC_RELAXED);
+		push_cost[i] = (uint32_t)(HAL_RTC_GetFreeRunTime() - t);
+	}
+	OS_SemaphoreWait(&b.done, OS_WAIT_FOREVER);
+	t_push = HAL_RTC_GetFreeRunTime() - t_push;
+	printf("%u items: %u items/s, %u failed\n", BENCH_EVQ_ITEMS,
+	       t_push ? (uint32_t)((uint64_t)BENCH_EVQ_ITEMS * 1000000 / t_push) : 0,
+	       __atomic_load_n(&b.fail, __ATOMIC_RELAXED));
+	bench_evq_print("push", push_cost, BENCH_EVQ_ITEMS);
+	bench_evq_print("push to pop", b.lat_us, BENCH_EVQ_ITEMS);
+	OS_SemaphoreDelete(&b.done);
+
+out:
+	cmd_free(push_cost);
+	b.heap->deinit(b.heap);
+	return (err || b.fail) ? CMD_STATUS_FAIL : CMD_STATUS_OK;
+}
+
+#if (defined(CONFIG_OS_RTTHREAD) && defined(RT_USING_HEAP))
+#define BENCH_HEAP_SLOTS    64
+#define BENCH_HEAP_OPS_MAX  100000
+
+static uint32_t bench_heap_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 8;
+}
+
+/* mostly small objects, then RX frames and a few large buffers */
+static uint32_t bench_heap_size(uint32_t r)
+{
+	switch (r % 10) {
+	case 0:
+		return 2048 + (r >> 4) % 6144;
+	case 1:
+	case 2:
+	case 3:
+		return 1536 + (r >> 4) % 128;
+	default:
+		return 16 + (r >> 4) % 240;
+	}
+}
+
+/* the largest block rt_malloc() can return now, by bisection */
+static uint32_t bench_heap_largest(uint32_t hi)
+{
+	uint32_t lo = 0, mid;
+	void *p;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		p = rt_malloc(mid);
+		if (p) {
+			rt_free(p);
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+#ifdef RT_USING_HOOK
+/* a recorded rt_malloc (size > 0) or rt_free (size 0) call */
+struct bench_heap_rec {
+	void *ptr;
+	uint32_t size;
+};
+
+static struct bench_heap_rec *g_heap_rec;
+static uint32_t g_heap_rec_max;
+static uint32_t g_heap_rec_cnt;
+
+static void bench_heap_rec_add(void *ptr, uint32_t size)
+{
+	uint32_t i = __atomic_fetch_add(&g_heap_rec_cnt, 1, __ATOMIC_RELAXED);
+
+	if (i < g_heap_rec_max) {
+		g_heap_rec[i].ptr = ptr;
+		g_heap_rec[i].size = size;
+	}
+}
+
+static void bench_heap_malloc_hook(void *ptr, rt_size_t size)
+{
+	bench_heap_rec_add(ptr, size);
+}
+
+static void bench_heap_free_hook(void *ptr)
+{
+	bench_heap_rec_add(ptr, 0);
+}
+
+/*
+ * benchmark heap record [calls]
+ *   record the next calls (2000 by default) of rt_malloc and rt_free in RAM,
+ *   a realloc is recorded as the malloc and free it makes, if any.
+ * benchmark heap dump
+ *   stop recording and print the trace in the heap_replay format of
+ *   tools/host_test, "a <addr> <size>" and "f <addr>".
+ */
+static enum cmd_status cmd_heap_record_exec(char *cmd)
+{
+	uint32_t calls = 2000, i, n;
+
+	rt_malloc_sethook(NULL);
+	rt_free_sethook(NULL);
+
+	if (cmd_strncmp(cmd, "dump", 4) == 0) {
+		if (g_heap_rec == NULL) {
+			CMD_ERR("not recorded\n");
+			return CMD_STATUS_FAIL;
+		}
+		n = g_heap_rec_cnt < g_heap_rec_max ? g_heap_rec_cnt : g_heap_rec_max;
+		for (i = 0; i < n; ++i) {
+			if (g_heap_rec[i].size)
+				printf("a %x %u\n", (uint32_t)(uintptr_t)g_heap_rec[i].ptr,
+				       g_heap_rec[i].size);
+			else
+				printf("f %x\n", (uint32_t)(uintptr_t)g_heap_rec[i].ptr);
+		}
+		if (g_heap_rec_cnt > g_heap_rec_max)
+			CMD_WRN("%u calls not recorded\n", g_heap_rec_cnt - g_heap_rec_max);
+		cmd_free(g_heap_rec);
+		g_heap_rec = NULL;
+		return CMD_STATUS_OK;
+	}
+
+	if (cmd_sscanf(cmd + 6, "%u", &calls) == 1 &&
+	    (calls == 0 || calls > BENCH_HEAP_OPS_MAX)) {
+		CMD_ERR("invalid calls %u, 1 to %u\n", calls, BENCH_HEAP_OPS_MAX);
+		return CMD_STATUS_INVALID_ARG;
+	}
+	if (g_heap_rec)
+		cmd_free(g_heap_rec);
+	g_heap_rec = cmd_malloc(calls * sizeof(struct bench_heap_rec));
+	if (g_heap_rec == NULL) {
+		CMD_ERR("no memory\n");
+		return CMD_STATUS_FAIL;
+	}
+	g_heap_rec_max = calls;
+	g_heap_rec_cnt = 0;
+	rt_malloc_sethook(bench_heap_malloc_hook);
+	rt_free_sethook(bench_heap_free_hook);
+	return CMD_STATUS_OK;
+}
+#endif /* RT_USING_HOOK */
+
+/*
+ * benchmark heap [ops]
+ *   replay a fixed pseudo-random trace of ops (5000 by default, at most
+ *   BENCH_HEAP_OPS_MAX) rt_malloc, rt_realloc and rt_free calls over 64
+ *   slots, then print the cpu cycles per call at p50, p99, p99.9 and max.
+ *   With the trace blocks still held, the fragmentation is the part of the
+ *   free memory outside the largest block that can be allocated. Run it on
+ *   each heap algorithm to compare. Recorded traces are replayed on the host,
+ *   see "benchmark heap record".
+ */
+static enum cmd_status cmd_heap_exec(char *cmd)
+{
+	void *slot[BENCH_HEAP_SLOTS];
+	void *p;
+	uint32_t *cyc;
+	uint32_t ops = 5000, seed = 1, fail = 0, i, n, r, t;
+	rt_uint32_t total, used, max_used, largest;
+
+#ifdef RT_USING_HOOK
+	if (cmd_strncmp(cmd, "record", 6) == 0 || cmd_strncmp(cmd, "dump", 4) == 0)
+		return cmd_heap_record_exec(cmd);
+#endif
+
+	if (cmd_sscanf(cmd, "%u", &ops) == 1 &&
+	    (ops == 0 || ops > BENCH_HEAP_OPS_MAX)) {
+		CMD_ERR("invalid ops %u, 1 to %u\n", ops, BENCH_HEAP_OPS_MAX);
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	cyc = cmd_malloc(ops * sizeof(uint32_t));
+	if (cyc == NULL) {
+		CMD_ERR("no memory\n");
+		return CMD_STATUS_FAIL;
+	}
+	memset(slot, 0, sizeof(slot));
+	rt_hw_cycle_init();
+
+	for (i = 0; i < ops; ++i) {
+		n = bench_heap_rand(&seed) % BENCH_HEAP_SLOTS;
+		r = bench_heap_rand(&seed);
+		if (slot[n] == NULL) {
+			t = rt_hw_cycle_get();
+			p = rt_malloc(bench_heap_size(r));
+			t = rt_hw_cycle_get() - t;
+			if (p == NULL)
+				fail++;
+			slot[n] = p;
+		} else if (r % 4 == 0) {
+			t = rt_hw_cycle_get();
+			p = rt_realloc(slot[n], bench_heap_size(r >> 2));
+			t = rt_hw_cycle_get() - t;
+			if (p == NULL)
+				fail++;
+			else
+				slot[n] = p;
+		} else {
+			t = rt_hw_cycle_get();
+			rt_free(slot[n]);
+			t = rt_hw_cycle_get() - t;
+			slot[n] = NULL;
+		}
+		cyc[i] = t;
+	}
+
+	rt_memory_info(&total, &used, &max_used);
+	largest = bench_heap_largest(total - used);
+	for (n = 0; n < BENCH_HEAP_SLOTS; ++n) {
+		if (slot[n])
+			rt_free(slot[n]);
+	}
+
+	qsort(cyc, ops, sizeof(uint32_t), bench_u32_compare);
+	printf("%u ops, %u failed, cycles at %u MHz: p50 %u, p99 %u, "
+	       "p99.9 %u, max %u\n", ops, fail, HAL_GetCPUClock() / 1000000,
+	       cyc[ops / 2], cyc[ops * 99 / 100],
+	       cyc[(uint32_t)((uint64_t)ops * 999 / 1000)], cyc[ops - 1]);
+	printf("free %u, largest %u, fragmentation %u%%\n", total - used,
+	       largest, total > used ?
+	       100 - (uint32_t)((uint64_t)largest * 100 / (total - used)) : 0);
+
+	cmd_free(cyc);
+	return CMD_STATUS_OK;
+}
+#endif /* (defined(CONFIG_OS_RTTHREAD) && defined(RT_USING_HEAP)) */
+
+#if (defined(CONFIG_OTA) && OTA_OPT_PIPELINE_WRITE)
+#define BENCH_OTA_CHUNK     1460    /* one TCP segment per push */
+
+/*
+ * benchmark ota overwrite [kb] [ms]
+ *   push kb KB (256 by default) of dummy data to the OTA update area in TCP
+ *   segment sized chunks, sleeping ms (10 by default) per 4 KB to stand in
+ *   for the download. Print the pipelined write time against the sum of the
+ *   download, erase and program time a sequential writer would take.
+ *   Note: it overwrites the update area, a downloaded image there is lost,
+ *   hence the "overwrite" argument. The delta mode and skip size are turned
+ *   off while it runs and restored after. The image check at the end fails
+ *   on the dummy data as expected.
+ */
+static enum cmd_status cmd_ota_bench_exec(char *cmd)
+{
+	ota_write_stat_t stat;
+	uint8_t *buf;
+	uint32_t kb = 256, ms = 10, size, len, pushed = 0, sleep_ms = 0, i;
+	ota_status_t status = OTA_STATUS_OK;
+	int32_t skip_size;
+	uint8_t delta;
+
+	if (cmd_strncmp(cmd, "overwrite", 9) != 0 || (cmd[9] != '\0' && cmd[9] != ' ')) {
+		CMD_ERR("it overwrites the OTA update area, "
+		        "run \"benchmark ota overwrite [kb] [ms]\"\n");
+		return CMD_STATUS_INVALID_ARG;
+	}
+	if (cmd_sscanf(cmd + 9, "%u %u", &kb, &ms) >= 1 && kb == 0) {
+		CMD_ERR("invalid size %u\n", kb);
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	buf = cmd_malloc(BENCH_OTA_CHUNK);
+	if (buf == NULL) {
+		CMD_ERR("no memory\n");
+		return CMD_STATUS_FAIL;
+	}
+	for (i = 0; i < BENCH_OTA_CHUNK; ++i)
+		buf[i] = (uint8_t)i;
+
+	if (ota_push_init() != OTA_STATUS_OK) {
+		cmd_free(buf);
+		return CMD_STATUS_FAIL;
+	}
+	delta = ota_get_delta();
+	skip_size = ota_get_skip_size();
+	ota_set_delta(0);
+	ota_set_skip_size(0);
+	if (ota_push_start() != OTA_STATUS_OK) {
+		CMD_ERR("ota push start failed\n");
+		status = OTA_STATUS_ERROR;
+		goto out;
+	}
+
+	size = kb * 1024;
+	while (pushed < size) {
+		len = size - pushed;
+		if (len > BENCH_OTA_CHUNK)
+			len = BENCH_OTA_CHUNK;
+		if (ota_push_data(buf, len) != OTA_STATUS_OK) {
+			CMD_ERR("ota push failed at %u, update area too small?\n", pushed);
+			status = OTA_STATUS_ERROR;
+			goto out;
+		}
+		/* a 4 KB boundary is crossed */
+		if (ms && (pushed >> 12) != ((pushed + len) >> 12)) {
+			OS_MSleep(ms);
+			sleep_ms += ms;
+		}
+		pushed += len;
+	}
+	ota_push_finish(); /* flushes the writer, the image check fails */
+
+	ota_get_write_stat(&stat);
+	printf("%u KB: pipelined %u ms, sequential %u ms "
+	       "(download %u, erase %u, program %u)\n",
+	       stat.write_size / 1024, stat.total_ms,
+	       sleep_ms + stat.erase_ms + stat.program_ms,
+	       sleep_ms, stat.erase_ms, stat.program_ms);
+	printf("flash stall %u ms, network stall %u ms\n",
+	       stat.flash_stall_ms, stat.network_stall_ms);
+
+out:
+	ota_push_stop();
+	ota_set_delta(delta);
+	ota_set_skip_size(skip_size);
+	cmd_free(buf);
+	return status == OTA_STATUS_OK ? CMD_STATUS_OK : CMD_STATUS_FAIL;
+}
+#endif /* (defined(CONFIG_OTA) && OTA_OPT_PIPELINE_WRITE) */
+
 static const struct cmd_data g_benchmark_cmds[] = {
 	{ "coremark",   cmd_coremark_exec },
 	{ "dhrystonre", cmd_dhrystonre_exec },
 	{ "whetstone",  cmd_whetstone_exec },
+	{ "mem",        cmd_mem_exec },
+#if (LWIP_CHECKSUM_ON_COPY && defined(LWIP_CHKSUM_COPY))
+	{ "chksum",     cmd_chksum_exec },
+#endif
+	{ "evq",        cmd_evq_exec },
+#if (defined(CONFIG_OS_RTTHREAD) && defined(RT_USING_HEAP))
+	{ "heap",       cmd_heap_exec },
+#endif
+#if (defined(CONFIG_OTA) && OTA_OPT_PIPELINE_WRITE)
+	{ "ota",        cmd_ota_bench_exec },
+#endif
 };
 
 enum cmd_status cmd_benchmark_exec(char *cmd)
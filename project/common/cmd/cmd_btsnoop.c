@@ -63,13 +63,50 @@ enum cmd_status cmd_btsnoop_shut_down_exec(char *cmd)
 	return CMD_STATUS_OK;
 }
 
+#ifdef CONFIG_FILESYSTEMS
+/* $btsnoop start_up_file <path> */
+enum cmd_status cmd_btsnoop_start_up_file_exec(char *cmd)
+{
+	int ret;
+
+	if (cmd[0] == '\0') {
+		CMD_ERR("invalid argument\n");
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	ret = btsnoop_start_up_file(cmd);
+	if (ret != 0) {
+		CMD_ERR("btsnoop_start_up_file failed: %d\n", ret);
+		return CMD_STATUS_FAIL;
+	}
+	return CMD_STATUS_OK;
+}
+#endif
+
+/* $btsnoop status */
+enum cmd_status cmd_btsnoop_status_exec(char *cmd)
+{
+	uint32_t packets, dropped_packets;
+
+	btsnoop_get_stat(&packets, &dropped_packets);
+	cmd_write_respond(CMD_STATUS_OK, "packets %u, dropped %u",
+	                  packets, dropped_packets);
+	return CMD_STATUS_ACKED;
+}
+
 /*
 	$btsnoop start_up
+	$btsnoop start_up_file <path>
 	$btsnoop shut_down
+	$btsnoop status
 */
 static const struct cmd_data g_btsnoop_cmds[] = {
 	{ "start_up",      cmd_btsnoop_start_up_exec },
+#ifdef CONFIG_FILESYSTEMS
+	{ "start_up_file", cmd_btsnoop_start_up_file_exec },
+#endif
 	{ "shut_down",     cmd_btsnoop_shut_down_exec },
+	{ "status",        cmd_btsnoop_status_exec },
 };
 
 enum cmd_status cmd_btsnoop_exec(char *cmd)
@@ -27,6 +27,7 @@
  *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
 #include <string.h>
 
 #include "cmd_util.h"
@@ -90,11 +91,48 @@ static enum cmd_status cmd_console_write_exec(char *cmd)
 	return CMD_STATUS_OK;
 }
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+/*
+ * console stdio [level <0~15> | flush]
+ *   print the asynchronous stdout statistics, set the log level, or wait
+ *   for the queued output to be written out
+ */
+static enum cmd_status cmd_console_stdio_exec(char *cmd)
+{
+	struct stdio_async_stat stat;
+	uint32_t level;
+
+	if (cmd_strncmp(cmd, "level", 5) == 0) {
+		if (cmd_sscanf(cmd + 5, "%u", &level) != 1 || level > 0xF) {
+			CMD_ERR("invalid level\n");
+			return CMD_STATUS_INVALID_ARG;
+		}
+		stdio_log_set_level(level);
+		return CMD_STATUS_OK;
+	} else if (cmd_strcmp(cmd, "flush") == 0) {
+		return stdio_async_flush(1000) == 0 ? CMD_STATUS_OK : CMD_STATUS_FAIL;
+	} else if (cmd[0] != '\0') {
+		CMD_ERR("invalid cmd %s\n", cmd);
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	stdio_async_get_stat(&stat);
+	CMD_LOG(1, "records %u, bytes %u, dropped %u (%u bytes), filtered %u, "
+	        "used max %u, log level %d\n", stat.records, stat.bytes,
+	        stat.dropped, stat.dropped_bytes, stat.filtered, stat.used_max,
+	        stdio_log_get_level());
+	return CMD_STATUS_OK;
+}
+#endif /* CONFIG_LIBC_STDIO_ASYNC */
+
 static const struct cmd_data g_console_cmds[] = {
 	{ "enable",         cmd_console_enable_exec },
 	{ "disable",        cmd_console_disable_exec },
 	{ "get",            cmd_console_get_exec },
 	{ "write",          cmd_console_write_exec },
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	{ "stdio",          cmd_console_stdio_exec },
+#endif
 };
 
 enum cmd_status cmd_console_exec(char *cmd)
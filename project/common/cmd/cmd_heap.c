@@ -30,6 +30,12 @@
 #include "cmd_util.h"
 #include "debug/heap_trace.h"
 #include "sys/sys_heap.h"
+#if (defined(CONFIG_WLAN) && (CONFIG_MBUF_IMPL_MODE == 0))
+#include "sys/mbuf.h"
+#define CMD_HEAP_MBUF_POOL  MBUF_OPT_LIMIT_MEM
+#else
+#define CMD_HEAP_MBUF_POOL  0
+#endif
 
 extern void heap_get_space(uint8_t **start, uint8_t **end, uint8_t **current);
 extern void psram_heap_get_space(uint8_t **start, uint8_t **end, uint8_t **current);
@@ -98,12 +104,34 @@ enum cmd_status cmd_heap_info_exec(char *cmd)
 	return CMD_STATUS_ACKED;
 }
 
+/* heap site [verbose] */
+enum cmd_status cmd_heap_site_exec(char *cmd)
+{
+	heap_trace_site_show(cmd_atoi(cmd));
+
+	return CMD_STATUS_ACKED;
+}
+
+#endif
+
+#if CMD_HEAP_MBUF_POOL
+/* heap mbuf [verbose] */
+enum cmd_status cmd_heap_mbuf_exec(char *cmd)
+{
+	mb_pool_info(cmd_atoi(cmd));
+
+	return CMD_STATUS_ACKED;
+}
 #endif
 
 static const struct cmd_data g_heap_cmds[] = {
 	{ "space",    cmd_heap_space_exec },
 #if defined(CONFIG_MALLOC_TRACE) || defined(CONFIG_PSRAM_MALLOC_TRACE)
 	{ "info",     cmd_heap_info_exec },
+	{ "site",     cmd_heap_site_exec },
+#endif
+#if CMD_HEAP_MBUF_POOL
+	{ "mbuf",     cmd_heap_mbuf_exec },
 #endif
 };
 
@@ -35,8 +35,23 @@
 /*
  * ota file <url>
  * ota http <url>
+ * ota stat
+ * ota delta <0|1>
  */
 
+static void cmd_ota_show_stat(void)
+{
+	ota_write_stat_t stat;
+
+	if (ota_get_write_stat(&stat) != OTA_STATUS_OK)
+		return;
+
+	CMD_LOG(1, "OTA write %u bytes in %u ms, erase %u ms, program %u ms, "
+	        "flash stall %u ms, network stall %u ms\n",
+	        stat.write_size, stat.total_ms, stat.erase_ms, stat.program_ms,
+	        stat.flash_stall_ms, stat.network_stall_ms);
+}
+
 #if (OTA_OPT_PROTOCOL_FILE && (defined CONFIG_FAT_FS))
 enum cmd_status cmd_ota_file_exec(char *cmd)
 {
@@ -59,6 +74,7 @@ enum cmd_status cmd_ota_file_exec(char *cmd)
 		CMD_ERR("OTA file get image failed\n");
 		return CMD_STATUS_ACKED;
 	}
+	cmd_ota_show_stat();
 
 	if (ota_get_verify_data(&verify_data) != OTA_STATUS_OK) {
 		verify_type  = OTA_VERIFY_NONE;
@@ -97,6 +113,7 @@ enum cmd_status cmd_ota_http_exec(char *cmd)
 		CMD_ERR("OTA http get image failed\n");
 		return CMD_STATUS_ACKED;
 	}
+	cmd_ota_show_stat();
 
 	if (ota_get_verify_data(&verify_data) != OTA_STATUS_OK) {
 		verify_type  = OTA_VERIFY_NONE;
@@ -117,6 +134,27 @@ enum cmd_status cmd_ota_http_exec(char *cmd)
 }
 #endif /* OTA_OPT_PROTOCOL_HTTP */
 
+static enum cmd_status cmd_ota_stat_exec(char *cmd)
+{
+	cmd_ota_show_stat();
+	return CMD_STATUS_OK;
+}
+
+static enum cmd_status cmd_ota_delta_exec(char *cmd)
+{
+	int enable;
+
+	if (cmd_sscanf(cmd, "%d", &enable) != 1) {
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	if (ota_set_delta(enable) != OTA_STATUS_OK) {
+		CMD_ERR("OTA delta image is not supported\n");
+		return CMD_STATUS_FAIL;
+	}
+	return CMD_STATUS_OK;
+}
+
 static enum cmd_status cmd_ota_help_exec(char *cmd);
 
 static const struct cmd_data g_ota_cmds[] = {
@@ -126,6 +164,8 @@ static const struct cmd_data g_ota_cmds[] = {
 #if (OTA_OPT_PROTOCOL_HTTP && PRJCONF_NET_EN)
 	{ "http",  cmd_ota_http_exec, CMD_DESC("http <url>, ota from http, eg. ota http http://192.168.1.1/xr_system.img") },
 #endif
+	{ "stat",  cmd_ota_stat_exec, CMD_DESC("show flash write statistics of the last download") },
+	{ "delta", cmd_ota_delta_exec, CMD_DESC("delta <0|1>, the next image is a patch against the running image, made by tools/ota_delta.py") },
 	{ "help",  cmd_ota_help_exec, CMD_DESC(CMD_HELP_DESC) },
 };
 
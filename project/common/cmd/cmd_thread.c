@@ -28,6 +28,7 @@
  */
 
 #include "cmd_util.h"
+#include "kernel/os/os_cpuusage.h"
 
 enum cmd_status cmd_thread_list_exec(char *cmd)
 {
@@ -35,10 +36,177 @@ enum cmd_status cmd_thread_list_exec(char *cmd)
 	return CMD_STATUS_ACKED;
 }
 
+/* thread cpu [print_s] */
+enum cmd_status cmd_thread_cpu_exec(char *cmd)
+{
+	if (cmd[0] != '\0') {
+		OS_CpuUsageInit(cmd_atoi(cmd));
+	} else {
+		OS_CpuUsageShow();
+	}
+	return CMD_STATUS_ACKED;
+}
+
+#define THREAD_PROF_MAX         32
+#define THREAD_PROF_MAGIC       0x46525054  /* "TPRF" */
+#define THREAD_PROF_VERSION     1
+#define THREAD_PROF_NAME_LEN    8
+
+/*
+ * Binary dump, little endian, read by tools/thread_prof.py. Each structure
+ * is printed as a line "@tprof <hex>", the header first.
+ */
+struct thread_prof_hdr {
+	uint32_t magic;
+	uint8_t  version;
+	uint8_t  count;         /* records following */
+	uint16_t rec_size;
+	uint32_t time_ms;
+};
+
+struct thread_prof_rec {
+	char     name[THREAD_PROF_NAME_LEN];
+	uint8_t  priority;
+	char     state;
+	uint16_t reserved;
+	uint32_t stack_size;
+	uint32_t stack_free_min;
+	uint32_t runs;
+	uint32_t preempts;
+	uint32_t latency_max_us;
+	uint32_t latency_avg_us;
+};
+
+static void cmd_thread_prof_print_hex(const void *data, uint32_t size)
+{
+	const uint8_t *p = data;
+	uint32_t i;
+
+	printf("@tprof ");
+	for (i = 0; i < size; ++i) {
+		printf("%02x", p[i]);
+	}
+	printf("\n");
+}
+
+static void cmd_thread_prof_dump(const OS_ThreadProfile_t *prof, int n)
+{
+	struct thread_prof_hdr hdr;
+	struct thread_prof_rec rec;
+	int i;
+
+	hdr.magic = THREAD_PROF_MAGIC;
+	hdr.version = THREAD_PROF_VERSION;
+	hdr.count = n;
+	hdr.rec_size = sizeof(rec);
+	hdr.time_ms = OS_TicksToMSecs(OS_GetTicks());
+	cmd_thread_prof_print_hex(&hdr, sizeof(hdr));
+
+	for (i = 0; i < n; ++i) {
+		cmd_memset(&rec, 0, sizeof(rec));
+		cmd_strlcpy(rec.name, prof[i].name, sizeof(rec.name));
+		rec.priority = prof[i].priority;
+		rec.state = prof[i].state;
+		rec.stack_size = prof[i].stack_size;
+		rec.stack_free_min = prof[i].stack_free_min;
+		rec.runs = prof[i].runs;
+		rec.preempts = prof[i].preempts;
+		rec.latency_max_us = prof[i].latency_max_us;
+		rec.latency_avg_us = prof[i].latency_avg_us;
+		cmd_thread_prof_print_hex(&rec, sizeof(rec));
+	}
+}
+
+/* thread prof [reset|dump] */
+enum cmd_status cmd_thread_prof_exec(char *cmd)
+{
+	OS_ThreadProfile_t *prof;
+	int i, n;
+
+	if (cmd_strcmp(cmd, "reset") == 0) {
+		OS_ThreadProfileReset();
+		return CMD_STATUS_OK;
+	} else if (cmd[0] != '\0' && cmd_strcmp(cmd, "dump") != 0) {
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	prof = cmd_malloc(THREAD_PROF_MAX * sizeof(OS_ThreadProfile_t));
+	if (prof == NULL) {
+		return CMD_STATUS_FAIL;
+	}
+	n = OS_ThreadProfileGet(prof, THREAD_PROF_MAX);
+	if (n < 0) {
+		cmd_free(prof);
+		CMD_ERR("thread profile unsupported\n");
+		return CMD_STATUS_FAIL;
+	}
+
+	if (cmd[0] != '\0') {
+		cmd_thread_prof_dump(prof, n);
+	} else {
+		printf("%-15s Pri St StkSize StkFree Runs       Preempts   "
+		       "LatMax(us) LatAvg(us)\n", "Name");
+		for (i = 0; i < n; ++i) {
+			printf("%-15s %-3u %-2c %-7u %-7u %-10u %-10u %-10u %u\n",
+			       prof[i].name, prof[i].priority, prof[i].state,
+			       prof[i].stack_size, prof[i].stack_free_min,
+			       prof[i].runs, prof[i].preempts,
+			       prof[i].latency_max_us, prof[i].latency_avg_us);
+		}
+	}
+	cmd_free(prof);
+	return CMD_STATUS_ACKED;
+}
+
+#define THREAD_MUTEX_MAX        64
+
+/* thread mutex [reset] */
+enum cmd_status cmd_thread_mutex_exec(char *cmd)
+{
+	OS_MutexStat_t *stat;
+	int i, n;
+
+	if (cmd_strcmp(cmd, "reset") == 0) {
+		OS_MutexStatReset();
+		return CMD_STATUS_OK;
+	} else if (cmd[0] != '\0') {
+		return CMD_STATUS_INVALID_ARG;
+	}
+
+	stat = cmd_malloc(THREAD_MUTEX_MAX * sizeof(OS_MutexStat_t));
+	if (stat == NULL) {
+		return CMD_STATUS_FAIL;
+	}
+	n = OS_MutexStatGet(stat, THREAD_MUTEX_MAX);
+	if (n < 0) {
+		cmd_free(stat);
+		CMD_ERR("mutex statistics unsupported\n");
+		return CMD_STATUS_FAIL;
+	}
+
+	printf("%-8s %-8s Acquires   Contended  WaitTotal(us) WaitMax(us) "
+	       "HoldMax(us)\n", "Name", "Owner");
+	for (i = 0; i < n; ++i) {
+		/* the unused ones are only noise */
+		if (stat[i].acquires == 0 && stat[i].contended == 0) {
+			continue;
+		}
+		printf("%-8s %-8s %-10u %-10u %-13llu %-11u %u\n",
+		       stat[i].name, stat[i].owner, stat[i].acquires,
+		       stat[i].contended, stat[i].wait_total_us,
+		       stat[i].wait_max_us, stat[i].hold_max_us);
+	}
+	cmd_free(stat);
+	return CMD_STATUS_ACKED;
+}
+
 static enum cmd_status cmd_thread_help_exec(char *cmd);
 
 static const struct cmd_data g_thread_cmds[] = {
 	{ "list",    cmd_thread_list_exec, CMD_DESC("show the thread list") },
+	{ "cpu",     cmd_thread_cpu_exec,  CMD_DESC("cpu [print_s], show cpu usage or print it every print_s seconds") },
+	{ "prof",    cmd_thread_prof_exec, CMD_DESC("prof [reset|dump], show, clear or dump the stack and scheduling profile") },
+	{ "mutex",   cmd_thread_mutex_exec, CMD_DESC("mutex [reset], show or clear the mutex contention statistics") },
 	{ "help",    cmd_thread_help_exec, CMD_DESC(CMD_HELP_DESC) },
 };
 
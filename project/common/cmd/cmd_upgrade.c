@@ -33,6 +33,13 @@
 
 #define CMD_REBOOT_BY_WDG    1
 
+/* let the asynchronous stdout write the response out before reset */
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+#define cmd_reboot_flush()  stdio_async_flush(500)
+#else
+#define cmd_reboot_flush()  do { } while (0)
+#endif
+
 #if CMD_REBOOT_BY_WDG
 
 #include "driver/chip/hal_wdg.h"
@@ -40,6 +47,7 @@
 enum cmd_status cmd_reboot(PRCM_CPUABootFlag flag)
 {
 	cmd_write_respond(CMD_STATUS_OK, cmd_get_status_desc(CMD_STATUS_OK));
+	cmd_reboot_flush();
 
 	HAL_PRCM_SetCPUABootFlag(flag);
 	HAL_WDG_Reboot();
@@ -60,6 +68,7 @@ enum cmd_status cmd_reboot(PRCM_CPUABootFlag flag)
 	uint32_t handler;
 
 	cmd_write_respond(CMD_STATUS_OK, cmd_get_status_desc(CMD_STATUS_OK));
+	cmd_reboot_flush();
 	cmd_msleep(10);
 
 	HAL_PRCM_SetCPUABootFlag(flag);
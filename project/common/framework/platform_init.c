@@ -284,19 +284,19 @@ static void platform_wdg_feed(void *arg)
 
 static void platform_wdg_start(void)
 {
-	OS_Timer_t timer;
+	static OS_TimerStatic_t timer;
 
 	/* create OS timer to feed watchdog */
-	OS_TimerSetInvalid(&timer);
-	if (OS_TimerCreate(&timer, OS_TIMER_PERIODIC, platform_wdg_feed, NULL,
-	                   PRJCONF_WDG_FEED_PERIOD) != OS_OK) {
+	OS_TimerSetInvalid(&timer.timer);
+	if (OS_TimerCreateStatic(&timer, OS_TIMER_PERIODIC, platform_wdg_feed, NULL,
+	                         PRJCONF_WDG_FEED_PERIOD) != OS_OK) {
 		FWK_WRN("wdg timer create failed\n");
 		HAL_WDG_DeInit();
 		return;
 	}
 
 	HAL_WDG_Start(); /* start watchdog */
-	OS_TimerStart(&timer); /* start OS timer to feed watchdog */
+	OS_TimerStart(&timer.timer); /* start OS timer to feed watchdog */
 }
 #endif /* PRJCONF_WDG_EN */
 
@@ -568,6 +568,12 @@ __weak const wlan_ap_default_conf_t g_wlan_ap_default_conf = {
 /* init standard platform hardware and services */
 __weak void platform_init_level1(void)
 {
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	if (stdio_async_start() != 0) {
+		FWK_WRN("stdio async start fail\n");
+	}
+#endif
+
 #if PRJCONF_WDG_EN
 	platform_wdg_init();
 	platform_wdg_start();
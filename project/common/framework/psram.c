@@ -66,7 +66,7 @@ static uint32_t dma_rburst0 = 0, dma_rburst1 = 0;
 __sram_data
 static uint32_t dma_rwidth0 = 0, dma_rwidth1 = 0;
 __sram_data
-static OS_Semaphore_t dmaSem;
+static OS_SemaphoreStatic_t dmaSem;
 __sram_data
 uint32_t dma_burst_type[2] = {DMA_BURST_LEN_1, DMA_BURST_LEN_4};
 __sram_data
@@ -75,7 +75,7 @@ uint32_t dma_width_type[3] = {DMA_DATA_WIDTH_8BIT, DMA_DATA_WIDTH_16BIT, DMA_DAT
 __sram_text
 static void psram_DMARelease(void *arg)
 {
-	OS_SemaphoreRelease(&dmaSem);
+	OS_SemaphoreRelease(&dmaSem.sem);
 }
 
 __sram_text
@@ -99,7 +99,7 @@ static int psram_dma_read_write(uint32_t write, uint32_t addr,
 		return -1;
 	}
 
-	OS_SemaphoreCreate(&dmaSem, 0, 1);
+	OS_SemaphoreCreateStatic(&dmaSem, 0, 1);
 
 	dmaParam.irqType = DMA_IRQ_TYPE_END;
 	dmaParam.endCallback = (DMA_IRQCallback)psram_DMARelease;
@@ -166,7 +166,7 @@ static int psram_dma_read_write(uint32_t write, uint32_t addr,
 	else
 		HAL_DMA_Start(dma_ch, (uint32_t)addr, (uint32_t)buf, len);
 
-	ret = OS_SemaphoreWait(&dmaSem, 5000);
+	ret = OS_SemaphoreWait(&dmaSem.sem, 5000);
 	if (ret != OS_OK)
 		PSRAM_ERR("sem wait failed: %d", ret);
 
@@ -177,7 +177,7 @@ static int psram_dma_read_write(uint32_t write, uint32_t addr,
 	HAL_PsramCtrl_DMACrossEnable(0);
 #endif
 
-	OS_SemaphoreDelete(&dmaSem);
+	OS_SemaphoreDelete(&dmaSem.sem);
 
 	return 0;
 }
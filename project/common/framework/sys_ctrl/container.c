@@ -45,190 +45,229 @@
 #define CONTAINER_NOTSUPPORT()          CONTAINER_ALERT("not support command")
 
 
-typedef struct list_node {
-	struct list_head node;
+typedef struct heap_node {
 	uint32_t arg;
-} list_node;
+	uint32_t seq;
+} heap_node;
 
-typedef struct sorted_list {
+/*
+ * Bounded priority queue based on a binary heap.
+ * The root of the heap is the item which should be popped next. Items with
+ * equal priority are popped in FIFO order by comparing the push sequence.
+ * @slots counts the free entries so that producers block on it instead of
+ * polling, @items counts the valid entries for consumers.
+ */
+typedef struct prio_heap {
 	container_base base;
-	OS_Semaphore_t sem;
-	OS_Mutex_t lock;
-	struct list_head head;
-	struct list_head pool;
-	list_node *poolBuf;
+	OS_SemaphoreStatic_t slots;
+	OS_SemaphoreStatic_t items;
+	OS_MutexStatic_t lock;
+	heap_node *heap;
+	uint32_t count;
+	uint32_t seq;
 	int (*compare)(uint32_t newArg, uint32_t oldArg);
-} sorted_list;
+} prio_heap;
 
-typedef struct sorted_list_config {
+typedef struct prio_heap_config {
 	uint32_t size;
-	int (*compare)(uint32_t oldArg, uint32_t newArg);
-} sorted_list_config;
+	int (*compare)(uint32_t newArg, uint32_t oldArg);
+} prio_heap_config;
+
+/* return non-zero if @a should be popped before @b */
+static __inline int prio_heap_before(prio_heap *impl, heap_node *a, heap_node *b)
+{
+	if (impl->compare(a->arg, b->arg))
+		return 1;
+	if (impl->compare(b->arg, a->arg))
+		return 0;
+	return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static void prio_heap_sift_up(prio_heap *impl, uint32_t idx)
+{
+	heap_node node = impl->heap[idx];
+	uint32_t parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) >> 1;
+		if (!prio_heap_before(impl, &node, &impl->heap[parent]))
+			break;
+		impl->heap[idx] = impl->heap[parent];
+		idx = parent;
+	}
+	impl->heap[idx] = node;
+}
+
+static void prio_heap_sift_down(prio_heap *impl, uint32_t idx)
+{
+	heap_node node = impl->heap[idx];
+	uint32_t child;
+
+	while ((child = (idx << 1) + 1) < impl->count) {
+		if (child + 1 < impl->count &&
+		    prio_heap_before(impl, &impl->heap[child + 1], &impl->heap[child]))
+			child++;
+		if (!prio_heap_before(impl, &impl->heap[child], &node))
+			break;
+		impl->heap[idx] = impl->heap[child];
+		idx = child;
+	}
+	impl->heap[idx] = node;
+}
 
-static int sorted_list_init(struct container_base *base, uint32_t config)
+static int prio_heap_init(struct container_base *base, uint32_t config)
 {
 	OS_Status ret1 = OS_FAIL;
 	OS_Status ret2 = OS_FAIL;
-	list_node *vec = NULL;
-	sorted_list_config *cfg = (sorted_list_config *)config;
-	sorted_list *impl = __containerof(base, sorted_list, base);
+	OS_Status ret3 = OS_FAIL;
+	prio_heap_config *cfg = (prio_heap_config *)config;
+	prio_heap *impl = __containerof(base, prio_heap, base);
 
-	INIT_LIST_HEAD(&impl->head);
-	INIT_LIST_HEAD(&impl->pool);
 	impl->base.size = cfg->size;
 	impl->compare = cfg->compare;
+	impl->count = 0;
+	impl->seq = 0;
 
-	ret1 = OS_SemaphoreCreateBinary(&impl->sem);
+	ret1 = OS_SemaphoreCreateStatic(&impl->slots, cfg->size, cfg->size);
 	if (ret1 != OS_OK)
 		goto failed;
 
-	ret2 = OS_MutexCreate(&impl->lock);
+	ret2 = OS_SemaphoreCreateStatic(&impl->items, 0, cfg->size);
 	if (ret2 != OS_OK)
 		goto failed;
 
-	vec = malloc(sizeof(list_node) * impl->base.size);
-	if (vec == NULL)
+	ret3 = OS_MutexCreateStatic(&impl->lock);
+	if (ret3 != OS_OK)
 		goto failed;
-	memset(vec, 0, sizeof(list_node) * impl->base.size);
-	impl->poolBuf = vec;
 
-	for (int i = impl->base.size; i-- > 0;) {
-		INIT_LIST_HEAD(&vec[i].node);
-		list_add_tail(&vec[i].node, &impl->pool);
-	}
+	impl->heap = malloc(sizeof(heap_node) * impl->base.size);
+	if (impl->heap == NULL)
+		goto failed;
+	memset(impl->heap, 0, sizeof(heap_node) * impl->base.size);
 
 	return 0;
 
 failed:
-	if (vec != NULL)
-		free(vec);
 	if (ret1 == OS_OK)
-		OS_SemaphoreDelete(&impl->sem);
+		OS_SemaphoreDelete(&impl->slots.sem);
 	if (ret2 == OS_OK)
-		OS_MutexDelete(&impl->lock);
-	if (impl != NULL)
-		free(impl);
+		OS_SemaphoreDelete(&impl->items.sem);
+	if (ret3 == OS_OK)
+		OS_MutexDelete(&impl->lock.mutex);
 
 	return -1;
 }
 
-static int sorted_list_deinit(struct container_base *base)
+static int prio_heap_deinit(struct container_base *base)
 {
-	sorted_list *impl = __containerof(base, sorted_list, base);
+	prio_heap *impl = __containerof(base, prio_heap, base);
 
 	/* TODO: flush the node left */
 
-	OS_SemaphoreDelete(&impl->sem);
-	OS_MutexDelete(&impl->lock);
-	if (impl->poolBuf != NULL)
-		free(impl->poolBuf);
-	if (impl != NULL)
-		free(impl);
+	OS_SemaphoreDelete(&impl->slots.sem);
+	OS_SemaphoreDelete(&impl->items.sem);
+	OS_MutexDelete(&impl->lock.mutex);
+	if (impl->heap != NULL)
+		free(impl->heap);
+	free(impl);
 
 	return 0;
 }
 
-static int sorted_list_control(struct container_base *base, uint32_t cmd, uint32_t arg)
+static int prio_heap_control(struct container_base *base, uint32_t cmd, uint32_t arg)
 {
-	sorted_list *impl = __containerof(base, sorted_list, base);
+	prio_heap *impl = __containerof(base, prio_heap, base);
 	/* TODO: tbc... */
 	(void)impl;
 	return -1;
 }
 
-static int sorted_list_push(struct container_base *base, uint32_t arg, uint32_t timeout)
+static int prio_heap_push(struct container_base *base, uint32_t arg, uint32_t timeout)
 {
-#define BLOCK_WAIT_EACHTIME (3)
-	sorted_list *impl = __containerof(base, sorted_list, base);
-	list_node *node = NULL;
-	list_node *tmp = NULL;
-
-	OS_MutexLock(&impl->lock, -1);    /* TODO: OS should move to event_queue */
-
-	/* 1. get 1 node from pool */
-	while ((node = list_first_entry_or_null(&impl->pool, list_node, node)) == NULL) {
-		OS_MutexUnlock(&impl->lock);
-		OS_MSleep(BLOCK_WAIT_EACHTIME);
-		if (timeout <= BLOCK_WAIT_EACHTIME) {
-			CONTAINER_ALERT("list full and timeout");
-
-			return -1;
-		}
-		OS_MutexLock(&impl->lock, -1);
-		timeout -= BLOCK_WAIT_EACHTIME;
-	}
-	node->arg = arg;
+	prio_heap *impl = __containerof(base, prio_heap, base);
+	uint32_t idx;
 
-	CONTAINER_DEBUG("get a node from pool");
+	/* 1. wait for a free slot, woken up by pop */
+	if (OS_SemaphoreWait(&impl->slots.sem, timeout) != OS_OK) {
+		CONTAINER_ALERT("heap full and timeout");
+		return -1;
+	}
 
-	/* 2. find a proper place and insert it */
-	list_for_each_entry(tmp, &impl->head, node) {
-		if (impl->compare(arg, tmp->arg) >= 0) {
-			tmp = list_prev_entry(tmp, node);
-			break;
-		}
+	/* 2. append to the heap and move it to a proper place */
+	OS_MutexLock(&impl->lock.mutex, OS_WAIT_FOREVER);
+	if (impl->count >= impl->base.size) {
+		CONTAINER_ERROR("heap full but slot got!");
+		OS_MutexUnlock(&impl->lock.mutex);
+		return -2;
 	}
-	list_add(&node->node, &tmp->node);
+	idx = impl->count++;
+	impl->heap[idx].arg = arg;
+	impl->heap[idx].seq = impl->seq++;
+	prio_heap_sift_up(impl, idx);
+	OS_MutexUnlock(&impl->lock.mutex);
 
-	CONTAINER_DEBUG("insert node to list");
+	CONTAINER_DEBUG("insert node to heap");
 
 	/* 3. release sem to pop */
-	OS_SemaphoreRelease(&impl->sem);
+	OS_SemaphoreRelease(&impl->items.sem);
 
-	OS_MutexUnlock(&impl->lock);
 	return 0;
 }
 
-static int sorted_list_pop(struct container_base *base, uint32_t *arg, uint32_t timeout)
+static int prio_heap_pop(struct container_base *base, uint32_t *arg, uint32_t timeout)
 {
-	sorted_list *impl = __containerof(base, sorted_list, base);
-	list_node *node = NULL;
-	OS_Status ret;
+	prio_heap *impl = __containerof(base, prio_heap, base);
 
-	ret = OS_SemaphoreWait(&impl->sem, timeout);
-	if (ret != OS_OK)
+	if (OS_SemaphoreWait(&impl->items.sem, timeout) != OS_OK)
 		return -1;
 
-	OS_MutexLock(&impl->lock, -1);
+	OS_MutexLock(&impl->lock.mutex, OS_WAIT_FOREVER);
 
-	/* 1. get node from list */
-	node = list_first_entry_or_null(&impl->head, list_node, node);
-	if (node == NULL) {
-		CONTAINER_ERROR("list empty but sem released!");
-		OS_MutexUnlock(&impl->lock);
+	/* 1. take the root */
+	if (impl->count == 0) {
+		CONTAINER_ERROR("heap empty but sem released!");
+		OS_MutexUnlock(&impl->lock.mutex);
 		return -2;
 	}
-	*arg = node->arg;
+	*arg = impl->heap[0].arg;
 
-	CONTAINER_DEBUG("get a node from list");
+	/* 2. move the last one to root and sift it down */
+	if (--impl->count > 0) {
+		impl->heap[0] = impl->heap[impl->count];
+		prio_heap_sift_down(impl, 0);
+	}
+	OS_MutexUnlock(&impl->lock.mutex);
 
-	/* 2. remove the node from this and push it to pool */
-	list_del(&node->node);
-	list_add_tail(&node->node, &impl->head);
+	CONTAINER_DEBUG("get a node from heap");
 
-	CONTAINER_DEBUG("remove a node from list and push it to pool");
+	/* 3. wake up the blocked pusher */
+	OS_SemaphoreRelease(&impl->slots.sem);
 
-	OS_MutexUnlock(&impl->lock);
 	return 0;
 }
 
-container_base *sorted_list_create(uint32_t size, int (*compare)(uint32_t newArg, uint32_t oldArg))
+container_base *prio_heap_create(uint32_t size, int (*compare)(uint32_t newArg, uint32_t oldArg))
 {
-	sorted_list *impl = malloc(sizeof(*impl));
+	prio_heap *impl;
+	prio_heap_config cfg;
+
+	if (size == 0 || compare == NULL)
+		return NULL;
+
+	impl = malloc(sizeof(*impl));
 	if (impl == NULL)
 		return NULL;
 	memset(impl, 0, sizeof(*impl));
 
-	sorted_list_config cfg;
 	cfg.compare = compare;
 	cfg.size = size;
 
-	impl->base.control = sorted_list_control;
-	impl->base.deinit = sorted_list_deinit;
-	impl->base.pop = sorted_list_pop;
-	impl->base.push = sorted_list_push;
+	impl->base.control = prio_heap_control;
+	impl->base.deinit = prio_heap_deinit;
+	impl->base.pop = prio_heap_pop;
+	impl->base.push = prio_heap_push;
 
-	if (sorted_list_init(&impl->base, (uint32_t)&cfg) != 0) 	{
+	if (prio_heap_init(&impl->base, (uint32_t)&cfg) != 0) {
 		CONTAINER_ERROR("init failed");
 		free(impl);
 		return NULL;
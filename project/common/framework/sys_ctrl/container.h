@@ -41,6 +41,11 @@ typedef struct container_base {
 	int (*pop)(struct container_base *base, uint32_t *item, uint32_t timeout);
 } container_base;
 
-container_base *sorted_list_create(uint32_t size, int (*compare)(uint32_t newArg, uint32_t oldArg));
+/*
+ * Create a bounded priority container.
+ * @compare return non-zero if newArg should be popped before oldArg,
+ *          items with equal priority are popped in FIFO order.
+ */
+container_base *prio_heap_create(uint32_t size, int (*compare)(uint32_t newArg, uint32_t oldArg));
 
 #endif /* CONTAINER_H_ */
@@ -118,7 +118,7 @@ struct event_queue *prio_event_queue_create(uint32_t queue_len, uint32_t msg_siz
 		return NULL;
 	memset(impl, 0, sizeof(*impl));
 
-	impl->container = sorted_list_create(queue_len, complare_event_msg);
+	impl->container = prio_heap_create(queue_len, complare_event_msg);
 	if (impl->container == NULL)
 		goto out;
 	impl->base.send = prio_event_send;
@@ -129,7 +129,7 @@ struct event_queue *prio_event_queue_create(uint32_t queue_len, uint32_t msg_siz
 	return &impl->base;
 
 out:
-	EVTMSG_ERROR("sorted_list_create failed");
+	EVTMSG_ERROR("prio_heap_create failed");
 	free(impl);
 	return NULL;
 }
@@ -137,7 +137,8 @@ out:
 
 typedef struct normal_event_queue {
 	event_queue base;
-	OS_Queue_t queue;
+	OS_QueueStatic_t queue;
+	uint32_t pool[]; /* OS_QUEUE_POOL_SIZE() bytes */
 } normal_event_queue;
 
 static int normal_event_queue_deinit(struct event_queue *base)
@@ -146,13 +147,13 @@ static int normal_event_queue_deinit(struct event_queue *base)
 	OS_Status ret;
 
 #if CTRL_MSG_VALIDITY_CHECK
-	if (!OS_QueueIsValid(&impl->queue)) {
+	if (!OS_QueueIsValid(&impl->queue.queue)) {
 		EVTMSG_ALERT("%s(), invalid queue %p", __func__, g_ctrl_msg_queue.handle);
 		return 0;
 	}
 #endif
 
-	ret = OS_QueueDelete(&impl->queue);
+	ret = OS_QueueDelete(&impl->queue.queue);
 	if (ret != OS_OK) {
 		EVTMSG_ERROR("%s() failed, err 0x%x", __func__, ret);
 		return -1;
@@ -173,13 +174,13 @@ static int normal_event_send(struct event_queue *base, struct event_msg *msg, ui
 	//EVTMSG_DEBUG("send event: 0x%x", msg->event);
 
 #if CTRL_MSG_VALIDITY_CHECK
-	if (!OS_QueueIsValid(&impl->queue)) {
-		//EVTMSG_ALERT("%s(), invalid queue %p", __func__, &impl->queue);
+	if (!OS_QueueIsValid(&impl->queue.queue)) {
+		//EVTMSG_ALERT("%s(), invalid queue %p", __func__, &impl->queue.queue);
 		return -1;
 	}
 #endif
 
-	ret = OS_QueueSend(&impl->queue, msg, wait_ms);
+	ret = OS_QueueSend(&impl->queue.queue, msg, wait_ms);
 	if (ret != OS_OK) {
 		//EVTMSG_ERROR("%s() failed, err 0x%x", __func__, ret);
 		return -1;
@@ -193,13 +194,13 @@ static int normal_event_recv(struct event_queue *base, struct event_msg *msg, ui
 	OS_Status ret;
 
 #if CTRL_MSG_VALIDITY_CHECK
-	if (!OS_QueueIsValid(&impl->queue)) {
-		EVTMSG_ALERT("%s(), invalid queue %p", __func__, &impl->queue);
+	if (!OS_QueueIsValid(&impl->queue.queue)) {
+		EVTMSG_ALERT("%s(), invalid queue %p", __func__, &impl->queue.queue);
 		return -1;
 	}
 #endif
 
-	ret = OS_QueueReceive(&impl->queue, msg, wait_ms);
+	ret = OS_QueueReceive(&impl->queue.queue, msg, wait_ms);
 	if (ret != OS_OK) {
 		EVTMSG_ERROR("%s() failed, err 0x%x", __func__, ret);
 		return -1;
@@ -212,7 +213,8 @@ static int normal_event_recv(struct event_queue *base, struct event_msg *msg, ui
 
 struct event_queue *normal_event_queue_create(uint32_t queue_len, uint32_t msg_size)
 {
-	normal_event_queue *impl = malloc(sizeof(*impl));
+	/* the queue and its pool are allocated with the event queue */
+	normal_event_queue *impl = malloc(sizeof(*impl) + OS_QUEUE_POOL_SIZE(queue_len, msg_size));
 	if (impl == NULL)
 		return NULL;
 	memset(impl, 0, sizeof(*impl));
@@ -223,13 +225,13 @@ struct event_queue *normal_event_queue_create(uint32_t queue_len, uint32_t msg_s
 
 
 #if CTRL_MSG_VALIDITY_CHECK
-	if (OS_QueueIsValid(&impl->queue)) {
+	if (OS_QueueIsValid(&impl->queue.queue)) {
 		EVTMSG_ALERT("control message queue already inited\n");
 		return -1;
 	}
 #endif
 
-	if (OS_QueueCreate(&impl->queue, queue_len, msg_size) != OS_OK) {
+	if (OS_QueueCreateStatic(&impl->queue, queue_len, msg_size, impl->pool) != OS_OK) {
 		EVTMSG_ERROR("%s() failed!", __func__);
 		goto out;
 	}
@@ -63,6 +63,7 @@ int observer_init(observer_base *base, uint32_t event,
 	obs->event = event;
 	obs->trigger = trigger;
 	obs->arg = arg;
+	obs->snap_ref = 0;
 	INIT_LIST_HEAD(&obs->node);
 
 	return 0;
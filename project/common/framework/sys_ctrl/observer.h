@@ -60,6 +60,12 @@ typedef struct observer_base {
 	int state;
 	void *arg;
 	void (*trigger)(struct observer_base *base, uint32_t event, uint32_t arg);
+	uint32_t snap_ref;    /* publisher snapshots referring to it */
+
+	/* trigger statistics, updated by publisher */
+	uint32_t trigger_cnt;
+	uint32_t trigger_total_ms;
+	uint32_t trigger_max_ms;
 } observer_base;
 
 /*
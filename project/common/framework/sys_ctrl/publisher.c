@@ -47,6 +47,7 @@
 
 
 #define PUBLISHER_THREAD_STACKSIZE (2 * 1024)
+#define PUBLISHER_RETRY_MS 10    /* detach() retries the snapshot without memory */
 
 static void atomic_set(int *var, uint32_t cnt)
 {
@@ -55,6 +56,162 @@ static void atomic_set(int *var, uint32_t cnt)
 	arch_irq_enable();
 }
 
+static uint32_t publisher_key(struct publisher_base *base, uint32_t event)
+{
+	return base->index ? base->index(event) : 0;
+}
+
+/*
+ * Snapshot of the observer list, observers are sorted by index key.
+ * notify() dispatches from a snapshot without holding base->lock, attach and
+ * detach build a new one and release the old one, the last user frees it.
+ * Every snapshot holds a reference on its observers, a detached observer
+ * becomes idle when the last snapshot referring to it is freed.
+ */
+
+/* drop a snapshot reference of @obs, must be called with irq disabled */
+static int publisher_obs_put(observer_base *obs)
+{
+	if (--obs->snap_ref == 0 && obs->state == OBSERVER_DETACHED
+	    && list_empty(&obs->node)) {
+		obs->state = OBSERVER_ILDE;
+		return 1;
+	}
+	return 0;
+}
+
+/* wake up the detach() waiting for an observer to be idle */
+static void publisher_idle_wakeup(struct publisher_base *base, int idle)
+{
+	unsigned long flags;
+	uint32_t n = 0;
+
+	if (!idle)
+		return;
+
+	flags = arch_irq_save();
+	n = base->idle_waiters;
+	base->idle_waiters = 0;
+	arch_irq_restore(flags);
+
+	while (n--)
+		OS_SemaphoreRelease(&base->idle_sem);
+}
+
+static void publisher_snapshot_free(struct publisher_base *base, publisher_snapshot *snap)
+{
+	observer_base *obs;
+	unsigned long flags;
+	int idle = 0;
+
+	flags = arch_irq_save();
+	for (uint32_t i = 0; i < snap->count; i++) {
+		obs = snap->entry[i].obs;
+		if (obs != NULL)
+			idle |= publisher_obs_put(obs);
+	}
+	arch_irq_restore(flags);
+
+	publisher_idle_wakeup(base, idle);
+	free(snap);
+}
+
+static publisher_snapshot *publisher_snapshot_get(struct publisher_base *base)
+{
+	publisher_snapshot *snap;
+	unsigned long flags;
+
+	flags = arch_irq_save();
+	snap = base->snapshot;
+	if (snap != NULL)
+		snap->ref++;
+	arch_irq_restore(flags);
+
+	return snap;
+}
+
+static void publisher_snapshot_put(struct publisher_base *base, publisher_snapshot *snap)
+{
+	unsigned long flags;
+	uint32_t ref;
+
+	if (snap == NULL)
+		return;
+
+	flags = arch_irq_save();
+	ref = --snap->ref;
+	arch_irq_restore(flags);
+
+	if (ref == 0)
+		publisher_snapshot_free(base, snap);
+}
+
+/* build a snapshot of base->head, NULL if empty, must be called with base->lock held */
+static int publisher_snapshot_build(struct publisher_base *base, publisher_snapshot **out)
+{
+	publisher_snapshot *snap = NULL;
+	observer_base *itor;
+	publisher_entry tmp;
+	uint32_t cnt = 0;
+	uint32_t i, j;
+
+	list_for_each_entry(itor, &base->head, node)
+		cnt++;
+
+	if (cnt != 0) {
+		snap = malloc(sizeof(*snap) + cnt * sizeof(publisher_entry));
+		if (snap == NULL) {
+			PUBLISHER_ERROR("no mem for %u observers", cnt);
+			return -1;
+		}
+		snap->ref = 1;
+		snap->count = cnt;
+
+		/* insertion sort by key, keep the attach order within a key */
+		i = 0;
+		list_for_each_entry(itor, &base->head, node) {
+			tmp.key = publisher_key(base, itor->event);
+			tmp.obs = itor;
+			for (j = i; j > 0 && snap->entry[j - 1].key > tmp.key; j--)
+				snap->entry[j] = snap->entry[j - 1];
+			snap->entry[j] = tmp;
+			i++;
+		}
+	}
+
+	*out = snap;
+	return 0;
+}
+
+/* replace the snapshot by @snap, must be called with base->lock held */
+static void publisher_snapshot_install(struct publisher_base *base, publisher_snapshot *snap)
+{
+	publisher_snapshot *old;
+	unsigned long flags;
+	uint32_t i;
+
+	flags = arch_irq_save();
+	for (i = 0; snap != NULL && i < snap->count; i++)
+		snap->entry[i].obs->snap_ref++;
+	old = base->snapshot;
+	base->snapshot = snap;
+	arch_irq_restore(flags);
+
+	publisher_snapshot_put(base, old);
+}
+
+/* must be called with base->lock held */
+static int publisher_snapshot_update(struct publisher_base *base)
+{
+	publisher_snapshot *snap;
+
+	if (publisher_snapshot_build(base, &snap) != 0)
+		return -1;
+
+	publisher_snapshot_install(base, snap);
+	return 0;
+}
+
 static int __attach(struct publisher_base *base, observer_base *obs, int once)
 {
 	int ret = 0;
@@ -65,21 +222,28 @@ static int __attach(struct publisher_base *base, observer_base *obs, int once)
 
 	PUBLISHER_DEBUG("new observe event: 0x%x", obs->event);
 
-	/* TODO: entry critical section to sync list */
 	OS_RecursiveMutexLock(&base->lock, -1);
-	if (obs->state == OBSERVER_DETACHED) {
-		obs->state = attach_state;
-	} else if (list_empty(&obs->node)) {
-		arch_irq_disable();
+	if (!list_empty(&obs->node)) {
+		if (obs->state == OBSERVER_DETACHED) {
+			/* triggered once but not reaped yet, still in the snapshot */
+			atomic_set(&obs->state, attach_state);
+		} else {
+			PUBLISHER_ALERT("new observe event: %u failed", obs->event);
+			ret = -1;
+		}
+	} else if (obs->state == OBSERVER_ILDE || obs->state == OBSERVER_DETACHED) {
 		list_add_tail(&obs->node, &base->head);
-		obs->state = attach_state;
-		arch_irq_enable();
+		if (publisher_snapshot_update(base) != 0) {
+			list_del(&obs->node);
+			ret = -1;
+		} else {
+			atomic_set(&obs->state, attach_state);
+		}
 	} else {
 		PUBLISHER_ALERT("new observe event: %u failed", obs->event);
 		ret = -1;
 	}
 	OS_RecursiveMutexUnlock(&base->lock);
-	/* TODO: exit critical section */
 
 	return ret;
 }
@@ -94,75 +258,223 @@ static int attach(struct publisher_base *base, observer_base *obs)
 	return __attach(base, obs, 0);
 }
 
+/* remove @obs from the snapshot being dispatched by the current thread */
+static int publisher_dispatch_drop(struct publisher_base *base, observer_base *obs)
+{
+	publisher_snapshot *snap = base->dispatch;
+	unsigned long flags;
+	int idle = 0;
+
+	if (snap == NULL || base->dispatcher != OS_ThreadGetCurrentHandle())
+		return 0;
+
+	flags = arch_irq_save();
+	for (uint32_t i = 0; i < snap->count; i++) {
+		if (snap->entry[i].obs == obs) {
+			snap->entry[i].obs = NULL;
+			idle |= publisher_obs_put(obs);
+		}
+	}
+	arch_irq_restore(flags);
+
+	return idle;
+}
+
+/* wait until no snapshot refers to @obs, so it can be destroyed */
+static void publisher_wait_idle(struct publisher_base *base, observer_base *obs)
+{
+	unsigned long flags;
+
+	while (1) {
+		flags = arch_irq_save();
+		if (obs->state != OBSERVER_DETACHED) {
+			arch_irq_restore(flags);
+			break;
+		}
+		base->idle_waiters++;
+		arch_irq_restore(flags);
+
+		OS_SemaphoreWait(&base->idle_sem, OS_WAIT_FOREVER);
+	}
+}
+
 static int detach(struct publisher_base *base, observer_base *obs)
 {
-	/* TODO: entry critical section to sync list or return failed */
+	int detached = 0;
+
 	OS_RecursiveMutexLock(&base->lock, -1); /* it can't call in interrupt, should be fixed */
-	if (base->state == PUBLISHER_IDLE) {
-		list_del(&obs->node);
-		obs->state = OBSERVER_ILDE;
-	} else {
+	if (!list_empty(&obs->node)) {
+		/*
+		 * notify() may still dispatch from the old snapshot, it skips
+		 * detached observers. the observer becomes idle after the last
+		 * snapshot which refers to it is released.
+		 */
 		atomic_set(&obs->state, OBSERVER_DETACHED);
+		list_del(&obs->node);
+		/* the old snapshot refers to @obs until a new one replaces it */
+		while (publisher_snapshot_update(base) != 0) {
+			OS_RecursiveMutexUnlock(&base->lock);
+			OS_MSleep(PUBLISHER_RETRY_MS);
+			OS_RecursiveMutexLock(&base->lock, -1);
+		}
+		detached = 1;
 	}
 	OS_RecursiveMutexUnlock(&base->lock);
-	/* TODO: exit critical section */
+
+	if (detached) {
+		/*
+		 * detached by a trigger function, notify() on this thread must
+		 * not touch the observer after the trigger function returns.
+		 * otherwise wait for notify() on the publisher thread to finish
+		 * with it.
+		 */
+		publisher_idle_wakeup(base, publisher_dispatch_drop(base, obs));
+		publisher_wait_idle(base, obs);
+	}
 
 	PUBLISHER_DEBUG("remove observe event: %d", obs->event);
 
 	return 0;
 }
 
-static int notify(struct publisher_base *base, uint32_t event, uint32_t arg)
+/*
+ * remove observers detached in trigger function. without memory for the new
+ * snapshot they are kept in the list, a later reap() or detach() removes them.
+ */
+static void reap(struct publisher_base *base)
 {
-	observer_base *obs = NULL;
 	observer_base *itor = NULL;
 	observer_base *safe = NULL;
+	publisher_snapshot *snap;
+	LIST_HEAD_DEF(reaped);
+
+	OS_RecursiveMutexLock(&base->lock, -1);
+	list_for_each_entry_safe(itor, safe, &base->head, node) {
+		if (itor->state == OBSERVER_DETACHED)
+			list_move_tail(&itor->node, &reaped);
+	}
+	if (publisher_snapshot_build(base, &snap) != 0) {
+		list_splice_tail(&reaped, &base->head);
+	} else {
+		/* unlinked before the old snapshot is released, so they can become idle */
+		list_for_each_entry_safe(itor, safe, &reaped, node)
+			list_del(&itor->node);
+		publisher_snapshot_install(base, snap);
+	}
+	OS_RecursiveMutexUnlock(&base->lock);
+}
+
+static int notify(struct publisher_base *base, uint32_t event, uint32_t arg)
+{
+	publisher_snapshot *snap;
+	observer_base *obs;
+	uint32_t key = publisher_key(base, event);
+	uint32_t lo, hi, mid;
+	uint32_t t0, t1, ms;
+	int detached = 0;
 	int cnt = 0;
 
 	/* TODO: define some event to debug, for example, event -1 can be detect how many observer now. */
 
-	OS_RecursiveMutexLock(&base->lock, -1);
+	snap = publisher_snapshot_get(base);
+	if (snap == NULL) {
+		PUBLISHER_DEBUG("no observer eyes on this event");
+		return 0;
+	}
 	atomic_set(&base->state, PUBLISHER_WORKING);
+	base->dispatcher = OS_ThreadGetCurrentHandle();
+	base->dispatch = snap;
+
+	/* find the first observer with the same key */
+	lo = 0;
+	hi = snap->count;
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (snap->entry[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
 	/* trigger observers */
-	list_for_each_entry(itor, &base->head, node) {
-		/* TODO: detect the observer if is locked by detach or sth else */
-		if (base->compare(event, itor->event) == 0
-		    && (itor->state == OBSERVER_ATTACHED || itor->state == OBSERVER_ATTACHED_ONCE)) {
-			obs = itor;
-			uint32_t t0 = OS_TicksToMSecs(OS_GetTicks());
-			obs->trigger(obs, event, arg);
-			uint32_t t1 = OS_TicksToMSecs(OS_GetTicks());
-
-			if (itor->state == OBSERVER_ATTACHED_ONCE)
-				obs->state = OBSERVER_DETACHED;
+	t0 = OS_GetTicks();
+	for (; lo < snap->count && snap->entry[lo].key == key; lo++) {
+		obs = snap->entry[lo].obs;
+		if (obs == NULL || base->compare(event, obs->event) != 0
+		    || (obs->state != OBSERVER_ATTACHED && obs->state != OBSERVER_ATTACHED_ONCE))
+			continue;
 
-#define OBSERVER_TRIGGER_OVERTIME 1000
-			if ((t1 - t0 > OBSERVER_TRIGGER_OVERTIME) && (OS_TimeAfter(t1, t0)))
-				PUBLISHER_ALERT("obs: %p callback run %d ms", obs, t1 - t0);
-			cnt++;
-		}
-	}
+		obs->trigger(obs, event, arg);
+		t1 = OS_GetTicks();
+		ms = OS_TicksToMSecs(t1 - t0);
+		t0 = t1;
+		cnt++;
 
-	/* remove observers detached in trigger function */
-	list_for_each_entry_safe(itor, safe, &base->head, node) {
-		if (itor->state == OBSERVER_DETACHED) {
-			list_del(&itor->node);
-			atomic_set(&itor->state, OBSERVER_ILDE);
+		/* detached and maybe destroyed by its trigger function */
+		if (snap->entry[lo].obs == NULL)
+			continue;
+
+		if (obs->state == OBSERVER_ATTACHED_ONCE) {
+			atomic_set(&obs->state, OBSERVER_DETACHED);
+			detached = 1;
 		}
+
+		obs->trigger_cnt++;
+		obs->trigger_total_ms += ms;
+		if (ms > obs->trigger_max_ms)
+			obs->trigger_max_ms = ms;
+#define OBSERVER_TRIGGER_OVERTIME 1000
+		if (ms > OBSERVER_TRIGGER_OVERTIME)
+			PUBLISHER_ALERT("obs: %p callback run %u ms", obs, ms);
 	}
 
+	base->dispatch = NULL;
+	base->dispatcher = NULL;
 	atomic_set(&base->state, PUBLISHER_IDLE);
-	OS_RecursiveMutexUnlock(&base->lock);
+	publisher_snapshot_put(base, snap);
 
-	if (obs == NULL) {
+	if (detached)
+		reap(base);
+
+	if (cnt == 0)
 		PUBLISHER_DEBUG("no observer eyes on this event");
-		return 0;
-	}
 
 	return cnt;
 }
 
+void publisher_show(struct publisher_base *base)
+{
+	publisher_snapshot *snap;
+	observer_base *obs;
+	observer_base tmp;
+	unsigned long flags;
+
+	snap = publisher_snapshot_get(base);
+	if (snap == NULL) {
+		printf("no observer\n");
+		return;
+	}
+
+	printf("%-10s %-10s %-5s %-10s %-8s %-8s\n",
+	       "observer", "event", "state", "count", "avg(ms)", "max(ms)");
+	for (uint32_t i = 0; i < snap->count; i++) {
+		/* a trigger function may detach and destroy it meanwhile */
+		flags = arch_irq_save();
+		obs = snap->entry[i].obs;
+		if (obs != NULL)
+			tmp = *obs;
+		arch_irq_restore(flags);
+		if (obs == NULL)
+			continue;
+		printf("%-10p 0x%08x %-5d %-10u %-8u %-8u\n",
+		       obs, tmp.event, tmp.state, tmp.trigger_cnt,
+		       tmp.trigger_cnt ? tmp.trigger_total_ms / tmp.trigger_cnt : 0,
+		       tmp.trigger_max_ms);
+	}
+
+	publisher_snapshot_put(base, snap);
+}
+
 /*
 static void main_publisher(void *arg)
 {
@@ -212,6 +524,10 @@ publisher_base *publisher_create(struct event_queue *queue, int (*compare)(uint3
 	memset(base, 0, sizeof(*base));
 
 	OS_Status ret = OS_RecursiveMutexCreate(&base->lock);
+	if (ret != OS_OK)
+		goto failed;
+	OS_MutexSetName(&base->lock, "publish");
+	ret = OS_SemaphoreCreate(&base->idle_sem, 0, OS_SEMAPHORE_MAX_COUNT);
 	if (ret != OS_OK)
 		goto failed;
 
@@ -238,7 +554,9 @@ publisher_base *publisher_create(struct event_queue *queue, int (*compare)(uint3
 	return base;
 
 failed:
-	if (ret == OS_OK)
+	if (OS_SemaphoreIsValid(&base->idle_sem))
+		OS_SemaphoreDelete(&base->idle_sem);
+	if (OS_MutexIsValid(&base->lock))
 		OS_RecursiveMutexDelete(&base->lock);
 	if (base != NULL)
 		free(base);
@@ -257,6 +575,12 @@ static struct publisher_factory *set_compare(struct publisher_factory *ctor, int
 	return ctor;
 }
 
+static struct publisher_factory *set_index(struct publisher_factory *ctor, uint32_t (*index)(uint32_t event))
+{
+	ctor->publisher->index = index;
+	return ctor;
+}
+
 static struct publisher_factory *set_thread_param(struct publisher_factory *ctor, OS_Priority prio, uint32_t stack)
 {
 	ctor->prio = prio;
@@ -290,6 +614,7 @@ static struct publisher_base *create_publisher(struct publisher_factory *ctor)
 	return publisher;
 
 failed:
+	OS_SemaphoreDelete(&publisher->idle_sem);
 	OS_RecursiveMutexDelete(&publisher->lock);
 	if (publisher != NULL)
 		free(publisher);
@@ -309,6 +634,10 @@ struct publisher_factory *publisher_factory_create(struct event_queue *queue)
 	memset(ctor, 0, sizeof(*ctor));
 
 	OS_Status ret = OS_RecursiveMutexCreate(&base->lock);
+	if (ret != OS_OK)
+		goto failed;
+	OS_MutexSetName(&base->lock, "publish");
+	ret = OS_SemaphoreCreate(&base->idle_sem, 0, OS_SEMAPHORE_MAX_COUNT);
 	if (ret != OS_OK)
 		goto failed;
 
@@ -324,6 +653,7 @@ struct publisher_factory *publisher_factory_create(struct event_queue *queue)
 	ctor->stack = 2 * 1024;
 	ctor->size = sizeof(struct event_msg);
 	ctor->set_compare = set_compare;
+	ctor->set_index = set_index;
 	ctor->set_thread_param = set_thread_param;
 	ctor->set_msg_size = set_msg_size;
 	ctor->create_publisher = create_publisher;
@@ -332,7 +662,7 @@ struct publisher_factory *publisher_factory_create(struct event_queue *queue)
 	return ctor;
 
 failed:
-	if (ret == OS_OK)
+	if (OS_MutexIsValid(&base->lock))
 		OS_RecursiveMutexDelete(&base->lock);
 	if (ctor != NULL)
 		free(ctor);
@@ -36,19 +36,36 @@
 #include "observer.h"
 #include "looper.h"
 
+typedef struct publisher_entry {
+	uint32_t key;
+	observer_base *obs;
+} publisher_entry;
+
+typedef struct publisher_snapshot {
+	uint32_t ref;
+	uint32_t count;
+	publisher_entry entry[0];    /* sorted by key */
+} publisher_snapshot;
+
 typedef struct publisher_base {
 	looper_base *looper;
-	struct list_head head;    /* TODO: it's more effective by 2-dimention list */
+	struct list_head head;
+	publisher_snapshot *snapshot;    /* immutable copy of head for notify */
 //	struct event_queue *queue;
 //	OS_Thread_t thd;
 	OS_Mutex_t lock;    // or uint32_t sync by atomic;
 	int state;
+	publisher_snapshot *dispatch;    /* snapshot notify() is dispatching from */
+	OS_ThreadHandle_t dispatcher;    /* thread running notify() */
+	OS_Semaphore_t idle_sem;         /* detach() waits for the observer to be idle */
+	uint32_t idle_waiters;
 
 	int (*touch)(struct publisher_base *base, observer_base *obs);
 	int (*attach)(struct publisher_base *base, observer_base *obs);
 	int (*detach)(struct publisher_base *base, observer_base *obs);
 	int (*notify)(struct publisher_base *base, uint32_t event, uint32_t arg);
 	int (*compare)(uint32_t newEvent, uint32_t obsEvent);
+	uint32_t (*index)(uint32_t event);    /* only observers with the same index will be compared */
 } publisher_base;
 
 typedef struct publisher_factory {
@@ -58,6 +75,7 @@ typedef struct publisher_factory {
 	uint32_t stack;
 	uint32_t size;
 	struct publisher_factory *(*set_compare)(struct publisher_factory *ctor, int (*compare)(uint32_t newEvent, uint32_t obsEvent));
+	struct publisher_factory *(*set_index)(struct publisher_factory *ctor, uint32_t (*index)(uint32_t event));
 	struct publisher_factory *(*set_thread_param)(struct publisher_factory *ctor, OS_Priority prio, uint32_t stack);
 	struct publisher_factory *(*set_msg_size)(struct publisher_factory *ctor, uint32_t size);
 	struct publisher_base *(*create_publisher)(struct publisher_factory *ctor);
@@ -76,4 +94,7 @@ publisher_base *publisher_create(struct event_queue *queue, int (*compare)(uint3
 /* a factory config publisher for create publisher. */
 struct publisher_factory *publisher_factory_create(struct event_queue *queue);
 
+/* show the observers and their trigger time statistics. */
+void publisher_show(struct publisher_base *base);
+
 #endif /* PUBLISHER_H_ */
@@ -80,6 +80,11 @@ static int compare(uint32_t newEvent, uint32_t obsEvent)
 	return -1;
 }
 
+static uint32_t event_index(uint32_t event)
+{
+	return EVENT_TYPE(event);
+}
+
 int sys_ctrl_create(void)
 {
 	uint32_t queue_len = PRJCONF_SYS_CTRL_QUEUE_LEN;
@@ -99,6 +104,7 @@ int sys_ctrl_create(void)
 		publisher_factory *ctor = publisher_factory_create(g_sys_queue);
 		g_sys_publisher = ctor->set_thread_param(ctor, PRJCONF_SYS_CTRL_PRIO, PRJCONF_SYS_CTRL_STACK_SIZE)
 		                      ->set_compare(ctor, compare)
+		                      ->set_index(ctor, event_index)
 		                      ->set_msg_size(ctor, sizeof(struct sys_ctrl_msg))
 		                      ->create_publisher(ctor);
 
@@ -135,6 +141,14 @@ int sys_ctrl_detach(observer_base *obs)
 	return g_sys_publisher->detach(g_sys_publisher, obs);
 }
 
+void sys_ctrl_show(void)
+{
+	if (g_sys_publisher == NULL)
+		return;
+
+	publisher_show(g_sys_publisher);
+}
+
 __nonxip_text
 static int event_send(event_queue *queue, uint16_t type, uint16_t subtype, uint32_t data, void (*destruct)(event_msg *), uint32_t wait_ms)
 {
@@ -195,18 +209,18 @@ int sys_event_handler_send_wait_finish(uint16_t type, uint16_t subtype, uint32_t
 		return -1;
 
 	int ret;
-	OS_Semaphore_t sem;
+	OS_SemaphoreStatic_t sem;
 	memset(&sem, 0, sizeof(sem));
-	OS_SemaphoreCreate(&sem, 0, 1);
+	OS_SemaphoreCreateStatic(&sem, 0, 1);
 
-	struct sys_ctrl_msg msg = {{exec, sys_handler_finish, MK_EVENT(type, subtype), data}, &sem};
+	struct sys_ctrl_msg msg = {{exec, sys_handler_finish, MK_EVENT(type, subtype), data}, &sem.sem};
 	ret = queue->send(queue, &msg.msg, wait_ms);
 	if (ret != 0)
 		goto out;
 
-	OS_SemaphoreWait(&sem, OS_WAIT_FOREVER);
+	OS_SemaphoreWait(&sem.sem, OS_WAIT_FOREVER);
 out:
-	OS_SemaphoreDelete(&sem);
+	OS_SemaphoreDelete(&sem.sem);
 	return ret;
 }
 
@@ -92,9 +92,17 @@ int sys_ctrl_touch(observer_base *obs);
 /** @brief Attach/regist a observer permanent */
 int sys_ctrl_attach(observer_base *obs);
 
-/** @brief Detach/unregist a observer, the touched observer no need to detach */
+/**
+ * @brief Detach/unregist a observer, the touched observer no need to detach
+ * @note Return after the observer is not used by the event dispatching any
+ *       more, then it can be destroyed. It's allowed to detach and destroy
+ *       the observer in its trigger function.
+ */
 int sys_ctrl_detach(observer_base *obs);
 
+/** @brief Show the attached observers and their trigger time statistics */
+void sys_ctrl_show(void);
+
 /** @brief Send a event with data, if the queue is full it will wait until timeout */
 int sys_event_send(uint16_t type, uint16_t subtype, uint32_t data, uint32_t wait_ms);
 
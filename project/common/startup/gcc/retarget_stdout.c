@@ -197,6 +197,26 @@ static int stdout_write(const char *buf, int len)
 	return board_uart_write(g_stdout_uart_id, buf, len);
 }
 
+#if (defined(CONFIG_LIBC_STDIO_ASYNC) && HAL_UART_OPT_DMA)
+static uint8_t g_stdout_dma = 0;
+
+/* called by the stdio thread only, which sleeps while DMA is transmitting */
+static int stdout_write_dma(const char *buf, int len)
+{
+	if (!g_stdout_enable || g_stdout_uart_id >= UART_NUM || len <= 0) {
+		return 0;
+	}
+
+#ifdef CONFIG_PM
+	if (g_stdio_suspending) {
+		return stdout_write(buf, len);
+	}
+#endif
+
+	return HAL_UART_Transmit_DMA(g_stdout_uart_id, (const uint8_t *)buf, len);
+}
+#endif
+
 int stdout_init(void)
 {
 	if (g_stdout_uart_id < UART_NUM) {
@@ -208,6 +228,12 @@ int stdout_init(void)
 #ifdef CONFIG_LIBC_WRAP_STDIO
 		stdio_set_write(stdout_write);
 #endif
+#if (defined(CONFIG_LIBC_STDIO_ASYNC) && HAL_UART_OPT_DMA)
+		if (HAL_UART_EnableTxDMA(g_stdout_uart_id) == HAL_OK) {
+			g_stdout_dma = 1;
+			stdio_set_async_write(stdout_write_dma);
+		}
+#endif
 #ifdef CONFIG_PM
 		if (!g_stdio_suspending) {
 			pm_register_ops(STDIO_DEV);
@@ -234,6 +260,14 @@ int stdout_deinit(void)
 	}
 #endif
 
+#if (defined(CONFIG_LIBC_STDIO_ASYNC) && HAL_UART_OPT_DMA)
+	if (g_stdout_dma) {
+		stdio_set_async_write(NULL);
+		HAL_UART_DisableTxDMA(g_stdout_uart_id);
+		g_stdout_dma = 0;
+	}
+#endif
+
 	if (board_uart_deinit(g_stdout_uart_id) == HAL_OK) {
 		g_stdout_uart_id = UART_NUM;
 #ifdef CONFIG_LIBC_WRAP_STDIO
@@ -83,6 +83,7 @@ static const struct cmd_data g_main_cmds[] = {
 	{ "mem",     cmd_mem_exec, CMD_DESC("memory command") },
 	{ "heap",    cmd_heap_exec, CMD_DESC("heap use information command") },
 	{ "thread",  cmd_thread_exec, CMD_DESC("thread information command") },
+	{ "sysctrl", cmd_sysctrl_exec, CMD_DESC("system control information command") },
 	{ "upgrade", cmd_upgrade_exec, CMD_DESC("upgrade command") },
 	{ "reboot",  cmd_reboot_exec, CMD_DESC("reboot command") },
 #ifdef CONFIG_OTA
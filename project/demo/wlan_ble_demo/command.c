@@ -130,6 +130,7 @@ static const struct cmd_data g_main_cmds[] = {
 	{ "mem",        cmd_mem_exec },
 	{ "heap",       cmd_heap_exec },
 	{ "thread",     cmd_thread_exec },
+	{ "sysctrl",    cmd_sysctrl_exec },
 	{ "upgrade",    cmd_upgrade_exec },
 	{ "reboot",     cmd_reboot_exec },
 #ifdef CONFIG_OTA
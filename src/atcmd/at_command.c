@@ -49,6 +49,7 @@
 #define CMD_CACHE_MAX_LEN       (1024)
 #define CMD_SEND_DATA_MAX_LEN   (1024 + 4)
 #define CMD_SEND_TIMEOUT        (10)
+#define CMD_QUEUE_SIZE          (1024) /* a power of 2 */
 
 char *c_atCmdRspBuf[1024 + 4];
 
@@ -551,6 +552,29 @@ AT_ERROR_CODE at_init(at_callback_t *cb)
 	return AEC_OK;
 }
 
+/**
+  * @brief  AT command initializer, the commands are received by a UART.
+  * @param    cb: AT command callback function
+  * @param    uart_id: the UART, initialized by the caller
+  * @retval AEC_OK: succeed        Other: fail
+  */
+AT_ERROR_CODE at_init_uart(at_callback_t *cb, UART_ID uart_id)
+{
+	static u8 queue_buf[CMD_QUEUE_SIZE];
+	AT_ERROR_CODE aec;
+
+	aec = at_init(cb);
+	if (aec != AEC_OK) {
+		return aec;
+	}
+
+	if (at_queue_init_uart(uart_id, queue_buf, sizeof(queue_buf)) != 0) {
+		return AEC_UNDEFINED;
+	}
+
+	return AEC_OK;
+}
+
 static AT_ERROR_CODE at_parse_cmd(char *cmdline, s32 size)
 {
 	char at_cmd[AT_CMD_MAX_SIZE + 1];
@@ -614,67 +638,65 @@ AT_ERROR_CODE at_parse(void)
 	AT_ERROR_CODE aec = AEC_OK;
 	AT_QUEUE_ERROR_CODE aqec = AQEC_EMPTY;
 	u8 tmp;
+	s32 n, eol;
 	u8 send_timeout_flag = 0;
 	u32 flag = 0;
 	u32 t0 = 0;
+	OS_Time_t wait;
 
 	memset(&send_cache, 0, sizeof(cmd_send_cache_t));
 	memset(&cache, 0, sizeof(cmd_cache_t));
 	while (1) {
+		/* block for input, or until the payload times out */
+		if (send_timeout_flag == 1) {
+			wait = OS_TicksToMSecs(OS_GetTicks() - t0);
+			wait = wait < CMD_SEND_TIMEOUT * 1000 ?
+			       CMD_SEND_TIMEOUT * 1000 - wait : 0;
+		} else {
+			wait = OS_WAIT_FOREVER;
+		}
+		if (send_cache.status == 0 ||
+		    send_cache.cnt < send_cache.length) {
+			at_queue_wait(wait);
+		}
 
-		aqec = at_queue_get(&tmp);
-		if (aqec == AQEC_OK) {
-			if (send_cache.status == 0) {
-				if (tmp == AT_LF) {
-					if (cache.cnt < CMD_CACHE_MAX_LEN) {
-						cache.buf[cache.cnt++] = tmp;
-					} else {
-						cache.cnt = 0;
-						AT_DBG("command is discarded!\n");
-						continue;    /* command is discarded */
-					}
-
-					flag = 1;
-				} else if (tmp == AT_CR) {
-					cache.buf[cache.cnt++] = tmp;
-
-					aqec = at_queue_peek(&tmp);
-					if (aqec == AQEC_OK && tmp == AT_LF) {
-						aqec = at_queue_get(&tmp);
-						if (cache.cnt < CMD_CACHE_MAX_LEN) {
+		if (send_cache.status == 0) {
+			/* a whole line at a time */
+			n = at_queue_read_line(cache.buf + cache.cnt,
+			                       CMD_CACHE_MAX_LEN - cache.cnt, &eol);
+			if (n > 0) {
+				cache.cnt += n;
+				if (eol) {
+					if (cache.buf[cache.cnt - 1] == AT_CR) {
+						aqec = at_queue_peek(&tmp);
+						if (aqec == AQEC_OK && tmp == AT_LF) {
+							at_queue_get(&tmp);
 							cache.buf[cache.cnt++] = tmp;
-						} else {
-							cache.cnt = 0;
-							AT_DBG("command is discarded!\n");
-							continue;    /* command is discarded */
 						}
 					}
 					flag = 1;
+				} else if (cache.cnt >= CMD_CACHE_MAX_LEN) {
+					cache.cnt = 0;
+					AT_DBG("command is discarded!\n");
+					continue;    /* command is discarded */
 				}
-			} else if (send_cache.status == 1) {
+			}
+		} else if (send_cache.status == 1) {
+			/* binary payload in bulk, complete at once if length is 0 */
+			n = at_queue_read(send_cache.buf + send_cache.cnt,
+			                  send_cache.length - send_cache.cnt);
+			if (n > 0) {
 				send_timeout_flag = 1;
 				t0 = OS_GetTicks();
-				send_cache.buf[send_cache.cnt++] = tmp;
-				if (send_cache.cnt >= send_cache.length) {
-					if (send_cache.cnt >= CMD_CACHE_MAX_LEN) {
-						send_cache.cnt = 0;
-					}
-					memset(&cache, 0, sizeof(cmd_cache_t));
-					memcpy(cache.buf, "AT+CIPSEND=0,1,u",
-					       sizeof("AT+CIPSEND=0,1,u"));
-					cache.cnt = sizeof("AT+CIPSEND=0,1,u");
-					flag = 1;
-					send_timeout_flag = 0;
-					continue;
-				}
+				send_cache.cnt += n;
 			}
-
-			if (cache.cnt < CMD_CACHE_MAX_LEN) {
-				cache.buf[cache.cnt++] = tmp;
-			} else {
-				cache.cnt = 0;
-				AT_DBG("command is discarded!\n");
-				continue;    /* command is discarded */
+			if (send_cache.cnt >= send_cache.length) {
+				memset(&cache, 0, sizeof(cmd_cache_t));
+				memcpy(cache.buf, "AT+CIPSEND=0,1,u",
+				       sizeof("AT+CIPSEND=0,1,u"));
+				cache.cnt = sizeof("AT+CIPSEND=0,1,u");
+				flag = 1;
+				send_timeout_flag = 0;
 			}
 		}
 
@@ -2838,7 +2860,8 @@ static AT_ERROR_CODE send_data_handler(at_para_t *at_para)
 
 
 		if (send_cache.status == 0) {
-			if (sendDataPara.linkId >= 4 || sendDataPara.bufferlen > CMD_SEND_DATA_MAX_LEN) {
+			if (sendDataPara.linkId >= 4 || sendDataPara.bufferlen == 0 ||
+			    sendDataPara.bufferlen > CMD_SEND_DATA_MAX_LEN) {
 				memset(&send_cache, 0, sizeof(cmd_send_cache_t));
 				return AEC_PARA_ERROR;
 			} else {
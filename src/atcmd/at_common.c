@@ -140,10 +140,8 @@ AT_ERROR_CODE at_reset(void)
 
 AT_ERROR_CODE at_mode(AT_MODE mode)
 {
-	AT_QUEUE_ERROR_CODE aqec;
 	at_callback_para_t para;
-	s32 len, escape_len;
-	u8 tmp;
+	s32 len, n, escape_len;
 
 	if (at_callback.handle_cb != NULL) {
 		memset(&para, 0, sizeof(para));
@@ -153,12 +151,13 @@ AT_ERROR_CODE at_mode(AT_MODE mode)
 			para.u.mode.buf = at_socket_buf;
 
 			len = 0;
+			at_queue_wait(OS_WAIT_FOREVER);
 
 			while (len < AT_SOCKET_BUFFER_SIZE) {
-				aqec = at_queue_get(&tmp);
+				n = at_queue_read(&at_socket_buf[len], AT_SOCKET_BUFFER_SIZE - len);
 
-				if (aqec == AQEC_OK) {
-					at_socket_buf[len++] = tmp;
+				if (n > 0) {
+					len += n;
 				} else {
 					break;
 				}
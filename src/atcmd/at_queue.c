@@ -31,21 +31,58 @@
 #include "at_private.h"
 #include "at_debug.h"
 
+#define AT_QUEUE_FILL_SIZE  64 /* bytes got by the callback at a time */
+
 static at_queue_callback_t at_queue_callback = NULL;
 static at_queue_t at_queue;
 
+/* bytes can be read, refill by callback if empty */
+static u32 at_queue_fill(at_queue_t *q)
+{
+	u8 buf[AT_QUEUE_FILL_SIZE];
+	u32 cnt;
+	s32 n;
+
+	cnt = OS_RingCount(&q->ring);
+	if (cnt > 0 || at_queue_callback == NULL || !OS_RingIsValid(&q->ring)) {
+		return cnt;
+	}
+
+	cnt = q->ring.mask + 1;
+	n = at_queue_callback(buf, cnt < sizeof(buf) ? cnt : sizeof(buf));
+	if (n > 0) {
+		return OS_RingPut(&q->ring, buf, n);
+	}
+	return 0;
+}
+
+/**
+  * @brief  Initialize the queue.
+  * @param  buf: the ring buffer, only the largest power of 2 bytes of size
+  *              are used
+  * @param  cb: called to fill the queue when it is empty, NULL if the data is
+  *             written by at_queue_write()
+  * @retval 0: succeed        Other: fail
+  */
 s32 at_queue_init(void *buf, s32 size, at_queue_callback_t cb)
 {
 	at_queue_t *q = &at_queue;
+	u32 num = 1;
 
-	if (buf == NULL || cb == NULL) {
+	if (buf == NULL || size <= 0) {
 		return -1;    /* null pointer */
 	}
 
-	memset(q, 0, sizeof(at_queue_t));
-
-	q->qbuf = buf;
-	q->qsize = size;
+	if (OS_RingIsValid(&q->ring)) {
+		OS_RingDelete(&q->ring);
+	}
+	while (num <= (u32)size / 2) {
+		num *= 2;
+	}
+	q->overflow = 0;
+	if (OS_RingCreate(&q->ring, num, 1, OS_RING_F_NOTIFY, buf) != OS_OK) {
+		return -1;
+	}
 
 	at_queue_callback = cb;
 
@@ -55,36 +92,12 @@ s32 at_queue_init(void *buf, s32 size, at_queue_callback_t cb)
 AT_QUEUE_ERROR_CODE at_queue_get(u8 *element)
 {
 	at_queue_t *q = &at_queue;
-	u8 winbuf[32];
-	s32 dcnt;
-
-	if (q->qcnt <= 0) {
-		if (at_queue_callback != NULL) {
-			dcnt = at_queue_callback(winbuf, sizeof(winbuf));
-
-			if (dcnt > 0) {
-				if (dcnt > q->qsize - q->qcnt) {
-					AT_DBG("queue is overflow\n");
-				} else {
-					s32 i;
-
-					for (i = 0; i < dcnt; i++) {
-						q->qbuf[q->widx++] = winbuf[i];
-						q->widx = q->widx >= q->qsize ? 0 : q->widx;
-						q->qcnt++;
-					}
-				}
-			} else {
-				return AQEC_EMPTY;
-			}
-		} else {
-			return AQEC_EMPTY;
-		}
+
+	if (at_queue_fill(q) == 0) {
+		return AQEC_EMPTY;
 	}
 
-	*element = q->qbuf[q->ridx++];
-	q->ridx = q->ridx >= q->qsize ? 0 : q->ridx;
-	q->qcnt--;
+	OS_RingGet(&q->ring, element, 1, 0);
 
 	return AQEC_OK;
 }
@@ -92,34 +105,144 @@ AT_QUEUE_ERROR_CODE at_queue_get(u8 *element)
 AT_QUEUE_ERROR_CODE at_queue_peek(u8 *element)
 {
 	at_queue_t *q = &at_queue;
-	u8 winbuf[32];
-	s32 dcnt;
-
-	if (q->qcnt <= 0) {
-		if (at_queue_callback != NULL) {
-			dcnt = at_queue_callback(winbuf, sizeof(winbuf));
-
-			if (dcnt > 0) {
-				if (dcnt > q->qsize - q->qcnt) {
-					AT_DBG("queue is overflow\n");
-				} else {
-					s32 i;
-
-					for (i = 0; i < dcnt; i++) {
-						q->qbuf[q->widx++] = winbuf[i];
-						q->widx = q->widx >= q->qsize ? 0 : q->widx;
-						q->qcnt++;
-					}
-				}
-			} else {
-				return AQEC_EMPTY;
-			}
-		} else {
-			return AQEC_EMPTY;
-		}
+
+	if (at_queue_fill(q) == 0) {
+		return AQEC_EMPTY;
 	}
 
-	*element = q->qbuf[q->ridx];
+	OS_RingPeek(&q->ring, element, 1, 0);
 
 	return AQEC_OK;
 }
+
+/**
+  * @brief  Read up to size bytes.
+  * @retval bytes read, 0 if empty
+  */
+s32 at_queue_read(u8 *buf, s32 size)
+{
+	at_queue_t *q = &at_queue;
+
+	if (size <= 0 || at_queue_fill(q) == 0) {
+		return 0;
+	}
+
+	return OS_RingGet(&q->ring, buf, size, 0);
+}
+
+/**
+  * @brief  Wait until there is data to read or waitMS elapsed.
+  * @retval bytes can be read, 0 on timeout
+  */
+s32 at_queue_wait(OS_Time_t waitMS)
+{
+	at_queue_t *q = &at_queue;
+	u32 cnt;
+	u8 c;
+
+	/* the callback blocks for data itself */
+	cnt = at_queue_fill(q);
+	if (cnt == 0 && at_queue_callback == NULL && OS_RingIsValid(&q->ring)) {
+		OS_RingPeek(&q->ring, &c, 1, waitMS);
+		cnt = OS_RingCount(&q->ring);
+	}
+
+	return cnt;
+}
+
+/**
+  * @brief  Read up to size bytes, stop after the first CR or LF.
+  * @param  eol: set to 1 if the last byte read is CR or LF, else 0
+  * @retval bytes read, 0 if empty
+  */
+s32 at_queue_read_line(u8 *buf, s32 size, s32 *eol)
+{
+	at_queue_t *q = &at_queue;
+	u32 n, i;
+
+	*eol = 0;
+	if (size <= 0 || at_queue_fill(q) == 0) {
+		return 0;
+	}
+
+	/* copy what is there, then take the bytes up to the line end only */
+	n = OS_RingPeek(&q->ring, buf, size, 0);
+	for (i = 0; i < n; i++) {
+		if (buf[i] == AT_CR || buf[i] == AT_LF) {
+			*eol = 1;
+			n = i + 1;
+			break;
+		}
+	}
+
+	return OS_RingGet(&q->ring, buf, n, 0);
+}
+
+/**
+  * @brief  Write data, can be called from ISR. Data not fit is dropped.
+  * @retval bytes written
+  */
+s32 at_queue_write(const u8 *buf, s32 size)
+{
+	at_queue_t *q = &at_queue;
+	s32 n;
+
+	if (size <= 0 || !OS_RingIsValid(&q->ring)) {
+		return 0;
+	}
+
+	n = OS_RingPut(&q->ring, buf, size);
+	if (n < size) {
+		q->overflow += size - n;
+		AT_DBG("queue is overflow\n");
+	}
+
+	return n;
+}
+
+/* UART RX interrupt, move the received bytes to the queue */
+static void at_queue_uart_rx_callback(void *arg)
+{
+	UART_T *uart = arg;
+	u8 buf[AT_QUEUE_FILL_SIZE];
+	s32 n = 0;
+
+	while (HAL_UART_IsRxReady(uart)) {
+		buf[n++] = HAL_UART_GetRxData(uart);
+		if (n == sizeof(buf)) {
+			at_queue_write(buf, n);
+			n = 0;
+		}
+	}
+	if (n > 0) {
+		at_queue_write(buf, n);
+	}
+}
+
+/**
+  * @brief  Initialize the queue, written by the RX interrupt of a UART.
+  * @note   The UART is initialized by the caller.
+  * @retval 0: succeed        Other: fail
+  */
+s32 at_queue_init_uart(UART_ID uart_id, void *buf, s32 size)
+{
+	UART_T *uart = HAL_UART_GetInstance(uart_id);
+
+	if (uart == NULL || at_queue_init(buf, size, NULL) != 0) {
+		return -1;
+	}
+
+	if (HAL_UART_EnableRxCallback(uart_id, at_queue_uart_rx_callback, uart) != HAL_OK) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+  * @brief  Stop writing the data received by the UART to the queue.
+  */
+void at_queue_deinit_uart(UART_ID uart_id)
+{
+	HAL_UART_DisableRxCallback(uart_id);
+}
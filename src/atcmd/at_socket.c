@@ -31,6 +31,8 @@
 #include "at_private.h"
 #include "at_debug.h"
 
+#define AT_SOCKW_TIMEOUT_MS  (10 * 1000) /* max time between 2 bytes of data */
+
 u8 at_socket_buf[AT_SOCKET_BUFFER_SIZE];
 
 AT_ERROR_CODE at_sockon(char *hostname, s32 port, char *protocol, char *ind)
@@ -79,7 +81,7 @@ AT_ERROR_CODE at_sockw(char *id, s32 len)
 	at_callback_para_t para;
 	char *cptr;
 	s32 rlen;
-	s32 i;
+	s32 i, n;
 
 	memset(&para, 0, sizeof(para));
 
@@ -91,9 +93,10 @@ AT_ERROR_CODE at_sockw(char *id, s32 len)
 
 		para.u.sockw.len = rlen;
 
-		for (i = 0; i < rlen; i++) {
-			while (at_queue_get(&at_socket_buf[i]) != AQEC_OK) {
-				;
+		for (i = 0; i < rlen; i += n) {
+			n = at_queue_read(&at_socket_buf[i], rlen - i);
+			if (n == 0 && at_queue_wait(AT_SOCKW_TIMEOUT_MS) == 0) {
+				return AEC_SEND_TIMEOUT;
 			}
 		}
 
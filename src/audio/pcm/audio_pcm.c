@@ -37,6 +37,9 @@
 #include "audio/drc/drc.h"
 #include "audio/eq/eq.h"
 #include "kernel/os/os_mutex.h"
+#ifdef CONFIG_OS_RTTHREAD
+#include "rthw.h"
+#endif
 
 #if (CONFIG_AUDIO_HEAP_MODE == 1)
 #include "sys/sys_heap.h"
@@ -75,6 +78,7 @@ struct play_priv {
 
 struct cap_priv {
 	uint8_t	 *cache;
+	uint32_t offset;    /* read position of the remain data in cache */
 	uint32_t length;
 	uint32_t half_buf_size;
 	uint32_t frame_bytes;
@@ -88,6 +92,10 @@ struct pcm_priv {
 	struct play_priv play_priv;
 	struct cap_priv  cap_priv;
 
+	//audio filter stages created in snd_pcm_open, index by stream dir
+	struct audio_filter *filter_stage[2][AUDIO_FILTER_MAX];
+	uint8_t filter_stage_nums[2];
+
 	//mutex
 	OS_Mutex_t play_lock;
 	OS_Mutex_t cap_lock;
@@ -279,6 +287,26 @@ int audio_filter_register(Snd_Card_Num card_num, Audio_Filter_Type filter_type,
 	return 0;
 }
 
+static void audio_filter_stage_remove(Snd_Card_Num card_num, struct audio_filter *audio_filter_ptr)
+{
+	uint8_t dir, i, j;
+	struct pcm_priv *audio_pcm_priv;
+
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		return;
+	}
+
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0, j = 0; i < audio_pcm_priv->filter_stage_nums[dir]; i++) {
+			if (audio_pcm_priv->filter_stage[dir][i] != audio_filter_ptr) {
+				audio_pcm_priv->filter_stage[dir][j++] = audio_pcm_priv->filter_stage[dir][i];
+			}
+		}
+		audio_pcm_priv->filter_stage_nums[dir] = j;
+	}
+}
+
 int audio_filter_unregister(Snd_Card_Num card_num, Audio_Filter_Type filter_type)
 {
 	int ret = -1;
@@ -300,6 +328,7 @@ int audio_filter_unregister(Snd_Card_Num card_num, Audio_Filter_Type filter_type
 	list_for_each_entry(audio_filter_ptr, &audio_filter_list, node) {
 		if (audio_filter_ptr->filter_type == filter_type &&
 		                audio_filter_ptr->card_num == card_num) {
+			audio_filter_stage_remove(card_num, audio_filter_ptr);
 			list_del(&audio_filter_ptr->node);
 			pcm_free(audio_filter_ptr->user_params);
 			pcm_free(audio_filter_ptr);
@@ -362,8 +391,27 @@ static int audio_filter_create_do(struct audio_filter *audio_filter_ptr, struct
 	}
 }
 
+/*
+ * The cycle counter is free running and shared with the cpu usage, thread
+ * profile and mutex statistics of the kernel, only take deltas of it.
+ */
+#ifdef CONFIG_OS_RTTHREAD
+#define audio_filter_cycle_init()   rt_hw_cycle_init()
+#define audio_filter_cycle_get()    rt_hw_cycle_get()
+#else
+static void audio_filter_cycle_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#define audio_filter_cycle_get()    (DWT->CYCCNT)
+#endif
+
 static void audio_filter_create(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir, struct pcm_config *pcm_cfg)
 {
+	uint8_t nums = 0;
+	struct pcm_priv *audio_pcm_priv;
 	struct audio_filter *audio_filter_ptr;
 
 	/* Check pcm config pointer to be valid */
@@ -372,26 +420,48 @@ static void audio_filter_create(Snd_Card_Num card_num, Audio_Stream_Dir stream_d
 		return;
 	}
 
-	/* Search audio filter matched to create */
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		AUDIO_FILTER_ERROR("Invalid sound card num [%d]!\n", (uint8_t)card_num);
+		return;
+	}
+
+	/* Search audio filter matched to create, and add to the stage array */
 	if (!list_empty(&audio_filter_list)) {
 		list_for_each_entry(audio_filter_ptr, &audio_filter_list, node) {
 			if (AUDIO_FILTER_DIR(audio_filter_ptr->filter_type) == stream_dir &&
 			          audio_filter_ptr->card_num == card_num) {
-				 audio_filter_create_do(audio_filter_ptr, pcm_cfg);
+				if (audio_filter_create_do(audio_filter_ptr, pcm_cfg) == 0 && nums < AUDIO_FILTER_MAX) {
+					audio_filter_ptr->process_cnt = 0;
+					audio_filter_ptr->process_cycles = 0;
+					audio_filter_ptr->process_max_cycles = 0;
+					audio_pcm_priv->filter_stage[stream_dir][nums++] = audio_filter_ptr;
+				}
 			}
 		}
 	}
+	audio_pcm_priv->filter_stage_nums[stream_dir] = nums;
+
+	if (nums)
+		audio_filter_cycle_init();
 }
 
 static void audio_filter_destroy(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir)
 {
+	struct pcm_priv *audio_pcm_priv;
 	struct audio_filter *audio_filter_ptr;
 
+	/* Clear the stage array before destroy */
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv != NULL) {
+		audio_pcm_priv->filter_stage_nums[stream_dir] = 0;
+	}
+
 	/* Search audio filter matched to destroy */
 	if (!list_empty(&audio_filter_list)) {
 		list_for_each_entry(audio_filter_ptr, &audio_filter_list, node) {
 			if (AUDIO_FILTER_DIR(audio_filter_ptr->filter_type) == stream_dir &&
-			           audio_filter_ptr->card_num == card_num) {
+			           audio_filter_ptr->card_num == card_num && audio_filter_ptr->handle) {
 				audio_filter_ptr->filter_destroy(audio_filter_ptr->handle);
 				audio_filter_ptr->handle = NULL;
 				AUDIO_FILTER_DEBUG("Snd card-[%d] audio filter-[%s] destroy success.\n",
@@ -404,6 +474,8 @@ static void audio_filter_destroy(Snd_Card_Num card_num, Audio_Stream_Dir stream_
 static int audio_filter_process(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir, uint8_t *buf, uint32_t size)
 {
 	int sample_nums;
+	uint8_t i, nums;
+	uint32_t start, cycles;
 	struct pcm_priv *audio_pcm_priv;
 	struct audio_filter *audio_filter_ptr;
 
@@ -414,6 +486,11 @@ static int audio_filter_process(Snd_Card_Num card_num, Audio_Stream_Dir stream_d
 		return -1;
 	}
 
+	/* No audio filter stage */
+	if (!audio_pcm_priv->filter_stage_nums[stream_dir]) {
+		return 0;
+	}
+
 	/* Check buf and  size to be valid*/
 	if (buf == NULL || !size) {
 		AUDIO_FILTER_ERROR("Invalid buffer or buf_size!\n");
@@ -435,21 +512,41 @@ static int audio_filter_process(Snd_Card_Num card_num, Audio_Stream_Dir stream_d
 		return -1;
 	}
 
-	/* Process all play/record audio filter */
-	if (!list_empty(&audio_filter_list)) {
-		list_for_each_entry(audio_filter_ptr, &audio_filter_list, node) {
-			if (AUDIO_FILTER_DIR(audio_filter_ptr->filter_type) == stream_dir &&
-			                     audio_filter_ptr->card_num == card_num){
-				if (audio_filter_ptr->handle) {
-					audio_filter_ptr->filter_process(audio_filter_ptr->handle, (short *)buf, sample_nums);
-				}
-			}
-		}
+	/* Process all play/record audio filter stages in order */
+	nums = audio_pcm_priv->filter_stage_nums[stream_dir];
+	for (i = 0; i < nums; i++) {
+		audio_filter_ptr = audio_pcm_priv->filter_stage[stream_dir][i];
+		start = audio_filter_cycle_get();
+		audio_filter_ptr->filter_process(audio_filter_ptr->handle, (short *)buf, sample_nums);
+		cycles = audio_filter_cycle_get() - start;
+
+		audio_filter_ptr->process_cnt++;
+		audio_filter_ptr->process_cycles += cycles;
+		if (cycles > audio_filter_ptr->process_max_cycles)
+			audio_filter_ptr->process_max_cycles = cycles;
 	}
 
 	return 0;
 }
 
+void audio_filter_show(Snd_Card_Num card_num)
+{
+	struct audio_filter *audio_filter_ptr;
+
+	list_for_each_entry(audio_filter_ptr, &audio_filter_list, node) {
+		if (audio_filter_ptr->card_num != card_num) {
+			continue;
+		}
+		AUDIO_FILTER_ALWAYS("%-6s %s count %u, avg %u cycles, max %u cycles\n",
+		                    audio_filter_ptr->filter_name,
+		                    audio_filter_ptr->handle ? "on " : "off",
+		                    audio_filter_ptr->process_cnt,
+		                    audio_filter_ptr->process_cnt ?
+		                    (uint32_t)(audio_filter_ptr->process_cycles / audio_filter_ptr->process_cnt) : 0,
+		                    audio_filter_ptr->process_max_cycles);
+	}
+}
+
 int snd_pcm_read(Snd_Card_Num card_num, void *data, uint32_t count)
 {
 	int ret;
@@ -486,14 +583,15 @@ int snd_pcm_read(Snd_Card_Num card_num, void *data, uint32_t count)
 	/* Cache has data to read */
 	if (cpriv->length) {
 		if (cpriv->length > read_remain) {
-			memcpy(data_ptr, cpriv->cache, read_remain);
+			memcpy(data_ptr, cpriv->cache + cpriv->offset, read_remain);
+			cpriv->offset += read_remain;
 			cpriv->length -= read_remain;
-			memcpy(cpriv->cache, cpriv->cache + read_remain, cpriv->length);
 			return count;
 		} else {
-			memcpy(data_ptr, cpriv->cache, cpriv->length);
+			memcpy(data_ptr, cpriv->cache + cpriv->offset, cpriv->length);
 			data_ptr += cpriv->length;
 			read_remain -= cpriv->length;
+			cpriv->offset = 0;
 			cpriv->length = 0;
 			if (!read_remain) {
 				return count;
@@ -528,8 +626,72 @@ int snd_pcm_read(Snd_Card_Num card_num, void *data, uint32_t count)
 	}
 	audio_filter_process(card_num, PCM_IN, cpriv->cache, half_buf_size);
 	memcpy(data_ptr, cpriv->cache, read_remain);
-	cpriv->length = half_buf_size-read_remain;
-	memcpy(cpriv->cache, cpriv->cache + read_remain, cpriv->length);
+	cpriv->offset = read_remain;
+	cpriv->length = half_buf_size - read_remain;
+
+	return count;
+}
+
+int snd_pcm_read_peek(Snd_Card_Num card_num, void **data)
+{
+	int ret;
+	struct cap_priv *cpriv;
+	struct pcm_priv *audio_pcm_priv;
+
+	if (!data) {
+		AUDIO_PCM_ERROR("Invalid data params!\n");
+		return -1;
+	}
+
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		AUDIO_PCM_ERROR("Invalid sound card num [%d]!\n", (uint8_t)card_num);
+		return -1;
+	}
+
+	cpriv = &audio_pcm_priv->cap_priv;
+	if (cpriv->cache == NULL) {
+		AUDIO_PCM_ERROR("Capture Cache is NULL!\n");
+		return -1;
+	}
+
+	/* Refill cache with a whole half_buf_size */
+	if (!cpriv->length) {
+		ret = HAL_SndCard_PcmRead(card_num, cpriv->cache, cpriv->half_buf_size);
+		if (ret != cpriv->half_buf_size) {
+			AUDIO_PCM_ERROR("PCM read half_buf_size error!\n");
+			return -1;
+		}
+		audio_filter_process(card_num, PCM_IN, cpriv->cache, cpriv->half_buf_size);
+		cpriv->offset = 0;
+		cpriv->length = cpriv->half_buf_size;
+	}
+
+	*data = cpriv->cache + cpriv->offset;
+	return cpriv->length;
+}
+
+int snd_pcm_read_commit(Snd_Card_Num card_num, uint32_t count)
+{
+	struct cap_priv *cpriv;
+	struct pcm_priv *audio_pcm_priv;
+
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		AUDIO_PCM_ERROR("Invalid sound card num [%d]!\n", (uint8_t)card_num);
+		return -1;
+	}
+
+	cpriv = &audio_pcm_priv->cap_priv;
+	if (count > cpriv->length) {
+		AUDIO_PCM_ERROR("Commit %u more than peeked %u!\n", count, cpriv->length);
+		return -1;
+	}
+
+	cpriv->offset += count;
+	cpriv->length -= count;
+	if (!cpriv->length)
+		cpriv->offset = 0;
 
 	return count;
 }
@@ -620,6 +782,85 @@ int snd_pcm_write(Snd_Card_Num card_num, void *data, uint32_t count)
 	return count;
 }
 
+int snd_pcm_write_peek(Snd_Card_Num card_num, void **data)
+{
+	int ret;
+	struct play_priv *ppriv;
+	struct pcm_priv *audio_pcm_priv;
+
+	if (!data) {
+		AUDIO_PCM_ERROR("Invalid data params!\n");
+		return -1;
+	}
+
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		AUDIO_PCM_ERROR("Invalid sound card num [%d]!\n", (uint8_t)card_num);
+		return -1;
+	}
+
+	/* same lock as snd_pcm_write/flush/close, the cache state is consistent */
+	if (pcm_lock(&audio_pcm_priv->write_lock) != OS_OK) {
+		AUDIO_PCM_ERROR("Obtain write lock err.\n");
+		return -1;
+	}
+
+	ppriv = &audio_pcm_priv->play_priv;
+	if (ppriv->cache == NULL) {
+		AUDIO_PCM_ERROR("Play Cache is NULL!\n");
+		ret = -1;
+	} else {
+		*data = ppriv->cache + ppriv->length;
+		ret = ppriv->half_buf_size - ppriv->length;
+	}
+
+	pcm_unlock(&audio_pcm_priv->write_lock);
+	return ret;
+}
+
+int snd_pcm_write_commit(Snd_Card_Num card_num, uint32_t count)
+{
+	int ret = count;
+	struct play_priv *ppriv;
+	struct pcm_priv *audio_pcm_priv;
+
+	audio_pcm_priv = card_num_to_pcm_priv(card_num);
+	if (audio_pcm_priv == NULL) {
+		AUDIO_PCM_ERROR("Invalid sound card num [%d]!\n", (uint8_t)card_num);
+		return -1;
+	}
+
+	if (pcm_lock(&audio_pcm_priv->write_lock) != OS_OK) {
+		AUDIO_PCM_ERROR("Obtain write lock err.\n");
+		return -1;
+	}
+
+	ppriv = &audio_pcm_priv->play_priv;
+	if (ppriv->cache == NULL) {
+		AUDIO_PCM_ERROR("Play Cache is NULL!\n");
+		pcm_unlock(&audio_pcm_priv->write_lock);
+		return -1;
+	}
+	if (count > ppriv->half_buf_size - ppriv->length) {
+		AUDIO_PCM_ERROR("Commit %u more than peeked %u!\n", count,
+		                ppriv->half_buf_size - ppriv->length);
+		pcm_unlock(&audio_pcm_priv->write_lock);
+		return -1;
+	}
+
+	/* Write to hardware when a whole half_buf_size is ready */
+	ppriv->length += count;
+	if (ppriv->length == ppriv->half_buf_size) {
+		audio_filter_process(card_num, PCM_OUT, ppriv->cache, ppriv->half_buf_size);
+		if (HAL_SndCard_PcmWrite(card_num, ppriv->cache, ppriv->half_buf_size) < 0)
+			ret = -1;
+		ppriv->length = 0;
+	}
+
+	pcm_unlock(&audio_pcm_priv->write_lock);
+	return ret;
+}
+
 int snd_pcm_flush(Snd_Card_Num card_num)
 {
 	uint32_t i, half_buf_size;
@@ -716,6 +957,7 @@ int snd_pcm_open(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir, struct pcm_
 			AUDIO_PCM_ERROR("obtain cap cache failed...\n");
 			return -1;
 		}
+		audio_pcm_priv->cap_priv.offset = 0;
 		audio_pcm_priv->cap_priv.length = 0;
 		audio_pcm_priv->cap_priv.half_buf_size = buf_size/2;
 		audio_pcm_priv->cap_priv.frame_bytes = pcm_frames_to_bytes(pcm_cfg, 1);
@@ -759,8 +1001,11 @@ int snd_pcm_close(Snd_Card_Num card_num, Audio_Stream_Dir stream_dir)
 
 	/* deinit audio_pcm_priv */
 	if (stream_dir == PCM_OUT) {
+		/* wait for a write, flush or write peek/commit using the cache */
+		OS_MutexLock(&audio_pcm_priv->write_lock, OS_WAIT_FOREVER);
 		pcm_free(audio_pcm_priv->play_priv.cache);
 		memset(&(audio_pcm_priv->play_priv), 0, sizeof(struct play_priv));
+		pcm_unlock(&audio_pcm_priv->write_lock);
 		pcm_unlock(&audio_pcm_priv->play_lock);
 	} else {
 		pcm_free(audio_pcm_priv->cap_priv.cache);
@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <stdio.h>
 #include "kernel/os/os.h"
 #include "console/console.h"
 #include "console_debug.h"
@@ -437,6 +438,15 @@ void console_stop(void)
 int console_write(uint8_t *buf, int32_t len)
 {
 	console_priv_t *console;
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	int ret;
+
+	/* keep the order with stdout, which shares the UART */
+	ret = stdio_async_write((const char *)buf, len);
+	if (ret >= 0) {
+		return ret;
+	}
+#endif
 
 	console = &g_console;
 	return HAL_UART_Transmit_Poll(console->uart_id, buf, len);
@@ -52,7 +52,9 @@
 #define HEAP_MEM_ERR_ON         1
 
 #define HEAP_MEM_DBG_MIN_SIZE   100
-#define HEAP_MEM_MAX_CNT        1024
+#define HEAP_MEM_HASH_BITS      11
+#define HEAP_MEM_HASH_SIZE      (1 << HEAP_MEM_HASH_BITS)
+#define HEAP_MEM_MAX_CNT        (HEAP_MEM_HASH_SIZE * 7 / 8) /* max load */
 #define HEAP_SYSLOG             printf
 
 #define HEAP_MEM_IS_TRACED(size)    (size > HEAP_MEM_DBG_MIN_SIZE)
@@ -73,19 +75,39 @@
 #ifdef HEAP_BACKTRACE
 #define BACKTRACE_COUNT   4
 #define BACKTRACE_OFFSET  2
+
+/*
+ * Allocations are aggregated by call site (backtrace). A site is never
+ * removed, the last one (HEAP_SITE_MAX_CNT) collects the allocations when
+ * the table is full.
+ */
+#define HEAP_SITE_HASH_BITS     8
+#define HEAP_SITE_MAX_CNT       (1 << HEAP_SITE_HASH_BITS)
+#define HEAP_SITE_OTHER         HEAP_SITE_MAX_CNT
+#define HEAP_SITE_HIST_NUM      8 /* live size histogram, <=32, <=64, ... >2K */
+#define HEAP_SITE_SHOW_NUM      16
+
+struct heap_site {
+	void *backtrace[BACKTRACE_COUNT];
+	uint32_t alloc_cnt;  /* 0 if not used */
+	uint32_t live_cnt;
+	size_t live_sum;
+	uint16_t hist[HEAP_SITE_HIST_NUM];
+};
+
+static struct heap_site g_site[HEAP_SITE_MAX_CNT + 1];
 #endif
 
+/* open addressed by ptr, linear probing, no tombstone */
 struct heap_mem {
 	void *ptr;
 	size_t size;
 #ifdef HEAP_BACKTRACE
-	void *backtrace[BACKTRACE_COUNT];
+	uint16_t site;
 #endif
 };
 
-static struct heap_mem g_mem[HEAP_MEM_MAX_CNT];
-
-static int g_mem_empty_idx = 0; /* beginning idx to do the search for new one */
+static struct heap_mem g_mem[HEAP_MEM_HASH_SIZE];
 
 static heap_info_t g_mem_info;
 
@@ -122,30 +144,128 @@ static __always_inline int is_rangeof_psramheap(void *ptr)
 }
 #endif
 
-static void heap_mem_show(int verbose, struct heap_mem *heap)
+static __always_inline uint32_t heap_mem_hash(void *ptr)
 {
+	return ((uint32_t)ptr * 2654435761U) >> (32 - HEAP_MEM_HASH_BITS);
+}
+
+/* return the slot of @ptr, or the empty slot to insert it */
+static int heap_mem_lookup(void *ptr)
+{
+	uint32_t i = heap_mem_hash(ptr);
+
+	while (g_mem[i].ptr != NULL && g_mem[i].ptr != ptr) {
+		i = (i + 1) & (HEAP_MEM_HASH_SIZE - 1);
+	}
+	return i;
+}
+
+/* remove slot @i, move the following entries back to fill the hole */
+static void heap_mem_remove(uint32_t i)
+{
+	uint32_t j = i;
+	uint32_t k;
+
+	while (1) {
+		j = (j + 1) & (HEAP_MEM_HASH_SIZE - 1);
+		if (g_mem[j].ptr == NULL)
+			break;
+		k = heap_mem_hash(g_mem[j].ptr);
+		/* entry j can not move before its home k */
+		if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+			continue;
+		g_mem[i] = g_mem[j];
+		i = j;
+	}
+	g_mem[i].ptr = NULL;
+	g_mem[i].size = 0;
+}
+
 #ifdef HEAP_BACKTRACE
+static void heap_backtrace_show(void *backtrace[])
+{
 	int i;
-#endif
+
+	HEAP_SYSLOG("backtrace:");
+	for (i = 0; i < BACKTRACE_COUNT; i++) {
+		HEAP_SYSLOG("%p ", backtrace[i]);
+	}
+	HEAP_SYSLOG("\n");
+}
+
+static __always_inline int heap_site_hist_idx(size_t size)
+{
+	int idx;
+
+	if (size <= 32)
+		return 0;
+	idx = 32 - __builtin_clz(size - 1) - 5;
+	return idx < HEAP_SITE_HIST_NUM ? idx : HEAP_SITE_HIST_NUM - 1;
+}
+
+/* find or add the site of the caller */
+static uint16_t heap_site_get(void)
+{
+	void *trace[BACKTRACE_COUNT + BACKTRACE_OFFSET];
+	void **bt = &trace[BACKTRACE_OFFSET];
+	uint32_t hash = 0;
+	uint32_t i, n;
+
+	memset(trace, 0, sizeof(trace));
+	backtrace_get(trace, BACKTRACE_COUNT + BACKTRACE_OFFSET);
+	for (i = 0; i < BACKTRACE_COUNT; i++) {
+		hash = (hash ^ (uint32_t)bt[i]) * 2654435761U;
+	}
+
+	i = hash >> (32 - HEAP_SITE_HASH_BITS);
+	for (n = 0; n < HEAP_SITE_MAX_CNT; n++) {
+		if (g_site[i].alloc_cnt == 0) {
+			memcpy(g_site[i].backtrace, bt, sizeof(g_site[i].backtrace));
+			return i;
+		}
+		if (memcmp(g_site[i].backtrace, bt, sizeof(g_site[i].backtrace)) == 0) {
+			return i;
+		}
+		i = (i + 1) & (HEAP_SITE_MAX_CNT - 1);
+	}
+	return HEAP_SITE_OTHER;
+}
+
+static void heap_site_add(struct heap_mem *heap)
+{
+	struct heap_site *site;
+
+	heap->site = heap_site_get();
+	site = &g_site[heap->site];
+	site->alloc_cnt++;
+	site->live_cnt++;
+	site->live_sum += heap->size;
+	site->hist[heap_site_hist_idx(heap->size)]++;
+}
+
+static void heap_site_del(struct heap_mem *heap)
+{
+	struct heap_site *site = &g_site[heap->site];
+
+	site->live_cnt--;
+	site->live_sum -= heap->size;
+	site->hist[heap_site_hist_idx(heap->size)]--;
+}
+#endif /* HEAP_BACKTRACE */
+
+static void heap_mem_show(int verbose, struct heap_mem *heap)
+{
 	if (verbose) {
 		HEAP_SYSLOG("%p, %u\n", heap->ptr, heap->size);
 #ifdef HEAP_BACKTRACE
-		HEAP_SYSLOG("backtrace:");
-		for (i = 0; i < BACKTRACE_COUNT; i++) {
-			HEAP_SYSLOG("%p ", heap->backtrace[i]);
-		}
-		HEAP_SYSLOG("\n");
+		heap_backtrace_show(g_site[heap->site].backtrace);
 #endif
 	}
 
 	if (MEM_CHK_MAGIC(heap->ptr, heap->size)) {
 		HEAP_MEM_ERR("mem (%p) corrupt\n", heap->ptr);
 #ifdef HEAP_BACKTRACE
-		HEAP_SYSLOG("backtrace:");
-		for (i = 0; i < BACKTRACE_COUNT; i++) {
-			HEAP_SYSLOG("%p ", heap->backtrace[i]);
-		}
-		HEAP_SYSLOG("\n");
+		heap_backtrace_show(g_site[heap->site].backtrace);
 #endif
 	}
 }
@@ -164,7 +284,7 @@ void sram_heap_trace_info_show(int verbose)
 	            g_sram_info.sum_max, g_sram_info.sum_max / 1024,
 	            g_sram_info.entry_cnt, g_sram_info.entry_cnt_max);
 
-	for (i = 0; i < HEAP_MEM_MAX_CNT; ++i) {
+	for (i = 0; i < HEAP_MEM_HASH_SIZE; ++i) {
 		if ((g_mem[i].ptr != NULL) && (is_rangeof_sramheap(g_mem[i].ptr))) {
 			heap_mem_show(verbose, &g_mem[i]);
 		}
@@ -197,7 +317,7 @@ void psram_heap_trace_info_show(int verbose)
 	            g_psram_info.sum_max, g_psram_info.sum_max / 1024,
 	            g_psram_info.entry_cnt, g_psram_info.entry_cnt_max);
 
-	for (i = 0; i < HEAP_MEM_MAX_CNT; ++i) {
+	for (i = 0; i < HEAP_MEM_HASH_SIZE; ++i) {
 		if ((g_mem[i].ptr != NULL) && (is_rangeof_psramheap(g_mem[i].ptr))) {
 			heap_mem_show(verbose, &g_mem[i]);
 		}
@@ -248,56 +368,142 @@ void heap_trace_info_get(heap_info_t *info)
 	malloc_mutex_unlock();
 }
 
-/* Note: @ptr != NULL */
-static void heap_trace_add_entry(void *ptr, size_t size)
+/*
+ * Show the live allocations by call site. The lock is only held to copy a
+ * site or a part of the table, so it can be used while the system is busy.
+ */
+void heap_trace_site_show(int verbose)
 {
-	int i;
+#ifdef HEAP_BACKTRACE
+	struct heap_site site;
+	struct heap_mem mem[HEAP_SITE_SHOW_NUM];
+	int s, i, j, n;
 
-	MEM_SET_MAGIC(ptr, size);
+	HEAP_SYSLOG("<<< heap call site >>>\n"
+	            "live cnt, live sum, alloc cnt, hist(<=32,64,128,256,512,1K,2K,>2K)\n");
 
-	for (i = g_mem_empty_idx; i < HEAP_MEM_MAX_CNT; ++i) {
-		if (g_mem[i].ptr == NULL) {
-			g_mem[i].ptr = ptr;
-			g_mem[i].size = size;
-#ifdef HEAP_BACKTRACE
-			void *trace[BACKTRACE_COUNT + BACKTRACE_OFFSET];
-			backtrace_get(trace, BACKTRACE_COUNT + BACKTRACE_OFFSET);
-			memcpy(g_mem[i].backtrace, &trace[BACKTRACE_OFFSET], sizeof(void *) * BACKTRACE_COUNT);
+	for (s = 0; s <= HEAP_SITE_MAX_CNT; ++s) {
+		malloc_mutex_lock();
+		memcpy(&site, &g_site[s], sizeof(site));
+		malloc_mutex_unlock();
+
+		if (site.live_cnt == 0) {
+			continue;
+		}
+		HEAP_SYSLOG("%u, %u, %u, hist", site.live_cnt, site.live_sum, site.alloc_cnt);
+		for (i = 0; i < HEAP_SITE_HIST_NUM; i++) {
+			HEAP_SYSLOG(" %u", site.hist[i]);
+		}
+		HEAP_SYSLOG("\n");
+		if (s == HEAP_SITE_OTHER) {
+			HEAP_SYSLOG("backtrace: (other)\n");
+		} else {
+			heap_backtrace_show(site.backtrace);
+		}
+		if (!verbose) {
+			continue;
+		}
+
+		for (i = 0; i < HEAP_MEM_HASH_SIZE; ) {
+			n = 0;
+			malloc_mutex_lock();
+			for (j = 0; j < HEAP_SITE_SHOW_NUM && i < HEAP_MEM_HASH_SIZE; ++j, ++i) {
+				if (g_mem[i].ptr != NULL && g_mem[i].site == s) {
+					mem[n++] = g_mem[i];
+				}
+			}
+			malloc_mutex_unlock();
+			for (j = 0; j < n; ++j) {
+				HEAP_SYSLOG("  %p, %u\n", mem[j].ptr, mem[j].size);
+			}
+		}
+	}
+#else
+	HEAP_SYSLOG("heap call site needs CONFIG_BACKTRACE\n");
 #endif
-			g_mem_info.entry_cnt++;
-			g_mem_empty_idx = i + 1;
-			g_mem_info.sum += size;
-			if (g_mem_info.sum > g_mem_info.sum_max)
-				g_mem_info.sum_max = g_mem_info.sum;
-			if (g_mem_info.entry_cnt > g_mem_info.entry_cnt_max)
-				g_mem_info.entry_cnt_max = g_mem_info.entry_cnt;
+}
+
+static void heap_info_add(void *ptr, size_t size)
+{
+	g_mem_info.sum += size;
+	if (g_mem_info.sum > g_mem_info.sum_max)
+		g_mem_info.sum_max = g_mem_info.sum;
 #ifdef SRAM_HEAP_TRACE
-			if (is_rangeof_sramheap(ptr)) {
-				g_sram_info.entry_cnt++;
-				g_sram_info.sum += size;
-				if (g_sram_info.sum > g_sram_info.sum_max)
-					g_sram_info.sum_max = g_sram_info.sum;
-				if (g_sram_info.entry_cnt > g_sram_info.entry_cnt_max)
-					g_sram_info.entry_cnt_max = g_sram_info.entry_cnt;
-			}
+	if (is_rangeof_sramheap(ptr)) {
+		g_sram_info.sum += size;
+		if (g_sram_info.sum > g_sram_info.sum_max)
+			g_sram_info.sum_max = g_sram_info.sum;
+	}
 #endif
 #ifdef PSRAM_HEAP_TRACE
-			if (is_rangeof_psramheap(ptr)) {
-				g_psram_info.entry_cnt++;
-				g_psram_info.sum += size;
-				if (g_psram_info.sum > g_psram_info.sum_max)
-					g_psram_info.sum_max = g_psram_info.sum;
-				if (g_psram_info.entry_cnt > g_psram_info.entry_cnt_max)
-					g_psram_info.entry_cnt_max = g_psram_info.entry_cnt;
-			}
+	if (is_rangeof_psramheap(ptr)) {
+		g_psram_info.sum += size;
+		if (g_psram_info.sum > g_psram_info.sum_max)
+			g_psram_info.sum_max = g_psram_info.sum;
+	}
 #endif
-			break;
-		}
+}
+
+static void heap_info_sub(void *ptr, size_t size)
+{
+	g_mem_info.sum -= size;
+#ifdef SRAM_HEAP_TRACE
+	if (is_rangeof_sramheap(ptr)) {
+		g_sram_info.sum -= size;
+	}
+#endif
+#ifdef PSRAM_HEAP_TRACE
+	if (is_rangeof_psramheap(ptr)) {
+		g_psram_info.sum -= size;
 	}
+#endif
+}
 
-	if (i >= HEAP_MEM_MAX_CNT) {
+static void heap_info_cnt(void *ptr, int cnt)
+{
+	g_mem_info.entry_cnt += cnt;
+	if (g_mem_info.entry_cnt > g_mem_info.entry_cnt_max)
+		g_mem_info.entry_cnt_max = g_mem_info.entry_cnt;
+#ifdef SRAM_HEAP_TRACE
+	if (is_rangeof_sramheap(ptr)) {
+		g_sram_info.entry_cnt += cnt;
+		if (g_sram_info.entry_cnt > g_sram_info.entry_cnt_max)
+			g_sram_info.entry_cnt_max = g_sram_info.entry_cnt;
+	}
+#endif
+#ifdef PSRAM_HEAP_TRACE
+	if (is_rangeof_psramheap(ptr)) {
+		g_psram_info.entry_cnt += cnt;
+		if (g_psram_info.entry_cnt > g_psram_info.entry_cnt_max)
+			g_psram_info.entry_cnt_max = g_psram_info.entry_cnt;
+	}
+#endif
+}
+
+/* Note: @ptr != NULL */
+static void heap_trace_add_entry(void *ptr, size_t size)
+{
+	int i;
+
+	MEM_SET_MAGIC(ptr, size);
+
+	if (g_mem_info.entry_cnt >= HEAP_MEM_MAX_CNT) {
 		HEAP_MEM_ERR("heap mem count exceed %d\n", HEAP_MEM_MAX_CNT);
+		return;
 	}
+
+	i = heap_mem_lookup(ptr);
+	if (g_mem[i].ptr != NULL) {
+		HEAP_MEM_ERR("heap mem entry (%p) exist\n", ptr);
+		return;
+	}
+	g_mem[i].ptr = ptr;
+	g_mem[i].size = size;
+#ifdef HEAP_BACKTRACE
+	heap_site_add(&g_mem[i]);
+#endif
+	heap_info_cnt(ptr, 1);
+	heap_info_add(ptr, size);
 }
 
 /* Note: @ptr != NULL */
@@ -306,49 +512,28 @@ static size_t heap_trace_delete_entry(void *ptr)
 	int i;
 	size_t size;
 
-	for (i = 0; i < HEAP_MEM_MAX_CNT; ++i) {
-		if (g_mem[i].ptr == ptr) {
-			size = g_mem[i].size;
-			if (MEM_CHK_MAGIC(ptr, size)) {
-				HEAP_MEM_ERR("mem f (%p, %u) corrupt\n", ptr, size);
+	i = heap_mem_lookup(ptr);
+	if (g_mem[i].ptr == NULL) {
+		HEAP_MEM_ERR("heap mem entry (%p) missed\n", ptr);
 #ifdef HEAP_BACKTRACE
-				int j;
-				HEAP_SYSLOG("backtrace:");
-				for (j = 0; j < BACKTRACE_COUNT; j++) {
-					HEAP_SYSLOG("%p ", g_mem[i].backtrace[j]);
-				}
-				HEAP_SYSLOG("\n");
-#endif
-			}
-			g_mem_info.sum -= size;
-			g_mem[i].ptr = NULL;
-			g_mem[i].size = 0;
-			g_mem_info.entry_cnt--;
-			if (i < g_mem_empty_idx)
-				g_mem_empty_idx = i;
-#ifdef SRAM_HEAP_TRACE
-			if (is_rangeof_sramheap(ptr)) {
-				g_sram_info.sum -= size;
-				g_sram_info.entry_cnt--;
-			}
-#endif
-#ifdef PSRAM_HEAP_TRACE
-			if (is_rangeof_psramheap(ptr)) {
-				g_psram_info.sum -= size;
-				g_psram_info.entry_cnt--;
-			}
+		backtrace_show();
 #endif
-			break;
-		}
+		return -1;
 	}
 
-	if (i >= HEAP_MEM_MAX_CNT) {
-		HEAP_MEM_ERR("heap mem entry (%p) missed\n", ptr);
+	size = g_mem[i].size;
+	if (MEM_CHK_MAGIC(ptr, size)) {
+		HEAP_MEM_ERR("mem f (%p, %u) corrupt\n", ptr, size);
 #ifdef HEAP_BACKTRACE
-		backtrace_show();
+		heap_backtrace_show(g_site[g_mem[i].site].backtrace);
 #endif
-		size = -1;
 	}
+#ifdef HEAP_BACKTRACE
+	heap_site_del(&g_mem[i]);
+#endif
+	heap_mem_remove(i);
+	heap_info_cnt(ptr, -1);
+	heap_info_sub(ptr, size);
 
 	return size;
 }
@@ -356,55 +541,13 @@ static size_t heap_trace_delete_entry(void *ptr)
 /* Note: @old_ptr != NULL, @new_ptr != NULL, @new_size != 0 */
 static size_t heap_trace_update_entry(void *old_ptr, void *new_ptr, size_t new_size)
 {
-	int i;
 	size_t old_size;
 
-	MEM_SET_MAGIC(new_ptr, new_size);
-
-	for (i = 0; i < HEAP_MEM_MAX_CNT; ++i) {
-		if (g_mem[i].ptr == old_ptr) {
-			old_size = g_mem[i].size;
-			g_mem_info.sum = g_mem_info.sum - old_size + new_size;
-			g_mem[i].ptr = new_ptr;
-			g_mem[i].size = new_size;
-#ifdef HEAP_BACKTRACE
-			void *trace[BACKTRACE_COUNT + BACKTRACE_OFFSET];
-			backtrace_get(trace, BACKTRACE_COUNT + BACKTRACE_OFFSET);
-			memcpy(g_mem[i].backtrace, &trace[BACKTRACE_OFFSET], sizeof(void *) * BACKTRACE_COUNT);
-#endif
-			if (g_mem_info.sum > g_mem_info.sum_max)
-				g_mem_info.sum_max = g_mem_info.sum;
-#ifdef SRAM_HEAP_TRACE
-			if (is_rangeof_sramheap(old_ptr)) {
-				g_sram_info.sum -= old_size;
-			}
-			if (is_rangeof_sramheap(new_ptr)) {
-				g_sram_info.sum += new_size;
-			}
-			if (g_sram_info.sum > g_sram_info.sum_max)
-				g_sram_info.sum_max = g_sram_info.sum;
-#endif
-#ifdef PSRAM_HEAP_TRACE
-			if (is_rangeof_psramheap(old_ptr)) {
-				g_psram_info.sum -= old_size;
-			}
-			if (is_rangeof_psramheap(new_ptr)) {
-				g_psram_info.sum += new_size;
-			}
-			if (g_psram_info.sum > g_psram_info.sum_max)
-				g_psram_info.sum_max = g_psram_info.sum;
-#endif
-			break;
-		}
-	}
-
-	if (i >= HEAP_MEM_MAX_CNT) {
+	old_size = heap_trace_delete_entry(old_ptr);
+	if (old_size == (size_t)-1) {
 		HEAP_MEM_ERR("heap mem entry (%p) missed\n", new_ptr);
-#ifdef HEAP_BACKTRACE
-		backtrace_show();
-#endif
-		old_size = -1;
 	}
+	heap_trace_add_entry(new_ptr, new_size);
 
 	return old_size;
 }
@@ -415,7 +558,9 @@ int heap_trace_malloc(void *ptr, size_t size)
 		HEAP_MEM_DBG("m (%p, %u)\n", ptr, size);
 	}
 	if (ptr) {
+		malloc_mutex_lock();
 		heap_trace_add_entry(ptr, size);
+		malloc_mutex_unlock();
 	} else {
 		HEAP_MEM_ERR("heap mem exhausted (%u)\n", size);
 	}
@@ -430,7 +575,9 @@ int heap_trace_free(void *ptr)
 		return 0;
 	}
 
+	malloc_mutex_lock();
 	size = heap_trace_delete_entry(ptr);
+	malloc_mutex_unlock();
 	if (HEAP_MEM_IS_TRACED(size)) {
 		HEAP_MEM_DBG("f (%p, %u)\n", ptr, size);
 	}
@@ -441,6 +588,7 @@ int heap_trace_realloc(void *old_ptr, void *new_ptr, size_t new_size)
 {
 	size_t old_size = 0;
 
+	malloc_mutex_lock();
 	if (new_size == 0) {
 		if (old_ptr) {
 			old_size = heap_trace_delete_entry(old_ptr);
@@ -460,6 +608,7 @@ int heap_trace_realloc(void *old_ptr, void *new_ptr, size_t new_size)
 			}
 		}
 	}
+	malloc_mutex_unlock();
 	if (HEAP_MEM_IS_TRACED(new_size) || HEAP_MEM_IS_TRACED(old_size)) {
 		HEAP_MEM_DBG("r (%p, %u) -> (%p, %u)\n", old_ptr, old_size, new_ptr, new_size);
 	}
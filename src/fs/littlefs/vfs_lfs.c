@@ -89,6 +89,7 @@ static inline int lfs_lock_create(lfs_lock_t *lock)
 	if (OS_MutexCreate(lock) != OS_OK) {
 		return -1;
 	}
+	OS_MutexSetName(lock, "lfs");
 
 	return 0;
 }
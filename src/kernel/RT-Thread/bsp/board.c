@@ -18,6 +18,7 @@
 #include "driver/chip/system_chip.h"
 #include "driver/chip/hal_global.h"
 #include "driver/chip/hal_gpio.h"
+#include "driver/chip/hal_cmsis.h"
 // #include "common/board/board.h"
 #include "sys/sram_heap.h"
 
@@ -30,11 +31,11 @@
 #endif
 
 #define _SCB_BASE       (0xE000E010UL)
-#define _SYSTICK_CTRL   (*(rt_uint32_t *)(_SCB_BASE + 0x0))
-#define _SYSTICK_LOAD   (*(rt_uint32_t *)(_SCB_BASE + 0x4))
-#define _SYSTICK_VAL    (*(rt_uint32_t *)(_SCB_BASE + 0x8))
-#define _SYSTICK_CALIB  (*(rt_uint32_t *)(_SCB_BASE + 0xC))
-#define _SYSTICK_PRI    (*(rt_uint8_t  *)(0xE000ED23UL))
+#define _SYSTICK_CTRL   (*(volatile rt_uint32_t *)(_SCB_BASE + 0x0))
+#define _SYSTICK_LOAD   (*(volatile rt_uint32_t *)(_SCB_BASE + 0x4))
+#define _SYSTICK_VAL    (*(volatile rt_uint32_t *)(_SCB_BASE + 0x8))
+#define _SYSTICK_CALIB  (*(volatile rt_uint32_t *)(_SCB_BASE + 0xC))
+#define _SYSTICK_PRI    (*(volatile rt_uint8_t  *)(0xE000ED23UL))
 
 // Updates the variable SystemCoreClock and must be called 
 // whenever the core clock is changed during program execution.
@@ -92,6 +93,128 @@ void rt_hw_board_init()
     _SysTick_Config(SystemCoreClock / RT_TICK_PER_SECOND);
 }
 
+#ifdef RT_USING_TICKLESS
+#define _SYSTICK_ENABLE         (1UL << 0)
+#define _SYSTICK_COUNTFLAG      (1UL << 16)
+#define _SYSTICK_CTRL_RUN       0x07 /* clock source, interrupt and enable */
+#define _SCB_ICSR               (*(volatile rt_uint32_t *)0xE000ED04UL)
+#define _SCB_ICSR_PENDSVSET     (1UL << 28)
+
+/* SysTick counts lost while it is stopped to be reprogrammed */
+#define _SYSTICK_STOPPED_COMPENSATION   45
+
+/**
+ * Sleep for ticks with the SysTick programmed for the whole sleep instead of
+ * interrupting every tick, and step the OS tick by the ticks slept. Called
+ * by the idle thread with interrupts disabled, any pending interrupt ends
+ * the sleep. Ported from vPortSuppressTicksAndSleep() of FreeRTOS.
+ */
+void rt_hw_tickless_idle(rt_tick_t ticks)
+{
+    rt_uint32_t one_tick = SystemCoreClock / RT_TICK_PER_SECOND;
+    rt_uint32_t reload, load, elapsed, completed;
+#ifdef RT_USING_CPU_USAGE
+    rt_uint32_t slept, cycles;
+#endif
+
+    if (ticks > 0xFFFFFF / one_tick)
+    {
+        ticks = 0xFFFFFF / one_tick;
+    }
+
+    /* stop the SysTick, the time it is stopped is lost */
+    _SYSTICK_CTRL &= ~_SYSTICK_ENABLE;
+
+    /* -1 tick as this one is partly gone */
+    reload = _SYSTICK_VAL + one_tick * (ticks - 1);
+    if (reload > _SYSTICK_STOPPED_COMPENSATION)
+    {
+        reload -= _SYSTICK_STOPPED_COMPENSATION;
+    }
+
+    if (_SCB_ICSR & _SCB_ICSR_PENDSVSET)
+    {
+        /* a context switch is pending, finish the current tick */
+        _SYSTICK_LOAD = _SYSTICK_VAL;
+        _SYSTICK_CTRL |= _SYSTICK_ENABLE;
+        _SYSTICK_LOAD = one_tick - 1;
+        return;
+    }
+
+    _SYSTICK_LOAD = reload;
+    _SYSTICK_VAL  = 0;
+    _SYSTICK_CTRL |= _SYSTICK_ENABLE;
+#ifdef RT_USING_CPU_USAGE
+    cycles = rt_hw_cycle_get();
+#endif
+
+    __asm volatile ("dsb" ::: "memory");
+    __asm volatile ("wfi");
+    __asm volatile ("isb");
+
+    /* stop the SysTick without reading CTRL, it clears COUNTFLAG */
+    _SYSTICK_CTRL = _SYSTICK_CTRL_RUN & ~_SYSTICK_ENABLE;
+
+    if (_SYSTICK_CTRL & _SYSTICK_COUNTFLAG)
+    {
+        /* slept all the ticks, the tick interrupt is pending for the last
+         * one, load what is left of the next tick */
+        load = (one_tick - 1) - (reload - _SYSTICK_VAL);
+        if (load < _SYSTICK_STOPPED_COMPENSATION || load > one_tick)
+        {
+            load = one_tick - 1;
+        }
+        completed = ticks - 1;
+#ifdef RT_USING_CPU_USAGE
+        slept = reload + 1 + (reload - _SYSTICK_VAL);
+#endif
+    }
+    else
+    {
+        /* woken up by another interrupt, count the whole ticks slept and
+         * load the rest of the current one */
+        elapsed = ticks * one_tick - _SYSTICK_VAL;
+        completed = elapsed / one_tick;
+        load = (completed + 1) * one_tick - elapsed;
+#ifdef RT_USING_CPU_USAGE
+        slept = reload - _SYSTICK_VAL;
+#endif
+    }
+
+#ifdef RT_USING_CPU_USAGE
+    /* the DWT cycle counter stops with the core clock in WFI, charge the
+     * cycles it missed to the idle thread, SysTick runs at core clock */
+    cycles = rt_hw_cycle_get() - cycles;
+    if (slept > cycles)
+    {
+        rt_cpu_usage_add(slept - cycles);
+    }
+#endif
+
+    _SYSTICK_LOAD = load;
+    _SYSTICK_VAL  = 0;
+    _SYSTICK_CTRL |= _SYSTICK_ENABLE;
+    rt_tick_step(completed);
+    _SYSTICK_LOAD = one_tick - 1;
+}
+#endif
+
+/*
+ * cpu cycle counter for cpu usage and profiling, DWT runs at core clock.
+ * it is free running and shared by all users, which take deltas of it and
+ * MUST NOT reset it.
+ */
+void rt_hw_cycle_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+rt_uint32_t rt_hw_cycle_get(void)
+{
+    return DWT->CYCCNT;
+}
+
 void SysTick_Handler(void)
 {
     /* enter interrupt */
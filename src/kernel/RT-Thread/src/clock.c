@@ -88,6 +88,23 @@ void rt_tick_increase(void)
     rt_timer_check();
 }
 
+#ifdef RT_USING_TICKLESS
+/**
+ * This function will step the tick forward by the ticks passed in tickless
+ * idle, the timers due are checked by the next tick interrupt.
+ *
+ * @param ticks the ticks passed while the clock ISR was stopped
+ */
+void rt_tick_step(rt_tick_t ticks)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    rt_tick += ticks;
+    rt_hw_interrupt_enable(level);
+}
+#endif
+
 /**
  * This function will calculate the tick from millisecond.
  *
@@ -176,6 +176,37 @@ void rt_thread_idle_excute(void)
 }
 
 extern void rt_system_power_manager(void);
+#ifdef RT_USING_TICKLESS
+/* the shortest idle time worth stopping the tick for */
+#ifndef RT_TICKLESS_IDLE_MIN
+#define RT_TICKLESS_IDLE_MIN    2
+#endif
+
+static void rt_thread_idle_tickless(void)
+{
+    register rt_base_t level;
+    rt_tick_t timeout;
+
+    /* keep interrupts disabled until woken up, an interrupt that readies a
+     * thread or starts a timer ends the sleep */
+    level = rt_hw_interrupt_disable();
+
+    timeout = rt_timer_next_timeout_tick();
+    if (timeout != RT_TICK_MAX)
+    {
+        timeout -= rt_tick_get();
+    }
+
+    if (timeout >= RT_TICKLESS_IDLE_MIN &&
+        (timeout < RT_TICK_MAX / 2 || timeout == RT_TICK_MAX))
+    {
+        rt_hw_tickless_idle(timeout);
+    }
+
+    rt_hw_interrupt_enable(level);
+}
+#endif
+
 static void rt_thread_idle_entry(void *parameter)
 {
     while (1)
@@ -194,6 +225,9 @@ static void rt_thread_idle_entry(void *parameter)
 #endif
 
         rt_thread_idle_excute();
+#ifdef RT_USING_TICKLESS
+        rt_thread_idle_tickless();
+#endif
 #ifdef RT_USING_PM
         rt_system_power_manager();
 #endif
@@ -525,6 +525,47 @@ rt_err_t rt_sem_control(rt_sem_t sem, int cmd, void *arg)
 #endif /* end of RT_USING_SEMAPHORE */
 
 #ifdef RT_USING_MUTEX
+#ifdef RT_USING_MUTEX_STATS
+static void _rt_mutex_stat_init(rt_mutex_t mutex)
+{
+    mutex->stat_wait_sum   = 0;
+    mutex->stat_wait_max   = 0;
+    mutex->stat_hold_max   = 0;
+    mutex->stat_hold_start = 0;
+    mutex->stat_acquires   = 0;
+    mutex->stat_contended  = 0;
+    mutex->stat_last_owner = RT_NULL;
+}
+
+/* the mutex has just been taken by thread, not nested */
+rt_inline void _rt_mutex_stat_taken(rt_mutex_t mutex, struct rt_thread *thread)
+{
+    mutex->stat_acquires++;
+    mutex->stat_last_owner = thread;
+    mutex->stat_hold_start = rt_hw_cycle_get();
+}
+
+/* the mutex is about to be released by its owner, not nested */
+rt_inline void _rt_mutex_stat_released(rt_mutex_t mutex)
+{
+    rt_uint32_t hold = rt_hw_cycle_get() - mutex->stat_hold_start;
+
+    if (hold > mutex->stat_hold_max)
+        mutex->stat_hold_max = hold;
+}
+
+/* the thread waited for the mutex since wait_start, taken or not */
+rt_inline void _rt_mutex_stat_waited(rt_mutex_t mutex, rt_uint32_t wait_start)
+{
+    rt_uint32_t wait = rt_hw_cycle_get() - wait_start;
+
+    mutex->stat_contended++;
+    mutex->stat_wait_sum += wait;
+    if (wait > mutex->stat_wait_max)
+        mutex->stat_wait_max = wait;
+}
+#endif
+
 /**
  * This function will initialize a mutex and put it under control of resource
  * management.
@@ -550,6 +591,9 @@ rt_err_t rt_mutex_init(rt_mutex_t mutex, const char *name, rt_uint8_t flag)
     mutex->owner = RT_NULL;
     mutex->original_priority = 0xFF;
     mutex->hold  = 0;
+#ifdef RT_USING_MUTEX_STATS
+    _rt_mutex_stat_init(mutex);
+#endif
 
     /* set flag */
     mutex->parent.parent.flag = flag;
@@ -611,6 +655,9 @@ rt_mutex_t rt_mutex_create(const char *name, rt_uint8_t flag)
     mutex->owner              = RT_NULL;
     mutex->original_priority  = 0xFF;
     mutex->hold               = 0;
+#ifdef RT_USING_MUTEX_STATS
+    _rt_mutex_stat_init(mutex);
+#endif
 
     /* set flag */
     mutex->parent.parent.flag = flag;
@@ -659,6 +706,9 @@ rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
 {
     register rt_base_t temp;
     struct rt_thread *thread;
+#ifdef RT_USING_MUTEX_STATS
+    rt_uint32_t wait_start;
+#endif
 
     /* this function must not be used in interrupt even if time = 0 */
     RT_DEBUG_IN_THREAD_CONTEXT;
@@ -717,6 +767,9 @@ rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
                 rt_hw_interrupt_enable(temp); /* enable interrupt */
                 return -RT_EFULL; /* value overflowed */
             }
+#ifdef RT_USING_MUTEX_STATS
+            _rt_mutex_stat_taken(mutex, thread);
+#endif
         }
         else
         {
@@ -765,6 +818,10 @@ rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
                     rt_timer_start(&(thread->thread_timer));
                 }
 
+#ifdef RT_USING_MUTEX_STATS
+                wait_start = rt_hw_cycle_get();
+#endif
+
                 /* enable interrupt */
                 rt_hw_interrupt_enable(temp);
 
@@ -773,6 +830,11 @@ rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
 
                 if (thread->error != RT_EOK)
                 {
+#ifdef RT_USING_MUTEX_STATS
+                    temp = rt_hw_interrupt_disable();
+                    _rt_mutex_stat_waited(mutex, wait_start);
+                    rt_hw_interrupt_enable(temp);
+#endif
                     /* return error */
                     return thread->error;
                 }
@@ -781,6 +843,11 @@ rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
                     /* the mutex is taken successfully. */
                     /* disable interrupt */
                     temp = rt_hw_interrupt_disable();
+#ifdef RT_USING_MUTEX_STATS
+                    /* handed over by the releaser, the hold starts now */
+                    _rt_mutex_stat_waited(mutex, wait_start);
+                    _rt_mutex_stat_taken(mutex, thread);
+#endif
                 }
             }
         }
@@ -845,6 +912,9 @@ rt_err_t rt_mutex_release(rt_mutex_t mutex)
     /* if no hold */
     if (mutex->hold == 0)
     {
+#ifdef RT_USING_MUTEX_STATS
+        _rt_mutex_stat_released(mutex);
+#endif
         /* change the owner thread to original priority */
         if (mutex->original_priority != mutex->owner->current_priority)
         {
@@ -1336,6 +1336,11 @@ void rt_assert_handler(const char *ex_string, const char *func, rt_size_t line)
 {
     volatile char dummy = 0;
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+    /* the asserting thread never returns to let the ring drain */
+    stdio_async_panic();
+#endif
+
     if (rt_assert_hook == RT_NULL)
     {
         rt_kprintf("(%s) assertion failed at function:%s, line number:%d \n", ex_string, func, line);
@@ -306,6 +306,7 @@ void rt_object_init(struct rt_object         *object,
     information = rt_object_get_information(type);
     RT_ASSERT(information != RT_NULL);
 
+#ifdef RT_DEBUG
     /* check object type to avoid re-initialization */
 
     /* enter critical */
@@ -325,6 +326,10 @@ void rt_object_init(struct rt_object         *object,
     }
     /* leave critical */
     rt_exit_critical();
+#else
+    /* the search is for the assertion only */
+    (void)node;
+#endif
 
     /* initialize object's parameters */
     /* set object type to static */
@@ -75,6 +75,83 @@ rt_scheduler_sethook(void (*hook)(struct rt_thread *from, struct rt_thread *to))
 /**@}*/
 #endif
 
+#ifdef RT_USING_CPU_USAGE
+static rt_uint32_t rt_cpu_usage_stamp;
+static rt_uint64_t rt_cpu_usage_total;
+static rt_uint32_t rt_cpu_usage_switch_cnt;
+
+/**
+ * This function will charge the cycles since the last call to the current
+ * thread. It's called with interrupt disabled.
+ */
+void rt_cpu_usage_update(void)
+{
+    rt_uint32_t now, delta;
+
+    now = rt_hw_cycle_get();
+    delta = now - rt_cpu_usage_stamp;
+    rt_cpu_usage_stamp = now;
+
+    rt_cpu_usage_total += delta;
+    if (rt_current_thread != RT_NULL)
+        rt_current_thread->run_cycles += delta;
+}
+
+/**
+ * This function will charge cycles the cycle counter did not count to the
+ * current thread, it stops in the tickless sleep of the idle thread. It's
+ * called with interrupt disabled.
+ */
+void rt_cpu_usage_add(rt_uint32_t cycles)
+{
+    rt_cpu_usage_total += cycles;
+    if (rt_current_thread != RT_NULL)
+        rt_current_thread->run_cycles += cycles;
+}
+
+/**
+ * This function will return the cycles since the scheduler started, updated
+ * by rt_cpu_usage_update().
+ */
+rt_uint64_t rt_cpu_usage_cycles(void)
+{
+    return rt_cpu_usage_total;
+}
+
+/**
+ * This function will return the number of thread switches.
+ */
+rt_uint32_t rt_cpu_usage_switches(void)
+{
+    return rt_cpu_usage_switch_cnt;
+}
+#endif
+
+#ifdef RT_USING_THREAD_PROFILE
+/*
+ * This function will account the switch from a thread to another in their
+ * profile. It's called with interrupt disabled.
+ */
+static void _rt_thread_profile_switch(struct rt_thread *from, struct rt_thread *to)
+{
+    rt_uint32_t now, latency;
+
+    now = rt_hw_cycle_get();
+    if ((from->stat & RT_THREAD_STAT_MASK) == RT_THREAD_READY)
+    {
+        /* preempted or yielded, ready from now */
+        from->prof_preempts++;
+        from->prof_ready = now;
+    }
+
+    latency = now - to->prof_ready;
+    to->prof_runs++;
+    to->prof_latency_sum += latency;
+    if (latency > to->prof_latency_max)
+        to->prof_latency_max = latency;
+}
+#endif
+
 #ifdef RT_USING_OVERFLOW_CHECK
 static void _rt_scheduler_stack_check(struct rt_thread *thread)
 {
@@ -176,6 +253,16 @@ void rt_system_scheduler_start(void)
 
     rt_current_thread = to_thread;
 
+#ifdef RT_USING_CYCLE_COUNTER
+    rt_hw_cycle_init();
+#endif
+#ifdef RT_USING_CPU_USAGE
+    rt_cpu_usage_stamp = rt_hw_cycle_get();
+#endif
+#ifdef RT_USING_THREAD_PROFILE
+    to_thread->prof_runs++;
+#endif
+
     /* switch to new thread */
     rt_hw_context_switch_to((rt_uint32_t)&to_thread->sp);
 
@@ -221,6 +308,13 @@ void rt_schedule(void)
         /* if the destination thread is not the same as current thread */
         if (to_thread != rt_current_thread)
         {
+#ifdef RT_USING_CPU_USAGE
+            rt_cpu_usage_update();
+            rt_cpu_usage_switch_cnt++;
+#endif
+#ifdef RT_USING_THREAD_PROFILE
+            _rt_thread_profile_switch(rt_current_thread, to_thread);
+#endif
             rt_current_priority = (rt_uint8_t)highest_ready_priority;
             from_thread         = rt_current_thread;
             rt_current_thread   = to_thread;
@@ -276,6 +370,12 @@ void rt_schedule_insert_thread(struct rt_thread *thread)
     /* disable interrupt */
     temp = rt_hw_interrupt_disable();
 
+#ifdef RT_USING_THREAD_PROFILE
+    /* ready from now, unless only requeued as its priority changed */
+    if ((thread->stat & RT_THREAD_STAT_MASK) != RT_THREAD_READY)
+        thread->prof_ready = rt_hw_cycle_get();
+#endif
+
     /* change stat */
     thread->stat = RT_THREAD_READY | (thread->stat & ~RT_THREAD_STAT_MASK);
 
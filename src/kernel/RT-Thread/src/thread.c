@@ -186,6 +186,19 @@ static rt_err_t _rt_thread_init(struct rt_thread *thread,
     thread->cleanup   = 0;
     thread->user_data = 0;
 
+#ifdef RT_USING_CPU_USAGE
+    thread->run_cycles = 0;
+    thread->usage_last = 0;
+    rt_memset(thread->usage_win, 0, sizeof(thread->usage_win));
+#endif
+#ifdef RT_USING_THREAD_PROFILE
+    thread->prof_latency_sum = 0;
+    thread->prof_latency_max = 0;
+    thread->prof_ready       = 0;
+    thread->prof_runs        = 0;
+    thread->prof_preempts    = 0;
+#endif
+
     /* initialize thread timer */
     rt_timer_init(&(thread->thread_timer),
                   thread->name,
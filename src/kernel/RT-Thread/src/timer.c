@@ -21,8 +21,38 @@
 #include <rtthread.h>
 #include <rthw.h>
 
+#ifdef RT_USING_TIMER_WHEEL
+/*
+ * Hierarchical timer wheel: a timer is hashed into the slot of its timeout
+ * tick, at the first level whose range covers the distance to the timeout.
+ * Level n has 32 slots of 32^n ticks each, so 4 levels cover 2^20 ticks and
+ * timers further away are parked in the last level. Start and stop are O(1),
+ * the timers of an upper level slot are cascaded down when the wheel reaches
+ * it. The due timers are moved to the expired list, which is checked like
+ * the skip list was.
+ */
+#define RT_TIMER_WHEEL_BITS             5
+#define RT_TIMER_WHEEL_SIZE             (1 << RT_TIMER_WHEEL_BITS)
+#define RT_TIMER_WHEEL_MASK             (RT_TIMER_WHEEL_SIZE - 1)
+#define RT_TIMER_WHEEL_LEVEL            4
+#define RT_TIMER_WHEEL_RANGE            (1UL << (RT_TIMER_WHEEL_BITS * RT_TIMER_WHEEL_LEVEL))
+
+struct rt_timer_wheel
+{
+    rt_tick_t   tick;                                   /* next tick to collect */
+    rt_uint32_t bitmap[RT_TIMER_WHEEL_LEVEL];           /* non-empty slots */
+    rt_list_t   slot[RT_TIMER_WHEEL_LEVEL][RT_TIMER_WHEEL_SIZE];
+    rt_list_t   expired;                                /* due timers */
+};
+typedef struct rt_timer_wheel rt_timer_head_t;
+#define RT_TIMER_HEAD_NUM               1
+#else
+typedef rt_list_t rt_timer_head_t;
+#define RT_TIMER_HEAD_NUM               RT_TIMER_SKIP_LIST_LEVEL
+#endif
+
 /* hard timer list */
-static rt_list_t rt_timer_list[RT_TIMER_SKIP_LIST_LEVEL];
+static rt_timer_head_t rt_timer_list[RT_TIMER_HEAD_NUM];
 
 #ifdef RT_USING_TIMER_SOFT
 
@@ -40,7 +70,7 @@ static rt_list_t rt_timer_list[RT_TIMER_SKIP_LIST_LEVEL];
 /* soft timer status */
 static rt_uint8_t soft_timer_status = RT_SOFT_TIMER_IDLE;
 /* soft timer list */
-static rt_list_t rt_soft_timer_list[RT_TIMER_SKIP_LIST_LEVEL];
+static rt_timer_head_t rt_soft_timer_list[RT_TIMER_HEAD_NUM];
 static struct rt_thread timer_thread;
 ALIGN(RT_ALIGN_SIZE)
 static rt_uint8_t timer_thread_stack[RT_TIMER_THREAD_STACK_SIZE];
@@ -110,22 +140,221 @@ static void _rt_timer_init(rt_timer_t timer,
     }
 }
 
+rt_inline rt_timer_head_t *_rt_timer_list_of(rt_timer_t timer)
+{
+#ifdef RT_USING_TIMER_SOFT
+    if (timer->parent.flag & RT_TIMER_FLAG_SOFT_TIMER)
+        return rt_soft_timer_list;
+#endif
+    return rt_timer_list;
+}
+
+#ifdef RT_USING_TIMER_WHEEL
+/* the row linking a timer into a wheel slot or the expired list */
+#define RT_TIMER_WHEEL_ROW              (RT_TIMER_SKIP_LIST_LEVEL - 1)
+
+static void _rt_timer_wheel_init(struct rt_timer_wheel *wheel)
+{
+    int i, j;
+
+    wheel->tick = rt_tick_get();
+    for (i = 0; i < RT_TIMER_WHEEL_LEVEL; i++)
+    {
+        wheel->bitmap[i] = 0;
+        for (j = 0; j < RT_TIMER_WHEEL_SIZE; j++)
+        {
+            rt_list_init(&wheel->slot[i][j]);
+        }
+    }
+    rt_list_init(&wheel->expired);
+}
+
+rt_inline int _rt_timer_wheel_isempty(struct rt_timer_wheel *wheel)
+{
+    return (wheel->bitmap[0] | wheel->bitmap[1] |
+            wheel->bitmap[2] | wheel->bitmap[3]) == 0;
+}
+
+/* move all the nodes of list "from" to the tail of list "to" */
+rt_inline void _rt_list_splice_tail(rt_list_t *from, rt_list_t *to)
+{
+    if (!rt_list_isempty(from))
+    {
+        from->next->prev = to->prev;
+        to->prev->next   = from->next;
+        from->prev->next = to;
+        to->prev         = from->prev;
+        rt_list_init(from);
+    }
+}
+
+static void _rt_timer_wheel_add(struct rt_timer_wheel *wheel, rt_timer_t timer)
+{
+    rt_tick_t expires = timer->timeout_tick;
+    rt_tick_t delta;
+    int lvl, idx;
+
+    /* an idle wheel may be far behind, catch up first */
+    if (_rt_timer_wheel_isempty(wheel))
+        wheel->tick = rt_tick_get();
+
+    delta = expires - wheel->tick;
+    if (delta >= RT_TICK_MAX / 2)
+    {
+        /* the slot of the timeout tick is collected already */
+        rt_list_insert_before(&wheel->expired, &timer->row[RT_TIMER_WHEEL_ROW]);
+        return;
+    }
+    if (delta >= RT_TIMER_WHEEL_RANGE)
+    {
+        /* park it in the last slot, it is hashed again when cascaded */
+        delta   = RT_TIMER_WHEEL_RANGE - 1;
+        expires = wheel->tick + delta;
+    }
+
+    for (lvl = 0; lvl < RT_TIMER_WHEEL_LEVEL - 1; lvl++)
+    {
+        if (delta < (1UL << (RT_TIMER_WHEEL_BITS * (lvl + 1))))
+            break;
+    }
+    idx = (expires >> (RT_TIMER_WHEEL_BITS * lvl)) & RT_TIMER_WHEEL_MASK;
+
+    rt_list_insert_before(&wheel->slot[lvl][idx], &timer->row[RT_TIMER_WHEEL_ROW]);
+    wheel->bitmap[lvl] |= 1UL << idx;
+}
+
+static void _rt_timer_wheel_cascade(struct rt_timer_wheel *wheel, int lvl, int idx)
+{
+    rt_list_t list;
+    struct rt_timer *t;
+
+    if (!(wheel->bitmap[lvl] & (1UL << idx)))
+        return;
+
+    rt_list_init(&list);
+    _rt_list_splice_tail(&wheel->slot[lvl][idx], &list);
+    wheel->bitmap[lvl] &= ~(1UL << idx);
+
+    while (!rt_list_isempty(&list))
+    {
+        t = rt_list_entry(list.next, struct rt_timer, row[RT_TIMER_WHEEL_ROW]);
+        rt_list_remove(&t->row[RT_TIMER_WHEEL_ROW]);
+        _rt_timer_wheel_add(wheel, t);
+    }
+}
+
+/* move the timers due until current_tick to the expired list */
+static void _rt_timer_wheel_collect(struct rt_timer_wheel *wheel, rt_tick_t current_tick)
+{
+    rt_uint32_t bits;
+    rt_tick_t step;
+    int lvl, idx, i;
+
+    while ((current_tick - wheel->tick) < RT_TICK_MAX / 2)
+    {
+        if (_rt_timer_wheel_isempty(wheel))
+        {
+            wheel->tick = current_tick + 1;
+            break;
+        }
+
+        idx = wheel->tick & RT_TIMER_WHEEL_MASK;
+        if (idx == 0)
+        {
+            for (lvl = 1; lvl < RT_TIMER_WHEEL_LEVEL; lvl++)
+            {
+                i = (wheel->tick >> (RT_TIMER_WHEEL_BITS * lvl)) & RT_TIMER_WHEEL_MASK;
+                _rt_timer_wheel_cascade(wheel, lvl, i);
+                if (i != 0)
+                    break;
+            }
+        }
+
+        if (wheel->bitmap[0] & (1UL << idx))
+        {
+            _rt_list_splice_tail(&wheel->slot[0][idx], &wheel->expired);
+            wheel->bitmap[0] &= ~(1UL << idx);
+        }
+
+        /* skip the empty slots, but not the next cascade */
+        bits = (wheel->bitmap[0] >> idx) >> 1;
+        step = bits ? __rt_ffs(bits) : RT_TIMER_WHEEL_SIZE - idx;
+        if (step > current_tick - wheel->tick + 1)
+            step = current_tick - wheel->tick + 1;
+        wheel->tick += step;
+    }
+}
+
+/*
+ * The next timeout tick of a wheel. The slots of level 0 hold one tick each,
+ * for the upper levels the start of the first non-empty slot is returned, it
+ * may be earlier than the timeout, never later.
+ */
+static rt_tick_t _rt_timer_wheel_next_timeout(struct rt_timer_wheel *wheel)
+{
+    rt_uint32_t bitmap, bits;
+    rt_tick_t delta, next = RT_TICK_MAX;
+    int lvl, idx, shift;
+
+    if (!rt_list_isempty(&wheel->expired))
+    {
+        return rt_list_entry(wheel->expired.next, struct rt_timer,
+                             row[RT_TIMER_WHEEL_ROW])->timeout_tick;
+    }
+
+    for (lvl = 0; lvl < RT_TIMER_WHEEL_LEVEL; lvl++)
+    {
+        bitmap = wheel->bitmap[lvl];
+        if (bitmap == 0)
+            continue;
+
+        shift = RT_TIMER_WHEEL_BITS * lvl;
+        idx = (wheel->tick >> shift) & RT_TIMER_WHEEL_MASK;
+        /* rotate the slot of the wheel tick to bit 0 */
+        bits = idx ? (bitmap >> idx) | (bitmap << (RT_TIMER_WHEEL_SIZE - idx)) : bitmap;
+
+        if (lvl > 0 && (wheel->tick & ((1UL << shift) - 1)) != 0)
+        {
+            /* the slot of the wheel tick is cascaded already, a timer
+             * in it is one turn ahead */
+            bits  = (bits >> 1) | (bits << (RT_TIMER_WHEEL_SIZE - 1));
+            delta = ((wheel->tick >> shift) + __rt_ffs(bits)) << shift;
+        }
+        else
+        {
+            delta = ((wheel->tick >> shift) + __rt_ffs(bits) - 1) << shift;
+        }
+        delta -= wheel->tick;
+        if (delta < next)
+            next = delta;
+    }
+
+    return next == RT_TICK_MAX ? RT_TICK_MAX : wheel->tick + next;
+}
+#endif /* RT_USING_TIMER_WHEEL */
+
 /* the fist timer always in the last row */
-static rt_tick_t rt_timer_list_next_timeout(rt_list_t timer_list[])
+static rt_tick_t rt_timer_list_next_timeout(rt_timer_head_t timer_list[])
 {
+#ifndef RT_USING_TIMER_WHEEL
     struct rt_timer *timer;
+#endif
     register rt_base_t level;
     rt_tick_t timeout_tick = RT_TICK_MAX;
 
     /* disable interrupt */
     level = rt_hw_interrupt_disable();
 
+#ifdef RT_USING_TIMER_WHEEL
+    timeout_tick = _rt_timer_wheel_next_timeout(timer_list);
+#else
     if (!rt_list_isempty(&timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1]))
     {
         timer = rt_list_entry(timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1].next,
                               struct rt_timer, row[RT_TIMER_SKIP_LIST_LEVEL - 1]);
         timeout_tick = timer->timeout_tick;
     }
+#endif
 
     /* enable interrupt */
     rt_hw_interrupt_enable(level);
@@ -133,17 +362,49 @@ static rt_tick_t rt_timer_list_next_timeout(rt_list_t timer_list[])
     return timeout_tick;
 }
 
+/* the first timer of the list, the wheel collects the timers due first */
+static struct rt_timer *rt_timer_list_first(rt_timer_head_t timer_list[],
+                                            rt_tick_t current_tick)
+{
+    rt_list_t *head;
+
+#ifdef RT_USING_TIMER_WHEEL
+    _rt_timer_wheel_collect(timer_list, current_tick);
+    head = &timer_list->expired;
+#else
+    head = &timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1];
+#endif
+    if (rt_list_isempty(head))
+        return RT_NULL;
+
+    return rt_list_entry(head->next, struct rt_timer, row[RT_TIMER_SKIP_LIST_LEVEL - 1]);
+}
+
 rt_inline void _rt_timer_remove(rt_timer_t timer)
 {
+#ifdef RT_USING_TIMER_WHEEL
+    struct rt_timer_wheel *wheel = _rt_timer_list_of(timer);
+    rt_list_t *node = &timer->row[RT_TIMER_WHEEL_ROW];
+    rt_ubase_t n;
+
+    /* the last timer of a slot leaves, the slot is linked to itself only */
+    n = ((rt_ubase_t)node->prev - (rt_ubase_t)&wheel->slot[0][0]) / sizeof(rt_list_t);
+    if (node->next == node->prev && n < RT_TIMER_WHEEL_LEVEL * RT_TIMER_WHEEL_SIZE)
+    {
+        wheel->bitmap[n >> RT_TIMER_WHEEL_BITS] &= ~(1UL << (n & RT_TIMER_WHEEL_MASK));
+    }
+    rt_list_remove(node);
+#else
     int i;
 
     for (i = 0; i < RT_TIMER_SKIP_LIST_LEVEL; i++)
     {
         rt_list_remove(&timer->row[i]);
     }
+#endif
 }
 
-#if RT_DEBUG_TIMER
+#if RT_DEBUG_TIMER && !defined(RT_USING_TIMER_WHEEL)
 static int rt_timer_count_height(struct rt_timer *timer)
 {
     int i, cnt = 0;
@@ -310,12 +571,14 @@ rt_err_t rt_timer_delete(rt_timer_t timer)
  */
 rt_err_t rt_timer_start(rt_timer_t timer)
 {
-    unsigned int row_lvl;
-    rt_list_t *timer_list;
+    rt_timer_head_t *timer_list;
     register rt_base_t level;
+#ifndef RT_USING_TIMER_WHEEL
+    unsigned int row_lvl;
     rt_list_t *row_head[RT_TIMER_SKIP_LIST_LEVEL];
     unsigned int tst_nr;
     static unsigned int random_nr;
+#endif
 
     /* timer check */
     RT_ASSERT(timer != RT_NULL);
@@ -337,19 +600,12 @@ rt_err_t rt_timer_start(rt_timer_t timer)
     RT_ASSERT(timer->init_tick < RT_TICK_MAX / 2);
     timer->timeout_tick = rt_tick_get() + timer->init_tick;
 
-#ifdef RT_USING_TIMER_SOFT
-    if (timer->parent.flag & RT_TIMER_FLAG_SOFT_TIMER)
-    {
-        /* insert timer to soft timer list */
-        timer_list = rt_soft_timer_list;
-    }
-    else
-#endif
-    {
-        /* insert timer to system timer list */
-        timer_list = rt_timer_list;
-    }
+    /* insert timer to soft or system timer list */
+    timer_list = _rt_timer_list_of(timer);
 
+#ifdef RT_USING_TIMER_WHEEL
+    _rt_timer_wheel_add(timer_list, timer);
+#else
     row_head[0]  = &timer_list[0];
     for (row_lvl = 0; row_lvl < RT_TIMER_SKIP_LIST_LEVEL; row_lvl++)
     {
@@ -400,6 +656,7 @@ rt_err_t rt_timer_start(rt_timer_t timer)
          * bits. */
         tst_nr >>= (RT_TIMER_SKIP_LIST_MASK + 1) >> 1;
     }
+#endif /* RT_USING_TIMER_WHEEL */
 
     timer->parent.flag |= RT_TIMER_FLAG_ACTIVATED;
 
@@ -535,11 +792,8 @@ void rt_timer_check(void)
     /* disable interrupt */
     level = rt_hw_interrupt_disable();
 
-    while (!rt_list_isempty(&rt_timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1]))
+    while ((t = rt_timer_list_first(rt_timer_list, current_tick)) != RT_NULL)
     {
-        t = rt_list_entry(rt_timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1].next,
-                          struct rt_timer, row[RT_TIMER_SKIP_LIST_LEVEL - 1]);
-
         /*
          * It supposes that the new tick shall less than the half duration of
          * tick max.
@@ -617,11 +871,8 @@ void rt_soft_timer_check(void)
     /* disable interrupt */
     level = rt_hw_interrupt_disable();
 
-    while (!rt_list_isempty(&rt_soft_timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1]))
+    while ((t = rt_timer_list_first(rt_soft_timer_list, rt_tick_get())) != RT_NULL)
     {
-        t = rt_list_entry(rt_soft_timer_list[RT_TIMER_SKIP_LIST_LEVEL - 1].next,
-                            struct rt_timer, row[RT_TIMER_SKIP_LIST_LEVEL - 1]);
-
         current_tick = rt_tick_get();
 
         /*
@@ -720,12 +971,16 @@ static void rt_thread_timer_entry(void *parameter)
  */
 void rt_system_timer_init(void)
 {
+#ifdef RT_USING_TIMER_WHEEL
+    _rt_timer_wheel_init(rt_timer_list);
+#else
     int i;
 
     for (i = 0; i < sizeof(rt_timer_list) / sizeof(rt_timer_list[0]); i++)
     {
         rt_list_init(rt_timer_list + i);
     }
+#endif
 }
 
 /**
@@ -736,6 +991,9 @@ void rt_system_timer_init(void)
 void rt_system_timer_thread_init(void)
 {
 #ifdef RT_USING_TIMER_SOFT
+#ifdef RT_USING_TIMER_WHEEL
+    _rt_timer_wheel_init(rt_soft_timer_list);
+#else
     int i;
 
     for (i = 0;
@@ -744,6 +1002,7 @@ void rt_system_timer_thread_init(void)
     {
         rt_list_init(rt_soft_timer_list + i);
     }
+#endif
 
     /* start software timer thread */
     rt_thread_init(&timer_thread,
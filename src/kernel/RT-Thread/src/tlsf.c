@@ -0,0 +1,686 @@
+/*
+ * Copyright (c) 2006-2021, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * File      : tlsf.c
+ *
+ * Two-Level Segregated Fit heap, after M. Masmano et al., "TLSF: a New
+ * Dynamic Memory Allocator for Real-Time Systems", ECRTS 2004.
+ *
+ * The free blocks are kept in size classes: a first level of power of two
+ * ranges, each split linearly into 2^TLSF_SL_LOG2 second level classes. Two
+ * bitmaps tell which classes have free blocks, so that malloc finds a class
+ * at least as large as the request with two bit scans, and free merges with
+ * both physical neighbours right away. Both run in bounded time, whatever
+ * the fragmentation of the heap.
+ */
+
+#include <rthw.h>
+#include <rtthread.h>
+
+#define RT_MEM_STATS
+
+#if defined (RT_USING_HEAP) && defined (RT_USING_TLSF)
+
+#if RT_ALIGN_SIZE == 4
+#define TLSF_ALIGN_LOG2         2
+#elif RT_ALIGN_SIZE == 8
+#define TLSF_ALIGN_LOG2         3
+#else
+#error "TLSF heap needs RT_ALIGN_SIZE of 4 or 8"
+#endif
+
+#define TLSF_ALIGN_SIZE         (1UL << TLSF_ALIGN_LOG2)
+
+/* 16 second level classes per power of two, 6% max internal fragmentation */
+#define TLSF_SL_LOG2            4
+#define TLSF_SL_COUNT           (1UL << TLSF_SL_LOG2)
+
+/* blocks below TLSF_SMALL_SIZE all map to first level 0, linearly */
+#define TLSF_FL_SHIFT           (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_SIZE         (1UL << TLSF_FL_SHIFT)
+
+/* largest block is below 16MB */
+#define TLSF_FL_MAX             24
+#define TLSF_FL_COUNT           (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_BLOCK_SIZE_MAX     (1UL << TLSF_FL_MAX)
+
+#define TLSF_BLOCK_FREE         0x1UL
+#define TLSF_BLOCK_FLAGS        (TLSF_ALIGN_SIZE - 1)
+
+/*
+ * A block is its header followed by the payload. The free list links are
+ * only used while the block is free and overlay the payload, so the
+ * overhead of an allocated block is the header only.
+ */
+struct tlsf_block
+{
+    struct tlsf_block *prev_phys;                       /**< physical previous block, RT_NULL for the first */
+    rt_size_t          size;                            /**< payload size | flags */
+
+    struct tlsf_block *next_free;                       /**< next in the free list */
+    struct tlsf_block *prev_free;                       /**< previous in the free list */
+};
+
+#define TLSF_HDR_SIZE           (2 * sizeof(void *))
+#define TLSF_PAYLOAD_MIN        (2 * sizeof(void *))
+
+struct tlsf_control
+{
+    rt_uint32_t        fl_bitmap;
+    rt_uint32_t        sl_bitmap[TLSF_FL_COUNT];
+    struct tlsf_block *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+};
+
+#ifdef RT_USING_HOOK
+static void (*rt_malloc_hook)(void *ptr, rt_size_t size);
+static void (*rt_free_hook)(void *ptr);
+
+/**
+ * @addtogroup Hook
+ */
+
+/**@{*/
+
+/**
+ * This function will set a hook function, which will be invoked when a memory
+ * block is allocated from heap memory.
+ *
+ * @param hook the hook function
+ */
+void rt_malloc_sethook(void (*hook)(void *ptr, rt_size_t size))
+{
+    rt_malloc_hook = hook;
+}
+
+/**
+ * This function will set a hook function, which will be invoked when a memory
+ * block is released to heap memory.
+ *
+ * @param hook the hook function
+ */
+void rt_free_sethook(void (*hook)(void *ptr))
+{
+    rt_free_hook = hook;
+}
+
+/**@}*/
+
+#endif
+
+static struct tlsf_control *tlsf;
+static struct tlsf_block *heap_first;
+static struct tlsf_block *heap_end;                     /* zero sized, always used */
+
+static struct rt_semaphore heap_sem;
+static rt_size_t mem_size_aligned;
+
+#ifdef RT_MEM_STATS
+static rt_size_t used_mem, max_mem;
+#endif
+
+/* index of the most significant bit set, x != 0 */
+rt_inline int tlsf_fls(rt_size_t x)
+{
+    return (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(x);
+}
+
+/* index of the least significant bit set, x != 0 */
+rt_inline int tlsf_ffs(rt_uint32_t x)
+{
+    return __builtin_ctz(x);
+}
+
+rt_inline rt_size_t tlsf_block_size(const struct tlsf_block *block)
+{
+    return block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+rt_inline int tlsf_block_is_free(const struct tlsf_block *block)
+{
+    return (block->size & TLSF_BLOCK_FREE) != 0;
+}
+
+rt_inline void *tlsf_block_to_ptr(struct tlsf_block *block)
+{
+    return (rt_uint8_t *)block + TLSF_HDR_SIZE;
+}
+
+rt_inline struct tlsf_block *tlsf_ptr_to_block(void *ptr)
+{
+    return (struct tlsf_block *)((rt_uint8_t *)ptr - TLSF_HDR_SIZE);
+}
+
+rt_inline struct tlsf_block *tlsf_block_next(struct tlsf_block *block)
+{
+    return (struct tlsf_block *)((rt_uint8_t *)block + TLSF_HDR_SIZE +
+                                 tlsf_block_size(block));
+}
+
+/* the classes of the free lists holding blocks of exactly size */
+rt_inline void tlsf_mapping_insert(rt_size_t size, int *fl, int *sl)
+{
+    int f;
+
+    if (size < TLSF_SMALL_SIZE)
+    {
+        *fl = 0;
+        *sl = (int)(size >> TLSF_ALIGN_LOG2);
+    }
+    else
+    {
+        f = tlsf_fls(size);
+        *sl = (int)((size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT);
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+/* the first class whose blocks are all at least size long */
+rt_inline void tlsf_mapping_search(rt_size_t size, int *fl, int *sl)
+{
+    if (size >= TLSF_SMALL_SIZE)
+        size += (1UL << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+static struct tlsf_block *tlsf_search_suitable(int *fl, int *sl)
+{
+    rt_uint32_t sl_map, fl_map;
+
+    sl_map = tlsf->sl_bitmap[*fl] & (~0UL << *sl);
+    if (sl_map == 0)
+    {
+        /* none left at this first level, take the next larger one */
+        if (*fl + 1 >= TLSF_FL_COUNT)
+            return RT_NULL;
+        fl_map = tlsf->fl_bitmap & (~0UL << (*fl + 1));
+        if (fl_map == 0)
+            return RT_NULL;
+
+        *fl = tlsf_ffs(fl_map);
+        sl_map = tlsf->sl_bitmap[*fl];
+    }
+    *sl = tlsf_ffs(sl_map);
+
+    return tlsf->blocks[*fl][*sl];
+}
+
+static void tlsf_remove_free(struct tlsf_block *block, int fl, int sl)
+{
+    struct tlsf_block *prev = block->prev_free;
+    struct tlsf_block *next = block->next_free;
+
+    if (next != RT_NULL)
+        next->prev_free = prev;
+    if (prev != RT_NULL)
+    {
+        prev->next_free = next;
+    }
+    else
+    {
+        tlsf->blocks[fl][sl] = next;
+        if (next == RT_NULL)
+        {
+            tlsf->sl_bitmap[fl] &= ~(1UL << sl);
+            if (tlsf->sl_bitmap[fl] == 0)
+                tlsf->fl_bitmap &= ~(1UL << fl);
+        }
+    }
+}
+
+rt_inline void tlsf_remove_block(struct tlsf_block *block)
+{
+    int fl, sl;
+
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+    tlsf_remove_free(block, fl, sl);
+}
+
+static void tlsf_insert_block(struct tlsf_block *block)
+{
+    int fl, sl;
+    struct tlsf_block *head;
+
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+    head = tlsf->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = RT_NULL;
+    if (head != RT_NULL)
+        head->prev_free = block;
+    tlsf->blocks[fl][sl] = block;
+    tlsf->fl_bitmap |= 1UL << fl;
+    tlsf->sl_bitmap[fl] |= 1UL << sl;
+}
+
+/* the first size bytes of block are kept, returns the rest or RT_NULL */
+static struct tlsf_block *tlsf_block_split(struct tlsf_block *block, rt_size_t size)
+{
+    struct tlsf_block *rest;
+    rt_size_t block_size = tlsf_block_size(block);
+
+    if (block_size < size + TLSF_HDR_SIZE + TLSF_PAYLOAD_MIN)
+        return RT_NULL;
+
+    rest = (struct tlsf_block *)((rt_uint8_t *)tlsf_block_to_ptr(block) + size);
+    rest->prev_phys = block;
+    rest->size = (block_size - size - TLSF_HDR_SIZE) | TLSF_BLOCK_FREE;
+    tlsf_block_next(rest)->prev_phys = rest;
+    block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+
+    return rest;
+}
+
+/* next is the free physical next of block, not in a free list */
+rt_inline void tlsf_block_absorb(struct tlsf_block *block, struct tlsf_block *next)
+{
+    block->size += TLSF_HDR_SIZE + tlsf_block_size(next);
+    tlsf_block_next(block)->prev_phys = block;
+}
+
+/* merge the free block with its free neighbours and put it in a free list */
+static void tlsf_block_release(struct tlsf_block *block)
+{
+    struct tlsf_block *prev = block->prev_phys;
+    struct tlsf_block *next = tlsf_block_next(block);
+
+    if (prev != RT_NULL && tlsf_block_is_free(prev))
+    {
+        tlsf_remove_block(prev);
+        tlsf_block_absorb(prev, block);
+        block = prev;
+    }
+    if (tlsf_block_is_free(next))
+    {
+        tlsf_remove_block(next);
+        tlsf_block_absorb(block, next);
+    }
+    tlsf_insert_block(block);
+}
+
+rt_inline rt_size_t tlsf_adjust_size(rt_size_t size)
+{
+    size = RT_ALIGN(size, TLSF_ALIGN_SIZE);
+    if (size < TLSF_PAYLOAD_MIN)
+        size = TLSF_PAYLOAD_MIN;
+
+    return size;
+}
+
+rt_inline int tlsf_check(void *rmem)
+{
+    return (rt_uint8_t *)rmem > (rt_uint8_t *)heap_first &&
+           (rt_uint8_t *)rmem < (rt_uint8_t *)heap_end;
+}
+
+/**
+ * @ingroup SystemInit
+ *
+ * This function will initialize system heap memory.
+ *
+ * @param begin_addr the beginning address of system heap memory.
+ * @param end_addr the end address of system heap memory.
+ */
+void rt_system_heap_init(void *begin_addr, void *end_addr)
+{
+    rt_ubase_t begin_align = RT_ALIGN((rt_ubase_t)begin_addr, TLSF_ALIGN_SIZE);
+    rt_ubase_t end_align   = RT_ALIGN_DOWN((rt_ubase_t)end_addr, TLSF_ALIGN_SIZE);
+    rt_ubase_t pool = begin_align + RT_ALIGN(sizeof(struct tlsf_control), TLSF_ALIGN_SIZE);
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    /* room for the control, a minimal block and the end block */
+    if (end_align < pool ||
+        end_align - pool < 2 * TLSF_HDR_SIZE + TLSF_PAYLOAD_MIN)
+    {
+        rt_kprintf("mem init, error begin address 0x%x, and end address 0x%x\n",
+                   (rt_ubase_t)begin_addr, (rt_ubase_t)end_addr);
+
+        return;
+    }
+
+    mem_size_aligned = end_align - pool - 2 * TLSF_HDR_SIZE;
+    if (mem_size_aligned >= TLSF_BLOCK_SIZE_MAX)
+        mem_size_aligned = TLSF_BLOCK_SIZE_MAX - TLSF_ALIGN_SIZE;
+
+    tlsf = (struct tlsf_control *)begin_align;
+    rt_memset(tlsf, 0, sizeof(*tlsf));
+
+    RT_DEBUG_LOG(RT_DEBUG_MEM, ("mem init, heap begin address 0x%x, size %d\n",
+                                pool, mem_size_aligned));
+
+    /* one free block spanning the heap, followed by the end block */
+    heap_first            = (struct tlsf_block *)pool;
+    heap_first->prev_phys = RT_NULL;
+    heap_first->size      = mem_size_aligned | TLSF_BLOCK_FREE;
+
+    heap_end              = tlsf_block_next(heap_first);
+    heap_end->prev_phys   = heap_first;
+    heap_end->size        = 0;
+
+    tlsf_insert_block(heap_first);
+
+    rt_sem_init(&heap_sem, "heap", 1, RT_IPC_FLAG_FIFO);
+}
+
+/**
+ * @addtogroup MM
+ */
+
+/**@{*/
+
+/**
+ * Allocate a block of memory with a minimum of 'size' bytes.
+ *
+ * @param size is the minimum size of the requested block in bytes.
+ *
+ * @return pointer to allocated memory or NULL if no free memory was found.
+ */
+void *rt_malloc(rt_size_t size)
+{
+    struct tlsf_block *block, *rest;
+    int fl, sl;
+
+    if (size == 0)
+        return RT_NULL;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    if (size > mem_size_aligned)
+    {
+        RT_DEBUG_LOG(RT_DEBUG_MEM, ("no memory\n"));
+
+        return RT_NULL;
+    }
+
+    size = tlsf_adjust_size(size);
+    tlsf_mapping_search(size, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT)
+        return RT_NULL;
+
+    /* take memory semaphore */
+    rt_sem_take(&heap_sem, RT_WAITING_FOREVER);
+
+    block = tlsf_search_suitable(&fl, &sl);
+    if (block == RT_NULL)
+    {
+        rt_sem_release(&heap_sem);
+        RT_DEBUG_LOG(RT_DEBUG_MEM, ("no memory\n"));
+
+        return RT_NULL;
+    }
+
+    tlsf_remove_free(block, fl, sl);
+    block->size &= ~TLSF_BLOCK_FREE;
+
+    /* the rest cannot have a free next, free blocks are always merged */
+    rest = tlsf_block_split(block, size);
+    if (rest != RT_NULL)
+        tlsf_insert_block(rest);
+
+#ifdef RT_MEM_STATS
+    used_mem += tlsf_block_size(block) + TLSF_HDR_SIZE;
+    if (max_mem < used_mem)
+        max_mem = used_mem;
+#endif
+
+    rt_sem_release(&heap_sem);
+
+    RT_DEBUG_LOG(RT_DEBUG_MEM,
+                 ("allocate memory at 0x%x, size: %d\n",
+                  (rt_ubase_t)tlsf_block_to_ptr(block),
+                  (rt_ubase_t)tlsf_block_size(block)));
+
+    RT_OBJECT_HOOK_CALL(rt_malloc_hook, (tlsf_block_to_ptr(block), size));
+
+    return tlsf_block_to_ptr(block);
+}
+
+/**
+ * This function will change the previously allocated memory block.
+ *
+ * @param rmem pointer to memory allocated by rt_malloc
+ * @param newsize the required new size
+ *
+ * @return the changed memory block address
+ */
+void *rt_realloc(void *rmem, rt_size_t newsize)
+{
+    struct tlsf_block *block, *next, *rest;
+    rt_size_t size;
+    void *nmem;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    if (newsize > mem_size_aligned)
+    {
+        RT_DEBUG_LOG(RT_DEBUG_MEM, ("realloc: out of memory\n"));
+
+        return RT_NULL;
+    }
+    else if (newsize == 0)
+    {
+        rt_free(rmem);
+        return RT_NULL;
+    }
+
+    /* allocate a new memory block */
+    if (rmem == RT_NULL)
+        return rt_malloc(newsize);
+
+    if (!tlsf_check(rmem))
+    {
+        /* illegal memory */
+        return rmem;
+    }
+
+    newsize = tlsf_adjust_size(newsize);
+    block = tlsf_ptr_to_block(rmem);
+
+    rt_sem_take(&heap_sem, RT_WAITING_FOREVER);
+
+    size = tlsf_block_size(block);
+    next = tlsf_block_next(block);
+
+    /* grow in place into a free next block */
+    if (newsize > size && tlsf_block_is_free(next) &&
+        size + TLSF_HDR_SIZE + tlsf_block_size(next) >= newsize)
+    {
+        tlsf_remove_block(next);
+        tlsf_block_absorb(block, next);
+    }
+
+    if (newsize <= tlsf_block_size(block))
+    {
+        rest = tlsf_block_split(block, newsize);
+        if (rest != RT_NULL)
+            tlsf_block_release(rest);
+#ifdef RT_MEM_STATS
+        used_mem += tlsf_block_size(block);
+        used_mem -= size;
+        if (max_mem < used_mem)
+            max_mem = used_mem;
+#endif
+        rt_sem_release(&heap_sem);
+
+        return rmem;
+    }
+    rt_sem_release(&heap_sem);
+
+    /* expand memory */
+    nmem = rt_malloc(newsize);
+    if (nmem != RT_NULL) /* check memory */
+    {
+        rt_memcpy(nmem, rmem, size < newsize ? size : newsize);
+        rt_free(rmem);
+    }
+
+    return nmem;
+}
+
+/**
+ * This function will contiguously allocate enough space for count objects
+ * that are size bytes of memory each and returns a pointer to the allocated
+ * memory.
+ *
+ * The allocated memory is filled with bytes of value zero.
+ *
+ * @param count number of objects to allocate
+ * @param size size of the objects to allocate
+ *
+ * @return pointer to allocated memory / NULL pointer if there is an error
+ */
+void *rt_calloc(rt_size_t count, rt_size_t size)
+{
+    void *p;
+
+    /* allocate 'count' objects of size 'size' */
+    p = rt_malloc(count * size);
+
+    /* zero the memory */
+    if (p)
+        rt_memset(p, 0, count * size);
+
+    return p;
+}
+
+/**
+ * This function will release the previously allocated memory block by
+ * rt_malloc. The released memory block is taken back to system heap.
+ *
+ * @param rmem the address of memory which will be released
+ */
+void rt_free(void *rmem)
+{
+    struct tlsf_block *block;
+
+    if (rmem == RT_NULL)
+        return;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    RT_ASSERT((((rt_ubase_t)rmem) & (TLSF_ALIGN_SIZE - 1)) == 0);
+    RT_ASSERT(tlsf_check(rmem));
+
+    RT_OBJECT_HOOK_CALL(rt_free_hook, (rmem));
+
+    if (!tlsf_check(rmem))
+    {
+        RT_DEBUG_LOG(RT_DEBUG_MEM, ("illegal memory\n"));
+
+        return;
+    }
+
+    block = tlsf_ptr_to_block(rmem);
+
+    RT_DEBUG_LOG(RT_DEBUG_MEM,
+                 ("release memory 0x%x, size: %d\n",
+                  (rt_ubase_t)rmem, (rt_ubase_t)tlsf_block_size(block)));
+
+    /* protect the heap from concurrent access */
+    rt_sem_take(&heap_sem, RT_WAITING_FOREVER);
+
+    if (tlsf_block_is_free(block) || tlsf_block_next(block)->prev_phys != block)
+    {
+        rt_kprintf("to free a bad data block:\n");
+        rt_kprintf("mem: 0x%08x, size: 0x%08x\n", block, block->size);
+    }
+    RT_ASSERT(!tlsf_block_is_free(block));
+    RT_ASSERT(tlsf_block_next(block)->prev_phys == block);
+
+#ifdef RT_MEM_STATS
+    used_mem -= tlsf_block_size(block) + TLSF_HDR_SIZE;
+#endif
+
+    block->size |= TLSF_BLOCK_FREE;
+    tlsf_block_release(block);
+    rt_sem_release(&heap_sem);
+}
+
+#ifdef RT_MEM_STATS
+void rt_memory_info(rt_uint32_t *total,
+                    rt_uint32_t *used,
+                    rt_uint32_t *max_used)
+{
+    if (total != RT_NULL)
+        *total = mem_size_aligned;
+    if (used  != RT_NULL)
+        *used = used_mem;
+    if (max_used != RT_NULL)
+        *max_used = max_mem;
+}
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+/* the largest free block is in the highest non empty class */
+static rt_size_t tlsf_largest_free(void)
+{
+    struct tlsf_block *block;
+    rt_size_t size, max = 0;
+    int fl;
+
+    rt_sem_take(&heap_sem, RT_WAITING_FOREVER);
+    if (tlsf->fl_bitmap != 0)
+    {
+        fl = tlsf_fls(tlsf->fl_bitmap);
+        block = tlsf->blocks[fl][tlsf_fls(tlsf->sl_bitmap[fl])];
+        for (; block != RT_NULL; block = block->next_free)
+        {
+            size = tlsf_block_size(block);
+            if (size > max)
+                max = size;
+        }
+    }
+    rt_sem_release(&heap_sem);
+
+    return max;
+}
+
+void list_mem(void)
+{
+    rt_kprintf("total memory: %d\n", mem_size_aligned);
+    rt_kprintf("used memory : %d\n", used_mem);
+    rt_kprintf("maximum allocated memory: %d\n", max_mem);
+    rt_kprintf("largest free block: %d\n", tlsf_largest_free());
+}
+FINSH_FUNCTION_EXPORT(list_mem, list memory usage information)
+
+#ifdef RT_USING_MEMTRACE
+int memcheck(void)
+{
+    rt_ubase_t level;
+    struct tlsf_block *block, *prev = RT_NULL;
+
+    level = rt_hw_interrupt_disable();
+    for (block = heap_first; block != heap_end; block = tlsf_block_next(block))
+    {
+        if (block->prev_phys != prev) goto __exit;
+        if (tlsf_block_size(block) > mem_size_aligned) goto __exit;
+        if (prev != RT_NULL && tlsf_block_is_free(prev) && tlsf_block_is_free(block)) goto __exit;
+        prev = block;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return 0;
+__exit:
+    rt_kprintf("Memory block wrong:\n");
+    rt_kprintf("address: 0x%08x\n", block);
+    rt_kprintf("   prev: 0x%08x\n", block->prev_phys);
+    rt_kprintf("   size: 0x%08x\n", block->size);
+    rt_hw_interrupt_enable(level);
+
+    return 0;
+}
+MSH_CMD_EXPORT(memcheck, check memory data);
+#endif /* end of RT_USING_MEMTRACE */
+#endif /* end of RT_USING_FINSH    */
+
+#endif
+
+/**@}*/
+
+#endif /* end of RT_USING_TLSF */
@@ -45,3 +45,21 @@ uint32_t OS_CpuUsageGet(void)
 {
 	return OSGetCpuUsage();
 }
+
+int OS_CpuUsageGetInfo(OS_CpuUsageInfo_t *info)
+{
+	OS_Memset(info, 0, sizeof(*info));
+	info->usage = OSGetCpuUsage() * 10;
+	info->idle = 1000 - info->usage;
+	return 0;
+}
+
+int OS_CpuUsageGetThreads(OS_CpuUsageThread_t *threads, int num)
+{
+	return 0; /* not supported */
+}
+
+void OS_CpuUsageShow(void)
+{
+	OS_LOG(1, "cpu usage %u%%\n", OSGetCpuUsage());
+}
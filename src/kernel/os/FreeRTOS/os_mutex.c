@@ -49,6 +49,30 @@ OS_Status OS_MutexCreate(OS_Mutex_t *mutex)
 	return OS_OK;
 }
 
+/*
+ * Without configSUPPORT_STATIC_ALLOCATION the static variants fall back to
+ * the kernel allocating the object.
+ */
+OS_Status OS_MutexCreateStatic(OS_MutexStatic_t *mutex)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	_Static_assert(sizeof(StaticSemaphore_t) <= sizeof(mutex->storage),
+	               "OS_MUTEX_STATIC_STORAGE_WORDS too small");
+
+	OS_HANDLE_ASSERT(!OS_MutexIsValid(&mutex->mutex), mutex->mutex.handle);
+
+	mutex->mutex.handle = xSemaphoreCreateMutexStatic((StaticSemaphore_t *)mutex->storage);
+	if (mutex->mutex.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", mutex->mutex.handle);
+		return OS_FAIL;
+	}
+
+	return OS_OK;
+#else
+	return OS_MutexCreate(&mutex->mutex);
+#endif
+}
+
 OS_Status OS_MutexDelete(OS_Mutex_t *mutex)
 {
 	OS_HANDLE_ASSERT(OS_MutexIsValid(mutex), mutex->handle);
@@ -101,6 +125,23 @@ OS_Status OS_RecursiveMutexCreate(OS_Mutex_t *mutex)
 	return OS_OK;
 }
 
+OS_Status OS_RecursiveMutexCreateStatic(OS_MutexStatic_t *mutex)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	OS_HANDLE_ASSERT(!OS_MutexIsValid(&mutex->mutex), mutex->mutex.handle);
+
+	mutex->mutex.handle = xSemaphoreCreateRecursiveMutexStatic((StaticSemaphore_t *)mutex->storage);
+	if (mutex->mutex.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", mutex->mutex.handle);
+		return OS_FAIL;
+	}
+
+	return OS_OK;
+#else
+	return OS_RecursiveMutexCreate(&mutex->mutex);
+#endif
+}
+
 OS_Status OS_RecursiveMutexDelete(OS_Mutex_t *mutex)
 {
 	return OS_MutexDelete(mutex);
@@ -144,3 +185,17 @@ OS_ThreadHandle_t OS_MutexGetOwner(OS_Mutex_t *mutex)
 
 	return (OS_ThreadHandle_t)xSemaphoreGetMutexHolder(mutex->handle);
 }
+
+void OS_MutexSetName(OS_Mutex_t *mutex, const char *name)
+{
+	/* the queue registry keeps a reference to name, not used */
+}
+
+int OS_MutexStatGet(OS_MutexStat_t *stat, int num)
+{
+	return -1;
+}
+
+void OS_MutexStatReset(void)
+{
+}
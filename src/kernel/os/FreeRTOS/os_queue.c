@@ -49,6 +49,30 @@ OS_Status OS_QueueCreate(OS_Queue_t *queue, uint32_t queueLen, uint32_t itemSize
 	return OS_OK;
 }
 
+/*
+ * Without configSUPPORT_STATIC_ALLOCATION the static variants fall back to
+ * the kernel allocating the object, the pool is not used.
+ */
+OS_Status OS_QueueCreateStatic(OS_QueueStatic_t *queue, uint32_t queueLen,
+                               uint32_t itemSize, void *pool)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	_Static_assert(sizeof(StaticQueue_t) <= sizeof(queue->storage),
+	               "OS_QUEUE_STATIC_STORAGE_WORDS too small");
+
+	queue->queue.handle = xQueueCreateStatic(queueLen, itemSize, pool,
+	                                         (StaticQueue_t *)queue->storage);
+	if (queue->queue.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", queue->queue.handle);
+		return OS_FAIL;
+	}
+
+	return OS_OK;
+#else
+	return OS_QueueCreate(&queue->queue, queueLen, itemSize);
+#endif
+}
+
 OS_Status OS_QueueDelete(OS_Queue_t *queue)
 {
 	UBaseType_t ret;
@@ -62,6 +62,30 @@ OS_Status OS_SemaphoreCreateBinary(OS_Semaphore_t *sem)
 	return OS_OK;
 }
 
+/*
+ * Without configSUPPORT_STATIC_ALLOCATION the static variants fall back to
+ * the kernel allocating the object.
+ */
+OS_Status OS_SemaphoreCreateStatic(OS_SemaphoreStatic_t *sem, uint32_t initCount,
+                                   uint32_t maxCount)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	_Static_assert(sizeof(StaticSemaphore_t) <= sizeof(sem->storage),
+	               "OS_SEMAPHORE_STATIC_STORAGE_WORDS too small");
+
+	sem->sem.handle = xSemaphoreCreateCountingStatic(maxCount, initCount,
+	                                                 (StaticSemaphore_t *)sem->storage);
+	if (sem->sem.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", sem->sem.handle);
+		return OS_FAIL;
+	}
+
+	return OS_OK;
+#else
+	return OS_SemaphoreCreate(&sem->sem, initCount, maxCount);
+#endif
+}
+
 OS_Status OS_SemaphoreDelete(OS_Semaphore_t *sem)
 {
 	OS_HANDLE_ASSERT(OS_SemaphoreIsValid(sem), sem->handle);
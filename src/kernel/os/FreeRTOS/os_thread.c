@@ -57,6 +57,34 @@ OS_Status OS_ThreadCreate(OS_Thread_t *thread, const char *name,
 	return OS_OK;
 }
 
+/*
+ * Without configSUPPORT_STATIC_ALLOCATION the static variants fall back to
+ * the kernel allocating the object and the stack.
+ */
+OS_Status OS_ThreadCreateStatic(OS_ThreadStatic_t *thread, const char *name,
+                                OS_ThreadEntry_t entry, void *arg,
+                                OS_Priority priority, void *stack,
+                                uint32_t stackSize)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	_Static_assert(sizeof(StaticTask_t) <= sizeof(thread->storage),
+	               "OS_THREAD_STATIC_STORAGE_WORDS too small");
+
+	OS_HANDLE_ASSERT(!OS_ThreadIsValid(&thread->thread), thread->thread.handle);
+
+	thread->thread.handle = xTaskCreateStatic(entry, name, stackSize / sizeof(StackType_t),
+	                                          arg, OS_KERNEL_PRIO(priority), stack,
+	                                          (StaticTask_t *)thread->storage);
+	if (thread->thread.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", thread->thread.handle);
+		return OS_FAIL;
+	}
+	return OS_OK;
+#else
+	return OS_ThreadCreate(&thread->thread, name, entry, arg, priority, stackSize);
+#endif
+}
+
 OS_Status OS_ThreadDelete(OS_Thread_t *thread)
 {
 	TaskHandle_t handle;
@@ -206,6 +234,49 @@ void OS_ThreadList(void)
 	OS_Free(taskStatusArray);
 }
 
+/* no scheduling profile, only the stack high water marks */
+int OS_ThreadProfileGet(OS_ThreadProfile_t *prof, int num)
+{
+	TaskStatus_t *taskStatusArray;
+	UBaseType_t taskNum, i;
+	int n = 0;
+
+	taskNum = uxTaskGetNumberOfTasks();
+	taskStatusArray = OS_Malloc(taskNum * sizeof(TaskStatus_t));
+	if (taskStatusArray == NULL) {
+		OS_ERR("no mem\n");
+		return -1;
+	}
+
+	taskNum = uxTaskGetSystemState(taskStatusArray, taskNum, NULL);
+	for (i = 0; i < taskNum && n < num; ++i, ++n) {
+		OS_Memset(&prof[n], 0, sizeof(prof[n]));
+		strncpy(prof[n].name, taskStatusArray[i].pcTaskName,
+		        OS_THREAD_PROFILE_NAME_MAX - 1);
+		prof[n].priority = taskStatusArray[i].uxCurrentPriority;
+		switch (taskStatusArray[i].eCurrentState) {
+		case eRunning:
+		case eReady:
+			prof[n].state = 'R';
+			break;
+		case eBlocked:
+		case eSuspended:
+			prof[n].state = 'S';
+			break;
+		case eDeleted:
+			prof[n].state = 'C';
+			break;
+		default:
+			prof[n].state = '?';
+			break;
+		}
+		prof[n].stack_free_min = taskStatusArray[i].usStackHighWaterMark *
+		                         sizeof(StackType_t);
+	}
+	OS_Free(taskStatusArray);
+	return n;
+}
+
 #else
 
 void OS_ThreadList(void)
@@ -213,4 +284,13 @@ void OS_ThreadList(void)
 	OS_LOG(1, "OS_ThreadList() not supported, please set configUSE_TRACE_FACILITY to 1\n");
 }
 
+int OS_ThreadProfileGet(OS_ThreadProfile_t *prof, int num)
+{
+	return -1;
+}
+
 #endif
+
+void OS_ThreadProfileReset(void)
+{
+}
@@ -91,6 +91,58 @@ OS_Status OS_TimerCreate(OS_Timer_t *timer, OS_TimerType type,
 	return OS_OK;
 }
 
+/* Storage of a static timer, private data first */
+typedef struct OS_TimerStaticPriv {
+	OS_TimerPriv_t      priv;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	StaticTimer_t       timer;
+#endif
+} OS_TimerStaticPriv_t;
+
+_Static_assert(sizeof(OS_TimerStaticPriv_t) <= sizeof(((OS_TimerStatic_t *)0)->storage),
+               "OS_TIMER_STATIC_STORAGE_WORDS too small");
+
+/*
+ * Without configSUPPORT_STATIC_ALLOCATION only the private data is embedded,
+ * the kernel timer is still allocated by xTimerCreate().
+ */
+OS_Status OS_TimerCreateStatic(OS_TimerStatic_t *timer, OS_TimerType type,
+                               OS_TimerCallback_t cb, void *arg, uint32_t periodMS)
+{
+	OS_TimerStaticPriv_t *spriv = (OS_TimerStaticPriv_t *)timer->storage;
+
+	OS_HANDLE_ASSERT(!OS_TimerIsValid(&timer->timer), timer->timer.handle);
+
+	spriv->priv.callback = cb;
+	spriv->priv.argument = arg;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	spriv->priv.handle = xTimerCreateStatic("",
+	                                        OS_MSecsToTicks(periodMS),
+	                                        type == OS_TIMER_PERIODIC ? pdTRUE : pdFALSE,
+	                                        &spriv->priv,
+	                                        OS_TimerPrivCallback,
+	                                        &spriv->timer);
+#else
+	spriv->priv.handle = xTimerCreate("",
+	                                  OS_MSecsToTicks(periodMS),
+	                                  type == OS_TIMER_PERIODIC ? pdTRUE : pdFALSE,
+	                                  &spriv->priv,
+	                                  OS_TimerPrivCallback);
+#endif
+	if (spriv->priv.handle == NULL) {
+		OS_ERR("err %"OS_HANDLE_F"\n", spriv->priv.handle);
+		return OS_FAIL;
+	}
+	timer->timer.handle = &spriv->priv;
+	return OS_OK;
+}
+
+/* the private data of a static timer is in its storage */
+static __inline int OS_TimerIsStatic(OS_Timer_t *timer)
+{
+	return (timer->handle == (void *)((OS_TimerStatic_t *)timer)->storage);
+}
+
 static __inline TimerHandle_t OS_TimerGetKernelHandle(OS_Timer_t *timer)
 {
 	OS_TimerPriv_t *priv = timer->handle;
@@ -139,10 +191,12 @@ OS_Status OS_TimerDelete(OS_Timer_t *timer)
 
 #if OS_TIMER_USE_FREERTOS_ORIG_CALLBACK
 	OS_TimerPriv_t *priv = timer->handle;
+	int is_static = OS_TimerIsStatic(timer);
 #endif
 	OS_TimerSetInvalid(timer);
 #if OS_TIMER_USE_FREERTOS_ORIG_CALLBACK
-	OS_Free(priv);
+	if (!is_static)
+		OS_Free(priv);
 #endif
 	return OS_OK;
 }
@@ -1,13 +1,327 @@
+/**
+ * @file os_cpuusage.c
+ * @author XRADIO IOT WLAN Team
+ */
+
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
 #include "kernel/os/os_cpuusage.h"
+#include "kernel/os/os_thread.h"
+#include "driver/chip/hal_clock.h"
 #include "os_util.h"
+#include <rthw.h>
+
+#ifdef RT_USING_CPU_USAGE
+
+/*
+ * The kernel charges the cycles between two thread switches to the thread
+ * switched out (rt_cpu_usage_update()). The sampler thread takes the cycles
+ * of each thread every CPU_USAGE_PERIOD_MS into its struct rt_thread, the
+ * usage is calculated over the last RT_CPU_USAGE_WIN_NUM periods. Interrupts
+ * are charged to the thread they interrupt, the tickless sleep to the idle
+ * thread.
+ */
+#define CPU_USAGE_PERIOD_MS     250
+#define CPU_USAGE_SHOW_MAX      32
+#define CPU_USAGE_STACK_SIZE    (1 * 1024)
+#define CPU_USAGE_COST_LOOP     16
+#define CPU_USAGE_NAME_LEN      ((RT_NAME_MAX < OS_CPUUSAGE_NAME_MAX) ? \
+                                 RT_NAME_MAX : (OS_CPUUSAGE_NAME_MAX - 1))
+
+struct cpu_usage {
+	rt_uint64_t last;                       /* cycles at the last sample */
+	uint32_t    win[RT_CPU_USAGE_WIN_NUM];  /* cycles of each period */
+	uint32_t    switches[RT_CPU_USAGE_WIN_NUM];
+	uint32_t    cost[RT_CPU_USAGE_WIN_NUM]; /* cycles of each sample */
+	uint32_t    last_switches;
+	uint32_t    update_cost;                /* cycles of rt_cpu_usage_update() */
+	uint32_t    print_s;
+	uint8_t     idx;
+	uint8_t     started;
+	OS_Thread_t sampler;
+};
+
+static struct cpu_usage g_cpu_usage;
+
+/*
+ * The totals are taken with interrupt disabled, the threads with the
+ * scheduler locked: no thread is switched, created or deleted, so their
+ * run_cycles stay still while the list is walked.
+ */
+static void cpu_usage_sample(struct cpu_usage *cu, int reset)
+{
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	struct rt_thread *thread;
+	uint32_t start;
+	rt_uint64_t now;
+	rt_base_t level;
+	int idx;
+
+	rt_enter_critical();
+	level = rt_hw_interrupt_disable();
+	start = rt_hw_cycle_get();
+	rt_cpu_usage_update();
+
+	idx = cu->idx;
+	now = rt_cpu_usage_cycles();
+	cu->win[idx] = (uint32_t)(now - cu->last);
+	cu->last = now;
+	cu->switches[idx] = rt_cpu_usage_switches() - cu->last_switches;
+	cu->last_switches += cu->switches[idx];
+	rt_hw_interrupt_enable(level);
+
+	info = rt_object_get_information(RT_Object_Class_Thread);
+	rt_list_for_each(node, &info->object_list) {
+		thread = rt_list_entry(node, struct rt_thread, list);
+		thread->usage_win[idx] = (uint32_t)(thread->run_cycles - thread->usage_last);
+		thread->usage_last = thread->run_cycles;
+		if (reset) {
+			OS_Memset(thread->usage_win, 0, sizeof(thread->usage_win));
+		}
+	}
+
+	cu->idx = (idx + 1) % RT_CPU_USAGE_WIN_NUM;
+	cu->cost[idx] = rt_hw_cycle_get() - start;
+	rt_exit_critical();
+}
+
+static __inline uint32_t cpu_usage_sum(const uint32_t *win)
+{
+	uint32_t sum = 0;
+	int i;
+
+	for (i = 0; i < RT_CPU_USAGE_WIN_NUM; ++i) {
+		sum += win[i];
+	}
+	return sum;
+}
+
+static __inline uint16_t cpu_usage_permille(uint32_t part, uint32_t total)
+{
+	return total ? (uint16_t)((uint64_t)part * 1000 / total) : 0;
+}
+
+static void cpu_usage_task(void *arg)
+{
+	struct cpu_usage *cu = arg;
+	uint32_t cnt = 0;
+
+	while (1) {
+		OS_MSleep(CPU_USAGE_PERIOD_MS);
+		cpu_usage_sample(cu, 0);
+		if (cu->print_s && ++cnt >= cu->print_s * (1000 / CPU_USAGE_PERIOD_MS)) {
+			cnt = 0;
+			OS_LOG(1, "[%8u]: cpu usage:%u%%\n", OS_GetTicks(), OS_CpuUsageGet());
+		}
+	}
+}
+
+/* measure the cycles added to a thread switch by rt_cpu_usage_update() */
+static uint32_t cpu_usage_update_cost(void)
+{
+	uint32_t start, cost;
+	rt_base_t level;
+	int i;
+
+	level = rt_hw_interrupt_disable();
+	start = rt_hw_cycle_get();
+	for (i = 0; i < CPU_USAGE_COST_LOOP; ++i) {
+		rt_cpu_usage_update();
+	}
+	cost = (rt_hw_cycle_get() - start) / CPU_USAGE_COST_LOOP;
+	rt_hw_interrupt_enable(level);
+	return cost;
+}
+
+static void cpu_usage_start(uint32_t print_s)
+{
+	struct cpu_usage *cu = &g_cpu_usage;
+	rt_base_t level;
+	uint8_t started;
 
+	cu->print_s = print_s;
+	level = rt_hw_interrupt_disable();
+	started = cu->started;
+	cu->started = 1;
+	rt_hw_interrupt_enable(level);
+	if (started) {
+		return;
+	}
+
+	cu->update_cost = cpu_usage_update_cost();
+	cpu_usage_sample(cu, 1); /* start the first period */
+	level = rt_hw_interrupt_disable();
+	OS_Memset(cu->win, 0, sizeof(cu->win));
+	OS_Memset(cu->switches, 0, sizeof(cu->switches));
+	OS_Memset(cu->cost, 0, sizeof(cu->cost));
+	rt_hw_interrupt_enable(level);
+	if (OS_ThreadCreate(&cu->sampler, "cpu_usage", cpu_usage_task, cu,
+	                    OS_THREAD_PRIO_SYS_CTRL, CPU_USAGE_STACK_SIZE) != OS_OK) {
+		OS_ERR("create cpu usage thread failed\n");
+	}
+}
+
+/*
+ * print_s: 0: not print, other: print cpu usage every print_s seconds.
+ */
 void OS_CpuUsageInit(uint32_t print_s)
 {
-	// OSCpuUsageInit(print_s);
+	cpu_usage_start(print_s);
 }
 
 uint32_t OS_CpuUsageGet(void)
 {
-	// return OSGetCpuUsage();
+	OS_CpuUsageInfo_t info;
+
+	OS_CpuUsageGetInfo(&info);
+	return (info.usage + 5) / 10;
+}
+
+int OS_CpuUsageGetInfo(OS_CpuUsageInfo_t *info)
+{
+	struct cpu_usage *cu = &g_cpu_usage;
+	rt_thread_t idle = rt_thread_idle_gethandler();
+	uint32_t total, idle_sum, cost;
+	rt_base_t level;
+
+	cpu_usage_start(cu->print_s);
+
+	level = rt_hw_interrupt_disable();
+	total = cpu_usage_sum(cu->win);
+	idle_sum = cpu_usage_sum(idle->usage_win);
+	info->switches = cpu_usage_sum(cu->switches);
+	cost = info->switches * cu->update_cost + cpu_usage_sum(cu->cost);
+	rt_hw_interrupt_enable(level);
+
+	if (total == 0) {
+		OS_Memset(info, 0, sizeof(*info));
+		return -1; /* no sample yet */
+	}
+	info->idle = cpu_usage_permille(idle_sum, total);
+	info->usage = 1000 - info->idle;
+	info->overhead = (uint16_t)((uint64_t)cost * 10000 / total);
+	info->window_ms = (uint32_t)((uint64_t)total * 1000 / HAL_GetCPUClock());
 	return 0;
 }
+
+int OS_CpuUsageGetThreads(OS_CpuUsageThread_t *threads, int num)
+{
+	struct cpu_usage *cu = &g_cpu_usage;
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	struct rt_thread *thread;
+	uint32_t total, clk_mhz;
+	int n = 0;
+
+	cpu_usage_start(cu->print_s);
+	clk_mhz = HAL_GetCPUClock() / 1000000;
+
+	rt_enter_critical();
+	total = cpu_usage_sum(cu->win);
+	info = rt_object_get_information(RT_Object_Class_Thread);
+	rt_list_for_each(node, &info->object_list) {
+		if (n < num) {
+			thread = rt_list_entry(node, struct rt_thread, list);
+			OS_Memset(threads[n].name, 0, OS_CPUUSAGE_NAME_MAX);
+			OS_Memcpy(threads[n].name, thread->name, CPU_USAGE_NAME_LEN);
+			threads[n].priority = thread->current_priority;
+			threads[n].usage = cpu_usage_permille(cpu_usage_sum(thread->usage_win), total);
+			threads[n].run_us = thread->usage_last / clk_mhz;
+		}
+		n++;
+	}
+	rt_exit_critical();
+	return n;
+}
+
+void OS_CpuUsageShow(void)
+{
+	OS_CpuUsageThread_t *threads;
+	OS_CpuUsageInfo_t info;
+	int i, n;
+
+	if (OS_CpuUsageGetInfo(&info) != 0) {
+		OS_LOG(1, "cpu usage is sampling, try again later\n");
+		return;
+	}
+	OS_LOG(1, "cpu usage %u.%u%%, idle %u.%u%%, in %u ms, "
+	       "switches %u, overhead %u.%02u%%\n",
+	       info.usage / 10, info.usage % 10, info.idle / 10, info.idle % 10,
+	       info.window_ms, info.switches,
+	       info.overhead / 100, info.overhead % 100);
+
+	threads = OS_Malloc(CPU_USAGE_SHOW_MAX * sizeof(OS_CpuUsageThread_t));
+	if (threads == NULL) {
+		OS_ERR("no mem\n");
+		return;
+	}
+	n = OS_CpuUsageGetThreads(threads, CPU_USAGE_SHOW_MAX);
+	OS_LOG(1, "%-*s Pri Usage  RunTime(ms)\n", RT_NAME_MAX, "Name");
+	for (i = 0; i < n && i < CPU_USAGE_SHOW_MAX; ++i) {
+		OS_LOG(1, "%-*.*s %-3u %3u.%u%% %u\n", RT_NAME_MAX, RT_NAME_MAX,
+		       threads[i].name, threads[i].priority,
+		       threads[i].usage / 10, threads[i].usage % 10,
+		       (uint32_t)(threads[i].run_us / 1000));
+	}
+	if (n > CPU_USAGE_SHOW_MAX) {
+		OS_LOG(1, "%d more threads not shown\n", n - CPU_USAGE_SHOW_MAX);
+	}
+	OS_Free(threads);
+}
+
+#else /* RT_USING_CPU_USAGE */
+
+void OS_CpuUsageInit(uint32_t print_s)
+{
+}
+
+uint32_t OS_CpuUsageGet(void)
+{
+	return 0;
+}
+
+int OS_CpuUsageGetInfo(OS_CpuUsageInfo_t *info)
+{
+	OS_Memset(info, 0, sizeof(*info));
+	return -1;
+}
+
+int OS_CpuUsageGetThreads(OS_CpuUsageThread_t *threads, int num)
+{
+	return 0;
+}
+
+void OS_CpuUsageShow(void)
+{
+	OS_LOG(1, "cpu usage unsupported, please enable RT_USING_CPU_USAGE\n");
+}
+
+#endif /* RT_USING_CPU_USAGE */
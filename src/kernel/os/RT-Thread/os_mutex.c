@@ -35,6 +35,8 @@
 #include "kernel/os/os_mutex.h"
 #include "os_util.h"
 #include <rtthread.h>
+#include <rthw.h>
+#include "driver/chip/hal_clock.h"
 #include "debug/backtrace.h"
 
 OS_Status OS_MutexCreate(OS_Mutex_t *mutex)
@@ -50,11 +52,27 @@ OS_Status OS_MutexCreate(OS_Mutex_t *mutex)
 	return OS_OK;
 }
 
+_Static_assert(sizeof(struct rt_mutex) <= sizeof(((OS_MutexStatic_t *)0)->storage),
+               "OS_MUTEX_STATIC_STORAGE_WORDS too small");
+
+OS_Status OS_MutexCreateStatic(OS_MutexStatic_t *mutex)
+{
+	struct rt_mutex *rt_mutex = (struct rt_mutex *)mutex->storage;
+
+	OS_HANDLE_ASSERT(!OS_MutexIsValid(&mutex->mutex), mutex->mutex.handle);
+	rt_mutex_init(rt_mutex, "NULL", RT_IPC_FLAG_PRIO);
+	mutex->mutex.handle = rt_mutex;
+	return OS_OK;
+}
+
 OS_Status OS_MutexDelete(OS_Mutex_t *mutex)
 {
 	OS_HANDLE_ASSERT(OS_MutexIsValid(mutex), mutex->handle);
 	// vSemaphoreDelete(mutex->handle);
-	rt_mutex_delete (mutex->handle);
+	if (rt_object_is_systemobject(mutex->handle))
+		rt_mutex_detach(mutex->handle);
+	else
+		rt_mutex_delete (mutex->handle);
 	OS_MutexSetInvalid(mutex);
 	return OS_OK;
 }
@@ -103,9 +121,14 @@ OS_Status OS_RecursiveMutexCreate(OS_Mutex_t *mutex)
 	return OS_OK;
 }
 
+/* rt_mutex is recursive */
+OS_Status OS_RecursiveMutexCreateStatic(OS_MutexStatic_t *mutex)
+{
+	return OS_MutexCreateStatic(mutex);
+}
+
 OS_Status OS_RecursiveMutexDelete(OS_Mutex_t *mutex)
 {
-    printf("OS_RecursiveMutexDelete %p\n",mutex);
 	return OS_MutexDelete(mutex);
 }
 
@@ -148,3 +171,103 @@ OS_ThreadHandle_t OS_MutexGetOwner(OS_Mutex_t *mutex)
 
 	return ((rt_mutex_t)mutex->handle)->owner;
 }
+
+void OS_MutexSetName(OS_Mutex_t *mutex, const char *name)
+{
+	if (!OS_MutexIsValid(mutex)) {
+		return;
+	}
+	rt_strncpy(((rt_mutex_t)mutex->handle)->parent.parent.name, name, RT_NAME_MAX - 1);
+}
+
+#ifdef RT_USING_MUTEX_STATS
+/* kernel object names are not terminated when RT_NAME_MAX long */
+#define OS_MUTEX_STAT_NAME_LEN \
+	(RT_NAME_MAX < OS_MUTEX_STAT_NAME_MAX ? RT_NAME_MAX : OS_MUTEX_STAT_NAME_MAX - 1)
+
+/* the thread may have been deleted since it took the mutex */
+static int OS_MutexThreadExist(struct rt_thread *thread)
+{
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+
+	info = rt_object_get_information(RT_Object_Class_Thread);
+	rt_list_for_each(node, &info->object_list) {
+		if (rt_list_entry(node, struct rt_thread, list) == thread) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void OS_MutexStatFill(OS_MutexStat_t *p, rt_mutex_t mutex, uint32_t clk_mhz)
+{
+	struct rt_thread *owner;
+	rt_uint64_t wait_sum;
+	rt_base_t level;
+
+	OS_Memset(p, 0, sizeof(*p));
+	rt_strncpy(p->name, mutex->parent.parent.name, OS_MUTEX_STAT_NAME_LEN);
+	level = rt_hw_interrupt_disable();
+	p->acquires = mutex->stat_acquires;
+	p->contended = mutex->stat_contended;
+	p->wait_max_us = mutex->stat_wait_max / clk_mhz;
+	p->hold_max_us = mutex->stat_hold_max / clk_mhz;
+	wait_sum = mutex->stat_wait_sum;
+	owner = mutex->stat_last_owner;
+	rt_hw_interrupt_enable(level);
+	p->wait_total_us = wait_sum / clk_mhz;
+	if (owner && OS_MutexThreadExist(owner)) {
+		rt_strncpy(p->owner, owner->name, OS_MUTEX_STAT_NAME_LEN);
+	} else {
+		p->owner[0] = '-';
+	}
+}
+#endif
+
+int OS_MutexStatGet(OS_MutexStat_t *stat, int num)
+{
+#ifdef RT_USING_MUTEX_STATS
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	uint32_t clk_mhz = HAL_GetCPUClock() / 1000000;
+	int n = 0;
+
+	/* no mutex or thread is deleted meanwhile */
+	rt_enter_critical();
+	info = rt_object_get_information(RT_Object_Class_Mutex);
+	rt_list_for_each(node, &info->object_list) {
+		if (n >= num) {
+			break;
+		}
+		OS_MutexStatFill(&stat[n++], rt_list_entry(node, struct rt_mutex, parent.parent.list),
+		                 clk_mhz);
+	}
+	rt_exit_critical();
+	return n;
+#else
+	return -1;
+#endif
+}
+
+void OS_MutexStatReset(void)
+{
+#ifdef RT_USING_MUTEX_STATS
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	rt_mutex_t mutex;
+	rt_base_t level;
+
+	level = rt_hw_interrupt_disable();
+	info = rt_object_get_information(RT_Object_Class_Mutex);
+	rt_list_for_each(node, &info->object_list) {
+		mutex = rt_list_entry(node, struct rt_mutex, parent.parent.list);
+		mutex->stat_acquires = 0;
+		mutex->stat_contended = 0;
+		mutex->stat_wait_sum = 0;
+		mutex->stat_wait_max = 0;
+		mutex->stat_hold_max = 0;
+	}
+	rt_hw_interrupt_enable(level);
+#endif
+}
@@ -51,13 +51,36 @@ OS_Status OS_QueueCreate(OS_Queue_t *queue, uint32_t queueLen, uint32_t itemSize
 	return OS_OK;
 }
 
+_Static_assert(sizeof(struct rt_messagequeue) <= sizeof(((OS_QueueStatic_t *)0)->storage),
+               "OS_QUEUE_STATIC_STORAGE_WORDS too small");
+
+OS_Status OS_QueueCreateStatic(OS_QueueStatic_t *queue, uint32_t queueLen,
+                               uint32_t itemSize, void *pool)
+{
+	rt_mq_t mq = (rt_mq_t)queue->storage;
+
+	rt_mq_init(mq, "NULL", pool, itemSize, OS_QUEUE_POOL_SIZE(queueLen, itemSize),
+	           RT_IPC_FLAG_PRIO);
+	if (mq->max_msgs < queueLen) {
+		/* RT_ALIGN_SIZE is larger than OS_QUEUE_POOL_SIZE() assumes */
+		OS_ERR("pool holds %u items of %u\n", mq->max_msgs, queueLen);
+		rt_mq_detach(mq);
+		return OS_FAIL;
+	}
+	queue->queue.handle = mq;
+	return OS_OK;
+}
+
 OS_Status OS_QueueDelete(OS_Queue_t *queue)
 {
 	rt_err_t ret;
 
 	OS_HANDLE_ASSERT(OS_QueueIsValid(queue), queue->handle);
 
-	ret = rt_mq_delete((rt_mq_t)queue->handle);
+	if (rt_object_is_systemobject(queue->handle))
+		ret = rt_mq_detach((rt_mq_t)queue->handle);
+	else
+		ret = rt_mq_delete((rt_mq_t)queue->handle);
 	if (ret != RT_EOK) {
 		OS_ERR("queue %"OS_HANDLE_F" delete fail\n", queue->handle);
 		return OS_FAIL;
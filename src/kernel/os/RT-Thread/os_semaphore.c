@@ -79,12 +79,37 @@ OS_Status OS_SemaphoreCreateBinary(OS_Semaphore_t *sem)
 	return OS_OK;
 }
 
+/* Storage of a static semaphore */
+typedef struct _RTT_SEM_STATIC_STRUCT {
+	RTT_SEM             priv;
+	struct rt_semaphore sem;
+} RTT_SEM_STATIC;
+
+_Static_assert(sizeof(RTT_SEM_STATIC) <= sizeof(((OS_SemaphoreStatic_t *)0)->storage),
+               "OS_SEMAPHORE_STATIC_STORAGE_WORDS too small");
+
+OS_Status OS_SemaphoreCreateStatic(OS_SemaphoreStatic_t *sem, uint32_t initCount,
+                                   uint32_t maxCount)
+{
+	RTT_SEM_STATIC *rt_sem = (RTT_SEM_STATIC *)sem->storage;
+
+	rt_sem_init(&rt_sem->sem, "NULL", initCount, RT_IPC_FLAG_PRIO);
+	rt_sem->priv.handle = &rt_sem->sem;
+	rt_sem->priv.maxCount = maxCount;
+	sem->sem.handle = &rt_sem->priv;
+	return OS_OK;
+}
+
 OS_Status OS_SemaphoreDelete(OS_Semaphore_t *sem)
 {
 	OS_HANDLE_ASSERT(OS_SemaphoreIsValid(sem), sem->handle);
     RTT_SEM *rt_sem = sem->handle;
-	rt_sem_delete(rt_sem->handle);
-    free(rt_sem);
+	if (rt_object_is_systemobject(&rt_sem->handle->parent.parent)) {
+		rt_sem_detach(rt_sem->handle);
+	} else {
+		rt_sem_delete(rt_sem->handle);
+		free(rt_sem);
+	}
 	OS_SemaphoreSetInvalid(sem);
 	return OS_OK;
 }
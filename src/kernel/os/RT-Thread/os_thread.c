@@ -33,9 +33,11 @@
  */
 
 #include "kernel/os/os_thread.h"
+#include "driver/chip/hal_clock.h"
 #include "os_util.h"
 // #include "task.h"
 #include <rtthread.h>
+#include <rthw.h>
 
 /* Macro used to convert OS_Priority to the kernel's real priority */
 #define OS_KERNEL_PRIO(prio) (prio)
@@ -62,6 +64,40 @@ OS_Status OS_ThreadCreate(OS_Thread_t *thread, const char *name,
 	return OS_OK;
 }
 
+_Static_assert(sizeof(struct rt_thread) <= sizeof(((OS_ThreadStatic_t *)0)->storage),
+               "OS_THREAD_STATIC_STORAGE_WORDS too small");
+
+OS_Status OS_ThreadCreateStatic(OS_ThreadStatic_t *thread, const char *name,
+                                OS_ThreadEntry_t entry, void *arg,
+                                OS_Priority priority, void *stack,
+                                uint32_t stackSize)
+{
+	rt_thread_t handle = (rt_thread_t)thread->storage;
+	rt_err_t ret;
+
+	OS_HANDLE_ASSERT(!OS_ThreadIsValid(&thread->thread), thread->thread.handle);
+
+	ret = rt_thread_init(handle, name, entry, arg, stack, stackSize, priority, 100);
+	if (ret == RT_EOK)
+		ret = rt_thread_startup(handle);
+	if (ret != RT_EOK) {
+		OS_ERR("err %"OS_BASETYPE_F"\n", ret);
+		OS_ThreadSetInvalid(&thread->thread);
+		return OS_FAIL;
+	}
+	thread->thread.handle = handle;
+	return OS_OK;
+}
+
+/* a static thread is detached, its storage and stack belong to the caller */
+static void OS_ThreadRelease(rt_thread_t handle)
+{
+	if (rt_object_is_systemobject((rt_object_t)handle))
+		rt_thread_detach(handle);
+	else
+		rt_thread_delete(handle);
+}
+
 OS_Status OS_ThreadDelete(OS_Thread_t *thread)
 {
 	rt_thread_t handle, curHandle;
@@ -71,7 +107,7 @@ OS_Status OS_ThreadDelete(OS_Thread_t *thread)
 
 	if (thread == NULL) {
 		// vTaskDelete(NULL); /* delete self */
-		rt_thread_delete(rt_thread_self());
+		OS_ThreadRelease(rt_thread_self());
 		return OS_OK;
 	}
 
@@ -84,12 +120,12 @@ OS_Status OS_ThreadDelete(OS_Thread_t *thread)
 		/* delete self */
 		OS_ThreadSetInvalid(thread);
 		// vTaskDelete(NULL);
-		rt_thread_delete(handle);
+		OS_ThreadRelease(handle);
 	} else {
 		/* delete other thread */
 		OS_WRN("thread %"OS_HANDLE_F" delete %"OS_HANDLE_F"\n", curHandle, handle);
 		// vTaskDelete(handle);
-		rt_thread_delete(handle);
+		OS_ThreadRelease(handle);
 		OS_ThreadSetInvalid(thread);
 	}
 
@@ -151,11 +187,21 @@ int OS_ThreadIsSchedulerRunning(void)
 	return (rt_critical_level() == 0);
 }
 
-// #if INCLUDE_uxTaskGetStackHighWaterMark
-#if 0
+/* stack never used, the kernel fills the stack with '#' at creation */
+static uint32_t OS_ThreadStackFree(struct rt_thread *thread)
+{
+	const uint8_t *p = thread->stack_addr;
+	const uint8_t *end = p + thread->stack_size;
+
+	while (p < end && *p == '#') {
+		++p;
+	}
+	return p - (const uint8_t *)thread->stack_addr;
+}
+
 uint32_t OS_ThreadGetStackMinFreeSize(OS_Thread_t *thread)
 {
-	TaskHandle_t handle;
+	rt_thread_t handle;
 
 	if (thread != NULL) {
 		if (OS_ThreadIsValid(thread)) {
@@ -164,12 +210,11 @@ uint32_t OS_ThreadGetStackMinFreeSize(OS_Thread_t *thread)
 			return 0;
 		}
 	} else {
-		handle = NULL;
+		handle = rt_thread_self();
 	}
 
-	return (uxTaskGetStackHighWaterMark(handle) * sizeof(StackType_t));
+	return OS_ThreadStackFree(handle);
 }
-#endif
 
 #ifdef RT_USING_OVERFLOW_CHECK
 //TODO
@@ -180,71 +225,129 @@ uint32_t OS_ThreadGetStackMinFreeSize(OS_Thread_t *thread)
 // }
 #endif
 
-// #if (configUSE_TRACE_FACILITY == 1)
-#if 0
-void OS_ThreadList(void)
+static char OS_ThreadState(struct rt_thread *thread)
 {
-	TaskStatus_t *taskStatusArray;
-	UBaseType_t taskNum, i;
-	char state;
-
-	taskNum = uxTaskGetNumberOfTasks();
-	taskStatusArray = OS_Malloc(taskNum * sizeof(TaskStatus_t));
-	if (taskStatusArray == NULL) {
-		OS_ERR("no mem\n");
-		return;
+	switch (thread->stat & RT_THREAD_STAT_MASK) {
+	case RT_THREAD_READY:
+	case RT_THREAD_RUNNING:
+		return 'R';
+	case RT_THREAD_SUSPEND:
+		return 'S';
+	case RT_THREAD_INIT:
+		return 'I';
+	case RT_THREAD_CLOSE:
+		return 'C';
+	default:
+		return '?';
 	}
+}
 
-	i = uxTaskGetSystemState(taskStatusArray, taskNum, NULL);
-	if (i != taskNum) {
-		OS_WRN("task num %lu != %lu\n", i, taskNum);
-	}
+static void OS_ThreadProfileFill(OS_ThreadProfile_t *p, struct rt_thread *thread)
+{
+#ifdef RT_USING_THREAD_PROFILE
+	uint32_t clk_mhz = HAL_GetCPUClock() / 1000000;
+	rt_uint64_t latency_sum;
+	rt_base_t level;
+#endif
 
-	OS_LOG(1, "%*sState Pri Idx StkCur     StkBot     StkFree StkFreeMin\n",
-	       -configMAX_TASK_NAME_LEN, "Name");
-	for (i = 0; i < taskNum; ++i) {
-		OS_LOG(1, "%*.*s", -configMAX_TASK_NAME_LEN, configMAX_TASK_NAME_LEN,
-		       taskStatusArray[i].pcTaskName);
+	OS_Memset(p, 0, sizeof(*p));
+	/* thread->name is not terminated when RT_NAME_MAX long */
+	rt_strncpy(p->name, thread->name, RT_NAME_MAX < OS_THREAD_PROFILE_NAME_MAX ?
+	           RT_NAME_MAX : OS_THREAD_PROFILE_NAME_MAX - 1);
+	p->priority = thread->current_priority;
+	p->state = OS_ThreadState(thread);
+	p->stack_size = thread->stack_size;
+	p->stack_free_min = OS_ThreadStackFree(thread);
+#ifdef RT_USING_THREAD_PROFILE
+	level = rt_hw_interrupt_disable();
+	p->runs = thread->prof_runs;
+	p->preempts = thread->prof_preempts;
+	p->latency_max_us = thread->prof_latency_max / clk_mhz;
+	latency_sum = thread->prof_latency_sum;
+	rt_hw_interrupt_enable(level);
+	if (p->runs) {
+		p->latency_avg_us = (uint32_t)(latency_sum / p->runs / clk_mhz);
+	}
+#endif
+}
 
-		switch (taskStatusArray[i].eCurrentState) {
-		case eReady:
-			state = 'R';
-			break;
-		case eBlocked:
-			state = 'B';
-			break;
-		case eSuspended:
-			state = 'S';
-			break;
-		case eDeleted:
-			state = 'D';
-			break;
-		default:
-			state = '?';
+int OS_ThreadProfileGet(OS_ThreadProfile_t *prof, int num)
+{
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	int n = 0;
+
+	/* no thread is deleted meanwhile, scanning the stacks is too slow to
+	 * disable IRQ */
+	rt_enter_critical();
+	info = rt_object_get_information(RT_Object_Class_Thread);
+	rt_list_for_each(node, &info->object_list) {
+		if (n >= num) {
 			break;
 		}
-		OS_LOG(1, "%-5c %-3lu %-3lu %-10p %-10p %-7u %-u\n",
-		          state,
-		          taskStatusArray[i].uxCurrentPriority,
-		          taskStatusArray[i].xTaskNumber,
-		          taskStatusArray[i].pxTopOfStack,
-#if (CONFIG_OS_FREERTOS_VER == 80203)
-		          taskStatusArray[i].pxStack,
-		          (taskStatusArray[i].pxTopOfStack - taskStatusArray[i].pxStack) * sizeof(StackType_t),
-#elif (CONFIG_OS_FREERTOS_VER == 100201)
-		          taskStatusArray[i].pxStackBase,
-		          (taskStatusArray[i].pxTopOfStack - taskStatusArray[i].pxStackBase) * sizeof(StackType_t),
-#endif
-		          taskStatusArray[i].usStackHighWaterMark * sizeof(StackType_t));
+		OS_ThreadProfileFill(&prof[n++], rt_list_entry(node, struct rt_thread, list));
 	}
-	OS_Free(taskStatusArray);
+	rt_exit_critical();
+	return n;
 }
 
-#else
+void OS_ThreadProfileReset(void)
+{
+#ifdef RT_USING_THREAD_PROFILE
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	struct rt_thread *thread;
+	rt_base_t level;
+
+	level = rt_hw_interrupt_disable();
+	info = rt_object_get_information(RT_Object_Class_Thread);
+	rt_list_for_each(node, &info->object_list) {
+		thread = rt_list_entry(node, struct rt_thread, list);
+		thread->prof_runs = 0;
+		thread->prof_preempts = 0;
+		thread->prof_latency_max = 0;
+		thread->prof_latency_sum = 0;
+	}
+	rt_hw_interrupt_enable(level);
+#endif
+}
 
-void OS_ThreadList(void)
+static void OS_ThreadListPrint(const OS_ThreadProfile_t *p)
 {
-	OS_LOG(1, "OS_ThreadList() not supported, please set configUSE_TRACE_FACILITY to 1\n");
+	OS_LOG(1, "%-*.*s %-5c %-3u %-7u %u\n", RT_NAME_MAX, RT_NAME_MAX,
+	       p->name, p->state, p->priority, p->stack_size, p->stack_free_min);
 }
 
-#endif
+void OS_ThreadList(void)
+{
+	struct rt_object_information *info;
+	struct rt_list_node *node;
+	OS_ThreadProfile_t *prof;
+	OS_ThreadProfile_t one;
+	int num, i;
+
+	OS_LOG(1, "%-*s State Pri StkSize StkFreeMin\n", RT_NAME_MAX, "Name");
+
+	if (OS_IsISRContext()) {
+		/* exception dump, no thread runs and the heap may be broken */
+		info = rt_object_get_information(RT_Object_Class_Thread);
+		rt_list_for_each(node, &info->object_list) {
+			OS_ThreadProfileFill(&one, rt_list_entry(node, struct rt_thread, list));
+			OS_ThreadListPrint(&one);
+		}
+		return;
+	}
+
+	/* snapshot under the lock, print after it, room for a few new threads */
+	num = rt_object_get_length(RT_Object_Class_Thread) + 4;
+	prof = OS_Malloc(num * sizeof(OS_ThreadProfile_t));
+	if (prof == NULL) {
+		OS_ERR("no mem\n");
+		return;
+	}
+	num = OS_ThreadProfileGet(prof, num);
+	for (i = 0; i < num; ++i) {
+		OS_ThreadListPrint(&prof[i]);
+	}
+	OS_Free(prof);
+}
@@ -91,10 +91,43 @@ OS_Status OS_TimerCreate(OS_Timer_t *timer, OS_TimerType type,
 		return OS_FAIL;
 	}
 	timer->handle = priv;
-    printf("time handle creat %p\n",timer->handle);
 	return OS_OK;
 }
 
+/* Storage of a static timer, private data first */
+typedef struct OS_TimerStaticPriv {
+	OS_TimerPriv_t      priv;
+	struct rt_timer     timer;
+} OS_TimerStaticPriv_t;
+
+_Static_assert(sizeof(OS_TimerStaticPriv_t) <= sizeof(((OS_TimerStatic_t *)0)->storage),
+               "OS_TIMER_STATIC_STORAGE_WORDS too small");
+
+OS_Status OS_TimerCreateStatic(OS_TimerStatic_t *timer, OS_TimerType type,
+                               OS_TimerCallback_t cb, void *arg, uint32_t periodMS)
+{
+	OS_TimerStaticPriv_t *spriv = (OS_TimerStaticPriv_t *)timer->storage;
+
+	OS_HANDLE_ASSERT(!OS_TimerIsValid(&timer->timer), timer->timer.handle);
+
+	spriv->priv.callback = cb;
+	spriv->priv.argument = arg;
+	spriv->priv.handle = &spriv->timer;
+	rt_timer_init(&spriv->timer, "NULL",
+	              OS_TimerPrivCallback,
+	              &spriv->priv,
+	              rt_tick_from_millisecond(periodMS),
+	              type == OS_TIMER_PERIODIC ? RT_TIMER_FLAG_PERIODIC : RT_TIMER_FLAG_ONE_SHOT);
+	timer->timer.handle = &spriv->priv;
+	return OS_OK;
+}
+
+/* the private data of a static timer is in its storage */
+static __inline int OS_TimerIsStatic(OS_Timer_t *timer)
+{
+	return (timer->handle == (void *)((OS_TimerStatic_t *)timer)->storage);
+}
+
 static __inline rt_timer_t OS_TimerGetKernelHandle(OS_Timer_t *timer)
 {
 	OS_TimerPriv_t *priv = timer->handle;
@@ -135,7 +168,13 @@ OS_Status OS_TimerDelete(OS_Timer_t *timer)
 	OS_HANDLE_ASSERT(OS_TimerIsValid(timer), timer->handle);
 
 	handle = OS_TimerGetKernelHandle(timer);
-    printf("time handle delete %p\n",handle);
+#if OS_TIMER_USE_FREERTOS_ORIG_CALLBACK
+	if (OS_TimerIsStatic(timer)) {
+		rt_timer_detach(handle);
+		OS_TimerSetInvalid(timer);
+		return OS_OK;
+	}
+#endif
 	ret = rt_timer_delete(handle);
 	if (ret != RT_EOK) {
 		OS_ERR("err %"OS_BASETYPE_F"\n", ret);
@@ -160,7 +199,6 @@ OS_Status OS_TimerStart(OS_Timer_t *timer)
 	OS_HANDLE_ASSERT(OS_TimerIsValid(timer), timer->handle);
 
 	handle = OS_TimerGetKernelHandle(timer);
-    printf("time handle start %p\n",handle);
 	ret = rt_timer_start(handle);
 	if (ret != RT_EOK) {
 		OS_ERR("err %"OS_BASETYPE_F"\n", ret);
@@ -179,7 +217,6 @@ OS_Status OS_TimerChangePeriod(OS_Timer_t *timer, uint32_t periodMS)
 	OS_HANDLE_ASSERT(OS_TimerIsValid(timer), timer->handle);
 
 	handle = OS_TimerGetKernelHandle(timer);
-    printf("time handle change %p\n",handle);
 	ret = rt_timer_control(handle, RT_TIMER_CTRL_SET_TIME, &tick);
 	if (ret != RT_EOK) {
 		OS_ERR("err %"OS_BASETYPE_F"\n", ret);
@@ -199,8 +236,6 @@ OS_Status OS_TimerStop(OS_Timer_t *timer)
 	OS_HANDLE_ASSERT(OS_TimerIsValid(timer), timer->handle);
 
 	handle = OS_TimerGetKernelHandle(timer);
-    printf("time handle stop %p\n",handle);
-    
 	ret = rt_timer_stop(handle);
 	if (ret != RT_EOK) {
 		OS_ERR("err %"OS_BASETYPE_F"\n", ret);
@@ -0,0 +1,220 @@
+/**
+ * @file os_block_queue.c
+ * @author XRADIO IOT WLAN Team
+ */
+
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include "kernel/os/os_queue.h"
+#include "kernel/os/os_thread.h"
+#include "sys/interrupt.h"
+#include "os_util.h"
+
+/*
+ * Block queue. Each block of the pool starts with a header word linking it
+ * in the free list or in the list of blocks sent, the user gets the bytes
+ * after it. The lists are protected by disabling IRQ, two semaphores count
+ * their blocks for the waiting threads.
+ */
+#define BQ_HDR(block)       ((void **)(block) - 1)
+#define BQ_BLOCK(hdr)       ((void *)((void **)(hdr) + 1))
+
+OS_Status OS_BlockQueueCreate(OS_BlockQueue_t *bq, uint32_t blockNum,
+                              uint32_t blockSize, void *pool)
+{
+	uint32_t i;
+	uint8_t *hdr;
+
+	OS_BlockQueueSetInvalid(bq);
+	bq->poolAlloc = 0;
+	if (pool == NULL) {
+		pool = malloc(OS_BLOCK_QUEUE_POOL_SIZE(blockNum, blockSize));
+		if (pool == NULL) {
+			OS_ERR("no mem for %u blocks of %u\n", blockNum, blockSize);
+			return OS_E_NOMEM;
+		}
+		bq->poolAlloc = 1;
+	}
+
+	if (OS_SemaphoreCreate(&bq->slots, blockNum, blockNum) != OS_OK)
+		goto err;
+	if (OS_SemaphoreCreate(&bq->items, 0, blockNum) != OS_OK) {
+		OS_SemaphoreDelete(&bq->slots);
+		goto err;
+	}
+
+	bq->pool = pool;
+	bq->blockSize = sizeof(void *) + ((blockSize + 3) & ~3U);
+	bq->blockNum = blockNum;
+	bq->head = NULL;
+	bq->tail = NULL;
+	bq->freeList = NULL;
+	for (i = 0, hdr = pool; i < blockNum; i++, hdr += bq->blockSize) {
+		*(void **)hdr = bq->freeList;
+		bq->freeList = hdr;
+	}
+	return OS_OK;
+
+err:
+	OS_BlockQueueSetInvalid(bq);
+	if (bq->poolAlloc)
+		free(pool);
+	return OS_FAIL;
+}
+
+OS_Status OS_BlockQueueDelete(OS_BlockQueue_t *bq)
+{
+	OS_HANDLE_ASSERT(OS_BlockQueueIsValid(bq), bq->items.handle);
+
+	OS_SemaphoreDelete(&bq->items);
+	OS_SemaphoreDelete(&bq->slots);
+	if (bq->poolAlloc)
+		free(bq->pool);
+	bq->pool = NULL;
+	return OS_OK;
+}
+
+void *OS_BlockQueueAlloc(OS_BlockQueue_t *bq, OS_Time_t waitMS)
+{
+	unsigned long flags;
+	void **hdr;
+
+	if (OS_SemaphoreWait(&bq->slots, waitMS) != OS_OK)
+		return NULL;
+
+	flags = arch_irq_save();
+	hdr = bq->freeList;
+	bq->freeList = *hdr;
+	arch_irq_restore(flags);
+	return BQ_BLOCK(hdr);
+}
+
+void OS_BlockQueueFree(OS_BlockQueue_t *bq, void *block)
+{
+	unsigned long flags;
+	void **hdr = BQ_HDR(block);
+
+	flags = arch_irq_save();
+	*hdr = bq->freeList;
+	bq->freeList = hdr;
+	arch_irq_restore(flags);
+	OS_SemaphoreRelease(&bq->slots);
+}
+
+/* append blocks to the list of blocks sent, the caller releases bq->items */
+static void OS_BlockQueueAppend(OS_BlockQueue_t *bq, void * const *blocks,
+                                uint32_t num)
+{
+	unsigned long flags;
+	void **hdr;
+	uint32_t i;
+
+	flags = arch_irq_save();
+	for (i = 0; i < num; i++) {
+		hdr = BQ_HDR(blocks[i]);
+		*hdr = NULL;
+		if (bq->tail)
+			*(void **)bq->tail = hdr;
+		else
+			bq->head = hdr;
+		bq->tail = hdr;
+	}
+	arch_irq_restore(flags);
+}
+
+OS_Status OS_BlockQueueSend(OS_BlockQueue_t *bq, void *block)
+{
+	OS_BlockQueueAppend(bq, &block, 1);
+	return OS_SemaphoreRelease(&bq->items);
+}
+
+OS_Status OS_BlockQueueSendBatch(OS_BlockQueue_t *bq, void * const *blocks,
+                                 uint32_t num)
+{
+	OS_Status ret = OS_OK;
+	int isr = OS_IsISRContext();
+
+	OS_BlockQueueAppend(bq, blocks, num);
+
+	/* wake up the receiver once, when all the blocks are counted */
+	if (!isr)
+		OS_ThreadSuspendScheduler();
+	while (num--) {
+		if (OS_SemaphoreRelease(&bq->items) != OS_OK)
+			ret = OS_FAIL;
+	}
+	if (!isr)
+		OS_ThreadResumeScheduler();
+	return ret;
+}
+
+/* take num blocks from the list of blocks sent, already counted */
+static void OS_BlockQueueTake(OS_BlockQueue_t *bq, void **blocks, uint32_t num)
+{
+	unsigned long flags;
+	void **hdr;
+	uint32_t i;
+
+	flags = arch_irq_save();
+	for (i = 0; i < num; i++) {
+		hdr = bq->head;
+		bq->head = *hdr;
+		blocks[i] = BQ_BLOCK(hdr);
+	}
+	if (bq->head == NULL)
+		bq->tail = NULL;
+	arch_irq_restore(flags);
+}
+
+void *OS_BlockQueueReceive(OS_BlockQueue_t *bq, OS_Time_t waitMS)
+{
+	void *block;
+
+	if (OS_SemaphoreWait(&bq->items, waitMS) != OS_OK)
+		return NULL;
+	OS_BlockQueueTake(bq, &block, 1);
+	return block;
+}
+
+uint32_t OS_BlockQueueReceiveBatch(OS_BlockQueue_t *bq, void **blocks,
+                                   uint32_t num, OS_Time_t waitMS)
+{
+	uint32_t n;
+
+	if (num == 0 || OS_SemaphoreWait(&bq->items, waitMS) != OS_OK)
+		return 0;
+	for (n = 1; n < num; n++) {
+		if (OS_SemaphoreWait(&bq->items, 0) != OS_OK)
+			break;
+	}
+	OS_BlockQueueTake(bq, blocks, n);
+	return n;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file os_ring.c
+ * @author XRADIO IOT WLAN Team
+ */
+
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "kernel/os/os_ring.h"
+#include "os_util.h"
+
+/*
+ * The producers move head and the consumer moves tail. A single producer
+ * publishes the elements put by storing head. Several producers reserve
+ * elements by moving head with compare-and-swap, then publish each element
+ * by storing its position + 1 as its sequence: the consumer takes the
+ * elements ready in order, it never waits for a preempted producer.
+ *
+ * To wait, the consumer sets "waiting" and checks the ring again before
+ * sleeping on the semaphore. A producer checks "waiting" after publishing
+ * and releases the semaphore if it clears it, so the kernel is called only
+ * when the consumer sleeps. The fences order "waiting" and the ring indexes
+ * between both sides.
+ */
+
+OS_Status OS_RingCreate(OS_Ring_t *ring, uint32_t elemNum, uint32_t elemSize,
+                        uint32_t flags, void *buf)
+{
+	uint32_t i;
+
+	OS_RingSetInvalid(ring);
+	if (elemNum == 0 || (elemNum & (elemNum - 1)) != 0 ||
+	    elemSize == 0 || elemSize > 0xFFFF) {
+		OS_ERR("invalid ring %u x %u\n", elemNum, elemSize);
+		return OS_E_PARAM;
+	}
+
+	ring->mem = NULL;
+	if (buf == NULL) {
+		buf = malloc(OS_RING_BUF_SIZE(elemNum, elemSize, flags));
+		if (buf == NULL) {
+			OS_ERR("no mem for ring %u x %u\n", elemNum, elemSize);
+			return OS_E_NOMEM;
+		}
+		ring->mem = buf;
+	}
+
+	OS_SemaphoreSetInvalid(&ring->sem);
+	if ((flags & OS_RING_F_NOTIFY) &&
+	    OS_SemaphoreCreateBinary(&ring->sem) != OS_OK) {
+		free(ring->mem);
+		ring->mem = NULL;
+		return OS_FAIL;
+	}
+
+	ring->head = 0;
+	ring->tail = 0;
+	ring->mask = elemNum - 1;
+	ring->elemSize = elemSize;
+	ring->flags = flags;
+	ring->waiting = 0;
+	if (flags & OS_RING_F_MPSC) {
+		ring->seq = buf;
+		for (i = 0; i < elemNum; i++)
+			ring->seq[i] = i + 1 - elemNum; /* put one lap before */
+		ring->buf = (uint8_t *)(ring->seq + elemNum);
+	} else {
+		ring->seq = NULL;
+		ring->buf = buf;
+	}
+	return OS_OK;
+}
+
+OS_Status OS_RingDelete(OS_Ring_t *ring)
+{
+	OS_HANDLE_ASSERT(OS_RingIsValid(ring), ring->buf);
+
+	if (OS_SemaphoreIsValid(&ring->sem))
+		OS_SemaphoreDelete(&ring->sem);
+	free(ring->mem);
+	ring->mem = NULL;
+	OS_RingSetInvalid(ring);
+	return OS_OK;
+}
+
+/* copy num elements into the ring at position pos */
+static void OS_RingCopyIn(OS_Ring_t *ring, uint32_t pos, const uint8_t *src,
+                          uint32_t num)
+{
+	uint32_t off = pos & ring->mask;
+	uint32_t n = ring->mask + 1 - off;
+
+	if (n > num)
+		n = num;
+	memcpy(ring->buf + off * ring->elemSize, src, n * ring->elemSize);
+	if (n < num)
+		memcpy(ring->buf, src + n * ring->elemSize, (num - n) * ring->elemSize);
+}
+
+/* copy num elements out of the ring at position pos */
+static void OS_RingCopyOut(OS_Ring_t *ring, uint32_t pos, uint8_t *dst,
+                           uint32_t num)
+{
+	uint32_t off = pos & ring->mask;
+	uint32_t n = ring->mask + 1 - off;
+
+	if (n > num)
+		n = num;
+	memcpy(dst, ring->buf + off * ring->elemSize, n * ring->elemSize);
+	if (n < num)
+		memcpy(dst + n * ring->elemSize, ring->buf, (num - n) * ring->elemSize);
+}
+
+/* wake up the consumer if it waits, after publishing elements */
+static void OS_RingNotify(OS_Ring_t *ring)
+{
+	if (!(ring->flags & OS_RING_F_NOTIFY))
+		return;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->waiting, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&ring->waiting, 0, __ATOMIC_RELAXED))
+		OS_SemaphoreRelease(&ring->sem);
+}
+
+uint32_t OS_RingPut(OS_Ring_t *ring, const void *elems, uint32_t num)
+{
+	uint32_t size = ring->mask + 1;
+	uint32_t head, tail, i;
+
+	if (!(ring->flags & OS_RING_F_MPSC)) {
+		head = ring->head;
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if (num > size - (head - tail))
+			num = size - (head - tail);
+		if (num == 0)
+			return 0;
+		OS_RingCopyIn(ring, head, elems, num);
+		__atomic_store_n(&ring->head, head + num, __ATOMIC_RELEASE);
+	} else {
+		if (num == 0 || num > size)
+			return 0;
+		do {
+			/* head read after tail, never behind it */
+			tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+			head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+			if (head + num - tail > size)
+				return 0;
+		} while (!__atomic_compare_exchange_n(&ring->head, &head, head + num, 1,
+		                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+		OS_RingCopyIn(ring, head, elems, num);
+		for (i = 0; i < num; i++) {
+			__atomic_store_n(&ring->seq[(head + i) & ring->mask], head + i + 1,
+			                 __ATOMIC_RELEASE);
+		}
+	}
+
+	OS_RingNotify(ring);
+	return num;
+}
+
+/* number of elements ready to get, at most num */
+static uint32_t OS_RingReady(OS_Ring_t *ring, uint32_t num)
+{
+	uint32_t tail = ring->tail;
+	uint32_t n;
+
+	if (!(ring->flags & OS_RING_F_MPSC)) {
+		n = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+		return n < num ? n : num;
+	}
+
+	for (n = 0; n < num; n++) {
+		if (__atomic_load_n(&ring->seq[(tail + n) & ring->mask],
+		                    __ATOMIC_ACQUIRE) != tail + n + 1)
+			break;
+	}
+	return n;
+}
+
+/* number of elements ready to get, at most num, waiting for one if empty */
+static uint32_t OS_RingWait(OS_Ring_t *ring, uint32_t num, OS_Time_t waitMS)
+{
+	uint32_t n;
+
+	while ((n = OS_RingReady(ring, num)) == 0) {
+		if (num == 0 || waitMS == 0 || !(ring->flags & OS_RING_F_NOTIFY))
+			return 0;
+
+		__atomic_store_n(&ring->waiting, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		n = OS_RingReady(ring, num);
+		if (n != 0) {
+			__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+			break;
+		}
+		/* the semaphore may be left released, check the ring again */
+		if (OS_SemaphoreWait(&ring->sem, waitMS) != OS_OK) {
+			__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+			return 0;
+		}
+	}
+	return n;
+}
+
+uint32_t OS_RingGet(OS_Ring_t *ring, void *elems, uint32_t num,
+                    OS_Time_t waitMS)
+{
+	uint32_t n = OS_RingWait(ring, num, waitMS);
+
+	if (n == 0)
+		return 0;
+	OS_RingCopyOut(ring, ring->tail, elems, n);
+	__atomic_store_n(&ring->tail, ring->tail + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+uint32_t OS_RingPeek(OS_Ring_t *ring, void *elems, uint32_t num,
+                     OS_Time_t waitMS)
+{
+	uint32_t n = OS_RingWait(ring, num, waitMS);
+
+	if (n != 0)
+		OS_RingCopyOut(ring, ring->tail, elems, n);
+	return n;
+}
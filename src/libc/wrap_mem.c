@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef CONFIG_LIBC_WRAP_MEM
+
+#include <stdint.h>
+#include <stddef.h>
+#include "compiler.h"
+
+/*
+ * memcpy()/memmove()/memset() of the whole image (gcc.mk wraps them), used
+ * instead of the ROM versions, see appos.ld.
+ *   - the destination is aligned first, all stores are word stores
+ *   - aligned data is moved by 32 bytes LDM/STM bursts
+ *   - misaligned source is read by aligned words and shifted into place,
+ *     instead of falling back to byte copy
+ *   - plain C except the bursts, so it can be built and checked on the host
+ *
+ * NB: the loops MUST NOT be turned into memcpy()/memset() calls by gcc.
+ */
+#define MEM_OPTIMIZE    __attribute__((__optimize__("-O2", "-fno-tree-loop-distribute-patterns")))
+
+#define MEM_SMALL_SIZE  8   /* copy/set byte by byte below this size */
+
+#if defined(__thumb2__)
+#define MEM_OPT_LDM_STM 1
+#else
+#define MEM_OPT_LDM_STM 0
+#endif
+
+typedef uint32_t __attribute__((__may_alias__)) mem_word_t;
+
+#define MEM_ALIGN_MOD(addr) ((uintptr_t)(addr) & 0x3)
+
+/* join the tail of word @lo and the head of word @hi, @sh is 8, 16 or 24 */
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define MEM_SHIFT(lo, hi, sh)   (((lo) << (sh)) | ((hi) >> (32 - (sh))))
+#else
+#define MEM_SHIFT(lo, hi, sh)   (((lo) >> (sh)) | ((hi) << (32 - (sh))))
+#endif
+
+/* forward copy of @n bytes from @s to word aligned @dw, @s is misaligned */
+#define MEM_COPY_FWD_SHIFT(dw, s, n, sh)                        \
+    do {                                                        \
+        const mem_word_t *_sw = (const mem_word_t *)((s) - (sh) / 8); \
+        uint32_t _lo = *_sw++, _hi;                             \
+        while ((n) >= 16) {                                     \
+            _hi = *_sw++; *(dw)++ = MEM_SHIFT(_lo, _hi, sh);    \
+            _lo = *_sw++; *(dw)++ = MEM_SHIFT(_hi, _lo, sh);    \
+            _hi = *_sw++; *(dw)++ = MEM_SHIFT(_lo, _hi, sh);    \
+            _lo = *_sw++; *(dw)++ = MEM_SHIFT(_hi, _lo, sh);    \
+            (n) -= 16;                                          \
+        }                                                       \
+        while ((n) >= 4) {                                      \
+            _hi = *_sw++; *(dw)++ = MEM_SHIFT(_lo, _hi, sh);    \
+            _lo = _hi;                                          \
+            (n) -= 4;                                           \
+        }                                                       \
+        (s) = (const uint8_t *)_sw - 4 + (sh) / 8;              \
+    } while (0)
+
+/* backward copy of @n bytes from the end @s to word aligned end @dw */
+#define MEM_COPY_BWD_SHIFT(dw, s, n, sh)                        \
+    do {                                                        \
+        const mem_word_t *_sw = (const mem_word_t *)((s) - (sh) / 8); \
+        uint32_t _hi = *_sw, _lo;                               \
+        while ((n) >= 16) {                                     \
+            _lo = *--_sw; *--(dw) = MEM_SHIFT(_lo, _hi, sh);    \
+            _hi = *--_sw; *--(dw) = MEM_SHIFT(_hi, _lo, sh);    \
+            _lo = *--_sw; *--(dw) = MEM_SHIFT(_lo, _hi, sh);    \
+            _hi = *--_sw; *--(dw) = MEM_SHIFT(_hi, _lo, sh);    \
+            (n) -= 16;                                          \
+        }                                                       \
+        while ((n) >= 4) {                                      \
+            _lo = *--_sw; *--(dw) = MEM_SHIFT(_lo, _hi, sh);    \
+            _hi = _lo;                                          \
+            (n) -= 4;                                           \
+        }                                                       \
+        (s) = (const uint8_t *)_sw + (sh) / 8;                  \
+    } while (0)
+
+static __always_inline void mem_copy_fwd(uint8_t *d, const uint8_t *s, size_t n)
+{
+	if (n >= MEM_SMALL_SIZE) {
+		while (MEM_ALIGN_MOD(d)) {
+			*d++ = *s++;
+			--n;
+		}
+
+		mem_word_t *dw = (mem_word_t *)d;
+
+		switch (MEM_ALIGN_MOD(s)) {
+		case 0: {
+			const mem_word_t *sw = (const mem_word_t *)s;
+			while (n >= 32) {
+#if MEM_OPT_LDM_STM
+				__asm volatile (
+					"ldmia %0!, {r3, r4, r5, r6}\n\t"
+					"stmia %1!, {r3, r4, r5, r6}\n\t"
+					"ldmia %0!, {r3, r4, r5, r6}\n\t"
+					"stmia %1!, {r3, r4, r5, r6}\n\t"
+					: "+r" (sw), "+r" (dw)
+					:
+					: "r3", "r4", "r5", "r6", "memory");
+#else
+				dw[0] = sw[0]; dw[1] = sw[1]; dw[2] = sw[2]; dw[3] = sw[3];
+				dw[4] = sw[4]; dw[5] = sw[5]; dw[6] = sw[6]; dw[7] = sw[7];
+				dw += 8;
+				sw += 8;
+#endif
+				n -= 32;
+			}
+			while (n >= 4) {
+				*dw++ = *sw++;
+				n -= 4;
+			}
+			s = (const uint8_t *)sw;
+			break;
+		}
+		case 1:
+			MEM_COPY_FWD_SHIFT(dw, s, n, 8);
+			break;
+		case 2:
+			MEM_COPY_FWD_SHIFT(dw, s, n, 16);
+			break;
+		default:
+			MEM_COPY_FWD_SHIFT(dw, s, n, 24);
+			break;
+		}
+
+		d = (uint8_t *)dw;
+	}
+
+	while (n) {
+		*d++ = *s++;
+		--n;
+	}
+}
+
+/* copy @n bytes ending at @d and @s, from the end */
+static __always_inline void mem_copy_bwd(uint8_t *d, const uint8_t *s, size_t n)
+{
+	if (n >= MEM_SMALL_SIZE) {
+		while (MEM_ALIGN_MOD(d)) {
+			*--d = *--s;
+			--n;
+		}
+
+		mem_word_t *dw = (mem_word_t *)d;
+
+		switch (MEM_ALIGN_MOD(s)) {
+		case 0: {
+			const mem_word_t *sw = (const mem_word_t *)s;
+			while (n >= 32) {
+#if MEM_OPT_LDM_STM
+				__asm volatile (
+					"ldmdb %0!, {r3, r4, r5, r6}\n\t"
+					"stmdb %1!, {r3, r4, r5, r6}\n\t"
+					"ldmdb %0!, {r3, r4, r5, r6}\n\t"
+					"stmdb %1!, {r3, r4, r5, r6}\n\t"
+					: "+r" (sw), "+r" (dw)
+					:
+					: "r3", "r4", "r5", "r6", "memory");
+#else
+				dw -= 8;
+				sw -= 8;
+				dw[7] = sw[7]; dw[6] = sw[6]; dw[5] = sw[5]; dw[4] = sw[4];
+				dw[3] = sw[3]; dw[2] = sw[2]; dw[1] = sw[1]; dw[0] = sw[0];
+#endif
+				n -= 32;
+			}
+			while (n >= 4) {
+				*--dw = *--sw;
+				n -= 4;
+			}
+			s = (const uint8_t *)sw;
+			break;
+		}
+		case 1:
+			MEM_COPY_BWD_SHIFT(dw, s, n, 8);
+			break;
+		case 2:
+			MEM_COPY_BWD_SHIFT(dw, s, n, 16);
+			break;
+		default:
+			MEM_COPY_BWD_SHIFT(dw, s, n, 24);
+			break;
+		}
+
+		d = (uint8_t *)dw;
+	}
+
+	while (n) {
+		*--d = *--s;
+		--n;
+	}
+}
+
+__sram_text MEM_OPTIMIZE
+void *__wrap_memcpy(void *dst, const void *src, size_t n)
+{
+	mem_copy_fwd((uint8_t *)dst, (const uint8_t *)src, n);
+	return dst;
+}
+
+__sram_text MEM_OPTIMIZE
+void *__wrap_memmove(void *dst, const void *src, size_t n)
+{
+	if ((uintptr_t)dst - (uintptr_t)src >= n) {
+		/* @dst is below @src or not overlapped, a forward copy never
+		 * overwrites the source before reading it */
+		mem_copy_fwd((uint8_t *)dst, (const uint8_t *)src, n);
+	} else {
+		mem_copy_bwd((uint8_t *)dst + n, (const uint8_t *)src + n, n);
+	}
+	return dst;
+}
+
+__sram_text MEM_OPTIMIZE
+void *__wrap_memset(void *s, int c, size_t n)
+{
+	uint8_t *d = (uint8_t *)s;
+
+	if (n >= MEM_SMALL_SIZE) {
+		while (MEM_ALIGN_MOD(d)) {
+			*d++ = (uint8_t)c;
+			--n;
+		}
+
+		mem_word_t *dw = (mem_word_t *)d;
+		uint32_t v = (uint8_t)c * 0x01010101U;
+
+		if (n >= 32) {
+#if MEM_OPT_LDM_STM
+			register uint32_t v0 __asm("r3") = v;
+			register uint32_t v1 __asm("r4") = v;
+			register uint32_t v2 __asm("r5") = v;
+			register uint32_t v3 __asm("r6") = v;
+			do {
+				__asm volatile (
+					"stmia %0!, {%1, %2, %3, %4}\n\t"
+					"stmia %0!, {%1, %2, %3, %4}\n\t"
+					: "+r" (dw)
+					: "r" (v0), "r" (v1), "r" (v2), "r" (v3)
+					: "memory");
+				n -= 32;
+			} while (n >= 32);
+#else
+			do {
+				dw[0] = v; dw[1] = v; dw[2] = v; dw[3] = v;
+				dw[4] = v; dw[5] = v; dw[6] = v; dw[7] = v;
+				dw += 8;
+				n -= 32;
+			} while (n >= 32);
+#endif
+		}
+		while (n >= 4) {
+			*dw++ = v;
+			n -= 4;
+		}
+
+		d = (uint8_t *)dw;
+	}
+
+	while (n) {
+		*d++ = (uint8_t)c;
+		--n;
+	}
+	return s;
+}
+
+#endif /* CONFIG_LIBC_WRAP_MEM */
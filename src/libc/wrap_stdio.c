@@ -34,6 +34,11 @@
 #include <string.h>
 #include "driver/chip/hal_cmsis.h"
 #include "kernel/os/os_mutex.h"
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+#include "kernel/os/os_thread.h"
+#include "kernel/os/os_semaphore.h"
+#include "kernel/os/os_time.h"
+#endif
 
 #define WRAP_STDOUT_BUF_SIZE	1024
 
@@ -64,6 +69,7 @@ void stdout_mutex_lock(void)
 
 	if (!OS_MutexIsValid(&s_stdout_mutex)) {
 		OS_RecursiveMutexCreate(&s_stdout_mutex);
+		OS_MutexSetName(&s_stdout_mutex, "stdout");
 	}
 	OS_RecursiveMutexLock(&s_stdout_mutex, OS_WAIT_FOREVER);
 }
@@ -86,7 +92,7 @@ void stdio_set_write(stdio_write_fn fn)
 	stdout_mutex_unlock();
 }
 
-static __inline int stdio_wrap_write(char *buf, int len, int max)
+static __inline int stdio_real_len(char *buf, int len, int max)
 {
 #ifndef CONFIG_LIBC_PRINTF_FLOAT
 	/* BUG: If "CONFIG_LIBC_PRINTF_FLOAT" is not defined, the return value
@@ -101,34 +107,575 @@ static __inline int stdio_wrap_write(char *buf, int len, int max)
 		len = strlen(buf);
 	}
 #endif
-	return s_stdio_write(buf, len);
+	return len;
 }
 
-int __wrap_printf(const char *format, ...)
+static __inline int stdio_wrap_write(char *buf, int len, int max)
+{
+	return s_stdio_write(buf, stdio_real_len(buf, len, max));
+}
+
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+
+/*
+ * Asynchronous standard output
+ *
+ * Output is queued in a ring of records by any number of producers, threads
+ * or ISRs, without any lock: a producer reserves its record by a CAS on the
+ * head, fills it and sets the commit flag of its header. The drain thread
+ * writes the committed records out in order, clears them and moves the tail.
+ * A record is never split at the end of the ring, a padding record fills the
+ * end instead. A record which does not fit is dropped and counted.
+ *
+ * Output in case of IRQ/FIQ disabled or scheduler not running is still
+ * written synchronously, the ring may never be drained in these cases.
+ * Fault handlers and panic/assert paths go through stdio_async_panic(),
+ * which writes the queued records out first, then turns the ring off.
+ */
+
+#define STDIO_ASYNC_BUF_SIZE    CONFIG_LIBC_STDIO_ASYNC_BUF_SIZE
+#define STDIO_ASYNC_BUF_MASK    (STDIO_ASYNC_BUF_SIZE - 1)
+#define STDIO_ASYNC_LINE_SIZE   128 /* record reserved to format a line */
+#define STDIO_ASYNC_REC_MAX     (WRAP_STDOUT_BUF_SIZE + 4)
+#define STDIO_ASYNC_STACK_SIZE  (1 * 1024)
+#define STDIO_ASYNC_THREAD_PRIO OS_PRIORITY_LOW
+
+#if (STDIO_ASYNC_BUF_SIZE & STDIO_ASYNC_BUF_MASK)
+#error "CONFIG_LIBC_STDIO_ASYNC_BUF_SIZE must be a power of 2"
+#endif
+
+/* record header
+ *    - bit 0~15:  size of the record, header included, 4 bytes aligned
+ *    - bit 16~28: length of the data
+ *    - bit 29~30: type
+ *    - bit 31:    commit flag, set at last
+ */
+#define STDIO_REC_SIZE(h)   ((h) & 0xFFFF)
+#define STDIO_REC_LEN(h)    (((h) >> 16) & 0x1FFF)
+#define STDIO_REC_TYPE(h)   (((h) >> 29) & 0x3)
+#define STDIO_REC_COMMIT    (1U << 31)
+#define STDIO_REC_HDR(size, len, type) \
+	((size) | ((len) << 16) | ((type) << 29) | STDIO_REC_COMMIT)
+
+#define STDIO_REC_ALIGN(n)  (((n) + 3) & ~3U)
+
+#define STDIO_REC_PAD       0
+#define STDIO_REC_TEXT      1
+#define STDIO_REC_BIN       2
+
+static struct {
+	uint32_t head;      /* reserved by producers, free running */
+	uint32_t tail;      /* released by the drain thread, free running */
+	uint32_t waiting;   /* drain thread is waiting for records */
+	uint8_t running;
+	uint8_t panic;      /* all output is synchronous from now on */
+	stdio_write_fn write;
+	OS_Semaphore_t sem;
+	OS_Thread_t thread;
+	struct stdio_async_stat stat;
+	uint32_t buf[STDIO_ASYNC_BUF_SIZE / 4];
+} s_async;
+
+static int s_log_level = 0xF; /* XR_LEVEL_ALL */
+
+int __wrap_vprintf(const char *format, va_list ap);
+
+/* all contexts but IRQ/FIQ disabled and scheduler not running, ISR is OK,
+ * except the fault handlers: NMI, hard, memory, bus and usage fault
+ */
+static __inline int stdio_async_usable(void)
+{
+	uint32_t ipsr;
+
+	if (!s_async.running || s_async.panic) {
+		return 0;
+	}
+	ipsr = __get_IPSR();
+	if (ipsr >= 2 && ipsr <= 6) {
+		stdio_async_panic();
+		return 0;
+	}
+	return (!__get_PRIMASK()    &&
+	        !__get_FAULTMASK()  &&
+	        OS_ThreadIsSchedulerRunning());
+}
+
+static __inline void stdio_async_stat_add(uint32_t *cnt, uint32_t n)
+{
+	__atomic_fetch_add(cnt, n, __ATOMIC_RELAXED);
+}
+
+static uint32_t *stdio_async_reserve(uint32_t size, uint32_t *start)
+{
+	uint32_t head, pos, pad, used;
+
+	head = __atomic_load_n(&s_async.head, __ATOMIC_RELAXED);
+	do {
+		pos = head & STDIO_ASYNC_BUF_MASK;
+		pad = (pos + size > STDIO_ASYNC_BUF_SIZE) ? STDIO_ASYNC_BUF_SIZE - pos : 0;
+		used = head + pad + size - __atomic_load_n(&s_async.tail, __ATOMIC_ACQUIRE);
+		if (used > STDIO_ASYNC_BUF_SIZE) {
+			return NULL;
+		}
+	} while (!__atomic_compare_exchange_n(&s_async.head, &head, head + pad + size,
+	                                      1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	if (pad) {
+		__atomic_store_n(&s_async.buf[pos / 4],
+		                 STDIO_REC_HDR(pad, 0, STDIO_REC_PAD), __ATOMIC_RELEASE);
+	}
+	if (used > __atomic_load_n(&s_async.stat.used_max, __ATOMIC_RELAXED)) {
+		/* not exact under contention */
+		__atomic_store_n(&s_async.stat.used_max, used, __ATOMIC_RELAXED);
+	}
+	*start = head + pad;
+	return &s_async.buf[(*start & STDIO_ASYNC_BUF_MASK) / 4];
+}
+
+static void stdio_async_wakeup(void)
+{
+	if (__atomic_exchange_n(&s_async.waiting, 0, __ATOMIC_SEQ_CST)) {
+		OS_SemaphoreRelease(&s_async.sem);
+	}
+}
+
+/* the unused end of the record is given back if no one reserved after it */
+static void stdio_async_commit(uint32_t *rec, uint32_t start, uint32_t size,
+                               uint32_t len, uint32_t type)
+{
+	uint32_t end = start + size;
+	uint32_t used = STDIO_REC_ALIGN(len + 4);
+
+	if (used < size &&
+	    __atomic_compare_exchange_n(&s_async.head, &end, start + used,
+	                                0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		size = used;
+	}
+	__atomic_store_n(rec, STDIO_REC_HDR(size, len, type), __ATOMIC_RELEASE);
+	stdio_async_stat_add(&s_async.stat.records, 1);
+	stdio_async_stat_add(&s_async.stat.bytes, len);
+	stdio_async_wakeup();
+}
+
+/* the ring must be kept zero where a header may be read */
+static void stdio_async_cancel(uint32_t *rec, uint32_t start, uint32_t size)
+{
+	uint32_t end = start + size;
+
+	memset(rec + 1, 0, size - 4);
+	if (!__atomic_compare_exchange_n(&s_async.head, &end, start,
+	                                 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		__atomic_store_n(rec, STDIO_REC_HDR(size, 0, STDIO_REC_PAD),
+		                 __ATOMIC_RELEASE);
+	}
+}
+
+static void stdio_async_drop(uint32_t len)
+{
+	stdio_async_stat_add(&s_async.stat.dropped, 1);
+	stdio_async_stat_add(&s_async.stat.dropped_bytes, len);
+}
+
+static int stdio_async_vprintf(const char *format, va_list ap)
+{
+	uint32_t *rec;
+	uint32_t start, size;
+	int len, max;
+	va_list aq;
+
+	size = STDIO_ASYNC_LINE_SIZE;
+	while (1) {
+		rec = stdio_async_reserve(size, &start);
+		if (rec == NULL) {
+			stdio_async_drop(size - 4);
+			return 0;
+		}
+		max = size - 4;
+		va_copy(aq, ap);
+		len = vsnprintf((char *)(rec + 1), max, format, aq);
+		va_end(aq);
+		len = stdio_real_len((char *)(rec + 1), len, max - 1);
+		if (len < max - 1 || size == STDIO_ASYNC_REC_MAX) {
+			break;
+		}
+		/* too long for the record, format it again in a larger one */
+		stdio_async_cancel(rec, start, size);
+		if (len >= max && len + 5 < STDIO_ASYNC_REC_MAX) {
+			size = STDIO_REC_ALIGN(len + 5);
+		} else {
+			size = STDIO_ASYNC_REC_MAX;
+		}
+	}
+	if (len > max - 1) {
+		len = max - 1;
+	}
+	stdio_async_commit(rec, start, size, len, STDIO_REC_TEXT);
+	return len;
+}
+
+/* copy @buf and a new line if @nl, split into records if too long */
+static int stdio_async_copy(const char *buf, int len, int nl)
+{
+	uint32_t *rec;
+	uint32_t start, size;
+	int n, cnt = 0;
+
+	do {
+		n = len - cnt;
+		if (n + nl > STDIO_ASYNC_REC_MAX - 4) {
+			n = STDIO_ASYNC_REC_MAX - 4 - nl;
+		}
+		size = STDIO_REC_ALIGN(n + nl + 4);
+		rec = stdio_async_reserve(size, &start);
+		if (rec == NULL) {
+			stdio_async_drop(len + nl - cnt);
+			break;
+		}
+		memcpy(rec + 1, buf + cnt, n);
+		cnt += n;
+		if (cnt == len && nl) {
+			((char *)(rec + 1))[n++] = '\n';
+			cnt += nl;
+			nl = 0;
+		}
+		stdio_async_commit(rec, start, size, n, STDIO_REC_TEXT);
+	} while (cnt < len + nl);
+
+	return cnt;
+}
+
+#ifdef CONFIG_LIBC_STDIO_ASYNC_BINARY
+
+/*
+ * Binary log message, "0x00, length (16 bits), format address (32 bits),
+ * arguments", all little endian, length counts the address and arguments.
+ * The arguments are packed without padding in the order of the format:
+ *    - "*" width/precision, integer, pointer: 32 bits
+ *    - "ll", "j", "L" integer: 64 bits
+ *    - floating point: 64 bits, double
+ *    - string: the chars, at most STDIO_BIN_STR_MAX, and "\0"
+ * tools/log_decode.py reads the format string from the elf file.
+ */
+
+#define STDIO_BIN_SIZE      96
+#define STDIO_BIN_HDR_SIZE  7
+#define STDIO_BIN_STR_MAX   63
+
+extern uint8_t __text_start__[];
+extern uint8_t __etext[];
+#if (defined(CONFIG_XIP))
+extern uint8_t __xip_start__[];
+extern uint8_t __xip_end__[];
+#endif
+
+/* the format string is in the image, the host can read it from the elf */
+static __inline int stdio_bin_format_ok(const char *format)
+{
+	if ((uint8_t *)format >= __text_start__ && (uint8_t *)format < __etext) {
+		return 1;
+	}
+#if (defined(CONFIG_XIP))
+	if ((uint8_t *)format >= __xip_start__ && (uint8_t *)format < __xip_end__) {
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+static __inline uint8_t *stdio_bin_put(uint8_t *p, uint8_t *end,
+                                       const void *val, int size)
+{
+	if (p == NULL || p + size > end) {
+		return NULL;
+	}
+	memcpy(p, val, size);
+	return p + size;
+}
+
+/* return the length of the message, -1 if not supported or too long */
+static int stdio_bin_encode(uint8_t *buf, int max, const char *format, va_list ap)
+{
+	uint8_t *p = buf + STDIO_BIN_HDR_SIZE;
+	uint8_t *end = buf + max;
+	const char *f = format;
+	const char *s;
+	uint32_t v32;
+	uint64_t v64;
+	double d;
+	int i, wide, len;
+
+	while (*f) {
+		if (*f++ != '%') {
+			continue;
+		}
+		while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0') {
+			f++;
+		}
+		for (i = 0; i < 2; i++) { /* width and precision */
+			if (*f == '*') {
+				v32 = va_arg(ap, int);
+				p = stdio_bin_put(p, end, &v32, 4);
+				f++;
+			} else {
+				while (*f >= '0' && *f <= '9') {
+					f++;
+				}
+			}
+			if (i > 0 || *f != '.') {
+				break;
+			}
+			f++;
+		}
+		wide = 0;
+		while (*f == 'h' || *f == 'l' || *f == 'L' || *f == 'j' ||
+		       *f == 'z' || *f == 't' || *f == 'q') {
+			if (*f == 'l' && f[1] == 'l') {
+				wide = 1;
+				f++;
+			} else if (*f == 'L' || *f == 'j' || *f == 'q') {
+				wide = 1;
+			}
+			f++;
+		}
+		switch (*f) {
+		case '%':
+			break;
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+			if (wide) {
+				v64 = va_arg(ap, long long);
+				p = stdio_bin_put(p, end, &v64, 8);
+			} else {
+				v32 = va_arg(ap, int);
+				p = stdio_bin_put(p, end, &v32, 4);
+			}
+			break;
+		case 'p':
+			v32 = (uint32_t)va_arg(ap, void *);
+			p = stdio_bin_put(p, end, &v32, 4);
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			d = va_arg(ap, double);
+			p = stdio_bin_put(p, end, &d, 8);
+			break;
+		case 's':
+			s = va_arg(ap, const char *);
+			if (s == NULL) {
+				s = "(null)";
+			}
+			len = strnlen(s, STDIO_BIN_STR_MAX);
+			p = stdio_bin_put(p, end, s, len);
+			p = stdio_bin_put(p, end, "", 1);
+			break;
+		case 'n':
+			(void)va_arg(ap, void *);
+			break;
+		default:
+			return -1;
+		}
+		if (p == NULL) {
+			return -1;
+		}
+		f++;
+	}
+
+	len = p - buf;
+	v32 = (uint32_t)format;
+	buf[0] = 0;
+	buf[1] = (len - 3) & 0xFF;
+	buf[2] = (len - 3) >> 8;
+	memcpy(buf + 3, &v32, 4);
+	return len;
+}
+
+/* return the length of the message, -1 to send it as text */
+static int stdio_bin_vprintf(const char *format, va_list ap)
+{
+	uint32_t *rec;
+	uint32_t start, size;
+	int len;
+	va_list aq;
+
+	if (!stdio_bin_format_ok(format)) {
+		return -1;
+	}
+	size = STDIO_BIN_SIZE + 4;
+	rec = stdio_async_reserve(size, &start);
+	if (rec == NULL) {
+		stdio_async_drop(STDIO_BIN_SIZE);
+		return 0;
+	}
+	va_copy(aq, ap);
+	len = stdio_bin_encode((uint8_t *)(rec + 1), STDIO_BIN_SIZE, format, aq);
+	va_end(aq);
+	if (len < 0) {
+		stdio_async_cancel(rec, start, size);
+		return -1;
+	}
+	stdio_async_commit(rec, start, size, len, STDIO_REC_BIN);
+	return len;
+}
+
+#endif /* CONFIG_LIBC_STDIO_ASYNC_BINARY */
+
+static void stdio_async_task(void *arg)
+{
+	uint32_t *rec;
+	uint32_t tail, hdr;
+	stdio_write_fn write;
+
+	while (1) {
+		tail = s_async.tail;
+		rec = &s_async.buf[(tail & STDIO_ASYNC_BUF_MASK) / 4];
+		hdr = __atomic_load_n(rec, __ATOMIC_ACQUIRE);
+		if (!(hdr & STDIO_REC_COMMIT)) {
+			__atomic_store_n(&s_async.waiting, 1, __ATOMIC_SEQ_CST);
+			if (!(__atomic_load_n(rec, __ATOMIC_SEQ_CST) & STDIO_REC_COMMIT)) {
+				OS_SemaphoreWait(&s_async.sem, OS_WAIT_FOREVER);
+			}
+			__atomic_store_n(&s_async.waiting, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		write = s_async.write ? s_async.write : s_stdio_write;
+		if (write && STDIO_REC_TYPE(hdr) != STDIO_REC_PAD && STDIO_REC_LEN(hdr)) {
+			write((char *)(rec + 1), STDIO_REC_LEN(hdr));
+		}
+		memset(rec, 0, STDIO_REC_SIZE(hdr));
+		__atomic_store_n(&s_async.tail, tail + STDIO_REC_SIZE(hdr), __ATOMIC_RELEASE);
+	}
+}
+
+int stdio_async_start(void)
+{
+	if (s_async.running) {
+		return 0;
+	}
+	if (OS_SemaphoreCreate(&s_async.sem, 0, 1) != OS_OK) {
+		return -1;
+	}
+	if (OS_ThreadCreate(&s_async.thread, "stdio", stdio_async_task, NULL,
+	                    STDIO_ASYNC_THREAD_PRIO, STDIO_ASYNC_STACK_SIZE) != OS_OK) {
+		OS_SemaphoreDelete(&s_async.sem);
+		return -1;
+	}
+	s_async.running = 1;
+	return 0;
+}
+
+/* wait for the ring to be written out, return 0 if empty */
+int stdio_async_flush(uint32_t timeout_ms)
+{
+	uint32_t end = OS_GetTicks() + OS_MSecsToTicks(timeout_ms);
+
+	while (__atomic_load_n(&s_async.tail, __ATOMIC_ACQUIRE) !=
+	       __atomic_load_n(&s_async.head, __ATOMIC_RELAXED)) {
+		if (!stdio_async_usable() || __get_IPSR() ||
+		    OS_TimeAfterEqual(OS_GetTicks(), end)) {
+			return -1;
+		}
+		OS_MSleep(1);
+	}
+	return 0;
+}
+
+/*
+ * Write the queued records out in the caller's context and stop queueing,
+ * for fault handlers and panic/assert paths which never return to the drain
+ * thread. A record still being filled by an interrupted producer ends it.
+ */
+void stdio_async_panic(void)
+{
+	uint32_t *rec;
+	uint32_t tail, hdr;
+
+	if (!s_async.running || s_async.panic) {
+		return;
+	}
+	s_async.panic = 1;
+
+	tail = s_async.tail;
+	while (tail != __atomic_load_n(&s_async.head, __ATOMIC_ACQUIRE)) {
+		rec = &s_async.buf[(tail & STDIO_ASYNC_BUF_MASK) / 4];
+		hdr = __atomic_load_n(rec, __ATOMIC_ACQUIRE);
+		if (!(hdr & STDIO_REC_COMMIT)) {
+			break;
+		}
+		/* the async writer may block, eg. UART DMA */
+		if (s_stdio_write && STDIO_REC_TYPE(hdr) != STDIO_REC_PAD &&
+		    STDIO_REC_LEN(hdr)) {
+			s_stdio_write((char *)(rec + 1), STDIO_REC_LEN(hdr));
+		}
+		tail += STDIO_REC_SIZE(hdr);
+	}
+	__atomic_store_n(&s_async.tail, tail, __ATOMIC_RELEASE);
+}
+
+/* return -1 if not queued, the caller should write it out itself */
+int stdio_async_write(const char *buf, int len)
+{
+	if (!stdio_async_usable()) {
+		return -1;
+	}
+	return len > 0 ? stdio_async_copy(buf, len, 0) : 0;
+}
+
+/* writer of the drain thread, it may block, eg. UART DMA */
+void stdio_set_async_write(stdio_write_fn fn)
+{
+	s_async.write = fn;
+}
+
+void stdio_async_get_stat(struct stdio_async_stat *stat)
+{
+	memcpy(stat, &s_async.stat, sizeof(*stat));
+}
+
+void stdio_log_set_level(int level)
+{
+	s_log_level = level;
+}
+
+int stdio_log_get_level(void)
+{
+	return s_log_level;
+}
+
+int stdio_log_printf(int level, const char *format, ...)
 {
 	int len;
 	va_list ap;
 
-	stdout_mutex_lock();
+	if (level > s_log_level) {
+		stdio_async_stat_add(&s_async.stat.filtered, 1);
+		return 0;
+	}
 
-	if (s_stdio_write == NULL) {
-		len = 0;
-	} else {
-		va_start(ap, format);
-		len = vsnprintf(s_stdout_buf, WRAP_STDOUT_BUF_SIZE, format, ap);
+	va_start(ap, format);
+#ifdef CONFIG_LIBC_STDIO_ASYNC_BINARY
+	if (stdio_async_usable() &&
+	    (len = stdio_bin_vprintf(format, ap)) >= 0) {
 		va_end(ap);
-		len = stdio_wrap_write(s_stdout_buf, len, WRAP_STDOUT_BUF_SIZE - 1);
+		return len;
 	}
-
-	stdout_mutex_unlock();
+#endif
+	len = __wrap_vprintf(format, ap);
+	va_end(ap);
 
 	return len;
 }
 
+#endif /* CONFIG_LIBC_STDIO_ASYNC */
+
 int __wrap_vprintf(const char *format, va_list ap)
 {
 	int len;
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	if (stdio_async_usable()) {
+		return stdio_async_vprintf(format, ap);
+	}
+#endif
+
 	stdout_mutex_lock();
 
 	if (s_stdio_write == NULL) {
@@ -143,10 +690,28 @@ int __wrap_vprintf(const char *format, va_list ap)
 	return len;
 }
 
+int __wrap_printf(const char *format, ...)
+{
+	int len;
+	va_list ap;
+
+	va_start(ap, format);
+	len = __wrap_vprintf(format, ap);
+	va_end(ap);
+
+	return len;
+}
+
 int __wrap_puts(const char *s)
 {
 	int len;
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	if (stdio_async_usable()) {
+		return stdio_async_copy(s, strlen(s), 1);
+	}
+#endif
+
 	stdout_mutex_lock();
 
 	if (s_stdio_write == NULL) {
@@ -169,18 +734,9 @@ int __wrap_fprintf(FILE *stream, const char *format, ...)
 	if (stream != stdout && stream != stderr)
 		return 0;
 
-	stdout_mutex_lock();
-
-	if (s_stdio_write == NULL) {
-		len = 0;
-	} else {
-		va_start(ap, format);
-		len = vsnprintf(s_stdout_buf, WRAP_STDOUT_BUF_SIZE, format, ap);
-		va_end(ap);
-		len = stdio_wrap_write(s_stdout_buf, len, WRAP_STDOUT_BUF_SIZE - 1);
-	}
-
-	stdout_mutex_unlock();
+	va_start(ap, format);
+	len = __wrap_vprintf(format, ap);
+	va_end(ap);
 
 	return len;
 }
@@ -207,6 +763,13 @@ int __wrap_putchar(int c)
 	int len;
 	char cc;
 
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	if (stdio_async_usable()) {
+		cc = c;
+		return stdio_async_copy(&cc, 1, 0);
+	}
+#endif
+
 	stdout_mutex_lock();
 
 	if (s_stdio_write == NULL) {
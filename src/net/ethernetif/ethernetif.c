@@ -148,6 +148,42 @@ static err_t ethernetif_null_linkoutput(struct netif *nif, struct pbuf *p)
 }
 
 #if (LWIP_MBUF_SUPPORT == 0)
+#if LWIP_MBUF_TX_ZERO_COPY
+_Static_assert(PBUF_LINK_ENCAPSULATION_HLEN >= MBUF_HEAD_SPACE,
+               "no room for 802.11 header in PBUF_RAM");
+
+static void eth_pbuf_ext_free(void *arg)
+{
+	pbuf_free((struct pbuf *)arg);
+}
+
+/*
+ * Send a single PBUF_RAM pbuf without copying. The pbuf is referenced by the
+ * mbuf until it is sent, TCP does not retransmit a segment in use meanwhile.
+ * There is no tail space, mb_append() copies the frame if a trailer is added.
+ *
+ * @return NULL if the pbuf is not suitable, it should be copied
+ */
+static __inline struct mbuf *eth_pbuf2mbuf_ext(struct pbuf *p)
+{
+	struct mbuf *m;
+	uint8_t *data = (uint8_t *)p->payload;
+	uint8_t *buf = (uint8_t *)p + LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf));
+
+	if (p->next != NULL || p->type_internal != PBUF_RAM ||
+	    (p->flags & PBUF_FLAG_IS_CUSTOM) ||
+	    data < buf + MBUF_HEAD_SPACE) {
+		return NULL;
+	}
+
+	m = mb_get_ext(data, p->len, MBUF_HEAD_SPACE, 0, eth_pbuf_ext_free, p);
+	if (m) {
+		pbuf_ref(p); /* @p is referenced by @m now */
+	}
+	return m;
+}
+#endif /* LWIP_MBUF_TX_ZERO_COPY */
+
 static __inline struct mbuf *eth_pbuf2mbuf(struct pbuf *p)
 {
 	struct mbuf *m;
@@ -155,6 +191,13 @@ static __inline struct mbuf *eth_pbuf2mbuf(struct pbuf *p)
 	uint8_t *data;
 	int32_t left;
 
+#if LWIP_MBUF_TX_ZERO_COPY
+	m = eth_pbuf2mbuf_ext(p);
+	if (m) {
+		return m;
+	}
+#endif
+
 	/* get a mbuf */
 	m = mb_get(p->tot_len, 1 | MBUF_GET_FLAG_LIMIT_TX);
 	if (m == NULL) {
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/inet_chksum.h"
+
+#if (LWIP_CHECKSUM_ON_COPY && defined(LWIP_CHKSUM_COPY))
+
+#include <stdint.h>
+
+/*
+ * LWIP_CHKSUM_COPY() of the port: copy @len bytes from @src to @dst and sum
+ * them in the same pass, instead of memcpy() followed by LWIP_CHKSUM() reading
+ * the data again.
+ *   - the destination is aligned first, all stores of the loop are word stores
+ *   - the source is read by words, misaligned loads are fine on Cortex-M33
+ *   - words are added to a 64-bit sum, carries are folded once at the end
+ *   - the result is the same as LWIP_CHKSUM(dst, len) for any alignment
+ *
+ * NB: the loops MUST NOT be turned into a memcpy() call by gcc.
+ */
+#define CHKSUM_OPTIMIZE     __attribute__((__optimize__("-O2", "-fno-tree-loop-distribute-patterns")))
+
+#define CHKSUM_SMALL_SIZE   8   /* copy and sum byte by byte below this size */
+
+typedef uint32_t __attribute__((__may_alias__)) chksum_word_t;
+typedef struct {
+	uint32_t w;
+} __attribute__((__packed__, __may_alias__)) chksum_uword_t;
+
+#define CHKSUM_LOAD(s, i)   (((const chksum_uword_t *)(s))[i].w)
+
+/* value of byte @b at offset @i of the data in its 16-bit word */
+#if (BYTE_ORDER == LITTLE_ENDIAN)
+#define CHKSUM_BYTE(b, i)   ((i) & 1 ? (uint32_t)(b) << 8 : (uint32_t)(b))
+#else
+#define CHKSUM_BYTE(b, i)   ((i) & 1 ? (uint32_t)(b) : (uint32_t)(b) << 8)
+#endif
+
+static __inline uint32_t chksum_fold(uint64_t sum)
+{
+	uint32_t acc;
+
+	sum = (sum & 0xffffffffULL) + (sum >> 32);
+	sum = (sum & 0xffffffffULL) + (sum >> 32);
+	acc = (uint32_t)sum;
+	acc = (acc & 0xffffUL) + (acc >> 16);
+	acc = (acc & 0xffffUL) + (acc >> 16);
+	return acc;
+}
+
+CHKSUM_OPTIMIZE
+u16_t arch_chksum_copy(void *dst, const void *src, u16_t len)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	uint64_t sum = 0;
+	u16_t i = 0;
+	uint8_t b;
+
+	if (len >= CHKSUM_SMALL_SIZE) {
+		uint64_t wsum = 0;
+		uint32_t w0, w1, w2, w3;
+		u16_t n;
+
+		while ((uintptr_t)d & 0x3) {
+			b = *s++;
+			*d++ = b;
+			sum += CHKSUM_BYTE(b, i);
+			++i;
+		}
+
+		chksum_word_t *dw = (chksum_word_t *)d;
+		n = len - i;
+		while (n >= 16) {
+			w0 = CHKSUM_LOAD(s, 0);
+			w1 = CHKSUM_LOAD(s, 1);
+			w2 = CHKSUM_LOAD(s, 2);
+			w3 = CHKSUM_LOAD(s, 3);
+			dw[0] = w0;
+			dw[1] = w1;
+			dw[2] = w2;
+			dw[3] = w3;
+			wsum += w0;
+			wsum += w1;
+			wsum += w2;
+			wsum += w3;
+			dw += 4;
+			s += 16;
+			n -= 16;
+		}
+		while (n >= 4) {
+			w0 = CHKSUM_LOAD(s, 0);
+			*dw++ = w0;
+			wsum += w0;
+			s += 4;
+			n -= 4;
+		}
+		d = (uint8_t *)dw;
+
+		/* the words started at an odd offset of the data, so the bytes of
+		 * their 16-bit sum are swapped */
+		w0 = chksum_fold(wsum);
+		sum += (i & 1) ? (SWAP_BYTES_IN_WORD(w0)) : w0;
+		i = len - n;
+	}
+
+	while (i < len) {
+		b = *s++;
+		*d++ = b;
+		sum += CHKSUM_BYTE(b, i);
+		++i;
+	}
+
+	return (u16_t)chksum_fold(sum);
+}
+
+#endif /* (LWIP_CHECKSUM_ON_COPY && defined(LWIP_CHKSUM_COPY)) */
@@ -35,7 +35,12 @@
 #include "lwip/debug.h"
 #include "lwip/sys.h"
 #include "lwip/stats.h"
+#include "lwip/tcpip.h"
 #include "sys/list.h"
+#include "driver/chip/hal_cmsis.h"
+#if LWIP_TCPIP_CORE_LOCK_TRACE
+#include "driver/chip/hal_rtc.h"
+#endif
 
 #include "arch/sys_arch.h"
 
@@ -309,6 +314,79 @@ void sys_thread_free(const char *name)
 }
 #endif /* */
 
+#if LWIP_TCPIP_CORE_LOCK_CHECK
+static OS_ThreadHandle_t g_lwip_tcpip_thread_handle;
+#endif
+
+/** Called first thing in tcpip_thread, the core lock exists */
+void sys_mark_tcpip_thread(void)
+{
+#if LWIP_TCPIP_CORE_LOCK_CHECK
+	g_lwip_tcpip_thread_handle = OS_ThreadGetCurrentHandle();
+#endif
+#if LWIP_TCPIP_CORE_LOCKING
+	OS_MutexSetName(&lock_tcpip_core, "tcpip");
+#endif
+}
+
+#if LWIP_TCPIP_CORE_LOCK_CHECK
+/** Check the caller of a core function is allowed to, LWIP_ASSERT_CORE_LOCKED().
+ * The core is single threaded until tcpip_thread starts, lwip_init() and
+ * the netifs added before are not checked. */
+void sys_check_core_locking(void)
+{
+	LWIP_ASSERT("lwIP core called from ISR", __get_IPSR() == 0);
+	if (g_lwip_tcpip_thread_handle != OS_INVALID_HANDLE) {
+#if LWIP_TCPIP_CORE_LOCKING
+		LWIP_ASSERT("lwIP core called without the core lock",
+		            OS_MutexGetOwner(&lock_tcpip_core) == OS_ThreadGetCurrentHandle());
+#else
+		LWIP_ASSERT("lwIP core called out of tcpip_thread",
+		            g_lwip_tcpip_thread_handle == OS_ThreadGetCurrentHandle());
+#endif
+	}
+}
+#endif /* LWIP_TCPIP_CORE_LOCK_CHECK */
+
+#if (LWIP_TCPIP_CORE_LOCKING && LWIP_TCPIP_CORE_LOCK_TRACE)
+static uint32_t g_lwip_core_lock_cnt;
+static uint32_t g_lwip_core_lock_contended;
+static uint32_t g_lwip_core_lock_hold_max;  /* in us */
+static uint64_t g_lwip_core_lock_time;
+static const char *g_lwip_core_lock_func;
+
+/** LOCK_TCPIP_CORE(), func is the caller */
+void sys_lock_tcpip_core(const char *func)
+{
+	if (OS_MutexLock(&lock_tcpip_core, 0) != OS_OK) {
+		OS_MutexLock(&lock_tcpip_core, OS_WAIT_FOREVER);
+		g_lwip_core_lock_contended++;
+	}
+	g_lwip_core_lock_cnt++;
+	g_lwip_core_lock_func = func;
+	g_lwip_core_lock_time = HAL_RTC_GetFreeRunTime();
+}
+
+/** UNLOCK_TCPIP_CORE(), reports each new longest hold and its callers */
+void sys_unlock_tcpip_core(const char *func)
+{
+	uint32_t hold = (uint32_t)(HAL_RTC_GetFreeRunTime() - g_lwip_core_lock_time);
+	const char *lock_func = g_lwip_core_lock_func;
+
+	if (hold > g_lwip_core_lock_hold_max) {
+		g_lwip_core_lock_hold_max = hold;
+	} else {
+		lock_func = NULL;
+	}
+	OS_MutexUnlock(&lock_tcpip_core);
+
+	if (lock_func) {
+		LWIP_PLATFORM_DIAG(("core lock held %u us, %s() to %s(), locks %u, contended %u\n",
+			hold, lock_func, func, g_lwip_core_lock_cnt, g_lwip_core_lock_contended));
+	}
+}
+#endif /* (LWIP_TCPIP_CORE_LOCKING && LWIP_TCPIP_CORE_LOCK_TRACE) */
+
 #endif /* (NO_SYS == 0) */
 
 #if (SYS_LIGHTWEIGHT_PROT && SYS_ARCH_PROTECT_USE_MUTEX)
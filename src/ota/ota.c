@@ -31,6 +31,8 @@
 #include "ota_debug.h"
 #include "ota_file.h"
 #include "ota_http.h"
+#include "ota_writer.h"
+#include "ota_delta.h"
 #include "ota/ota.h"
 #include "image/flash.h"
 #include "image/image.h"
@@ -50,6 +52,12 @@
 static ota_priv_t ota_priv;
 static ota_callback ota_cb = NULL;
 static int32_t ota_skip_size = -1;
+#if OTA_OPT_STREAM_VERIFY
+static uint8_t ota_verify_readback = 0;
+#endif
+#if OTA_OPT_DELTA
+static uint8_t ota_delta_enable = 0;
+#endif
 
 /* indexed by image_seq_t */
 static const image_seq_t ota_update_seq_policy[IMAGE_SEQ_NUM] = {
@@ -90,6 +98,300 @@ static image_seq_t ota_get_update_seq(void)
 	return seq;
 }
 
+#if OTA_OPT_STREAM_VERIFY
+#if OTA_OPT_EXTRA_VERIFY_CRC32
+/* CRC32 (the same as CE_CRC32), 4 bits per step */
+static const uint32_t ota_crc32_table[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+static uint32_t ota_crc32_update(uint32_t crc, const uint8_t *data, uint32_t size)
+{
+	while (size--) {
+		crc ^= *data++;
+		crc = (crc >> 4) ^ ota_crc32_table[crc & 0x0f];
+		crc = (crc >> 4) ^ ota_crc32_table[crc & 0x0f];
+	}
+	return crc;
+}
+#endif /* OTA_OPT_EXTRA_VERIFY_CRC32 */
+
+static void ota_stream_verify_start(void)
+{
+	ota_stream_verify_t *stream = &ota_priv.stream;
+
+	ota_memset(stream, 0, sizeof(*stream));
+#if OTA_OPT_EXTRA_VERIFY_CRC32
+	stream->crc32 = 0xffffffff;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_MD5)
+	mbedtls_md5_init(&stream->md5);
+	mbedtls_md5_starts(&stream->md5);
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA1)
+	mbedtls_sha1_init(&stream->sha1);
+	mbedtls_sha1_starts(&stream->sha1);
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA256)
+	mbedtls_sha256_init(&stream->sha256);
+	mbedtls_sha256_starts(&stream->sha256, 0);
+#endif
+	stream->valid = 1;
+}
+
+static void ota_stream_verify_hash(const uint8_t *data, uint32_t size)
+{
+	ota_stream_verify_t *stream = &ota_priv.stream;
+
+	if (size == 0)
+		return;
+#if OTA_OPT_EXTRA_VERIFY_CRC32
+	stream->crc32 = ota_crc32_update(stream->crc32, data, size);
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_MD5)
+	mbedtls_md5_update(&stream->md5, data, size);
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA1)
+	mbedtls_sha1_update(&stream->sha1, data, size);
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA256)
+	mbedtls_sha256_update(&stream->sha256, data, size);
+#endif
+}
+
+/**
+ * @brief Hash the image data written to flash, except the last
+ *        sizeof(ota_verify_data_t) bytes which may be the verify data
+ */
+static void ota_stream_verify_update(const uint8_t *data, uint32_t size)
+{
+	ota_stream_verify_t *stream = &ota_priv.stream;
+	uint32_t flush, n;
+
+	if (!stream->valid || size == 0)
+		return;
+
+	if (stream->tail_len + size <= sizeof(stream->tail)) {
+		ota_memcpy(stream->tail + stream->tail_len, data, size);
+		stream->tail_len += size;
+		return;
+	}
+
+	/* hash the front of (tail + data), keep the last bytes in tail */
+	flush = stream->tail_len + size - sizeof(stream->tail);
+	n = flush < stream->tail_len ? flush : stream->tail_len;
+	ota_stream_verify_hash(stream->tail, n);
+	ota_stream_verify_hash(data, flush - n);
+
+	memmove(stream->tail, stream->tail + n, stream->tail_len - n);
+	ota_memcpy(stream->tail + stream->tail_len - n, data + flush - n,
+	           size - (flush - n));
+	stream->tail_len = sizeof(stream->tail);
+}
+
+/**
+ * @brief Verify the image by the digest calculated while writing
+ * @return 1 if the image is verified, 0 if need to read back to verify
+ */
+static int ota_stream_verify_image(ota_verify_t verify, uint32_t *value)
+{
+	ota_stream_verify_t *stream = &ota_priv.stream;
+	uint32_t digest[8];
+	uint32_t size;
+
+	if (!stream->valid || ota_verify_readback ||
+	    stream->tail_len != sizeof(stream->tail))
+		return 0;
+	stream->valid = 0; /* digest can be finished only once */
+
+	switch (verify) {
+#if OTA_OPT_EXTRA_VERIFY_CRC32
+	case OTA_VERIFY_CRC32:
+		digest[0] = stream->crc32 ^ 0xffffffff;
+		size = sizeof(uint32_t);
+		break;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_MD5)
+	case OTA_VERIFY_MD5:
+		mbedtls_md5_finish(&stream->md5, (unsigned char *)digest);
+		size = 16;
+		break;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA1)
+	case OTA_VERIFY_SHA1:
+		mbedtls_sha1_finish(&stream->sha1, (unsigned char *)digest);
+		size = 20;
+		break;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA256)
+	case OTA_VERIFY_SHA256:
+		mbedtls_sha256_finish(&stream->sha256, (unsigned char *)digest);
+		size = 32;
+		break;
+#endif
+	default:
+		return 0;
+	}
+
+	OTA_DBG("%s(), verify %d, value[0] %#x, digest[0] %#x\n", __func__,
+	        verify, value[0], digest[0]);
+
+	/* mismatch, read back to make sure it is not a false alarm */
+	return ota_memcmp(value, digest, size) == 0;
+}
+#endif /* OTA_OPT_STREAM_VERIFY */
+
+ota_status_t ota_set_verify_readback(uint8_t enable)
+{
+#if OTA_OPT_STREAM_VERIFY
+	ota_verify_readback = enable;
+#endif
+	return OTA_STATUS_OK;
+}
+
+ota_status_t ota_get_write_stat(ota_write_stat_t *stat)
+{
+#if OTA_OPT_PIPELINE_WRITE
+	ota_writer_get_stat(stat);
+	return OTA_STATUS_OK;
+#else
+	return OTA_STATUS_ERROR;
+#endif
+}
+
+ota_status_t ota_set_delta(uint8_t enable)
+{
+#if OTA_OPT_DELTA
+	ota_delta_enable = enable;
+	ota_skip_size = enable ? 0 : -1; /* no bootloader in the patch */
+	return OTA_STATUS_OK;
+#else
+	return enable ? OTA_STATUS_ERROR : OTA_STATUS_OK;
+#endif
+}
+
+uint8_t ota_get_delta(void)
+{
+#if OTA_OPT_DELTA
+	return ota_delta_enable;
+#else
+	return 0;
+#endif
+}
+
+/* write image data at offset of the update image area */
+static ota_status_t ota_image_write(uint32_t offset, const uint8_t *data, uint32_t size)
+{
+#if OTA_OPT_PIPELINE_WRITE
+	/* the writer appends in order, offset is implied */
+	if (ota_writer_write(data, size) != OTA_STATUS_OK) {
+		return OTA_STATUS_ERROR;
+	}
+#else
+	image_seq_t seq = ota_get_update_seq();
+	const image_ota_param_t *iop = ota_priv.iop;
+
+	if (flash_write(iop->flash[seq], iop->addr[seq] + offset, data, size) != size) {
+		OTA_ERR("write flash fail, flash %u, addr %#x, size %#x\n",
+		        iop->flash[seq], iop->addr[seq] + offset, size);
+		return OTA_STATUS_ERROR;
+	}
+#endif
+	ota_priv.img_size += size;
+#if OTA_OPT_STREAM_VERIFY
+	ota_stream_verify_update(data, size);
+#endif
+	return OTA_STATUS_OK;
+}
+
+static __inline int ota_image_is_delta(void)
+{
+#if OTA_OPT_DELTA
+	return ota_delta_enable;
+#else
+	return 0;
+#endif
+}
+
+/* data after skip, which is a patch in delta mode */
+static ota_status_t ota_image_push(uint32_t offset, const uint8_t *data, uint32_t size)
+{
+#if OTA_OPT_DELTA
+	if (ota_delta_enable) {
+		return ota_delta_write(data, size);
+	}
+#endif
+	return ota_image_write(offset, data, size);
+}
+
+static ota_status_t ota_image_start(image_seq_t seq, uint32_t size)
+{
+	const image_ota_param_t *iop = ota_priv.iop;
+
+	ota_priv.img_size = 0;
+
+#if OTA_OPT_PIPELINE_WRITE
+	if (ota_writer_start(iop->flash[seq], iop->addr[seq], size) != OTA_STATUS_OK) {
+		return OTA_STATUS_ERROR;
+	}
+#else
+	OTA_SYSLOG("OTA: erase flash...\n");
+
+	if (flash_erase(iop->flash[seq], iop->addr[seq], size) != 0) {
+		OTA_ERR("OTA: erase fail\n");
+		return OTA_STATUS_ERROR;
+	}
+#endif
+
+#if OTA_OPT_DELTA
+	if (ota_delta_enable &&
+	    ota_delta_start(iop->flash[iop->running_seq], iop->addr[iop->running_seq],
+	                    IMAGE_AREA_SIZE(iop->img_max_size), size,
+	                    ota_image_write) != OTA_STATUS_OK) {
+#if OTA_OPT_PIPELINE_WRITE
+		ota_writer_stop();
+#endif
+		return OTA_STATUS_ERROR;
+	}
+#endif
+
+#if OTA_OPT_STREAM_VERIFY
+	ota_stream_verify_start();
+#endif
+	return OTA_STATUS_OK;
+}
+
+/* all data is pushed, wait for it to be in flash */
+static ota_status_t ota_image_finish(void)
+{
+	ota_status_t status = OTA_STATUS_OK;
+
+#if OTA_OPT_DELTA
+	if (ota_delta_enable && ota_delta_finish() != OTA_STATUS_OK) {
+		status = OTA_STATUS_ERROR;
+	}
+#endif
+#if OTA_OPT_PIPELINE_WRITE
+	if (ota_writer_finish() != OTA_STATUS_OK) {
+		status = OTA_STATUS_ERROR;
+	}
+#endif
+	return status;
+}
+
+static void ota_image_stop(void)
+{
+#if OTA_OPT_DELTA
+	ota_delta_stop();
+#endif
+#if OTA_OPT_PIPELINE_WRITE
+	ota_writer_stop();
+#endif
+}
+
 ota_status_t ota_init(void)
 {
 	ota_memset(&ota_priv, 0, sizeof(ota_priv));
@@ -134,20 +436,18 @@ static ota_status_t ota_update_image_process(image_seq_t seq, void *url,
 #endif
 	OTA_DBG("%s(), seq %d, flash %u, addr %#x, size %d\n", __func__, seq,
 			flash, addr, img_max_size);
-	OTA_SYSLOG("OTA: erase flash...\n");
 
 	if (ota_cb)
 		ota_cb(OTA_UPGRADE_START, 0, OTA_START_PERCENT);
 
-	if (flash_erase(flash, addr, img_max_size) != 0) {
+	if (ota_image_start(seq, img_max_size) != OTA_STATUS_OK) {
 		return ret;
 	}
 
-	OTA_DBG("%s(), erase flash success\n", __func__);
-
 	ota_buf = ota_malloc(OTA_BUF_SIZE);
 	if (ota_buf == NULL) {
 		OTA_ERR("no mem\n");
+		ota_image_stop();
 		return ret;
 	}
 
@@ -192,11 +492,6 @@ static ota_status_t ota_update_image_process(image_seq_t seq, void *url,
 
 	OTA_DBG("%s(), skip %d success\n", __func__, ota_skip_size);
 
-	if (HAL_Flash_Open(flash, OTA_FLASH_TIMEOUT) != HAL_OK) {
-		OTA_ERR("open flash %u fail\n", flash);
-		goto ota_err;
-	}
-
 	OTA_DBG("image max size %u\n", img_max_size);
 #if OTA_IMG_DATA_CORRUPTION_TEST
 	OTA_SYSLOG("ota img data corruption test start, pls power down the device\n");
@@ -215,7 +510,7 @@ static ota_status_t ota_update_image_process(image_seq_t seq, void *url,
 			img_max_size -= recv_size;
 			ota_priv.get_size += recv_size;
 
-			if (HAL_Flash_Write(flash, addr, ota_buf, recv_size) != HAL_OK) {
+			if (ota_image_push(addr - iop->addr[seq], ota_buf, recv_size) != OTA_STATUS_OK) {
 				OTA_ERR("write flash fail, flash %u, addr %#x, size %#x\n",
 				        flash, addr, recv_size);
 				break;
@@ -247,12 +542,18 @@ static ota_status_t ota_update_image_process(image_seq_t seq, void *url,
 	OTA_SYSLOG("ota img data corruption test end\n");
 #endif
 
-	HAL_Flash_Close(flash);
-
 ota_err:
 	if (ota_buf)
 		ota_free(ota_buf);
 
+	if (ret != OTA_STATUS_OK && img_max_size != 0) {
+		ota_image_stop();
+		return ret;
+	}
+	if (ota_image_finish() != OTA_STATUS_OK) {
+		return OTA_STATUS_ERROR;
+	}
+
 	if (ret != OTA_STATUS_OK) {
 		if (img_max_size == 0) {
 			/* reach max size, but not end, continue trying to check sections */
@@ -377,14 +678,8 @@ ota_status_t ota_push_start(void)
 		ota_cb(OTA_UPGRADE_START, 0, OTA_START_PERCENT);
 
 	OTA_DBG("%s(), seq %d, flash %u, addr %#x\n", __func__, seq, flash, addr);
-	OTA_SYSLOG("OTA: erase flash...\n");
-
-	if (flash_erase(flash, addr, img_max_size) != 0) {
-		OTA_ERR("OTA: erase fail\n");
-		return OTA_STATUS_ERROR;
-	}
 
-	return OTA_STATUS_OK;
+	return ota_image_start(seq, img_max_size);
 }
 
 ota_status_t ota_set_skip_size(int32_t skip_size)
@@ -393,6 +688,11 @@ ota_status_t ota_set_skip_size(int32_t skip_size)
 	return OTA_STATUS_OK;
 }
 
+int32_t ota_get_skip_size(void)
+{
+	return ota_skip_size;
+}
+
 ota_status_t ota_push_data(uint8_t *data, uint32_t size)
 {
 	image_seq_t      seq;
@@ -435,12 +735,17 @@ ota_status_t ota_push_data(uint8_t *data, uint32_t size)
 	}
 
 	/* check remain img size */
-	remain_img_size = img_max_size + ota_skip_size - ota_priv.get_size;
-	if (write_size > remain_img_size) {
-		OTA_ERR("download img size overflow: %u == %u\n",
-		        ota_priv.get_size - ota_skip_size + write_size, img_max_size);
-		status = OTA_STATUS_ERROR;
-		goto out;
+	if (ota_image_is_delta()) {
+		/* the data is a patch, the applied image is bounded by ota_delta */
+		remain_img_size = img_max_size - ota_priv.img_size;
+	} else {
+		remain_img_size = img_max_size + ota_skip_size - ota_priv.get_size;
+		if (write_size > remain_img_size) {
+			OTA_ERR("download img size overflow: %u == %u\n",
+			        ota_priv.get_size - ota_skip_size + write_size, img_max_size);
+			status = OTA_STATUS_ERROR;
+			goto out;
+		}
 	}
 
 	/* write to flash */
@@ -448,7 +753,8 @@ ota_status_t ota_push_data(uint8_t *data, uint32_t size)
 	flash = iop->flash[seq];
 	addr = iop->addr[seq] + ota_priv.get_size - ota_skip_size;
 
-	ret = flash_write(flash, addr, write_data, write_size);
+	if (ota_image_push(ota_priv.get_size - ota_skip_size, write_data, write_size) == OTA_STATUS_OK)
+		ret = write_size;
 	ota_priv.get_size += ret;
 	if (ret != write_size) {
 		OTA_ERR("write flash fail, flash %u, addr %#x, size %#x, ret %#x\n",
@@ -486,6 +792,12 @@ ota_status_t ota_push_finish(void)
 	OTA_SYSLOG("OTA: pushed image size (%#010x = %u KB)\n",
 	    ota_priv.get_size, ota_priv.get_size / 1024);
 
+	if (ota_image_finish() != OTA_STATUS_OK) {
+		OTA_ERR("write image failed\n");
+		status = OTA_STATUS_ERROR;
+		goto out;
+	}
+
 	OTA_SYSLOG("OTA: checking image...\n");
 	seq = ota_get_update_seq();
 	if (image_check_sections(seq) == IMAGE_INVALID) {
@@ -529,6 +841,8 @@ ota_status_t ota_push_stop(void)
 {
 	OTA_SYSLOG("OTA: push stop\n");
 
+	ota_image_stop();
+
 	if (ota_cb)
 		ota_cb(OTA_UPGRADE_STOP, ota_priv.get_size - ota_skip_size, OTA_VERIFY_IMAGE_PERCENT);
 
@@ -631,6 +945,15 @@ ota_status_t ota_get_verify_data(ota_verify_data_t *data)
 		return status;
 	}
 
+#if OTA_OPT_STREAM_VERIFY
+	/* the verify data is kept in the stream tail, no need to read flash */
+	if (ota_priv.stream.valid && ota_priv.stream.tail_len == sizeof(ota_verify_data_t)) {
+		ota_memcpy(data, ota_priv.stream.tail, sizeof(ota_verify_data_t));
+		if (data->ov_magic == OTA_VERIFY_MAGIC)
+			return OTA_STATUS_OK;
+	}
+#endif
+
 	flash = iop->flash[seq];
 	addr = ota_get_verify_data_pos(seq);
 	if (addr == 0) {
@@ -711,6 +1034,17 @@ out:
 	return status;
 }
 
+/* size of the image covered by the verify value */
+static uint32_t ota_verify_image_size(image_seq_t seq)
+{
+#if defined(CONFIG_BOOTLOADER)
+	return ota_get_verify_data_pos(seq) - ota_priv.iop->addr[seq];
+#else
+	/* the image written, which is applied from a patch in delta mode */
+	return ota_priv.img_size - sizeof(ota_verify_data_t);
+#endif
+}
+
 static ota_status_t ota_verify_image_append(image_seq_t seq,
                                             ota_verify_append_t append,
                                             void *hdl)
@@ -721,11 +1055,7 @@ static ota_status_t ota_verify_image_append(image_seq_t seq,
 
 	OTA_DBG("%s(), seq %d\n", __func__, seq);
 
-#if defined(CONFIG_BOOTLOADER)
-	size = ota_get_verify_data_pos(seq) - iop->addr[seq];
-#else
-	size = ota->get_size - ota_skip_size - sizeof(ota_verify_data_t);
-#endif
+	size = ota_verify_image_size(seq);
 
 	//If there is no verify data in new image, we will use OTA_VERIFY_NONE to verify it.
 	//In this case, the size will not be use.
@@ -753,7 +1083,7 @@ static ota_status_t ota_verify_image_crc32(image_seq_t seq, uint32_t *value)
 	CE_CRC_Handler hdl;
 	uint32_t crc;
 
-	if (HAL_CRC_Init(&hdl, CE_CRC32, ota_priv.get_size) != HAL_OK) {
+	if (HAL_CRC_Init(&hdl, CE_CRC32, ota_verify_image_size(seq)) != HAL_OK) {
 		OTA_ERR("CRC init failed\n");
 		return OTA_STATUS_ERROR;
 	}
@@ -909,6 +1239,22 @@ ota_status_t ota_verify_image(ota_verify_t verify, uint32_t *value)
 
 	OTA_DBG("%s(), verify %d, size %#x\n", __func__, verify, ota_priv.get_size);
 
+#ifndef CONFIG_BOOTLOADER
+	/* the verify value covers the image without its verify data */
+	if ((verify != OTA_VERIFY_NONE) &&
+	    (ota_priv.img_size < sizeof(ota_verify_data_t))) {
+		OTA_ERR("image too small, img_size %#x\n", ota_priv.img_size);
+		return OTA_STATUS_ERROR;
+	}
+#endif
+
+#if (OTA_OPT_STREAM_VERIFY && !defined(CONFIG_BOOTLOADER))
+	if (verify != OTA_VERIFY_NONE && ota_stream_verify_image(verify, value)) {
+		status = OTA_STATUS_OK;
+		goto verify_done;
+	}
+#endif
+
 	switch (verify) {
 	case OTA_VERIFY_NONE:
 		status = ota_verify_image_none(seq, value);
@@ -942,6 +1288,9 @@ ota_status_t ota_verify_image(ota_verify_t verify, uint32_t *value)
 		OTA_ERR("verify fail, status %d, verify %d\n", status, verify);
 		goto verify_err;
 	}
+#if (OTA_OPT_STREAM_VERIFY && !defined(CONFIG_BOOTLOADER))
+verify_done:
+#endif
 #if defined(CONFIG_OTA_POLICY_IMAGE_COMPRESSION)
 	cfg.seq = ota_get_update_seq();
 	cfg.state = IMAGE_STATE_VERIFIED;
@@ -981,5 +1330,8 @@ verify_err:
 void ota_reboot(void)
 {
 	OTA_DBG("OTA reboot.\n");
+#ifdef CONFIG_LIBC_STDIO_ASYNC
+	stdio_async_flush(500);
+#endif
 	HAL_WDG_Reboot();
 }
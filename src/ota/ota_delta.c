@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ota_i.h"
+#include "ota_debug.h"
+#include "ota_delta.h"
+#include "image/flash.h"
+#include "xz/xz.h"
+
+#if OTA_OPT_DELTA
+
+#define OTA_DELTA_BUF_SIZE      (1024)
+
+typedef enum {
+	OTA_DELTA_STATE_HEADER,
+	OTA_DELTA_STATE_CTRL,
+	OTA_DELTA_STATE_ADD,
+	OTA_DELTA_STATE_EXTRA,
+	OTA_DELTA_STATE_END,
+} ota_delta_state_t;
+
+typedef struct {
+	struct xz_dec       *xz;
+	uint8_t              stream_end;
+	ota_delta_state_t    state;
+	ota_delta_output_t   output;
+
+	uint32_t             old_flash;
+	uint32_t             old_addr;
+	uint32_t             old_max_size;
+	uint32_t             new_max_size;
+
+	ota_delta_header_t   header;
+	ota_delta_ctrl_t     ctrl;
+	uint32_t             field_len;  /* bytes of header/ctrl received */
+	uint32_t             len;        /* bytes left in add/extra */
+	uint32_t             old_pos;
+	uint32_t             new_pos;
+	uint32_t             new_crc32;
+
+	uint8_t              out[OTA_DELTA_BUF_SIZE];   /* decoded patch */
+	uint8_t              old[OTA_DELTA_BUF_SIZE];   /* old image */
+} ota_delta_t;
+
+static ota_delta_t *ota_delta;
+
+static int ota_delta_check_old(ota_delta_t *d)
+{
+	uint32_t crc = 0;
+	uint32_t pos = 0;
+	uint32_t size;
+
+	while (pos < d->header.old_size) {
+		size = d->header.old_size - pos;
+		if (size > OTA_DELTA_BUF_SIZE)
+			size = OTA_DELTA_BUF_SIZE;
+		if (flash_read(d->old_flash, d->old_addr + pos, d->old, size) != size) {
+			OTA_ERR("read flash fail, flash %u, addr %#x\n",
+			        d->old_flash, d->old_addr + pos);
+			return -1;
+		}
+		crc = xz_crc32(d->old, size, crc);
+		pos += size;
+	}
+
+	if (crc != d->header.old_crc32) {
+		OTA_ERR("patch is not for the running image, crc %#x != %#x\n",
+		        crc, d->header.old_crc32);
+		return -1;
+	}
+	return 0;
+}
+
+static int ota_delta_parse_header(ota_delta_t *d)
+{
+	ota_delta_header_t *h = &d->header;
+
+	if (h->magic != OTA_DELTA_MAGIC || h->version != OTA_DELTA_VERSION) {
+		OTA_ERR("bad patch, magic %#x, version %u\n", h->magic, h->version);
+		return -1;
+	}
+	if (h->old_size > d->old_max_size || h->new_size > d->new_max_size) {
+		OTA_ERR("bad patch, old size %u, new size %u\n", h->old_size, h->new_size);
+		return -1;
+	}
+	OTA_DBG("%s(), old size %u, new size %u\n", __func__, h->old_size, h->new_size);
+
+	if (ota_delta_check_old(d) != 0)
+		return -1;
+
+	d->state = h->new_size ? OTA_DELTA_STATE_CTRL : OTA_DELTA_STATE_END;
+	return 0;
+}
+
+static int ota_delta_parse_ctrl(ota_delta_t *d)
+{
+	ota_delta_ctrl_t *c = &d->ctrl;
+
+	if (c->add_len > d->header.new_size - d->new_pos ||
+	    c->extra_len > d->header.new_size - d->new_pos - c->add_len ||
+	    c->add_len > d->header.old_size - d->old_pos) {
+		OTA_ERR("bad ctrl, add %u, extra %u, new pos %u, old pos %u\n",
+		        c->add_len, c->extra_len, d->new_pos, d->old_pos);
+		return -1;
+	}
+	d->len = c->add_len;
+	d->state = OTA_DELTA_STATE_ADD;
+	return 0;
+}
+
+static int ota_delta_output(ota_delta_t *d, const uint8_t *data, uint32_t size)
+{
+	if (d->output(d->new_pos, data, size) != OTA_STATUS_OK)
+		return -1;
+	d->new_crc32 = xz_crc32(data, size, d->new_crc32);
+	d->new_pos += size;
+	return 0;
+}
+
+/* block is done, seek the old image */
+static int ota_delta_next(ota_delta_t *d)
+{
+	int64_t pos = (int64_t)d->old_pos + d->ctrl.seek;
+
+	if (pos < 0 || pos > d->header.old_size) {
+		OTA_ERR("bad seek %d, old pos %u\n", d->ctrl.seek, d->old_pos);
+		return -1;
+	}
+	d->old_pos = (uint32_t)pos;
+	d->state = (d->new_pos == d->header.new_size) ?
+	           OTA_DELTA_STATE_END : OTA_DELTA_STATE_CTRL;
+	return 0;
+}
+
+/* apply the decoded patch */
+static int ota_delta_process(ota_delta_t *d, const uint8_t *data, uint32_t size)
+{
+	uint8_t *field;
+	uint32_t field_size;
+	uint32_t len;
+	uint32_t i;
+
+	while (size > 0) {
+		switch (d->state) {
+		case OTA_DELTA_STATE_HEADER:
+		case OTA_DELTA_STATE_CTRL:
+			if (d->state == OTA_DELTA_STATE_HEADER) {
+				field = (uint8_t *)&d->header;
+				field_size = sizeof(ota_delta_header_t);
+			} else {
+				field = (uint8_t *)&d->ctrl;
+				field_size = sizeof(ota_delta_ctrl_t);
+			}
+			len = field_size - d->field_len;
+			if (len > size)
+				len = size;
+			ota_memcpy(field + d->field_len, data, len);
+			d->field_len += len;
+			if (d->field_len == field_size) {
+				d->field_len = 0;
+				if (d->state == OTA_DELTA_STATE_HEADER) {
+					if (ota_delta_parse_header(d) != 0)
+						return -1;
+				} else if (ota_delta_parse_ctrl(d) != 0) {
+					return -1;
+				}
+			}
+			break;
+		case OTA_DELTA_STATE_ADD:
+			len = d->len;
+			if (len > size)
+				len = size;
+			if (len > OTA_DELTA_BUF_SIZE)
+				len = OTA_DELTA_BUF_SIZE;
+			if (len > 0) {
+				if (flash_read(d->old_flash, d->old_addr + d->old_pos,
+				               d->old, len) != len) {
+					OTA_ERR("read flash fail, flash %u, addr %#x\n",
+					        d->old_flash, d->old_addr + d->old_pos);
+					return -1;
+				}
+				for (i = 0; i < len; ++i)
+					d->old[i] += data[i];
+				if (ota_delta_output(d, d->old, len) != 0)
+					return -1;
+				d->old_pos += len;
+				d->len -= len;
+			}
+			if (d->len == 0) {
+				d->len = d->ctrl.extra_len;
+				d->state = OTA_DELTA_STATE_EXTRA;
+			}
+			break;
+		case OTA_DELTA_STATE_EXTRA:
+			len = d->len;
+			if (len > size)
+				len = size;
+			if (len > 0) {
+				if (ota_delta_output(d, data, len) != 0)
+					return -1;
+				d->len -= len;
+			}
+			if (d->len == 0 && ota_delta_next(d) != 0)
+				return -1;
+			break;
+		default:
+			OTA_ERR("data after the end of patch, size %u\n", size);
+			return -1;
+		}
+		data += len;
+		size -= len;
+	}
+
+	/* empty blocks are done without data */
+	while ((d->state == OTA_DELTA_STATE_ADD && d->ctrl.add_len == 0) ||
+	       (d->state == OTA_DELTA_STATE_EXTRA && d->len == 0)) {
+		if (d->state == OTA_DELTA_STATE_ADD) {
+			d->len = d->ctrl.extra_len;
+			d->state = OTA_DELTA_STATE_EXTRA;
+		} else if (ota_delta_next(d) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Start applying a patch against the old image [old_addr, +old_max_size)
+ * @note The new image is passed to output, from offset 0 in order.
+ */
+ota_status_t ota_delta_start(uint32_t old_flash, uint32_t old_addr, uint32_t old_max_size,
+                             uint32_t new_max_size, ota_delta_output_t output)
+{
+	ota_delta_t *d;
+
+	ota_delta_stop();
+
+	d = ota_malloc(sizeof(ota_delta_t));
+	if (d == NULL) {
+		OTA_ERR("no mem\n");
+		return OTA_STATUS_ERROR;
+	}
+	ota_memset(d, 0, sizeof(ota_delta_t));
+
+	d->xz = xz_dec_init(XZ_DYNALLOC, OTA_DELTA_DICT_MAX);
+	if (d->xz == NULL) {
+		OTA_ERR("no mem\n");
+		ota_free(d);
+		return OTA_STATUS_ERROR;
+	}
+	d->state = OTA_DELTA_STATE_HEADER;
+	d->output = output;
+	d->old_flash = old_flash;
+	d->old_addr = old_addr;
+	d->old_max_size = old_max_size;
+	d->new_max_size = new_max_size;
+
+	ota_delta = d;
+	return OTA_STATUS_OK;
+}
+
+/**
+ * @brief Feed the patch (xz stream) in order
+ */
+ota_status_t ota_delta_write(const uint8_t *data, uint32_t size)
+{
+	ota_delta_t *d = ota_delta;
+	struct xz_buf b;
+	enum xz_ret xzret;
+	int full;
+
+	if (d == NULL)
+		return OTA_STATUS_ERROR;
+
+	if (d->stream_end) {
+		OTA_ERR("data after the end of xz stream, size %u\n", size);
+		return OTA_STATUS_ERROR;
+	}
+
+	b.in = data;
+	b.in_pos = 0;
+	b.in_size = size;
+	b.out = d->out;
+	b.out_pos = 0;
+	b.out_size = OTA_DELTA_BUF_SIZE;
+
+	do {
+		xzret = xz_dec_run(d->xz, &b);
+		full = (b.out_pos == b.out_size);
+		if (b.out_pos > 0 && ota_delta_process(d, d->out, b.out_pos) != 0)
+			return OTA_STATUS_ERROR;
+		b.out_pos = 0;
+
+		if (xzret == XZ_STREAM_END) {
+			d->stream_end = 1;
+			if (b.in_pos != b.in_size) {
+				OTA_ERR("data after the end of xz stream, size %u\n",
+				        (uint32_t)(b.in_size - b.in_pos));
+				return OTA_STATUS_ERROR;
+			}
+			break;
+		} else if (xzret != XZ_OK) {
+			OTA_ERR("xz_dec_run() fail %d\n", xzret);
+			return OTA_STATUS_ERROR;
+		}
+	} while (b.in_pos < b.in_size || full);
+
+	return OTA_STATUS_OK;
+}
+
+/**
+ * @brief Check the whole patch is applied, and free the resources
+ */
+ota_status_t ota_delta_finish(void)
+{
+	ota_delta_t *d = ota_delta;
+	ota_status_t status = OTA_STATUS_ERROR;
+
+	if (d == NULL)
+		return status;
+
+	if (!d->stream_end || d->state != OTA_DELTA_STATE_END) {
+		OTA_ERR("patch is not complete, state %d, new pos %u\n",
+		        d->state, d->new_pos);
+	} else if (d->new_crc32 != d->header.new_crc32) {
+		OTA_ERR("new image crc %#x != %#x\n", d->new_crc32, d->header.new_crc32);
+	} else {
+		OTA_DBG("%s(), new image size %u\n", __func__, d->new_pos);
+		status = OTA_STATUS_OK;
+	}
+
+	ota_delta_stop();
+	return status;
+}
+
+void ota_delta_stop(void)
+{
+	ota_delta_t *d = ota_delta;
+
+	if (d == NULL)
+		return;
+
+	ota_delta = NULL;
+	xz_dec_end(d->xz);
+	ota_free(d);
+}
+
+#endif /* OTA_OPT_DELTA */
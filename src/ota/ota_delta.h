@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _OTA_DELTA_H_
+#define _OTA_DELTA_H_
+
+#include "ota/ota.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if OTA_OPT_DELTA
+/*
+ * Delta image, generated by tools/ota_delta.py. The whole patch is one xz
+ * stream (CRC32 check, LZMA2 dictionary <= OTA_DELTA_DICT_MAX). Decoded,
+ * it is a header followed by blocks, all fields are little endian:
+ *
+ *   ota_delta_header_t
+ *   { ota_delta_ctrl_t, diff[add_len], extra[extra_len] } ...
+ *
+ * For each block, new[i] = old[old_pos + i] + diff[i] for add_len bytes,
+ * then extra[] is copied as is, then old_pos moves by add_len + seek.
+ * The old image is the running image without bootloader, which is also
+ * what is written to the update image area.
+ */
+#define OTA_DELTA_MAGIC         (0x544C4458) /* XDLT */
+#define OTA_DELTA_VERSION       (1)
+#define OTA_DELTA_DICT_MAX      (32 * 1024)
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t old_size;      /* size of the old image used by the patch */
+	uint32_t old_crc32;
+	uint32_t new_size;
+	uint32_t new_crc32;
+} ota_delta_header_t;
+
+typedef struct {
+	uint32_t add_len;
+	uint32_t extra_len;
+	int32_t  seek;
+} ota_delta_ctrl_t;
+
+/* write new image data at offset of the update image area */
+typedef ota_status_t (*ota_delta_output_t)(uint32_t offset, const uint8_t *data, uint32_t size);
+
+ota_status_t ota_delta_start(uint32_t old_flash, uint32_t old_addr, uint32_t old_max_size,
+                             uint32_t new_max_size, ota_delta_output_t output);
+ota_status_t ota_delta_write(const uint8_t *data, uint32_t size);
+ota_status_t ota_delta_finish(void);
+void ota_delta_stop(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OTA_DELTA_H_ */
@@ -49,9 +49,47 @@ extern "C" {
 #define OTA_BUF_SIZE                (2 << 10)
 #define OTA_FLASH_TIMEOUT           (5000)
 
+#if (OTA_OPT_STREAM_VERIFY && defined(CONFIG_WLAN))
+#define OTA_STREAM_VERIFY_DIGEST    1 /* md5/sha by mbedtls, only linked with wlan */
+#include "mbedtls/md5.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#else
+#define OTA_STREAM_VERIFY_DIGEST    0
+#endif
+
+#if OTA_OPT_STREAM_VERIFY
+/*
+ * The verify data is appended to the end of image, so the last
+ * sizeof(ota_verify_data_t) bytes are held back and only hashed when more
+ * data comes. At the end, tail holds the verify data.
+ */
+typedef struct {
+	uint8_t                  valid;
+	uint32_t                 tail_len;
+	uint8_t                  tail[sizeof(ota_verify_data_t)];
+#if OTA_OPT_EXTRA_VERIFY_CRC32
+	uint32_t                 crc32;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_MD5)
+	mbedtls_md5_context      md5;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA1)
+	mbedtls_sha1_context     sha1;
+#endif
+#if (OTA_STREAM_VERIFY_DIGEST && OTA_OPT_EXTRA_VERIFY_SHA256)
+	mbedtls_sha256_context   sha256;
+#endif
+} ota_stream_verify_t;
+#endif
+
 typedef struct {
 	const image_ota_param_t *iop;
 	uint32_t                 get_size;
+	uint32_t                 img_size;    /* written to the update image area */
+#if OTA_OPT_STREAM_VERIFY
+	ota_stream_verify_t      stream;
+#endif
 } ota_priv_t;
 
 typedef ota_status_t (*ota_update_init_t)(void *url);
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2017 XRADIO TECHNOLOGY CO., LTD. All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the
+ *       distribution.
+ *    3. Neither the name of XRADIO TECHNOLOGY CO., LTD. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ota_i.h"
+#include "ota_debug.h"
+#include "ota_writer.h"
+#include "image/flash.h"
+#include "kernel/os/os.h"
+
+#if OTA_OPT_PIPELINE_WRITE
+
+/*
+ * The download fills sector sized buffers, and a writer thread erases and
+ * programs the full ones. Flash is erased OTA_WRITER_ERASE_SIZE ahead of the
+ * programming address, so most erases run while the download is receiving.
+ */
+#define OTA_WRITER_SECTOR_SIZE      (4 * 1024)
+#define OTA_WRITER_BUF_NUM          (2)
+#define OTA_WRITER_ERASE_SIZE       (32 * 1024)
+
+#define OTA_WRITER_THREAD_STACK_SIZE    (1 * 1024)
+#define OTA_WRITER_THREAD_PRIO          OS_THREAD_PRIO_APP
+
+typedef struct {
+	uint32_t        addr;
+	uint32_t        len;
+	uint8_t        *data;
+} ota_writer_buf_t;
+
+typedef struct {
+	uint32_t            flash;
+	uint32_t            addr;       /* address of the next byte to fill */
+	uint32_t            end;        /* end of the image area */
+	uint32_t            erase_end;  /* erased up to, used by writer only */
+	uint32_t            start_tick;
+	volatile uint8_t    error;
+	ota_writer_buf_t   *cur;        /* buffer being filled */
+	OS_Queue_t          free_queue;
+	OS_Queue_t          full_queue;
+	OS_Semaphore_t      exit_sem;
+	OS_Thread_t         thread;
+	ota_writer_buf_t    buf[OTA_WRITER_BUF_NUM];
+} ota_writer_t;
+
+static ota_writer_t *ota_writer;
+static ota_write_stat_t ota_writer_stat;
+
+static int ota_writer_erase(ota_writer_t *w, uint32_t end)
+{
+	uint32_t size;
+	OS_Time_t tick;
+
+	if (end > w->end)
+		end = w->end;
+
+	while (w->erase_end < end) {
+		size = w->end - w->erase_end;
+		if (size > OTA_WRITER_ERASE_SIZE)
+			size = OTA_WRITER_ERASE_SIZE;
+
+		tick = OS_GetTicks();
+		if (flash_erase(w->flash, w->erase_end, size) != 0) {
+			OTA_ERR("erase fail, flash %u, addr %#x, size %#x\n",
+			        w->flash, w->erase_end, size);
+			return -1;
+		}
+		ota_writer_stat.erase_ms += OS_TicksToMSecs(OS_GetTicks() - tick);
+		w->erase_end += size;
+	}
+	return 0;
+}
+
+static int ota_writer_program(ota_writer_t *w, ota_writer_buf_t *buf)
+{
+	OS_Time_t tick;
+
+	if (ota_writer_erase(w, buf->addr + buf->len) != 0)
+		return -1;
+
+	tick = OS_GetTicks();
+	if (flash_write(w->flash, buf->addr, buf->data, buf->len) != buf->len) {
+		OTA_ERR("write flash fail, flash %u, addr %#x, size %#x\n",
+		        w->flash, buf->addr, buf->len);
+		return -1;
+	}
+	ota_writer_stat.program_ms += OS_TicksToMSecs(OS_GetTicks() - tick);
+	ota_writer_stat.write_size += buf->len;
+	return 0;
+}
+
+static void ota_writer_task(void *arg)
+{
+	ota_writer_t *w = arg;
+	ota_writer_buf_t *buf;
+	OS_Time_t tick;
+	uint32_t next;
+
+	while (1) {
+		tick = OS_GetTicks();
+		if (OS_MsgQueueReceive(&w->full_queue, (void **)&buf,
+		                       OS_WAIT_FOREVER) != OS_OK) {
+			continue;
+		}
+		ota_writer_stat.network_stall_ms += OS_TicksToMSecs(OS_GetTicks() - tick);
+		if (buf == NULL)
+			break; /* quit */
+
+		if (!w->error && ota_writer_program(w, buf) != 0)
+			w->error = 1;
+		next = buf->addr + buf->len;
+		OS_MsgQueueSend(&w->free_queue, buf, OS_WAIT_FOREVER);
+
+		/* keep one erase block ahead, while the next buffer is filling */
+		if (!w->error && w->erase_end < next + OTA_WRITER_SECTOR_SIZE &&
+		    ota_writer_erase(w, next + OTA_WRITER_ERASE_SIZE) != 0) {
+			w->error = 1;
+		}
+	}
+
+	OS_SemaphoreRelease(&w->exit_sem);
+	OS_ThreadDelete(NULL);
+}
+
+/* stop the writer thread and free the writer, return the error flag */
+static int ota_writer_destroy(ota_writer_t *w)
+{
+	int error;
+
+	if (OS_ThreadIsValid(&w->thread)) {
+		while (OS_MsgQueueSend(&w->full_queue, NULL, OS_WAIT_FOREVER) != OS_OK)
+			;
+		OS_SemaphoreWait(&w->exit_sem, OS_WAIT_FOREVER);
+	}
+	if (OS_SemaphoreIsValid(&w->exit_sem))
+		OS_SemaphoreDelete(&w->exit_sem);
+	if (OS_QueueIsValid(&w->full_queue))
+		OS_MsgQueueDelete(&w->full_queue);
+	if (OS_QueueIsValid(&w->free_queue))
+		OS_MsgQueueDelete(&w->free_queue);
+	if (w->buf[0].data)
+		ota_free(w->buf[0].data);
+	ota_writer_stat.total_ms = OS_TicksToMSecs(OS_GetTicks() - w->start_tick);
+	error = w->error;
+	ota_free(w);
+	return error;
+}
+
+/**
+ * @brief Start writing an image to flash [addr, addr + size)
+ * @note The area is erased on the way, so only the written part is erased.
+ */
+ota_status_t ota_writer_start(uint32_t flash, uint32_t addr, uint32_t size)
+{
+	ota_writer_t *w;
+	uint8_t *data;
+	int i;
+
+	ota_writer_stop();
+	ota_memset(&ota_writer_stat, 0, sizeof(ota_writer_stat));
+
+	w = ota_malloc(sizeof(ota_writer_t));
+	if (w == NULL) {
+		OTA_ERR("no mem\n");
+		return OTA_STATUS_ERROR;
+	}
+	ota_memset(w, 0, sizeof(ota_writer_t));
+	w->flash = flash;
+	w->addr = addr;
+	w->end = addr + size;
+	w->erase_end = addr;
+	w->start_tick = OS_GetTicks();
+
+	data = ota_malloc(OTA_WRITER_SECTOR_SIZE * OTA_WRITER_BUF_NUM);
+	if (data == NULL) {
+		OTA_ERR("no mem\n");
+		goto err;
+	}
+	if (OS_MsgQueueCreate(&w->free_queue, OTA_WRITER_BUF_NUM) != OS_OK ||
+	    OS_MsgQueueCreate(&w->full_queue, OTA_WRITER_BUF_NUM + 1) != OS_OK ||
+	    OS_SemaphoreCreate(&w->exit_sem, 0, 1) != OS_OK) {
+		OTA_ERR("create queue fail\n");
+		goto err;
+	}
+	for (i = 0; i < OTA_WRITER_BUF_NUM; ++i) {
+		w->buf[i].data = data + i * OTA_WRITER_SECTOR_SIZE;
+		OS_MsgQueueSend(&w->free_queue, &w->buf[i], 0);
+	}
+	data = NULL;
+
+	if (OS_ThreadCreate(&w->thread,
+	                    "ota_writer",
+	                    ota_writer_task,
+	                    w,
+	                    OTA_WRITER_THREAD_PRIO,
+	                    OTA_WRITER_THREAD_STACK_SIZE) != OS_OK) {
+		OTA_ERR("create thread fail\n");
+		goto err;
+	}
+
+	ota_writer = w;
+	return OTA_STATUS_OK;
+
+err:
+	if (data)
+		ota_free(data);
+	ota_writer_destroy(w);
+	return OTA_STATUS_ERROR;
+}
+
+/**
+ * @brief Append data to the image, blocks only if all buffers are in flash
+ */
+ota_status_t ota_writer_write(const uint8_t *data, uint32_t size)
+{
+	ota_writer_t *w = ota_writer;
+	ota_writer_buf_t *buf;
+	OS_Time_t tick;
+	uint32_t cap;
+	uint32_t len;
+
+	if (w == NULL || w->error)
+		return OTA_STATUS_ERROR;
+
+	if (size > w->end - w->addr) {
+		OTA_ERR("write overflow, addr %#x, size %#x\n", w->addr, size);
+		return OTA_STATUS_ERROR;
+	}
+
+	while (size > 0) {
+		buf = w->cur;
+		if (buf == NULL) {
+			tick = OS_GetTicks();
+			if (OS_MsgQueueReceive(&w->free_queue, (void **)&buf,
+			                       OS_WAIT_FOREVER) != OS_OK) {
+				return OTA_STATUS_ERROR;
+			}
+			ota_writer_stat.flash_stall_ms += OS_TicksToMSecs(OS_GetTicks() - tick);
+			if (w->error) {
+				OS_MsgQueueSend(&w->free_queue, buf, 0);
+				return OTA_STATUS_ERROR;
+			}
+			buf->addr = w->addr;
+			buf->len = 0;
+			w->cur = buf;
+		}
+
+		/* never let a buffer cross a sector boundary */
+		cap = OTA_WRITER_SECTOR_SIZE - (buf->addr & (OTA_WRITER_SECTOR_SIZE - 1));
+		len = cap - buf->len;
+		if (len > size)
+			len = size;
+		ota_memcpy(buf->data + buf->len, data, len);
+		buf->len += len;
+		w->addr += len;
+		data += len;
+		size -= len;
+
+		if (buf->len == cap) {
+			w->cur = NULL;
+			OS_MsgQueueSend(&w->full_queue, buf, OS_WAIT_FOREVER);
+		}
+	}
+
+	return OTA_STATUS_OK;
+}
+
+/**
+ * @brief Flush the buffered data and wait for the writer to finish
+ */
+ota_status_t ota_writer_finish(void)
+{
+	ota_writer_t *w = ota_writer;
+	ota_status_t status = OTA_STATUS_OK;
+
+	if (w == NULL)
+		return OTA_STATUS_ERROR;
+
+	if (w->cur && w->cur->len > 0) {
+		OS_MsgQueueSend(&w->full_queue, w->cur, OS_WAIT_FOREVER);
+		w->cur = NULL;
+	}
+
+	ota_writer = NULL;
+	/* the writer drains the queue before quit */
+	if (ota_writer_destroy(w) != 0)
+		status = OTA_STATUS_ERROR;
+
+	OTA_DBG("%s(), write %u bytes in %u ms, erase %u ms, program %u ms, "
+	        "flash stall %u ms, network stall %u ms\n", __func__,
+	        ota_writer_stat.write_size, ota_writer_stat.total_ms,
+	        ota_writer_stat.erase_ms, ota_writer_stat.program_ms,
+	        ota_writer_stat.flash_stall_ms, ota_writer_stat.network_stall_ms);
+	return status;
+}
+
+/**
+ * @brief Abort writing, the buffered data is dropped
+ */
+void ota_writer_stop(void)
+{
+	ota_writer_t *w = ota_writer;
+
+	if (w == NULL)
+		return;
+
+	ota_writer = NULL;
+	w->error = 1;
+	ota_writer_destroy(w);
+}
+
+void ota_writer_get_stat(ota_write_stat_t *stat)
+{
+	ota_memcpy(stat, &ota_writer_stat, sizeof(ota_write_stat_t));
+}
+
+#endif /* OTA_OPT_PIPELINE_WRITE */
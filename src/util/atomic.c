@@ -31,9 +31,71 @@
 #include "sys/interrupt.h"
 #include "util/atomic.h"
 
-#define ENTER_CRITICAL() arch_irq_disable()
+#if defined(__GNUC__)
 
-#define EXIT_CRITICAL() arch_irq_enable()
+/*
+ * The GCC atomic builtins are LDREX/STREX loops on Cortex-M3/M4/M33, they
+ * leave IRQ enabled. Sequentially consistent as the critical sections were.
+ */
+
+int arch_atomic_add_return(int *v, int i)
+{
+	return __atomic_add_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_sub_return(int *v, int i)
+{
+	return __atomic_sub_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_and_return(int *v, int i)
+{
+	return __atomic_and_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_or_return(int *v, int i)
+{
+	return __atomic_or_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_xor_return(int *v, int i)
+{
+	return __atomic_xor_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_nand_return(int *v, int i)
+{
+	return __atomic_nand_fetch(v, i, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_cmpxchg(int *v, int old, int new_v)
+{
+	/* old is updated to the current value on failure */
+	__atomic_compare_exchange_n(v, &old, new_v, 0, __ATOMIC_SEQ_CST,
+	                            __ATOMIC_SEQ_CST);
+	return old;
+}
+
+void arch_atomic_clear_mask(uint32_t *addr, uint32_t mask)
+{
+	__atomic_fetch_and(addr, ~mask, __ATOMIC_SEQ_CST);
+}
+
+void arch_atomic_set_mask(uint32_t *addr, uint32_t mask)
+{
+	__atomic_fetch_or(addr, mask, __ATOMIC_SEQ_CST);
+}
+
+int arch_atomic_xchg(int *v, int i)
+{
+	return __atomic_exchange_n(v, i, __ATOMIC_SEQ_CST);
+}
+
+#else /* __GNUC__ */
+
+#define ENTER_CRITICAL() unsigned long flags = arch_irq_save()
+
+#define EXIT_CRITICAL() arch_irq_restore(flags)
 
 
 int arch_atomic_add_return(int *v, int i)
@@ -148,3 +210,5 @@ int arch_atomic_xchg(int *v, int i)
 
 	return val;
 }
+
+#endif /* __GNUC__ */
@@ -17,16 +17,19 @@
  ******************************************************************************/
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "util/btsnoop.h"
 #include <sys/time.h>
 #include "kernel/os/os.h"
 #include "util/save_log_by_uart.h"
+#ifdef CONFIG_FILESYSTEMS
+#include "fs/vfs.h"
+#endif
 
 //#define HCILOG_UART_ID UART0_ID
 
 // Epoch in microseconds since 01/01/0000.
 static const uint64_t BTSNOOP_EPOCH_DELTA = 0x00dcddb30f2f8000ULL;
-static OS_Mutex_t lock;
 
 #ifndef CPU_LITTLE_ENDIAN
 #define CPU_LITTLE_ENDIAN
@@ -120,7 +123,91 @@ typedef enum {
 	kEventPacket = 4
 } packet_type_t;
 
-static void btsnoop_write_packet(uint8_t type, const uint8_t *packet, bool is_received)
+/*
+ * Packets are captured into a ring of complete records without any lock: a
+ * producer reserves its record by a CAS on the head, fills it and sets the
+ * commit flag of its header at last. The btsnoop thread writes the committed
+ * records to the sink in order, clears them and moves the tail. A record is
+ * never split at the end of the ring, a padding record fills the end instead.
+ * A packet which does not fit is dropped and counted in dropped_packets.
+ */
+#define BTSNOOP_RING_SIZE           (16 * 1024) /* power of 2 */
+#define BTSNOOP_RING_MASK           (BTSNOOP_RING_SIZE - 1)
+#define BTSNOOP_THREAD_STACK_SIZE   (2 * 1024)
+#define BTSNOOP_THREAD_PRIO         OS_PRIORITY_LOW
+
+/*
+ * record header: size of the record (header included), length of the data
+ * written to the sink, padding and commit flags
+ */
+#define BTSNOOP_REC_SIZE(h)         ((h) & 0xFFFF)
+#define BTSNOOP_REC_LEN(h)          (((h) >> 16) & 0x3FFF)
+#define BTSNOOP_REC_HDR(size, len)  ((size) | ((uint32_t)(len) << 16))
+#define BTSNOOP_REC_PAD             (1U << 30)
+#define BTSNOOP_REC_COMMIT          (1U << 31)
+#define BTSNOOP_REC_ALIGN(n)        (((n) + 3) & ~3U)
+
+/* btsnoop file, datalink type "HCI UART (H4)" */
+#define BTSNOOP_FILE_VERSION        1
+#define BTSNOOP_FILE_DATALINK       1002
+
+typedef enum {
+	BTSNOOP_SINK_NONE = 0,
+	BTSNOOP_SINK_UART,
+	BTSNOOP_SINK_FILE,
+} btsnoop_sink_t;
+
+static struct {
+	uint32_t head;          /* reserved by producers, free running */
+	uint32_t tail;          /* released by the btsnoop thread, free running */
+	uint32_t waiting;       /* btsnoop thread is waiting for records */
+	uint32_t dropped_packets;
+	uint32_t packets;
+	uint32_t writers;       /* producers in btsnoop_write_packet() */
+	volatile uint8_t sink;  /* kept until the btsnoop thread exits */
+	volatile uint8_t accepting; /* producers may capture */
+	volatile uint8_t stop;
+	uint32_t *buf;
+	OS_Semaphore_t sem;
+	OS_Thread_t thread;
+#ifdef CONFIG_FILESYSTEMS
+	vfs_file_t *file;
+#endif
+} s_btsnoop;
+
+static uint32_t *btsnoop_reserve(uint32_t size)
+{
+	uint32_t head, pos, pad;
+
+	head = __atomic_load_n(&s_btsnoop.head, __ATOMIC_RELAXED);
+	do {
+		pos = head & BTSNOOP_RING_MASK;
+		pad = (pos + size > BTSNOOP_RING_SIZE) ? BTSNOOP_RING_SIZE - pos : 0;
+		if (head + pad + size - __atomic_load_n(&s_btsnoop.tail, __ATOMIC_ACQUIRE)
+		    > BTSNOOP_RING_SIZE) {
+			return NULL;
+		}
+	} while (!__atomic_compare_exchange_n(&s_btsnoop.head, &head, head + pad + size,
+	                                      1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	if (pad) {
+		__atomic_store_n(&s_btsnoop.buf[pos / 4],
+		                 pad | BTSNOOP_REC_PAD | BTSNOOP_REC_COMMIT, __ATOMIC_RELEASE);
+	}
+	return &s_btsnoop.buf[((head + pad) & BTSNOOP_RING_MASK) / 4];
+}
+
+static void btsnoop_commit(uint32_t *rec, uint32_t hdr)
+{
+	__atomic_store_n(rec, hdr | BTSNOOP_REC_COMMIT, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&s_btsnoop.packets, 1, __ATOMIC_RELAXED);
+	if (__atomic_exchange_n(&s_btsnoop.waiting, 0, __ATOMIC_SEQ_CST)) {
+		OS_SemaphoreRelease(&s_btsnoop.sem);
+	}
+}
+
+static void btsnoop_record_packet(uint8_t sink, uint8_t type,
+                                  const uint8_t *packet, bool is_received)
 {
 	int length_he = 0;
 	int flags = 0;
@@ -146,30 +233,152 @@ static void btsnoop_write_packet(uint8_t type, const uint8_t *packet, bool is_re
 		return;
 	}
 
-	btsnoop_header_t header;
-	header.length_original = htonl(length_he);
-	header.length_captured = header.length_original;
-	header.flags = htonl(flags);
-	header.dropped_packets = 0;
+	/* a file record, or the header sent to Hcidump, is a btsnoop record */
+	int hdr_len = sizeof(btsnoop_header_t);
+#if !SYNC_WITH_HCIDUMP
+	if (sink == BTSNOOP_SINK_UART) {
+		hdr_len = 1;
+	}
+#endif
 
-	uint64_t timestamp = btsnoop_timestamp();
-	header.time_hi = htonl(timestamp >> 32);
-	header.time_lo = htonl(timestamp & 0xFFFFFFFF);
-	header.type = type;
+	uint32_t len = hdr_len + length_he - 1;
+	uint32_t size = BTSNOOP_REC_ALIGN(4 + len);
+	uint32_t *rec = btsnoop_reserve(size);
+	if (rec == NULL) {
+		__atomic_fetch_add(&s_btsnoop.dropped_packets, 1, __ATOMIC_RELAXED);
+		return;
+	}
 
-	if (get_uart_save_log_type() == UART_SAVE_BT_LOG) {
-		OS_MutexLock(&lock, -1);
+	uint8_t *p = (uint8_t *)(rec + 1);
+	if (hdr_len == sizeof(btsnoop_header_t)) {
+		btsnoop_header_t header;
+		header.length_original = htonl(length_he);
+		header.length_captured = header.length_original;
+		header.flags = htonl(flags);
+		header.dropped_packets = htonl(s_btsnoop.dropped_packets);
 
-#if SYNC_WITH_HCIDUMP
-		uart_save_log_write((uint8_t *)&header, sizeof(btsnoop_header_t));
-#else
-		uart_save_log_write((void *)&type, 1);
+		uint64_t timestamp = btsnoop_timestamp();
+		header.time_hi = htonl(timestamp >> 32);
+		header.time_lo = htonl(timestamp & 0xFFFFFFFF);
+		header.type = type;
+		memcpy(p, &header, sizeof(header));
+	} else {
+		*p = type;
+	}
+	memcpy(p + hdr_len, packet, length_he - 1);
+
+	btsnoop_commit(rec, BTSNOOP_REC_HDR(size, len));
+}
+
+static void btsnoop_write_packet(uint8_t type, const uint8_t *packet, bool is_received)
+{
+	uint8_t sink;
+
+	__atomic_fetch_add(&s_btsnoop.writers, 1, __ATOMIC_SEQ_CST);
+	sink = s_btsnoop.sink;
+	if (s_btsnoop.accepting && sink != BTSNOOP_SINK_NONE) {
+		btsnoop_record_packet(sink, type, packet, is_received);
+	}
+	__atomic_fetch_sub(&s_btsnoop.writers, 1, __ATOMIC_RELEASE);
+}
+
+static int btsnoop_sink_write(uint8_t sink, const void *data, int len)
+{
+#ifdef CONFIG_FILESYSTEMS
+	if (sink == BTSNOOP_SINK_FILE) {
+		return vfs_write(s_btsnoop.file, data, len);
+	}
 #endif
+	return uart_save_log_write(data, len);
+}
 
-		uart_save_log_write(packet, length_he - 1);
+static void btsnoop_task(void *arg)
+{
+	uint8_t sink = (uint8_t)(uintptr_t)arg;
+	uint32_t *rec;
+	uint32_t tail, hdr, size;
 
-		OS_MutexUnlock(&lock);
+	while (1) {
+		tail = s_btsnoop.tail;
+		rec = &s_btsnoop.buf[(tail & BTSNOOP_RING_MASK) / 4];
+		hdr = __atomic_load_n(rec, __ATOMIC_ACQUIRE);
+		if (!(hdr & BTSNOOP_REC_COMMIT)) {
+			if (s_btsnoop.stop) {
+				break;
+			}
+			__atomic_store_n(&s_btsnoop.waiting, 1, __ATOMIC_SEQ_CST);
+			if (!(__atomic_load_n(rec, __ATOMIC_SEQ_CST) & BTSNOOP_REC_COMMIT)) {
+				OS_SemaphoreWait(&s_btsnoop.sem, OS_WAIT_FOREVER);
+			}
+			__atomic_store_n(&s_btsnoop.waiting, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		size = BTSNOOP_REC_SIZE(hdr);
+		if (!(hdr & BTSNOOP_REC_PAD)) {
+			btsnoop_sink_write(sink, rec + 1, BTSNOOP_REC_LEN(hdr));
+		}
+		memset(rec, 0, size);
+		__atomic_store_n(&s_btsnoop.tail, tail + size, __ATOMIC_RELEASE);
 	}
+
+	OS_ThreadDelete(&s_btsnoop.thread);
+}
+
+static int btsnoop_start(btsnoop_sink_t sink)
+{
+	s_btsnoop.buf = malloc(BTSNOOP_RING_SIZE);
+	if (s_btsnoop.buf == NULL) {
+		return -1;
+	}
+	memset(s_btsnoop.buf, 0, BTSNOOP_RING_SIZE);
+	s_btsnoop.head = 0;
+	s_btsnoop.tail = 0;
+	s_btsnoop.waiting = 0;
+	s_btsnoop.dropped_packets = 0;
+	s_btsnoop.packets = 0;
+	s_btsnoop.stop = 0;
+
+	if (OS_SemaphoreCreate(&s_btsnoop.sem, 0, 1) != OS_OK) {
+		goto err_sem;
+	}
+	s_btsnoop.sink = sink;
+	if (OS_ThreadCreate(&s_btsnoop.thread, "btsnoop", btsnoop_task,
+	                    (void *)(uintptr_t)sink, BTSNOOP_THREAD_PRIO,
+	                    BTSNOOP_THREAD_STACK_SIZE) != OS_OK) {
+		goto err_thread;
+	}
+	s_btsnoop.accepting = 1;
+	return 0;
+
+err_thread:
+	s_btsnoop.sink = BTSNOOP_SINK_NONE;
+	OS_SemaphoreDelete(&s_btsnoop.sem);
+err_sem:
+	free(s_btsnoop.buf);
+	s_btsnoop.buf = NULL;
+	return -1;
+}
+
+/* the captured records are written out to the sink before stop */
+static void btsnoop_stop(void)
+{
+	s_btsnoop.accepting = 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&s_btsnoop.writers, __ATOMIC_ACQUIRE)) {
+		OS_MSleep(1); /* wait for the packets being captured */
+	}
+	s_btsnoop.stop = 1;
+	OS_SemaphoreRelease(&s_btsnoop.sem);
+
+	while (OS_ThreadIsValid(&s_btsnoop.thread)) {
+		OS_MSleep(1); /* wait for thread termination */
+	}
+	s_btsnoop.sink = BTSNOOP_SINK_NONE;
+
+	OS_SemaphoreDelete(&s_btsnoop.sem);
+	free(s_btsnoop.buf);
+	s_btsnoop.buf = NULL;
 }
 
 // Module lifecycle functions
@@ -177,23 +386,80 @@ int btsnoop_start_up(void)
 {
 	int ret;
 
+	if (s_btsnoop.sink != BTSNOOP_SINK_NONE) {
+		return -1;
+	}
+
 	ret = uart_save_log_start_up(UART_SAVE_BT_LOG);
 	if (ret != 0) {
 		return ret;
 	}
 
-	OS_MutexCreate(&lock);
+	ret = btsnoop_start(BTSNOOP_SINK_UART);
+	if (ret != 0) {
+		uart_save_log_shut_down();
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_FILESYSTEMS
+int btsnoop_start_up_file(const char *path)
+{
+	uint8_t hdr[16] = "btsnoop";
+	uint32_t val;
+
+	if (s_btsnoop.sink != BTSNOOP_SINK_NONE) {
+		return -1;
+	}
+
+	s_btsnoop.file = vfs_open(path, VFS_WRONLY | VFS_CREAT | VFS_TRUNC);
+	if (s_btsnoop.file == NULL) {
+		return -1;
+	}
+
+	val = htonl(BTSNOOP_FILE_VERSION);
+	memcpy(hdr + 8, &val, 4);
+	val = htonl(BTSNOOP_FILE_DATALINK);
+	memcpy(hdr + 12, &val, 4);
+	if (vfs_write(s_btsnoop.file, hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    btsnoop_start(BTSNOOP_SINK_FILE) != 0) {
+		vfs_close(s_btsnoop.file);
+		s_btsnoop.file = NULL;
+		return -1;
+	}
 
 	return 0;
 }
+#endif
 
 int btsnoop_shut_down(void)
 {
-	OS_MutexDelete(&lock);
+	uint8_t sink = s_btsnoop.sink;
+
+	if (sink == BTSNOOP_SINK_NONE) {
+		return 0;
+	}
+
+	btsnoop_stop();
+
+#ifdef CONFIG_FILESYSTEMS
+	if (sink == BTSNOOP_SINK_FILE) {
+		vfs_close(s_btsnoop.file);
+		s_btsnoop.file = NULL;
+		return 0;
+	}
+#endif
 
 	return uart_save_log_shut_down();
 }
 
+void btsnoop_get_stat(uint32_t *packets, uint32_t *dropped_packets)
+{
+	*packets = s_btsnoop.packets;
+	*dropped_packets = s_btsnoop.dropped_packets;
+}
+
 #if 0
 // Interface function
 void btsnoop_capture(const BT_HDR * buffer, bool is_received)
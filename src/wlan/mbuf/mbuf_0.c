@@ -34,163 +34,6 @@
 
 #define MBUF_SIZE       sizeof(struct mbuf) /* (24 + 24 + 32) == 80 */
 
-#if MBUF_OPT_LIMIT_MEM
-
-#define MBUF_LIMIT_MEM_DBG_ON   0
-
-#include "kernel/os/os_thread.h"
-
-/* limitation of memory usage
- *   - MBUF_TX_MEM_MAX: max sum of tx mem, 0 for no limit
- *   - MBUF_RX_MEM_MAX: max sum of rx mem, 0 for no limit
- *   - MBUF_TXRX_MEM_MAX: max sum of tx and rx mem, 0 for no limit.
- *                        MUST less than (MBUF_TX_MEM_MAX + MBUF_RX_MEM_MAX)
- */
-#if (CONFIG_MBUF_HEAP_MODE == 1)
-uint32_t MBUF_TX_MEM_MAX   = (64 * 1024);
-uint32_t MBUF_RX_MEM_MAX   = (64 * 1024);
-uint32_t MBUF_TXRX_MEM_MAX = 0;
-#else
-uint32_t MBUF_TX_MEM_MAX   = (20 * 1024);
-uint32_t MBUF_RX_MEM_MAX   = (20 * 1024);
-uint32_t MBUF_TXRX_MEM_MAX = (32 * 1024);
-#endif
-
-static int32_t m_tx_mem_sum = 0;
-static int32_t m_rx_mem_sum = 0;
-static int32_t m_txrx_mem_sum = 0;
-
-static __inline void mb_mem_lock(void)
-{
-	OS_ThreadSuspendScheduler();
-}
-
-static __inline void mb_mem_unlock(void)
-{
-	OS_ThreadResumeScheduler();
-}
-
-#if MBUF_LIMIT_MEM_DBG_ON
-static int32_t m_tx_mem_sum_max = 0;
-static int32_t m_rx_mem_sum_max = 0;
-static int32_t m_txrx_mem_sum_max = 0;
-
-void mb_limit_mem_info(void)
-{
-#define MB_SUM_VAL(v)    (v), (v) / 1024
-	MBUF_LOG(1, "<<< mbuf limit mem info >>>\n"
-	         "m_tx_mem_sum   %5u (%2u KB), max %5u (%2u KB)\n"
-	         "m_rx_mem_sum   %5u (%2u KB), max %5u (%2u KB)\n"
-	         "m_txrx_mem_sum %5u (%2u KB), max %5u (%2u KB)\n",
-	         MB_SUM_VAL(m_tx_mem_sum), MB_SUM_VAL(m_tx_mem_sum_max),
-	         MB_SUM_VAL(m_rx_mem_sum), MB_SUM_VAL(m_rx_mem_sum_max),
-	         MB_SUM_VAL(m_txrx_mem_sum), MB_SUM_VAL(m_txrx_mem_sum_max));
-
-	if (m_tx_mem_sum + m_rx_mem_sum != m_txrx_mem_sum) {
-		MBUF_ERR("tx %d + rx %d != total %d\n",
-		         m_tx_mem_sum, m_rx_mem_sum, m_txrx_mem_sum);
-	}
-
-#undef MB_SUM_VAL
-}
-#endif /* MBUF_LIMIT_MEM_DBG_ON */
-
-static __inline int mb_limit_mem_inc(uint8_t flag, int32_t len)
-{
-	int32_t sum;
-
-	mb_mem_lock();
-	sum = m_txrx_mem_sum + len;
-	if ((MBUF_TXRX_MEM_MAX > 0) && (sum > MBUF_TXRX_MEM_MAX)) {
-		mb_mem_unlock();
-		MBUF_DBG("txrx mem sum %d + len %d > %d, flag %#x\n",
-		         m_txrx_mem_sum, len, MBUF_TXRX_MEM_MAX, flag);
-		return -1;
-	}
-	if (flag & MBUF_GET_FLAG_LIMIT_TX) {
-		sum = m_tx_mem_sum + len;
-		if ((MBUF_TX_MEM_MAX > 0) && (sum > MBUF_TX_MEM_MAX)) {
-			mb_mem_unlock();
-			MBUF_DBG("tx mem sum %d + len %d > %d, flag %#x\n",
-			         m_tx_mem_sum, len, MBUF_TX_MEM_MAX, flag);
-			return -1;
-		} else {
-			m_tx_mem_sum = sum;
-#if MBUF_LIMIT_MEM_DBG_ON
-			if (m_tx_mem_sum > m_tx_mem_sum_max) {
-				m_tx_mem_sum_max = m_tx_mem_sum;
-			}
-#endif
-		}
-	}
-	if (flag & MBUF_GET_FLAG_LIMIT_RX) {
-		sum = m_rx_mem_sum + len;
-		if ((MBUF_RX_MEM_MAX > 0) && (sum > MBUF_RX_MEM_MAX)) {
-			mb_mem_unlock();
-			MBUF_DBG("rx mem sum %d + len %d > %d, flag %#x\n",
-			         m_rx_mem_sum, len, MBUF_RX_MEM_MAX, flag);
-			return -1;
-		} else {
-			m_rx_mem_sum = sum;
-#if MBUF_LIMIT_MEM_DBG_ON
-			if (m_rx_mem_sum > m_rx_mem_sum_max) {
-				m_rx_mem_sum_max = m_rx_mem_sum;
-			}
-#endif
-		}
-	}
-	m_txrx_mem_sum += len;
-#if MBUF_LIMIT_MEM_DBG_ON
-	if (m_txrx_mem_sum > m_txrx_mem_sum_max) {
-		m_txrx_mem_sum_max = m_txrx_mem_sum;
-	}
-#endif
-	mb_mem_unlock();
-	return 0;
-}
-
-static void mb_limit_mem_dec(uint8_t flag, int32_t len)
-{
-	mb_mem_lock();
-
-	if (m_txrx_mem_sum < len) {
-		MBUF_ERR("m_txrx_mem_sum %d < len %d\n", m_txrx_mem_sum, len);
-	}
-	m_txrx_mem_sum -= len;
-
-	if (flag & MBUF_GET_FLAG_LIMIT_TX) {
-		if (m_tx_mem_sum < len) {
-			MBUF_ERR("m_tx_mem_sum %d < len %d\n", m_tx_mem_sum, len);
-		}
-		m_tx_mem_sum -= len;
-	}
-
-	if (flag & MBUF_GET_FLAG_LIMIT_RX) {
-		if (m_rx_mem_sum < len) {
-			MBUF_ERR("m_rx_mem_sum %d < len %d\n", m_rx_mem_sum, len);
-		}
-		m_rx_mem_sum -= len;
-	}
-
-	mb_mem_unlock();
-}
-
-void mb_mem_set_limit(uint32_t tx, uint32_t rx, uint32_t txrx)
-{
-	MBUF_TX_MEM_MAX = tx;
-	MBUF_RX_MEM_MAX = rx;
-	MBUF_TXRX_MEM_MAX = txrx;
-}
-
-void mb_mem_get_limit(uint32_t *tx, uint32_t *rx, uint32_t *txrx)
-{
-	*tx = MBUF_TX_MEM_MAX;
-	*rx = MBUF_RX_MEM_MAX;
-	*txrx = MBUF_TXRX_MEM_MAX;
-}
-
-#endif /* MBUF_OPT_LIMIT_MEM */
-
 /*
  * @param tx
  *   - 1 means mbuf is used to do TX, reserve head/tail space
@@ -216,12 +59,15 @@ struct mbuf *mb_get(int len, int tx)
 	}
 
 #if MBUF_OPT_LIMIT_MEM
-	if (flag && mb_limit_mem_inc(flag, tot_len) != 0) {
-		return NULL;
+	struct mbuf *m;
+	if (flag) {
+		m = (struct mbuf *)mb_pool_get(flag, tot_len);
+	} else {
+		m = (struct mbuf *)MB_MALLOC(tot_len);
 	}
-#endif /* MBUF_OPT_LIMIT_MEM */
-
+#else
 	struct mbuf *m = (struct mbuf *)MB_MALLOC(tot_len);
+#endif /* MBUF_OPT_LIMIT_MEM */
 	if (m) {
 		MB_MEMSET(m, 0, MBUF_SIZE);
 		m->m_buf = (uint8_t *)m + MBUF_SIZE;
@@ -239,10 +85,7 @@ struct mbuf *mb_get(int len, int tx)
 #endif
 	} else {
 #if MBUF_OPT_LIMIT_MEM
-		if (flag) {
-			mb_limit_mem_dec(flag, tot_len);
-		}
-		MBUF_WRN("MB_MALLOC() fail, len %d\n", tot_len);
+		MBUF_WRN("MB_MALLOC() fail, len %d, flag %#x\n", tot_len, flag);
 #else
 		MBUF_DBG("MB_MALLOC() fail, len %d\n", tot_len);
 #endif
@@ -261,17 +104,73 @@ void mb_free(struct mbuf *m)
 		return;
 	}
 
+	if (m->m_flags & M_EXT) {
+		struct mb_ext *ext = MB_EXT(m);
+		if (ext->free) {
+			ext->free(ext->arg);
+		}
+	}
+
 #if MBUF_OPT_LIMIT_MEM
 	uint8_t flag = m->m_type & MBUF_GET_FLAG_MASK;
 	if (flag) {
-		int32_t len = MBUF_SIZE + m->m_len + m->m_headspace + m->m_tailspace;
-		mb_limit_mem_dec(flag, len);
+		int32_t len = MB_EXT_SIZE;
+		if (!(m->m_flags & M_EXT)) {
+			len = MBUF_SIZE + m->m_len + m->m_headspace + m->m_tailspace;
+		}
+		mb_pool_put(m, flag, len);
+		return;
 	}
 #endif /* MBUF_OPT_LIMIT_MEM */
 
 	MB_FREE(m);
 }
 
+/*
+ * Get a mbuf referencing external data @data without copying it, used to do
+ * TX only. The @headspace bytes before and @tailspace bytes after the data
+ * MUST be writable, headers and trailers are added there in place, see
+ * mb_append() if @tailspace is short. @ext_free(@arg) is called when the data
+ * is not referenced any more.
+ *
+ * @return a mbuf including @len data
+ */
+struct mbuf *mb_get_ext(uint8_t *data, int len, uint16_t headspace,
+                        uint16_t tailspace, void (*ext_free)(void *arg), void *arg)
+{
+	struct mbuf *m;
+
+	if (data == NULL || len < 0) {
+		MBUF_ERR("data %p, len %d\n", data, len);
+		return NULL;
+	}
+
+#if MBUF_OPT_LIMIT_MEM
+	m = (struct mbuf *)mb_pool_get(MBUF_GET_FLAG_LIMIT_TX, MB_EXT_SIZE);
+#else
+	m = (struct mbuf *)MB_MALLOC(MB_EXT_SIZE);
+#endif
+	if (m == NULL) {
+		MBUF_DBG("mbuf header alloc fail\n");
+		return NULL;
+	}
+
+	MB_MEMSET(m, 0, MB_EXT_SIZE);
+	m->m_buf = data - headspace;
+	m->m_data = data;
+	m->m_len = len;
+	m->m_headspace = headspace;
+	m->m_tailspace = tailspace;
+	m->m_flags = M_PKTHDR | M_EXT;
+	m->m_pkthdr.len = len;
+#if MBUF_OPT_LIMIT_MEM
+	m->m_type = MBUF_GET_FLAG_LIMIT_TX;
+#endif
+	MB_EXT(m)->free = ext_free;
+	MB_EXT(m)->arg = arg;
+	return m;
+}
+
 /*
  * Create a new mbuf including all data
  */
@@ -386,10 +285,11 @@ struct mbuf *mb_dup(struct mbuf *m)
  * and in the data area of an mbuf (so that mtod will work
  * for a structure of size len).  Returns the resulting
  * mbuf chain on success, frees it and returns null on failure.
- * If there is room, it will add up to max_protohdr-len extra bytes to the
- * contiguous region in an attempt to avoid being called next time.
+ *
+ * NB: mbufs are never chained, the data of a mbuf (M_EXT or not) is always
+ *     contiguous, only check the length here.
  */
-struct mbuf *mb_pullup(struct mbuf *m, int len) // NOT really support!
+struct mbuf *mb_pullup(struct mbuf *m, int len)
 {
 	if (m->m_len < len) {
 		mb_free(m);
@@ -433,6 +333,43 @@ struct mbuf *mb_split(struct mbuf *m0, int len0)
 	return m;
 }
 
+static void mb_ext_free_mbuf(void *arg)
+{
+	mb_free((struct mbuf *)arg);
+}
+
+/*
+ * Move the data of a M_EXT mbuf to a new mbuf with @tailspace bytes of tail
+ * space at least, the external storage is released.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int mb_ext_unshare(struct mbuf *m, int tailspace)
+{
+	struct mb_ext *ext = MB_EXT(m);
+	int32_t extra = tailspace > MBUF_TAIL_SPACE ? tailspace - MBUF_TAIL_SPACE : 0;
+	struct mbuf *nm = mb_get(m->m_len + extra, 1 | MBUF_GET_FLAG_LIMIT_TX);
+
+	if (nm == NULL || nm->m_headspace < m->m_headspace) {
+		if (nm)
+			mb_free(nm);
+		return -1;
+	}
+
+	mb_adj_tail(nm, -extra);
+	MB_MEMCPY(nm->m_data, m->m_data, m->m_len);
+	if (ext->free) {
+		ext->free(ext->arg);
+	}
+	ext->free = mb_ext_free_mbuf;
+	ext->arg = nm;
+	m->m_buf = nm->m_buf;
+	m->m_data = nm->m_data;
+	m->m_headspace = nm->m_headspace;
+	m->m_tailspace = nm->m_tailspace;
+	return 0;
+}
+
 /*
  * Append the specified data to the indicated mbuf chain,
  * Extend the mbuf chain if the new data does not fit in
@@ -442,7 +379,8 @@ struct mbuf *mb_split(struct mbuf *m0, int len0)
  */
 int mb_append(struct mbuf *m, int len, const uint8_t *cp)
 {
-	if (len > m->m_tailspace) {
+	if (len > m->m_tailspace &&
+	    (!(m->m_flags & M_EXT) || mb_ext_unshare(m, len) != 0)) {
 		MBUF_ERR("%d > %d\n", len, (int)m->m_tailspace);
 		return 0;
 	}
@@ -31,8 +31,7 @@
 
 #include "kernel/os/os_thread.h"
 #include "sys/mbuf_0.h"
-#include "mbuf_0_mem.h"
-#include "mbuf_debug.h"
+#include "mbuf_util.h"
 
 #if (CONFIG_MBUF_HEAP_MODE == 1)
 #define _MB_MALLOC(l)   psram_malloc(l)
@@ -159,7 +158,10 @@ void mbuf_free(void *ptr)
 	if (ptr) {
 #if (MB0_MEM_TRACE_SUM || MB0_MEM_TRACE_DETAIL)
 		struct mbuf *m = ptr;
-		size_t size = sizeof(struct mbuf) + m->m_len + m->m_headspace + m->m_tailspace;
+		size_t size = MB_EXT_SIZE;
+		if (!(m->m_flags & M_EXT)) {
+			size = sizeof(struct mbuf) + m->m_len + m->m_headspace + m->m_tailspace;
+		}
 #endif /* (MB0_MEM_TRACE_SUM || MB0_MEM_TRACE_DETAIL) */
 
 #if MB0_MEM_TRACE_SUM
@@ -190,4 +192,317 @@ void mbuf_free(void *ptr)
 	_MB_FREE(ptr);
 }
 
+#if MBUF_OPT_LIMIT_MEM
+
+#include "sys/interrupt.h"
+
+#define MBUF_SIZE       sizeof(struct mbuf)
+
+/*
+ * mbuf pool
+ *   - mbufs with MBUF_GET_FLAG_LIMIT_TX/RX are got from the heap by size
+ *     class, and kept in the TX/RX freelists after free, so the same few
+ *     block sizes are reused under load instead of fragmenting the heap.
+ *   - MBUF_TX_MEM_MAX/MBUF_RX_MEM_MAX/MBUF_TXRX_MEM_MAX limit the memory held
+ *     by the pools (in use and cached). When a limit is reached, the cached
+ *     blocks are given back to the heap before failing.
+ *   - each class caches up to m_pool_class_cache_max blocks, more are given
+ *     back to the heap on free, so a burst does not pin its peak for good.
+ *   - mbufs larger than the largest class are got from the heap directly,
+ *     they are counted by the limits but not cached.
+ *   - freelists are protected by disabling IRQ for a few instructions only.
+ */
+#define MB_POOL_CLASS_NUM   4
+
+/* (MBUF_SIZE + MBUF_HEAD_SPACE + MBUF_TAIL_SPACE) == 164, a 1514 bytes frame
+ * uses 1678 bytes, a TCP ACK uses 218 bytes, a M_EXT mbuf uses MB_EXT_SIZE.
+ */
+static const uint16_t m_pool_class_size[MB_POOL_CLASS_NUM] = {
+	MB_EXT_SIZE, 256, 640, 1760
+};
+
+/* about 4 KB of small blocks, 8 full frames */
+static const uint16_t m_pool_class_cache_max[MB_POOL_CLASS_NUM] = {
+	24, 16, 8, 8
+};
+
+/*
+ * limitation of memory usage
+ *   - MBUF_TX_MEM_MAX: max sum of tx mem, 0 for no limit
+ *   - MBUF_RX_MEM_MAX: max sum of rx mem, 0 for no limit
+ *   - MBUF_TXRX_MEM_MAX: max sum of tx and rx mem, 0 for no limit.
+ *                        MUST less than (MBUF_TX_MEM_MAX + MBUF_RX_MEM_MAX)
+ */
+#if (CONFIG_MBUF_HEAP_MODE == 1)
+uint32_t MBUF_TX_MEM_MAX   = (64 * 1024);
+uint32_t MBUF_RX_MEM_MAX   = (64 * 1024);
+uint32_t MBUF_TXRX_MEM_MAX = 0;
+#else
+uint32_t MBUF_TX_MEM_MAX   = (20 * 1024);
+uint32_t MBUF_RX_MEM_MAX   = (20 * 1024);
+uint32_t MBUF_TXRX_MEM_MAX = (32 * 1024);
+#endif
+
+enum {
+	MB_POOL_TX = 0,
+	MB_POOL_RX,
+	MB_POOL_NUM
+};
+
+#define MB_POOL_IDX(flag)   (((flag) & MBUF_GET_FLAG_LIMIT_TX) ? MB_POOL_TX : MB_POOL_RX)
+
+struct mb_pool_class {
+	void     *free_list;    /* cached blocks, linked by the first word */
+	uint16_t free_cnt;
+	uint16_t held_cnt;      /* blocks got from the heap */
+	uint32_t hit;           /* got from free_list */
+	uint32_t miss;          /* got from the heap */
+};
+
+struct mb_pool {
+	struct mb_pool_class cls[MB_POOL_CLASS_NUM];
+	int32_t  held;          /* bytes held, in use and cached */
+	int32_t  used;          /* bytes in use */
+	int32_t  used_max;
+	uint32_t fail;
+};
+
+static struct mb_pool m_pool[MB_POOL_NUM];
+static int32_t m_pool_held;
+
+static __inline int mb_pool_class_idx(int32_t size)
+{
+	int i;
+
+	for (i = 0; i < MB_POOL_CLASS_NUM; ++i) {
+		if (size <= m_pool_class_size[i])
+			break;
+	}
+	return i;
+}
+
+static __inline uint32_t mb_pool_limit(int idx)
+{
+	return (idx == MB_POOL_TX) ? MBUF_TX_MEM_MAX : MBUF_RX_MEM_MAX;
+}
+
+static __inline void mb_pool_use(struct mb_pool *pool, int32_t size)
+{
+	pool->used += size;
+	if (pool->used > pool->used_max)
+		pool->used_max = pool->used;
+}
+
+/* give a block back to the heap */
+static void mb_pool_release(void *ptr, int32_t size)
+{
+#if (MB0_MEM_TRACE_SUM || MB0_MEM_TRACE_DETAIL)
+	/* mbuf_free() gets the size from the mbuf header */
+	MB_MEMSET(ptr, 0, MBUF_SIZE);
+	((struct mbuf *)ptr)->m_len = size - MBUF_SIZE;
+#endif
+	MB_FREE(ptr);
+}
+
+/* take a cached block out of @pool, the largest first. IRQ disabled. */
+static void *mb_pool_evict(struct mb_pool *pool, int32_t *size)
+{
+	struct mb_pool_class *cls;
+	void *ptr;
+	int i;
+
+	for (i = MB_POOL_CLASS_NUM - 1; i >= 0; --i) {
+		cls = &pool->cls[i];
+		ptr = cls->free_list;
+		if (ptr) {
+			cls->free_list = *(void **)ptr;
+			cls->free_cnt--;
+			cls->held_cnt--;
+			*size = m_pool_class_size[i];
+			pool->held -= *size;
+			m_pool_held -= *size;
+			return ptr;
+		}
+	}
+	return NULL;
+}
+
+/* account @size bytes to pool @idx, evict cached blocks if over limit */
+static int mb_pool_reserve(int idx, int32_t size)
+{
+	struct mb_pool *pool = &m_pool[idx];
+	unsigned long flags;
+	uint32_t limit;
+	int32_t evict_size;
+	void *ptr;
+	int over;
+
+	while (1) {
+		flags = arch_irq_save();
+		limit = mb_pool_limit(idx);
+		over = (limit > 0) && (pool->held + size > limit);
+		if (!over && ((MBUF_TXRX_MEM_MAX == 0) ||
+		              (m_pool_held + size <= MBUF_TXRX_MEM_MAX))) {
+			pool->held += size;
+			m_pool_held += size;
+			arch_irq_restore(flags);
+			return 0;
+		}
+		ptr = mb_pool_evict(pool, &evict_size);
+		if (ptr == NULL && !over) { /* only over the txrx limit */
+			ptr = mb_pool_evict(&m_pool[!idx], &evict_size);
+		}
+		if (ptr == NULL) {
+			pool->fail++;
+			arch_irq_restore(flags);
+			MBUF_DBG("pool %d held %d + %d over limit, total %d\n",
+			         idx, pool->held, size, m_pool_held);
+			return -1;
+		}
+		arch_irq_restore(flags);
+		mb_pool_release(ptr, evict_size);
+	}
+}
+
+void *mb_pool_get(uint8_t flag, int32_t size)
+{
+	int idx = MB_POOL_IDX(flag);
+	struct mb_pool *pool = &m_pool[idx];
+	int i = mb_pool_class_idx(size);
+	unsigned long flags;
+	void *ptr;
+
+	if (i < MB_POOL_CLASS_NUM) {
+		size = m_pool_class_size[i];
+		flags = arch_irq_save();
+		ptr = pool->cls[i].free_list;
+		if (ptr) {
+			pool->cls[i].free_list = *(void **)ptr;
+			pool->cls[i].free_cnt--;
+			pool->cls[i].hit++;
+			mb_pool_use(pool, size);
+			arch_irq_restore(flags);
+			return ptr;
+		}
+		arch_irq_restore(flags);
+	}
+
+	if (mb_pool_reserve(idx, size) != 0) {
+		return NULL;
+	}
+	ptr = MB_MALLOC(size);
+
+	flags = arch_irq_save();
+	if (ptr) {
+		if (i < MB_POOL_CLASS_NUM) {
+			pool->cls[i].held_cnt++;
+			pool->cls[i].miss++;
+		}
+		mb_pool_use(pool, size);
+	} else {
+		pool->held -= size;
+		m_pool_held -= size;
+		pool->fail++;
+	}
+	arch_irq_restore(flags);
+	return ptr;
+}
+
+void mb_pool_put(void *ptr, uint8_t flag, int32_t size)
+{
+	struct mb_pool *pool = &m_pool[MB_POOL_IDX(flag)];
+	int i = mb_pool_class_idx(size);
+	unsigned long flags;
+
+	if (i < MB_POOL_CLASS_NUM) {
+		size = m_pool_class_size[i];
+		flags = arch_irq_save();
+		if (pool->cls[i].free_cnt < m_pool_class_cache_max[i]) {
+			*(void **)ptr = pool->cls[i].free_list;
+			pool->cls[i].free_list = ptr;
+			pool->cls[i].free_cnt++;
+			pool->used -= size;
+			arch_irq_restore(flags);
+			return;
+		}
+		pool->cls[i].held_cnt--;
+		arch_irq_restore(flags);
+	}
+
+	flags = arch_irq_save();
+	pool->used -= size;
+	pool->held -= size;
+	m_pool_held -= size;
+	arch_irq_restore(flags);
+	mb_pool_release(ptr, size);
+}
+
+/* give all the cached blocks back to the heap */
+void mb_pool_shrink(void)
+{
+	unsigned long flags;
+	int32_t size;
+	void *ptr;
+	int idx;
+
+	for (idx = 0; idx < MB_POOL_NUM; ++idx) {
+		while (1) {
+			flags = arch_irq_save();
+			ptr = mb_pool_evict(&m_pool[idx], &size);
+			arch_irq_restore(flags);
+			if (ptr == NULL)
+				break;
+			mb_pool_release(ptr, size);
+		}
+	}
+}
+
+void mb_pool_info(int verbose)
+{
+	static const char * const name[MB_POOL_NUM] = { "tx", "rx" };
+	struct mb_pool pool;
+	unsigned long flags;
+	int idx, i;
+
+	for (idx = 0; idx < MB_POOL_NUM; ++idx) {
+		flags = arch_irq_save();
+		memcpy(&pool, &m_pool[idx], sizeof(pool));
+		arch_irq_restore(flags);
+
+		MBUF_LOG(1, "<<< mbuf %s pool >>>\n"
+		         "held %5d (%2d KB), limit %5u\n"
+		         "used %5d (%2d KB), max %5d (%2d KB), fail %u\n",
+		         name[idx], pool.held, pool.held / 1024, mb_pool_limit(idx),
+		         pool.used, pool.used / 1024,
+		         pool.used_max, pool.used_max / 1024, pool.fail);
+		if (!verbose)
+			continue;
+		for (i = 0; i < MB_POOL_CLASS_NUM; ++i) {
+			MBUF_LOG(1, "%4u: held %3u, free %3u/%2u, hit %8u, miss %6u\n",
+			         m_pool_class_size[i], pool.cls[i].held_cnt,
+			         pool.cls[i].free_cnt, m_pool_class_cache_max[i],
+			         pool.cls[i].hit, pool.cls[i].miss);
+		}
+	}
+	MBUF_LOG(1, "txrx held %5d (%2d KB), limit %5u\n",
+	         m_pool_held, m_pool_held / 1024, MBUF_TXRX_MEM_MAX);
+}
+
+void mb_mem_set_limit(uint32_t tx, uint32_t rx, uint32_t txrx)
+{
+	MBUF_TX_MEM_MAX = tx;
+	MBUF_RX_MEM_MAX = rx;
+	MBUF_TXRX_MEM_MAX = txrx;
+	mb_pool_shrink();
+}
+
+void mb_mem_get_limit(uint32_t *tx, uint32_t *rx, uint32_t *txrx)
+{
+	*tx = MBUF_TX_MEM_MAX;
+	*rx = MBUF_RX_MEM_MAX;
+	*txrx = MBUF_TXRX_MEM_MAX;
+}
+
+#endif /* MBUF_OPT_LIMIT_MEM */
+
 #endif /* (CONFIG_MBUF_IMPL_MODE == 0) */
@@ -61,5 +61,24 @@ void mbuf_free(void *ptr);
 
 #endif /* (MB0_MEM_TRACE_SUM || MB0_MEM_TRACE_DETAIL) */
 
+/*
+ * External storage of a M_EXT mbuf, kept right after the mbuf header (where
+ * the head space of a mbuf from mb_get() begins). Not in mbuf::m_ext_info,
+ * the wlan driver uses that for its TX state.
+ */
+struct mb_ext {
+	void (*free)(void *arg);
+	void *arg;
+};
+
+#define MB_EXT(m)       ((struct mb_ext *)(void *)((struct mbuf *)(m) + 1))
+#define MB_EXT_SIZE     (sizeof(struct mbuf) + sizeof(struct mb_ext))
+
+#if MBUF_OPT_LIMIT_MEM
+/* mbuf pool, @flag is MBUF_GET_FLAG_LIMIT_TX or MBUF_GET_FLAG_LIMIT_RX */
+void *mb_pool_get(uint8_t flag, int32_t size);
+void mb_pool_put(void *ptr, uint8_t flag, int32_t size);
+#endif
+
 #endif /* (CONFIG_MBUF_IMPL_MODE == 0) */
 #endif /* _MBUF_0_MEM_H_ */
@@ -0,0 +1,323 @@
+/*
+ * Replay an allocation trace on the RT-Thread heaps built for the host, the
+ * small memory algorithm (mem.c) and TLSF (tlsf.c). For each heap print the
+ * time per call at p50, p99, p99.9 and max, the failed calls and, with the
+ * blocks of the trace still held, the fragmentation: the part of the free
+ * memory outside the largest block that can be allocated.
+ *
+ * Trace format, one call per line, ids are hex numbers:
+ *   a <id> <size>    rt_malloc(size), the block is named id
+ *   r <id> <size>    rt_realloc(id, size)
+ *   f <id>           rt_free(id)
+ * "benchmark heap record" captures a trace on the target, the ids are the
+ * block addresses there. heap_trace_gen.py writes synthetic traces.
+ *
+ * usage: heap_replay <trace> [heap KB]
+ *   the heap is 3072 KB by default, returns non-zero if a heap corrupted a
+ *   block or returned a misaligned one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <rtthread.h>
+
+#define HEAP_SIZE_DEFAULT   (3072 * 1024)
+#define HEAP_IDS_MAX        (1U << 20)          /* distinct ids in a trace */
+#define HEAP_ID_HASH_SIZE   (2 * HEAP_IDS_MAX)  /* power of 2 */
+
+#define HEAP_API(name)                                                  \
+	void name##_heap_init(void *begin_addr, void *end_addr);        \
+	void *name##_malloc(rt_size_t size);                            \
+	void *name##_realloc(void *rmem, rt_size_t newsize);            \
+	void name##_free(void *rmem);                                   \
+	void name##_info(rt_uint32_t *total, rt_uint32_t *used, rt_uint32_t *max_used);
+
+HEAP_API(mem)
+HEAP_API(tlsf)
+
+struct heap {
+	const char *name;
+	void (*init)(void *begin_addr, void *end_addr);
+	void *(*malloc)(rt_size_t size);
+	void *(*realloc)(void *rmem, rt_size_t newsize);
+	void (*free)(void *rmem);
+	void (*info)(rt_uint32_t *total, rt_uint32_t *used, rt_uint32_t *max_used);
+};
+
+#define HEAP_ENTRY(name) \
+	{ #name ".c", name##_heap_init, name##_malloc, name##_realloc, name##_free, name##_info }
+
+static const struct heap g_heaps[] = {
+	HEAP_ENTRY(mem),
+	HEAP_ENTRY(tlsf),
+};
+
+struct op {
+	char type;      /* 'a', 'r' or 'f' */
+	uint32_t slot;  /* the id, numbered from 0 */
+	uint32_t size;
+};
+
+static struct op *g_ops;
+static uint32_t g_op_cnt;
+static uint32_t g_op_max;
+static uint32_t g_slot_cnt;
+
+/* id to slot, open addressing, ids are never removed */
+static uint64_t *g_hash_id;
+static uint32_t *g_hash_slot;   /* slot + 1, 0 is empty */
+
+static uint32_t id_to_slot(uint64_t id)
+{
+	uint32_t h = (uint32_t)((id * 0x9E3779B97F4A7C15ULL) >> 40) & (HEAP_ID_HASH_SIZE - 1);
+
+	while (g_hash_slot[h]) {
+		if (g_hash_id[h] == id)
+			return g_hash_slot[h] - 1;
+		h = (h + 1) & (HEAP_ID_HASH_SIZE - 1);
+	}
+	if (g_slot_cnt == HEAP_IDS_MAX) {
+		fprintf(stderr, "more than %u ids\n", HEAP_IDS_MAX);
+		exit(2);
+	}
+	g_hash_id[h] = id;
+	g_hash_slot[h] = ++g_slot_cnt;
+	return g_slot_cnt - 1;
+}
+
+static void op_add(char type, uint32_t slot, uint32_t size)
+{
+	if (g_op_cnt == g_op_max) {
+		g_op_max = g_op_max ? g_op_max * 2 : 65536;
+		g_ops = realloc(g_ops, g_op_max * sizeof(struct op));
+		if (g_ops == NULL) {
+			fprintf(stderr, "no memory\n");
+			exit(2);
+		}
+	}
+	g_ops[g_op_cnt].type = type;
+	g_ops[g_op_cnt].slot = slot;
+	g_ops[g_op_cnt].size = size;
+	g_op_cnt++;
+}
+
+/*
+ * A recorded trace may start with blocks allocated before, or miss a free:
+ * calls on unknown ids are dropped, an id allocated again is freed first.
+ */
+static void trace_load(FILE *f)
+{
+	char line[128], type;
+	unsigned long long id;
+	unsigned long size;
+	uint8_t *live;
+	uint32_t slot;
+	int n;
+
+	g_hash_id = calloc(HEAP_ID_HASH_SIZE, sizeof(*g_hash_id));
+	g_hash_slot = calloc(HEAP_ID_HASH_SIZE, sizeof(*g_hash_slot));
+	live = calloc(HEAP_IDS_MAX, 1);
+	if (!g_hash_id || !g_hash_slot || !live) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		size = 0;
+		n = sscanf(line, " %c %llx %lu", &type, &id, &size);
+		if (n < 2 || (type != 'f' && n < 3))
+			continue;
+		slot = id_to_slot(id);
+		switch (type) {
+		case 'a':
+			if (live[slot])
+				op_add('f', slot, 0);
+			op_add('a', slot, size);
+			live[slot] = 1;
+			break;
+		case 'r':
+			if (live[slot])
+				op_add('r', slot, size);
+			break;
+		case 'f':
+			if (live[slot])
+				op_add('f', slot, 0);
+			live[slot] = 0;
+			break;
+		default:
+			break;
+		}
+	}
+	free(live);
+}
+
+static inline uint64_t now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static int u32_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* the largest block the heap can return now, by bisection */
+static uint32_t heap_largest(const struct heap *h, uint32_t hi)
+{
+	uint32_t lo = 0, mid;
+	void *p;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		p = h->malloc(mid);
+		if (p) {
+			h->free(p);
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+/* a block is filled with the low byte of its slot, check its last byte */
+static int block_check(const uint8_t *p, uint32_t size, uint32_t slot)
+{
+	return size == 0 || p[size - 1] == (uint8_t)slot;
+}
+
+static int heap_replay(const struct heap *h, uint8_t *arena, uint32_t heap_size)
+{
+	void **ptr = calloc(g_slot_cnt, sizeof(void *));
+	uint32_t *size = calloc(g_slot_cnt, sizeof(uint32_t));
+	uint32_t *ns = malloc(g_op_cnt * sizeof(uint32_t));
+	uint32_t i, n = 0, fail = 0, keep, largest;
+	rt_uint32_t total, used, max_used;
+	const struct op *o;
+	uint64_t t;
+	void *p;
+	int err = 0;
+
+	if (!ptr || !size || !ns) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+	h->init(arena, arena + heap_size);
+
+	for (i = 0; i < g_op_cnt && !err; ++i) {
+		o = &g_ops[i];
+		if (o->type != 'a' && ptr[o->slot] == NULL)
+			continue; /* its malloc failed */
+		if (o->type != 'a' && !block_check(ptr[o->slot], size[o->slot], o->slot)) {
+			printf("%s: block %u corrupted at op %u\n", h->name, o->slot, i);
+			err = 1;
+			break;
+		}
+
+		switch (o->type) {
+		case 'a':
+			t = now_ns();
+			p = h->malloc(o->size);
+			ns[n++] = (uint32_t)(now_ns() - t);
+			break;
+		case 'r':
+			t = now_ns();
+			p = h->realloc(ptr[o->slot], o->size);
+			ns[n++] = (uint32_t)(now_ns() - t);
+			if (p == NULL && o->size == 0) {
+				ptr[o->slot] = NULL; /* freed */
+				continue;
+			}
+			keep = size[o->slot] < o->size ? size[o->slot] : o->size;
+			if (p != NULL && !block_check(p, keep, o->slot)) {
+				printf("%s: block %u not kept by realloc at op %u\n", h->name, o->slot, i);
+				err = 1;
+			}
+			break;
+		default:
+			t = now_ns();
+			h->free(ptr[o->slot]);
+			ns[n++] = (uint32_t)(now_ns() - t);
+			ptr[o->slot] = NULL;
+			continue;
+		}
+
+		if (p == NULL) {
+			fail++;
+			if (o->type == 'a')
+				ptr[o->slot] = NULL;
+			continue; /* a failed realloc keeps the block */
+		}
+		if ((uintptr_t)p & (RT_ALIGN_SIZE - 1)) {
+			printf("%s: block %p misaligned at op %u\n", h->name, p, i);
+			err = 1;
+		}
+		ptr[o->slot] = p;
+		size[o->slot] = o->size;
+		memset(p, (uint8_t)o->slot, o->size);
+	}
+
+	h->info(&total, &used, &max_used);
+	largest = heap_largest(h, total - used);
+
+	if (n) {
+		qsort(ns, n, sizeof(uint32_t), u32_compare);
+		printf("  %-7s p50 %5u ns, p99 %6u ns, p99.9 %7u ns, max %8u ns, "
+		       "%u failed\n", h->name, ns[n / 2], ns[(uint64_t)n * 99 / 100],
+		       ns[(uint64_t)n * 999 / 1000], ns[n - 1], fail);
+	}
+	printf("  %-7s used %u/%u, max used %u, largest free %u, fragmentation %u%%\n",
+	       h->name, used, total, max_used, largest, total > used ?
+	       100 - (uint32_t)((uint64_t)largest * 100 / (total - used)) : 0);
+
+	free(ns);
+	free(size);
+	free(ptr);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t heap_size = HEAP_SIZE_DEFAULT;
+	uint8_t *arena;
+	FILE *f;
+	int err = 0;
+	size_t i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <trace> [heap KB]\n", argv[0]);
+		return 2;
+	}
+	if (argc > 2)
+		heap_size = (uint32_t)strtoul(argv[2], NULL, 0) * 1024;
+
+	f = fopen(argv[1], "r");
+	if (f == NULL) {
+		perror(argv[1]);
+		return 2;
+	}
+	trace_load(f);
+	fclose(f);
+	printf("%s: %u calls, %u ids, %u KB heap\n", argv[1], g_op_cnt, g_slot_cnt,
+	       heap_size / 1024);
+
+	arena = aligned_alloc(16, heap_size);
+	if (arena == NULL) {
+		fprintf(stderr, "no memory\n");
+		return 2;
+	}
+	for (i = 0; i < sizeof(g_heaps) / sizeof(g_heaps[0]); ++i)
+		err |= heap_replay(&g_heaps[i], arena, heap_size);
+
+	free(arena);
+	return err;
+}
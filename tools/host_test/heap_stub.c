@@ -0,0 +1,32 @@
+/*
+ * The RT-Thread services used by mem.c and tlsf.c, for the host build of
+ * heap_replay. The replay is single threaded, the heap semaphore is a no-op.
+ */
+
+#include <string.h>
+#include <rtthread.h>
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+	return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time)
+{
+	return RT_EOK;
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+	return RT_EOK;
+}
+
+void *rt_memset(void *s, int c, rt_ubase_t count)
+{
+	return memset(s, c, count);
+}
+
+void *rt_memcpy(void *dst, const void *src, rt_ubase_t count)
+{
+	return memcpy(dst, src, count);
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+#
+# Write a synthetic allocation trace for heap_replay, see the trace format
+# there. It stands in for a long uptime of a connected device: RX frame
+# sized blocks, small pbuf/socket objects, some long lived objects, a few
+# large buffers and reallocs.
+#
+# usage: heap_trace_gen.py <seed> <calls> > trace.txt
+#
+
+import random
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: %s <seed> <calls>" % sys.argv[0])
+    random.seed(int(sys.argv[1]))
+    calls = int(sys.argv[2])
+
+    live = {}                           # id: (size, long lived)
+    free_ids = list(range(1, 65536))
+    out = []
+    for _ in range(calls):
+        r = random.random()
+        if (r < 0.52 or not live) and len(live) < 1500 and free_ids:
+            k = random.random()
+            if k < 0.35:
+                size = random.choice([1536, 1600, 1664])    # RX frames
+            elif k < 0.85:
+                size = random.randint(8, 256)               # small objects
+            elif k < 0.97:
+                size = random.randint(256, 2048)
+            else:
+                size = random.randint(2048, 8192)           # large buffers
+            bid = free_ids.pop(random.randrange(len(free_ids)))
+            live[bid] = (size, random.random() < 0.03)
+            out.append("a %x %d" % (bid, size))
+        elif r < 0.56 and live:
+            bid = random.choice(list(live))
+            size = max(8, int(live[bid][0] * random.uniform(0.5, 2)))
+            live[bid] = (size, live[bid][1])
+            out.append("r %x %d" % (bid, size))
+        else:
+            sample = random.sample(list(live), min(8, len(live)))
+            cands = [b for b in sample if not live[b][1] or random.random() < 0.05]
+            bid = cands[0] if cands else sample[0]
+            del live[bid]
+            free_ids.append(bid)
+            out.append("f %x" % bid)
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
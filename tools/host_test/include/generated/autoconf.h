@@ -0,0 +1,20 @@
+/*
+ * Configuration of the sources built on the host by tools/host_test, instead
+ * of the autoconf.h generated from .config for the target.
+ */
+#ifndef _HOST_TEST_AUTOCONF_H_
+#define _HOST_TEST_AUTOCONF_H_
+
+#define CONFIG_RT_THREAD_PRIORITY_MAX 32
+#define CONFIG_RT_TICK_PER_SECOND 1000
+#define CONFIG_RT_NAME_MAX 8
+#define CONFIG_RT_USING_SEMAPHORE 1
+
+#if defined(__LP64__)
+#define ARCH_CPU_64BIT
+#define CONFIG_RT_ALIGN_SIZE 8
+#else
+#define CONFIG_RT_ALIGN_SIZE 4
+#endif
+
+#endif /* _HOST_TEST_AUTOCONF_H_ */
@@ -0,0 +1,19 @@
+/*
+ * The interrupt mask of the target, for the host build of the sources under
+ * tools/host_test, instead of include/sys/interrupt.h. The host tests are
+ * single threaded, saving and restoring the mask is a no-op.
+ */
+#ifndef _SYS_INTERRUPT_H_
+#define _SYS_INTERRUPT_H_
+
+static __inline unsigned long arch_irq_save(void)
+{
+	return 0;
+}
+
+static __inline void arch_irq_restore(unsigned long flags)
+{
+	(void)flags;
+}
+
+#endif /* _SYS_INTERRUPT_H_ */
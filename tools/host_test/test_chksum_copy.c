@@ -0,0 +1,119 @@
+/*
+ * Check arch_chksum_copy() of lwIP arch/chksum_copy.c, the LWIP_CHKSUM_COPY
+ * of the port, against the generic inet_chksum() of core/inet_chksum.c,
+ * both built for the host.
+ *   - lengths 0..CHKSUM_TEST_LEN_MAX, odd ones included, every source and
+ *     destination alignment 0..7, the copy must match and the bytes around
+ *     the destination must be left untouched
+ *   - 65535 bytes of 0xff, the longest sum with the most carries
+ *   - random lengths up to 65535
+ *
+ * usage: test_chksum_copy [bench]
+ *   bench: also print the MB/s of arch_chksum_copy() and of memcpy() followed
+ *   by inet_chksum()
+ */
+
+#include "lwip/inet_chksum.h" /* first, its sys/endian.h replaces the host one */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define CHKSUM_TEST_LEN_MAX     600
+#define CHKSUM_TEST_RAND_CNT    2000
+#define CHKSUM_TEST_BUF_SIZE    (0x10000 + 16)
+#define CHKSUM_TEST_GUARD       0xee
+
+static u8_t g_src[CHKSUM_TEST_BUF_SIZE] __attribute__((aligned(8)));
+static u8_t g_dst[CHKSUM_TEST_BUF_SIZE] __attribute__((aligned(8)));
+
+static int g_fail;
+
+static void check(const char *name, u16_t len, int sa, int da)
+{
+	u16_t sum, ref;
+
+	memset(g_dst, CHKSUM_TEST_GUARD, (size_t)len + 16);
+	sum = arch_chksum_copy(g_dst + da, g_src + sa, len);
+	ref = (u16_t)~inet_chksum(g_src + sa, len);
+	if (sum != ref || memcmp(g_dst + da, g_src + sa, len) ||
+	    g_dst[da + len] != CHKSUM_TEST_GUARD ||
+	    (da && g_dst[da - 1] != CHKSUM_TEST_GUARD)) {
+		if (g_fail++ < 10)
+			printf("FAIL %s len %u src %d dst %d: sum %04x, inet_chksum %04x\n",
+			       name, len, sa, da, sum, ref);
+	}
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void bench(void)
+{
+	static const u16_t lens[] = { 20, 64, 536, 1460 };
+	uint64_t t, t_copy, t_ref, bytes;
+	uint32_t i, loop;
+	size_t k;
+	volatile u16_t sum;
+
+	printf("MB/s   len  chksum_copy  memcpy+inet_chksum\n");
+	for (k = 0; k < sizeof(lens) / sizeof(lens[0]); ++k) {
+		loop = 64 * 1024 * 1024 / (lens[k] + 16);
+		bytes = (uint64_t)loop * lens[k];
+
+		t = now_ns();
+		for (i = 0; i < loop; ++i)
+			sum = arch_chksum_copy(g_dst + 2, g_src + 2, lens[k]);
+		t_copy = now_ns() - t;
+
+		t = now_ns();
+		for (i = 0; i < loop; ++i) {
+			memcpy(g_dst + 2, g_src + 2, lens[k]);
+			sum = inet_chksum(g_dst + 2, lens[k]);
+		}
+		t_ref = now_ns() - t;
+
+		printf("       %4u %12u %19u\n", lens[k],
+		       t_copy ? (uint32_t)(bytes * 1000 / t_copy) : 0,
+		       t_ref ? (uint32_t)(bytes * 1000 / t_ref) : 0);
+	}
+	(void)sum;
+}
+
+int main(int argc, char **argv)
+{
+	u32_t len;
+	int sa, da, i;
+
+	srand(1);
+	for (i = 0; i < CHKSUM_TEST_BUF_SIZE; ++i)
+		g_src[i] = (u8_t)rand();
+	for (len = 0; len <= CHKSUM_TEST_LEN_MAX; ++len) {
+		for (sa = 0; sa < 8; ++sa) {
+			for (da = 0; da < 8; ++da)
+				check("small", (u16_t)len, sa, da);
+		}
+	}
+
+	memset(g_src, 0xff, sizeof(g_src));
+	for (sa = 0; sa < 4; ++sa) {
+		for (da = 0; da < 4; ++da)
+			check("0xff", 0xffff, sa, da);
+	}
+
+	for (i = 0; i < CHKSUM_TEST_BUF_SIZE; ++i)
+		g_src[i] = (u8_t)rand();
+	for (i = 0; i < CHKSUM_TEST_RAND_CNT; ++i)
+		check("random", (u16_t)(rand() % 0x10000), rand() % 8, rand() % 8);
+
+	printf("chksum_copy: %s\n", g_fail ? "FAILED" : "ok");
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+		bench();
+	return g_fail != 0;
+}
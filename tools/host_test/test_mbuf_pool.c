@@ -0,0 +1,332 @@
+/*
+ * Check the TX/RX mbuf pools of src/wlan/mbuf/mbuf_0_mem.c, mb_pool_get()
+ * and mb_pool_put(), built for the host with the heap counted.
+ *   - random gets and puts of both pools, sizes in and above the classes:
+ *     the blocks must not overlap, the heap held must stay under the TX, RX
+ *     and TXRX limits
+ *   - a get failed at a limit must succeed once blocks are put back
+ *   - mb_pool_shrink() must give every cached block back to the heap
+ *
+ * Then replay TCP traffic as iperf makes it, full frames one way and an ACK
+ * per two frames the other way, in bursts of 1 to 8 frames. Print the heap
+ * calls per 1000 packets, 2000 without the pools (a malloc and a free per
+ * packet), and the peak heap held.
+ *
+ * usage: test_mbuf_pool [bench]
+ *   bench: also print the ns per packet of the pools and of the host malloc
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "sys/mbuf_0.h"
+#include "mbuf_0_mem.h"
+
+#define POOL_TEST_FRAME     1678    /* a 1514 bytes frame with the target mbuf */
+#define POOL_TEST_ACK       218     /* a TCP ACK with the target mbuf */
+#define POOL_TEST_SIZE_MAX  2200    /* above the largest class */
+#define POOL_TEST_LIVE_MAX  64
+#define POOL_TEST_OPS       200000
+#define POOL_TEST_PACKETS   100000
+#define POOL_TEST_TX_MAX    (20 * 1024)
+#define POOL_TEST_RX_MAX    (20 * 1024)
+#define POOL_TEST_TXRX_MAX  (32 * 1024)
+
+/* the heap of the pools, mbuf_0_mem.c is built with malloc/free renamed */
+struct heap_hdr {
+	size_t size;
+	size_t pad;
+};
+
+static uint32_t g_heap_calls;
+static int32_t g_heap_held;
+static int32_t g_heap_held_max;
+static int32_t g_heap_fail_at;  /* fail a malloc when held would pass it */
+
+void *pool_test_malloc(size_t size)
+{
+	struct heap_hdr *h;
+
+	g_heap_calls++;
+	if (g_heap_fail_at && g_heap_held + (int32_t)size > g_heap_fail_at)
+		return NULL;
+	h = malloc(sizeof(*h) + size);
+	if (h == NULL)
+		return NULL;
+	h->size = size;
+	g_heap_held += size;
+	if (g_heap_held > g_heap_held_max)
+		g_heap_held_max = g_heap_held;
+	return h + 1;
+}
+
+void pool_test_free(void *ptr)
+{
+	struct heap_hdr *h;
+
+	if (ptr == NULL)
+		return;
+	g_heap_calls++;
+	h = (struct heap_hdr *)ptr - 1;
+	g_heap_held -= h->size;
+	free(h);
+}
+
+/* the scheduler lock of mbuf_malloc()/mbuf_free(), single threaded here */
+void OS_ThreadSuspendScheduler(void)
+{
+}
+
+void OS_ThreadResumeScheduler(void)
+{
+}
+
+struct block {
+	uint8_t *ptr;
+	int32_t size;
+	uint8_t flag;
+	uint8_t fill;
+};
+
+static struct block g_live[POOL_TEST_LIVE_MAX];
+static int g_fail;
+
+#define FAIL(fmt, arg...)                               \
+	do {                                                \
+		if (g_fail++ < 10)                              \
+			printf("FAIL " fmt "\n", ##arg);            \
+	} while (0)
+
+static uint8_t pool_flag(int tx)
+{
+	return tx ? MBUF_GET_FLAG_LIMIT_TX : MBUF_GET_FLAG_LIMIT_RX;
+}
+
+static void block_put(struct block *b)
+{
+	int32_t i;
+
+	for (i = 0; i < b->size; ++i) {
+		if (b->ptr[i] != b->fill) {
+			FAIL("block %p size %d overwritten at %d", (void *)b->ptr, b->size, i);
+			break;
+		}
+	}
+	mb_pool_put(b->ptr, b->flag, b->size);
+	b->ptr = NULL;
+}
+
+static int block_get(struct block *b, int tx, int32_t size, uint8_t fill)
+{
+	b->flag = pool_flag(tx);
+	b->ptr = mb_pool_get(b->flag, size);
+	if (b->ptr == NULL)
+		return -1;
+	b->size = size;
+	b->fill = fill;
+	memset(b->ptr, fill, size);
+	return 0;
+}
+
+static void test_random(void)
+{
+	struct block *b;
+	uint32_t i, fails = 0, retried = 0;
+	int tx;
+
+	g_heap_held_max = 0;
+	for (i = 0; i < POOL_TEST_OPS; ++i) {
+		b = &g_live[rand() % POOL_TEST_LIVE_MAX];
+		if (b->ptr) {
+			block_put(b);
+			continue;
+		}
+		tx = rand() & 1;
+		if (block_get(b, tx, 16 + rand() % POOL_TEST_SIZE_MAX, (uint8_t)i) == 0)
+			continue;
+
+		/* at a limit, it must succeed with the blocks of its pool put back */
+		fails++;
+		for (b = g_live; b < g_live + POOL_TEST_LIVE_MAX; ++b) {
+			if (b->ptr && b->flag == pool_flag(tx))
+				block_put(b);
+		}
+		b = &g_live[0];
+		if (b->ptr)
+			block_put(b);
+		if (block_get(b, tx, POOL_TEST_FRAME, (uint8_t)i) != 0)
+			FAIL("%s get failed with its pool empty", tx ? "tx" : "rx");
+		retried++;
+	}
+	if (g_heap_held_max > POOL_TEST_TXRX_MAX)
+		FAIL("heap held %d over the txrx limit %d", g_heap_held_max, POOL_TEST_TXRX_MAX);
+
+	for (b = g_live; b < g_live + POOL_TEST_LIVE_MAX; ++b) {
+		if (b->ptr)
+			block_put(b);
+	}
+	mb_pool_shrink();
+	if (g_heap_held != 0)
+		FAIL("heap held %d after shrink", g_heap_held);
+	printf("random: %u ops, %u failed at a limit, %u retried\n",
+	       POOL_TEST_OPS, fails, retried);
+}
+
+/* the TX and RX limits hold with no TXRX limit */
+static void test_limits(void)
+{
+	int32_t held_max = 0;
+	int tx, n;
+
+	mb_mem_set_limit(POOL_TEST_TX_MAX, POOL_TEST_RX_MAX, 0);
+	for (tx = 0; tx < 2; ++tx) {
+		g_heap_held_max = 0;
+		for (n = 0; n < POOL_TEST_LIVE_MAX; ++n) {
+			if (block_get(&g_live[n], tx, POOL_TEST_FRAME, (uint8_t)n) != 0)
+				break;
+		}
+		if (n == POOL_TEST_LIVE_MAX || n == 0)
+			FAIL("%s got %d frames under a %d limit", tx ? "tx" : "rx",
+			     n, POOL_TEST_TX_MAX);
+		if (g_heap_held_max > POOL_TEST_TX_MAX)
+			FAIL("%s held %d over its limit", tx ? "tx" : "rx", g_heap_held_max);
+		if (g_heap_held_max > held_max)
+			held_max = g_heap_held_max;
+		while (n > 0)
+			block_put(&g_live[--n]);
+		mb_pool_shrink();
+	}
+	mb_mem_set_limit(POOL_TEST_TX_MAX, POOL_TEST_RX_MAX, POOL_TEST_TXRX_MAX);
+	if (g_heap_held != 0)
+		FAIL("heap held %d after set limit", g_heap_held);
+	printf("limits: held max %d\n", held_max);
+}
+
+/* a failed heap malloc is not counted as held */
+static void test_heap_fail(void)
+{
+	struct block b;
+
+	g_heap_fail_at = 1;
+	if (block_get(&b, 1, POOL_TEST_FRAME, 0) == 0) {
+		FAIL("get succeeded with the heap failing");
+		block_put(&b);
+	}
+	g_heap_fail_at = 0;
+	if (block_get(&b, 1, POOL_TEST_FRAME, 0) != 0)
+		FAIL("get failed after a heap failure");
+	else
+		block_put(&b);
+	mb_pool_shrink();
+	if (g_heap_held != 0)
+		FAIL("heap held %d after a heap failure", g_heap_held);
+}
+
+typedef void *(*get_fn_t)(uint8_t flag, int32_t size);
+typedef void (*put_fn_t)(void *ptr, uint8_t flag, int32_t size);
+
+static void *heap_get(uint8_t flag, int32_t size)
+{
+	return pool_test_malloc(size);
+}
+
+static void heap_put(void *ptr, uint8_t flag, int32_t size)
+{
+	pool_test_free(ptr);
+}
+
+/*
+ * @tx: frames are sent, ACKs received. Return the packets, count the heap
+ * calls and the failed gets.
+ */
+static uint32_t replay_tcp(get_fn_t get, put_fn_t put, int tx, uint32_t *fails)
+{
+	void *frame[8], *ack[4];
+	uint32_t packets = 0;
+	int burst, i, k;
+
+	srand(7);
+	*fails = 0;
+	while (packets < POOL_TEST_PACKETS) {
+		burst = 1 + rand() % 8;
+		for (i = 0; i < burst; ++i) {
+			frame[i] = get(pool_flag(tx), POOL_TEST_FRAME);
+			if (frame[i] == NULL)
+				(*fails)++;
+		}
+		for (k = 0; k < (burst + 1) / 2; ++k) {
+			ack[k] = get(pool_flag(!tx), POOL_TEST_ACK);
+			if (ack[k] == NULL)
+				(*fails)++;
+		}
+		for (i = 0; i < burst; ++i) {
+			if (frame[i])
+				put(frame[i], pool_flag(tx), POOL_TEST_FRAME);
+		}
+		for (k = 0; k < (burst + 1) / 2; ++k) {
+			if (ack[k])
+				put(ack[k], pool_flag(!tx), POOL_TEST_ACK);
+		}
+		packets += burst + k;
+	}
+	return packets;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void replay(int bench)
+{
+	static const char * const name[2] = { "tcp rx", "tcp tx" };
+	uint32_t packets, fails, calls;
+	uint64_t t, t_pool, t_heap;
+	int tx;
+
+	printf("%-6s  packets  heap calls  per 1000  held max  failed", "");
+	printf(bench ? "  ns/packet pool  heap\n" : "\n");
+	for (tx = 0; tx < 2; ++tx) {
+		mb_pool_shrink();
+		g_heap_calls = 0;
+		g_heap_held_max = 0;
+		t = now_ns();
+		packets = replay_tcp(mb_pool_get, mb_pool_put, tx, &fails);
+		t_pool = now_ns() - t;
+		calls = g_heap_calls;
+		printf("%-6s  %7u  %10u  %4u.%02u  %8d  %6u", name[tx], packets, calls,
+		       (uint32_t)((uint64_t)calls * 1000 / packets),
+		       (uint32_t)((uint64_t)calls * 100000 / packets % 100),
+		       g_heap_held_max, fails);
+
+		if (bench) {
+			t = now_ns();
+			packets = replay_tcp(heap_get, heap_put, tx, &fails);
+			t_heap = now_ns() - t;
+			printf("  %14u  %4u", (uint32_t)(t_pool / packets),
+			       (uint32_t)(t_heap / packets));
+		}
+		printf("\n");
+	}
+	mb_pool_shrink();
+	mb_pool_info(1);
+}
+
+int main(int argc, char **argv)
+{
+	int bench = (argc > 1 && strcmp(argv[1], "bench") == 0);
+
+	srand(1);
+	mb_mem_set_limit(POOL_TEST_TX_MAX, POOL_TEST_RX_MAX, POOL_TEST_TXRX_MAX);
+	test_limits();
+	test_heap_fail();
+	test_random();
+	printf("mbuf_pool: %s\n", g_fail ? "FAILED" : "ok");
+	replay(bench);
+	return g_fail != 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Check __wrap_memcpy/__wrap_memmove/__wrap_memset of src/libc/wrap_mem.c
+ * against a byte by byte reference, built for the host (the C paths, the
+ * LDM/STM bursts are Thumb-2 only).
+ *   - memcpy and memset, sizes 0..MEM_TEST_SIZE_MAX, every destination and
+ *     source alignment 0..7, plus large sizes
+ *   - memmove, same sizes, every source alignment 0..3 and every overlap
+ *     offset -MEM_TEST_OVERLAP..MEM_TEST_OVERLAP between source and
+ *     destination
+ *   - the bytes around the destination must be left untouched
+ *
+ * usage: test_wrap_mem [bench]
+ *   bench: also print the MB/s of the wrappers and of the host libc
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+void *__wrap_memcpy(void *dst, const void *src, size_t n);
+void *__wrap_memmove(void *dst, const void *src, size_t n);
+void *__wrap_memset(void *s, int c, size_t n);
+
+#define MEM_TEST_SIZE_MAX   300
+#define MEM_TEST_OVERLAP    70
+#define MEM_TEST_BUF_SIZE   (64 * 1024)
+#define MEM_TEST_BASE       128 /* room for the guard bytes and overlaps */
+
+static uint8_t g_src[MEM_TEST_BUF_SIZE] __attribute__((aligned(8)));
+static uint8_t g_dst[MEM_TEST_BUF_SIZE] __attribute__((aligned(8)));
+static uint8_t g_ref[MEM_TEST_BUF_SIZE] __attribute__((aligned(8)));
+
+static int g_fail;
+
+static void buf_fill(uint8_t *buf, size_t size, uint32_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (uint8_t)(seed >> 16);
+	}
+}
+
+static void ref_copy(uint8_t *d, const uint8_t *s, size_t n)
+{
+	uint8_t tmp[MEM_TEST_BUF_SIZE];
+	size_t i;
+
+	for (i = 0; i < n; ++i)
+		tmp[i] = s[i];
+	for (i = 0; i < n; ++i)
+		d[i] = tmp[i];
+}
+
+static void check(const char *name, size_t n, int da, int sa, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; ++i) {
+		if (g_dst[i] != g_ref[i]) {
+			if (g_fail++ < 10)
+				printf("FAIL %s n %zu dst %d src %d: byte %zd\n", name, n,
+				       da, sa, (ssize_t)i - MEM_TEST_BASE - da);
+			return;
+		}
+	}
+}
+
+static void test_copy_set(size_t n, int da, int sa)
+{
+	size_t size = MEM_TEST_BASE * 2 + n + 8;
+
+	buf_fill(g_src, size, (uint32_t)(n * 64 + da * 8 + sa));
+	buf_fill(g_dst, size, 1);
+	memcpy(g_ref, g_dst, size);
+	ref_copy(g_ref + MEM_TEST_BASE + da, g_src + MEM_TEST_BASE + sa, n);
+	if (__wrap_memcpy(g_dst + MEM_TEST_BASE + da, g_src + MEM_TEST_BASE + sa, n)
+	    != g_dst + MEM_TEST_BASE + da)
+		g_fail++;
+	check("memcpy", n, da, sa, size);
+
+	memset(g_ref + MEM_TEST_BASE + da, 0xa5 + sa, n);
+	if (__wrap_memset(g_dst + MEM_TEST_BASE + da, 0xa5 + sa, n)
+	    != g_dst + MEM_TEST_BASE + da)
+		g_fail++;
+	check("memset", n, da, sa, size);
+}
+
+/* move n bytes at src alignment sa by off bytes */
+static void test_move(size_t n, int sa, int off)
+{
+	size_t size = MEM_TEST_BASE * 2 + n + 8;
+	uint8_t *s = g_dst + MEM_TEST_BASE + sa;
+
+	buf_fill(g_dst, size, (uint32_t)(n * 256 + sa * 128 + off));
+	memcpy(g_ref, g_dst, size);
+	ref_copy(g_ref + MEM_TEST_BASE + sa + off, g_ref + MEM_TEST_BASE + sa, n);
+	if (__wrap_memmove(s + off, s, n) != s + off)
+		g_fail++;
+	check("memmove", n, off, sa, size);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+typedef void *(*copy_fn_t)(void *dst, const void *src, size_t n);
+
+static uint32_t bench_copy(copy_fn_t fn, size_t n, int da, int sa)
+{
+	uint64_t t, bytes = 0;
+	uint32_t i, loop = (uint32_t)(64 * 1024 * 1024 / (n + 16));
+
+	t = now_ns();
+	for (i = 0; i < loop; ++i) {
+		fn(g_dst + MEM_TEST_BASE + da, g_src + MEM_TEST_BASE + sa, n);
+		__asm volatile("" : : : "memory");
+		bytes += n;
+	}
+	t = now_ns() - t;
+	return t ? (uint32_t)(bytes * 1000 / t) : 0;
+}
+
+static void bench(void)
+{
+	static const size_t sizes[] = { 16, 64, 256, 1460, 4096 };
+	size_t i;
+	int da, sa;
+
+	printf("MB/s   size dst src   wrap   libc\n");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		for (da = 0; da < 4; da += 3) {
+			for (sa = 0; sa < 4; ++sa) {
+				printf("memcpy %4zu %3d %3d %6u %6u\n", sizes[i], da, sa,
+				       bench_copy(__wrap_memcpy, sizes[i], da, sa),
+				       bench_copy(memcpy, sizes[i], da, sa));
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t n;
+	int da, sa, off;
+
+	for (n = 0; n <= MEM_TEST_SIZE_MAX; ++n) {
+		for (da = 0; da < 8; ++da) {
+			for (sa = 0; sa < 8; ++sa)
+				test_copy_set(n, da, sa);
+		}
+		for (sa = 0; sa < 4; ++sa) {
+			for (off = -MEM_TEST_OVERLAP; off <= MEM_TEST_OVERLAP; ++off)
+				test_move(n, sa, off);
+		}
+	}
+	for (n = 1024; n <= MEM_TEST_BUF_SIZE - MEM_TEST_BASE * 2 - 8; n = n * 2 + 13) {
+		for (da = 0; da < 4; ++da) {
+			for (sa = 0; sa < 4; ++sa)
+				test_copy_set(n, da, sa);
+			test_move(n, da, -37);
+			test_move(n, da, 41);
+		}
+	}
+
+	printf("wrap_mem: %s\n", g_fail ? "FAILED" : "ok");
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+		bench();
+	return g_fail != 0;
+}
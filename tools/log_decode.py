@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+#
+# Decode the output of the binary log messages (CONFIG_LIBC_STDIO_ASYNC_BINARY,
+# src/libc/wrap_stdio.c).
+#
+#   log_decode.py <app.elf> [capture]
+#
+# The capture is the raw UART output, read from stdin if not given. Text is
+# passed through, each binary message is formatted with its format string read
+# from the elf file. A message is "0x00, length (16 bits), format address
+# (32 bits), arguments", see stdio_bin_encode().
+#
+# Needs python3 only.
+
+import re
+import struct
+import sys
+
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+CONV = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|L|j|z|t|q)?(.)")
+
+
+class Elf(object):
+    """the allocated sections of a 32 bits little endian elf file"""
+
+    def __init__(self, path):
+        data = open(path, "rb").read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a 32 bits little endian elf" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (name, stype, flags, addr, offset,
+             size) = struct.unpack_from("<6I", data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and stype != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b"\0", addr - base)
+                return data[addr - base:end].decode("utf-8", "replace")
+        return None
+
+
+def format_message(fmt, args):
+    """format like printf, args are packed as stdio_bin_encode() does"""
+    out = []
+    pos = 0
+    last = 0
+    for m in CONV.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        spec = "%" + flags
+        vals = []
+        for part, prefix in ((width, ""), (prec, ".")):
+            if part == "*":
+                vals.append(struct.unpack_from("<i", args, pos)[0])
+                pos += 4
+                spec += prefix + "*"
+            elif part is not None:
+                spec += prefix + part
+        wide = length in ("ll", "L", "j", "q")
+        if conv in "diuoxXc":
+            if wide:
+                v, = struct.unpack_from("<q" if conv in "di" else "<Q", args, pos)
+                pos += 8
+            else:
+                v, = struct.unpack_from("<i" if conv in "di" else "<I", args, pos)
+                pos += 4
+            if conv == "c":
+                v = chr(v & 0xFF)
+            spec += "d" if conv in "iu" else conv
+        elif conv == "p":
+            v, = struct.unpack_from("<I", args, pos)
+            pos += 4
+            spec += "s"
+            v = "0x%x" % v
+        elif conv in "eEfFgGaA":
+            v, = struct.unpack_from("<d", args, pos)
+            pos += 8
+            if conv in "aA":
+                spec += "s"
+                v = v.hex()
+            else:
+                spec += conv
+        elif conv == "s":
+            end = args.index(b"\0", pos)
+            v = args[pos:end].decode("utf-8", "replace")
+            pos = end + 1
+            spec += "s"
+        elif conv == "n":
+            continue
+        else:
+            raise ValueError("conversion %%%s" % conv)
+        out.append(spec % tuple(vals + [v]))
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode(elf, data, write):
+    pos = 0
+    while pos < len(data):
+        end = data.find(b"\0", pos)
+        if end < 0:
+            end = len(data)
+        write(data[pos:end].decode("utf-8", "replace"))
+        pos = end
+        if pos + 7 > len(data):
+            break
+        length, addr = struct.unpack_from("<HI", data, pos + 1)
+        args = data[pos + 7:pos + 3 + length]
+        pos += 3 + length
+        fmt = elf.string(addr)
+        if fmt is None:
+            write("<log: bad format address 0x%08x>\n" % addr)
+            continue
+        try:
+            write(format_message(fmt, args))
+        except (ValueError, struct.error) as e:
+            write("<log: %s: %s>\n" % (fmt.strip(), e))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit("usage: %s <app.elf> [capture]" % sys.argv[0])
+    elf = Elf(sys.argv[1])
+    if len(sys.argv) == 3:
+        data = open(sys.argv[2], "rb").read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(elf, data, sys.stdout.write)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+#
+# Generate and apply OTA delta images (OTA_OPT_DELTA, src/ota/ota_delta.h).
+#
+#   ota_delta.py diff  <old.img> <new.img> <patch>
+#   ota_delta.py apply <old.img> <patch> <new.img>
+#
+# The images are xr_system.img files. The bootloader is stripped (its size is
+# read from the boot section header, or given by --skip), since the device
+# keeps only the image area. "apply" writes the image area, without bootloader.
+# "diff" applies the patch it made and checks the result before saving it.
+#
+# Needs python3 (lzma module).
+
+import argparse
+import lzma
+import struct
+import sys
+import zlib
+
+OTA_DELTA_MAGIC = 0x544C4458  # XDLT
+OTA_DELTA_VERSION = 1
+OTA_DELTA_DICT_MAX = 32 * 1024
+
+HEADER = struct.Struct("<6I")   # ota_delta_header_t
+CTRL = struct.Struct("<IIi")    # ota_delta_ctrl_t
+
+IMAGE_MAGIC_NUMBER = 0x48495741
+IMAGE_BOOT_ID = 0xA5FF5A00
+IMAGE_INVALID_ADDR = 0xFFFFFFFF
+SECTION_HEADER = struct.Struct("<IIHHIIIIIII6I")
+
+MATCH_KEY = 8       # bytes hashed to find a match
+MATCH_STEP = 4      # old image is indexed every MATCH_STEP bytes
+MATCH_GAIN = 16     # bytes a new match must win over the current alignment
+
+
+def bootloader_size(img):
+    """size of the bootloader at the start of an xr_system.img"""
+    if len(img) < SECTION_HEADER.size:
+        return 0
+    sh = SECTION_HEADER.unpack_from(img, 0)
+    magic, next_addr, sid, priv5 = sh[0], sh[9], sh[10], sh[16]
+    if magic != IMAGE_MAGIC_NUMBER or sid != IMAGE_BOOT_ID:
+        return 0
+    return next_addr if priv5 == IMAGE_INVALID_ADDR else priv5
+
+
+def find_alignments(old, new):
+    """list of (new_pos, old_pos), where new starts to follow old from old_pos"""
+    index = {}
+    for p in range(0, len(old) - MATCH_KEY + 1, MATCH_STEP):
+        index.setdefault(old[p:p + MATCH_KEY], p)
+
+    aligns = [(0, 0)]
+    new_pos, old_pos = 0, 0
+    j = 0
+    while j < len(new) - MATCH_KEY:
+        o = old_pos + j - new_pos
+        if o < len(old) and old[o] == new[j]:
+            j += 1
+            continue
+        p = index.get(new[j:j + MATCH_KEY])
+        if p is None or p == o:
+            j += 1
+            continue
+
+        length = MATCH_KEY
+        while (j + length < len(new) and p + length < len(old) and
+               new[j + length] == old[p + length]):
+            length += 1
+        cur = sum(1 for k in range(length)
+                  if o + k < len(old) and old[o + k] == new[j + k])
+        if length - cur < MATCH_GAIN:
+            j += 1
+            continue
+
+        back = 0
+        while (j - back > new_pos and p - back > 0 and
+               new[j - back - 1] == old[p - back - 1]):
+            back += 1
+        new_pos, old_pos = j - back, p - back
+        aligns.append((new_pos, old_pos))
+        j += length
+    return aligns
+
+
+def forward_length(old, new, new_pos, old_pos, size):
+    """bytes of new[new_pos:] worth coding as diff against old[old_pos:]"""
+    score = best = length = 0
+    size = min(size, len(old) - old_pos)
+    for k in range(size):
+        if old[old_pos + k] == new[new_pos + k]:
+            score += 1
+        if score * 2 - (k + 1) > best * 2 - length:
+            best, length = score, k + 1
+    return length
+
+
+def diff(old, new):
+    aligns = find_alignments(old, new) + [(len(new), 0)]
+
+    # (old_pos, add, extra, new_pos) of each block
+    blocks = []
+    pos = 0
+    for (new_pos, old_pos), (new_end, _) in zip(aligns, aligns[1:]):
+        if new_pos == new_end:
+            continue
+        add = forward_length(old, new, new_pos, old_pos, new_end - new_pos)
+        if add == 0:
+            old_pos = pos
+        blocks.append((old_pos, add, new_end - new_pos - add, new_pos))
+        pos = old_pos + add
+    if blocks and blocks[0][0] != 0:
+        blocks.insert(0, (0, 0, 0, 0))  # the device starts at old position 0
+
+    out = bytearray(HEADER.pack(OTA_DELTA_MAGIC, OTA_DELTA_VERSION,
+                                len(old), zlib.crc32(old),
+                                len(new), zlib.crc32(new)))
+    for i, (old_pos, add, extra, new_pos) in enumerate(blocks):
+        next_old = blocks[i + 1][0] if i + 1 < len(blocks) else old_pos + add
+        out += CTRL.pack(add, extra, next_old - old_pos - add)
+        out += bytes((new[new_pos + k] - old[old_pos + k]) & 0xFF
+                     for k in range(add))
+        out += new[new_pos + add:new_pos + add + extra]
+    return bytes(out)
+
+
+def apply(old, patch):
+    """apply a decoded patch, the same as src/ota/ota_delta.c"""
+    magic, version, old_size, old_crc, new_size, new_crc = HEADER.unpack_from(patch, 0)
+    if magic != OTA_DELTA_MAGIC or version != OTA_DELTA_VERSION:
+        raise ValueError("bad patch, magic %#x, version %u" % (magic, version))
+    if old_size > len(old) or zlib.crc32(old[:old_size]) != old_crc:
+        raise ValueError("patch is not for this old image")
+
+    new = bytearray()
+    pos = HEADER.size
+    old_pos = 0
+    while len(new) < new_size:
+        add, extra, seek = CTRL.unpack_from(patch, pos)
+        pos += CTRL.size
+        if (len(new) + add + extra > new_size or old_pos + add > old_size):
+            raise ValueError("bad ctrl at %u" % pos)
+        new += bytes((old[old_pos + k] + patch[pos + k]) & 0xFF
+                     for k in range(add))
+        pos += add
+        new += patch[pos:pos + extra]
+        pos += extra
+        old_pos += add + seek
+        if old_pos < 0 or old_pos > old_size:
+            raise ValueError("bad seek at %u" % pos)
+    if pos != len(patch):
+        raise ValueError("data after the end of patch")
+    if zlib.crc32(new) != new_crc:
+        raise ValueError("new image crc mismatch")
+    return bytes(new)
+
+
+def compress(data):
+    filters = [{"id": lzma.FILTER_LZMA2,
+                "preset": 9 | lzma.PRESET_EXTREME,
+                "dict_size": OTA_DELTA_DICT_MAX}]
+    return lzma.compress(data, format=lzma.FORMAT_XZ, check=lzma.CHECK_CRC32,
+                         filters=filters)
+
+
+def strip(img, skip):
+    return img[bootloader_size(img) if skip is None else skip:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OTA delta image tool")
+    parser.add_argument("--skip", type=lambda x: int(x, 0), default=None,
+                        help="bootloader size, read from the image by default")
+    sub = parser.add_subparsers(dest="cmd")
+    p = sub.add_parser("diff", help="generate a patch")
+    p.add_argument("old")
+    p.add_argument("new")
+    p.add_argument("patch")
+    p = sub.add_parser("apply", help="apply a patch")
+    p.add_argument("old")
+    p.add_argument("patch")
+    p.add_argument("new")
+    args = parser.parse_args()
+
+    if args.cmd == "diff":
+        old = strip(open(args.old, "rb").read(), args.skip)
+        new = strip(open(args.new, "rb").read(), args.skip)
+        raw = diff(old, new)
+        if apply(old, raw) != new:
+            sys.exit("self check failed")
+        patch = compress(raw)
+        if apply(old, lzma.decompress(patch)) != new:
+            sys.exit("self check failed")
+        open(args.patch, "wb").write(patch)
+        print("%s: %u -> %u bytes, patch %u bytes" %
+              (args.patch, len(old), len(new), len(patch)))
+    elif args.cmd == "apply":
+        old = strip(open(args.old, "rb").read(), args.skip)
+        new = apply(old, lzma.decompress(open(args.patch, "rb").read()))
+        open(args.new, "wb").write(new)
+        print("%s: %u bytes" % (args.new, len(new)))
+    else:
+        parser.print_help()
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+# Decode the output of "thread prof dump" (project/common/cmd/cmd_thread.c)
+# into csv, one row per thread and dump, for plotting the stack usage and the
+# scheduling latency over time.
+#
+#   thread_prof.py [capture] > prof.csv
+#
+# The capture is the UART output, read from stdin if not given. It may hold
+# several dumps and any other text, only the "@tprof <hex>" lines are used.
+# A dump is a header (magic "TPRF", version, count, record size, time in ms)
+# followed by count records, see struct thread_prof_hdr/thread_prof_rec.
+#
+# Needs python3 only.
+
+import csv
+import struct
+import sys
+
+MAGIC = 0x46525054
+VERSION = 1
+
+HDR = struct.Struct("<IBBHI")
+REC = struct.Struct("<8sBcH6I")
+
+FIELDS = ("time_ms", "name", "prio", "state", "stack_size", "stack_free_min",
+          "stack_used_max", "runs", "preempts", "lat_max_us", "lat_avg_us")
+
+
+def records(lines):
+    """yield (time_ms, record) for each record of each complete dump"""
+    time_ms = None
+    left = 0
+    for line in lines:
+        pos = line.find("@tprof ")
+        if pos < 0:
+            continue
+        try:
+            data = bytes.fromhex(line[pos + 7:].strip())
+        except ValueError:
+            left = 0
+            continue
+        if left == 0:
+            if len(data) < HDR.size:
+                continue
+            magic, version, count, rec_size, time_ms = HDR.unpack_from(data)
+            if magic != MAGIC or version != VERSION or rec_size < REC.size:
+                sys.stderr.write("thread_prof: bad header %s\n" % data.hex())
+                continue
+            left = count
+            continue
+        left -= 1
+        if len(data) < REC.size:
+            sys.stderr.write("thread_prof: short record at %u ms\n" % time_ms)
+            continue
+        yield time_ms, REC.unpack_from(data)
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit("usage: %s [capture]" % sys.argv[0])
+    if len(sys.argv) == 2:
+        lines = open(sys.argv[1], "r", errors="replace")
+    else:
+        lines = sys.stdin
+    out = csv.writer(sys.stdout)
+    out.writerow(FIELDS)
+    for time_ms, rec in records(lines):
+        (name, prio, state, _, stack_size, stack_free_min, runs, preempts,
+         lat_max, lat_avg) = rec
+        out.writerow((time_ms, name.rstrip(b"\0").decode("ascii", "replace"),
+                      prio, state.decode("ascii", "replace"), stack_size,
+                      stack_free_min, stack_size - stack_free_min, runs,
+                      preempts, lat_max, lat_avg))
+
+
+if __name__ == "__main__":
+    main()